@@ -0,0 +1,139 @@
+/*
+ * Title: Allocation counting
+ * Description: Replacement global operator new and delete that count, per subsystem,
+ *      declared in Allocations.h. The aligned forms are left to the standard library; nothing
+ *      in the game allocates over-aligned types on the heap.
+*/
+
+#include "Allocations.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// The counters of one subsystem, on a cache line of their own
+struct alignas(64) SubsystemCounters {
+    std::atomic<uint64_t> allocations{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+    std::atomic<uint64_t> frees{ 0 };
+};
+
+const char* const SUBSYSTEM_NAMES[ALLOCATION_SUBSYSTEMS] = { "other", "input", "tick", "net", "render", "hud" };
+
+SubsystemCounters counters[ALLOCATION_SUBSYSTEMS];
+// A plain byte, so reading it in operator new needs no thread-local constructor
+thread_local AllocationSubsystem currentSubsystem = ALLOCATIONS_OTHER;
+AllocationCounts frameStart[ALLOCATION_SUBSYSTEMS];
+
+void* countedAllocate(size_t size) {
+    SubsystemCounters& subsystem = counters[currentSubsystem];
+    subsystem.allocations.fetch_add(1, std::memory_order_relaxed);
+    subsystem.bytes.fetch_add(size, std::memory_order_relaxed);
+    return malloc(size != 0 ? size : 1);
+}
+
+void countedFree(void* pointer) {
+    if (pointer != nullptr) {
+        counters[currentSubsystem].frees.fetch_add(1, std::memory_order_relaxed);
+        free(pointer);
+    }
+}
+
+}
+
+AllocationCounts allocationCounts(AllocationSubsystem subsystem) {
+    AllocationCounts counts;
+    counts.allocations = counters[subsystem].allocations.load(std::memory_order_relaxed);
+    counts.bytes = counters[subsystem].bytes.load(std::memory_order_relaxed);
+    counts.frees = counters[subsystem].frees.load(std::memory_order_relaxed);
+    return counts;
+}
+
+const char* allocationSubsystemName(AllocationSubsystem subsystem) {
+    return subsystem < ALLOCATION_SUBSYSTEMS ? SUBSYSTEM_NAMES[subsystem] : "?";
+}
+
+/*
+ * This function closes a frame of allocation counts
+ * @return what each subsystem allocated since the last call, or since the program started
+*/
+
+AllocationFrame allocationEndFrame() {
+    AllocationFrame frame;
+    for (int i = 0; i < ALLOCATION_SUBSYSTEMS; i++) {
+        AllocationCounts now = allocationCounts(static_cast<AllocationSubsystem>(i));
+        frame.allocations[i] = now.allocations - frameStart[i].allocations;
+        frame.bytes[i] = now.bytes - frameStart[i].bytes;
+        frame.total += frame.allocations[i];
+        frameStart[i] = now;
+    }
+    return frame;
+}
+
+AllocationSubsystem allocationSubsystem() {
+    return currentSubsystem;
+}
+
+AllocationScope::AllocationScope(AllocationSubsystem subsystem) : previous(currentSubsystem) {
+    currentSubsystem = subsystem;
+}
+
+AllocationScope::~AllocationScope() {
+    currentSubsystem = previous;
+}
+
+AllocationCounts allocationCounts() {
+    AllocationCounts counts;
+    for (int i = 0; i < ALLOCATION_SUBSYSTEMS; i++) {
+        AllocationCounts subsystem = allocationCounts(static_cast<AllocationSubsystem>(i));
+        counts.allocations += subsystem.allocations;
+        counts.bytes += subsystem.bytes;
+        counts.frees += subsystem.frees;
+    }
+    return counts;
+}
+
+void* operator new(size_t size) {
+    void* pointer = countedAllocate(size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    countedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    countedFree(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    countedFree(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    countedFree(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    countedFree(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    countedFree(pointer);
+}
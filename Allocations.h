@@ -0,0 +1,64 @@
+/*
+ * Title: Allocation counting
+ * Description: Counts every heap allocation the program makes through operator new, which
+ *      Allocations.cpp replaces with a version that counts and then calls malloc. Linking
+ *      Allocations.cpp into a program is all it takes to count. The counters are relaxed
+ *      atomics, so any thread may allocate.
+ *
+ *      Allocations are also counted per subsystem: ALLOCATION_SCOPE(ALLOCATIONS_TICK) charges
+ *      whatever the calling thread allocates until the end of the enclosing scope to the tick.
+ *      The subsystem is kept per thread, so work a tick hands to a worker thread is charged to
+ *      whatever that thread is in, ALLOCATIONS_OTHER unless it says otherwise.
+ *      allocationEndFrame() gives the counts of each subsystem since it was last called, which
+ *      is how the game finds a frame that allocated and who did it.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+enum AllocationSubsystem : uint8_t {
+    ALLOCATIONS_OTHER,
+    ALLOCATIONS_INPUT,
+    ALLOCATIONS_TICK,
+    ALLOCATIONS_NET,
+    ALLOCATIONS_RENDER,
+    ALLOCATIONS_HUD,
+    ALLOCATION_SUBSYSTEMS
+};
+
+struct AllocationCounts {
+    uint64_t allocations = 0;             // since the program started
+    uint64_t bytes = 0;
+    uint64_t frees = 0;
+};
+
+// What each subsystem allocated between two calls of allocationEndFrame
+struct AllocationFrame {
+    uint64_t allocations[ALLOCATION_SUBSYSTEMS] = {};
+    uint64_t bytes[ALLOCATION_SUBSYSTEMS] = {};
+    uint64_t total = 0;
+};
+
+AllocationCounts allocationCounts();
+AllocationCounts allocationCounts(AllocationSubsystem subsystem);
+const char* allocationSubsystemName(AllocationSubsystem subsystem);
+// Closes the frame: returns the allocations since the last call. Call from one thread.
+AllocationFrame allocationEndFrame();
+AllocationSubsystem allocationSubsystem();
+
+// Charges the calling thread's allocations to a subsystem until it goes out of scope
+class AllocationScope {
+public:
+    explicit AllocationScope(AllocationSubsystem subsystem);
+    ~AllocationScope();
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    AllocationSubsystem previous;
+};
+
+#define ALLOCATION_JOIN2(a, b) a##b
+#define ALLOCATION_JOIN(a, b) ALLOCATION_JOIN2(a, b)
+#define ALLOCATION_SCOPE(subsystem) AllocationScope ALLOCATION_JOIN(allocationScope, __LINE__)(subsystem)
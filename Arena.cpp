@@ -0,0 +1,488 @@
+/*
+ * Title: Arena mode
+ * Description: Implementation of the many-snake arena declared in Arena.h.
+*/
+
+#include "Arena.h"
+#include "GameTask.h"
+#include <algorithm>
+
+// Forward declarations of helpers used only inside this file
+static uint32_t nextRandom(uint32_t& state);
+static bool spawnSnake(ArenaState& arena, int index);
+static void spawnFood(ArenaState& arena, int index);
+static GameTask respawnLater(ArenaState& arena, int index);
+static Direction botDirection(ArenaState& arena, int index);
+
+static uint32_t cellIndex(const ArenaState& arena, ArenaCell cell) {
+    return static_cast<uint32_t>(cell.y) * arena.config.width + cell.x;
+}
+
+static bool inside(const ArenaState& arena, int x, int y) {
+    return x >= 0 && y >= 0 && x < arena.config.width && y < arena.config.height;
+}
+
+// Every grid write goes through these two so the free cell counts stay right
+static void occupyCell(ArenaState& arena, ArenaCell cell, uint32_t snake) {
+    uint32_t& entry = arena.grid[cellIndex(arena, cell)];
+    if (entry == 0) {
+        arena.freeCells.occupy(cell);
+    }
+    entry = snake;
+    arena.changed.push_back(cell);
+}
+
+static void releaseCell(ArenaState& arena, ArenaCell cell) {
+    uint32_t& entry = arena.grid[cellIndex(arena, cell)];
+    if (entry != 0) {
+        arena.freeCells.release(cell);
+        arena.changed.push_back(cell);
+    }
+    entry = 0;
+}
+
+static ArenaCell stepCell(ArenaCell cell, Direction direction) {
+    switch (direction) {
+    case UP: cell.y++; break;
+    case DOWN: cell.y--; break;
+    case LEFT: cell.x--; break;
+    case RIGHT: cell.x++; break;
+    }
+    return cell;
+}
+
+/*
+ * This function puts a new head on a snake, dropping the tail unless it grows
+*/
+
+static void pushHead(ArenaSnake& snake, ArenaCell cell, bool grow) {
+    if (grow && snake.length == snake.ring.size()) {
+        // full: unroll into a ring twice the size with the head at index 0
+        std::vector<ArenaCell> larger(snake.ring.size() * 2);
+        for (uint32_t i = 0; i < snake.length; i++) {
+            larger[i] = snake.segment(i);
+        }
+        snake.ring.swap(larger);
+        snake.head = 0;
+    }
+    snake.head = (snake.head - 1) & (snake.ring.size() - 1);
+    snake.ring[snake.head] = cell;
+    if (grow) {
+        snake.length++;
+    }
+}
+
+/*
+ * This function sets up an arena with every snake and food item placed at random
+ * @param arena: the arena to reset
+ * @param config: board size, number of snakes and food, random seed
+*/
+
+void initArena(ArenaState& arena, const ArenaConfig& config) {
+    arena.config = config;
+    arena.grid.assign(size_t(config.width) * config.height, 0);
+    arena.freeCells.init(config.width, config.height);
+    arena.rngState = config.seed != 0 ? config.seed : 0x9E3779B9u;
+    arena.tick = 0;
+    arena.timers.reset(0);
+    arena.changed.clear();
+    arena.snakes.assign(config.snakeCount, ArenaSnake());
+    arena.moves.assign(config.snakeCount, ArenaMove());
+    for (int i = 0; i < config.snakeCount; i++) {
+        arena.snakes[i].random = nextRandom(arena.rngState) | 1;
+        if (!spawnSnake(arena, i) && !(i == 0 && config.player)) {
+            respawnLater(arena, i);
+        }
+    }
+    arena.food.init(config.width, config.height, config.foodCount);
+    arena.foodTaken.assign(config.foodCount, -1);
+    arena.foodExpiry.assign(config.foodCount, 0);
+    for (int i = 0; i < config.foodCount; i++) {
+        spawnFood(arena, i);
+    }
+}
+
+/*
+ * This function advances the arena by one tick; see Arena.h for the phases
+ * @param arena: the arena to advance
+ * @param playerInput: direction for snake 0 when it is the player's
+ * @param pool: threads for the parallel phases; the result does not depend on its size
+*/
+
+void stepArena(ArenaState& arena, Direction playerInput, WorkerPool& pool) {
+    const size_t count = arena.snakes.size();
+    const size_t grain = 32;
+    arena.changed.clear();
+
+    // 1. propose: every snake reads the state from before the tick and writes only its own move
+    pool.parallelFor(count, grain, [&arena, playerInput](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            ArenaSnake& snake = arena.snakes[i];
+            ArenaMove& move = arena.moves[i];
+            move = ArenaMove();
+            if (!snake.alive) {
+                continue;
+            }
+            if (i == 0 && arena.config.player) {
+                move.direction = isOppositeDirection(snake.direction, playerInput) ? snake.direction : playerInput;
+            }
+            else {
+                move.direction = botDirection(arena, static_cast<int>(i));
+            }
+            move.target = stepCell(snake.segment(0), move.direction);
+            if (inside(arena, move.target.x, move.target.y)) {
+                move.food = arena.food.findAt(move.target);
+            }
+        }
+    });
+
+    // 2. claim: snakes heading for the same cell both crash
+    arena.claims.clear();
+    for (size_t i = 0; i < count; i++) {
+        const ArenaMove& move = arena.moves[i];
+        if (arena.snakes[i].alive && inside(arena, move.target.x, move.target.y)) {
+            arena.claims.push_back((uint64_t(cellIndex(arena, move.target)) << 32) | i);
+        }
+    }
+    std::sort(arena.claims.begin(), arena.claims.end());
+    for (size_t c = 1; c < arena.claims.size(); c++) {
+        if ((arena.claims[c] >> 32) == (arena.claims[c - 1] >> 32)) {
+            arena.moves[arena.claims[c] & 0xFFFFFFFFu].blocked = true;
+            arena.moves[arena.claims[c - 1] & 0xFFFFFFFFu].blocked = true;
+        }
+    }
+
+    // 3. resolve: a target is free if nobody is there or the tail there moves away this tick
+    pool.parallelFor(count, grain, [&arena](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            ArenaMove& move = arena.moves[i];
+            if (!arena.snakes[i].alive) {
+                continue;
+            }
+            if (move.blocked || !inside(arena, move.target.x, move.target.y)) {
+                move.dies = true;
+                continue;
+            }
+            uint32_t occupant = arena.grid[cellIndex(arena, move.target)];
+            if (occupant != 0) {
+                const ArenaSnake& other = arena.snakes[occupant - 1];
+                bool tailLeaves = other.pendingGrowth == 0 && other.tail().x == move.target.x && other.tail().y == move.target.y;
+                move.dies = !tailLeaves;
+            }
+        }
+    });
+
+    // 4. apply, in snake order. Crashed bodies and leaving tails are cleared before any head is
+    // written, so the order within each step doesn't matter.
+    for (size_t i = 0; i < count; i++) {
+        ArenaSnake& snake = arena.snakes[i];
+        if (!snake.alive || !arena.moves[i].dies) {
+            continue;
+        }
+        for (uint32_t s = 0; s < snake.length; s++) {
+            releaseCell(arena, snake.segment(s));
+        }
+        snake.alive = false;
+        snake.diedAt = arena.tick;
+        if (!(i == 0 && arena.config.player)) {
+            respawnLater(arena, static_cast<int>(i));
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        ArenaSnake& snake = arena.snakes[i];
+        if (snake.alive && snake.pendingGrowth == 0) {
+            releaseCell(arena, snake.tail());
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        ArenaSnake& snake = arena.snakes[i];
+        const ArenaMove& move = arena.moves[i];
+        if (!snake.alive) {
+            continue;
+        }
+        bool grow = snake.pendingGrowth > 0;
+        pushHead(snake, move.target, grow);
+        if (grow) {
+            snake.pendingGrowth--;
+        }
+        snake.direction = move.direction;
+        occupyCell(arena, move.target, static_cast<uint32_t>(i + 1));
+    }
+
+    // food goes to the lowest numbered snake that reached it, then moves somewhere else
+    std::fill(arena.foodTaken.begin(), arena.foodTaken.end(), -1);
+    for (size_t i = 0; i < count; i++) {
+        ArenaSnake& snake = arena.snakes[i];
+        int food = arena.moves[i].food;
+        if (!snake.alive || food < 0 || arena.foodTaken[food] >= 0) {
+            continue;
+        }
+        arena.foodTaken[food] = static_cast<int>(i);
+        bool big = arena.food.item(food).big;
+        snake.pendingGrowth += big ? BIG_FOOD_GROWTH : SMALL_FOOD_GROWTH;
+        snake.score += big ? 2 : 1;
+        spawnFood(arena, food);
+    }
+
+    // timed events: dead bots coming back, big food moving on. They fire in the order they
+    // were scheduled, on the main thread, so they are as deterministic as the rest.
+    arena.tick++;
+    arena.timers.advanceTo(arena.tick);
+}
+
+/*
+ * This function brings a dead bot back ARENA_RESPAWN_TICKS after it crashed, or on the first
+ * tick after that with room for it. The player's snake is never respawned.
+*/
+
+static GameTask respawnLater(ArenaState& arena, int index) {
+    co_await ticks(ARENA_RESPAWN_TICKS);
+    while (!spawnSnake(arena, index)) {
+        co_await ticks(1);
+    }
+}
+
+/*
+ * This function counts free cells in a straight line from a cell
+ * @param limit: stop counting here
+*/
+
+static int freeRun(const ArenaState& arena, ArenaCell cell, Direction direction, int limit) {
+    int run = 0;
+    while (run < limit) {
+        cell = stepCell(cell, direction);
+        if (!inside(arena, cell.x, cell.y) || arena.grid[cellIndex(arena, cell)] != 0) {
+            break;
+        }
+        run++;
+    }
+    return run;
+}
+
+/*
+ * This function steers a bot: head for the nearest food, don't run into anything close, and
+ * turn at random now and then. It only writes to the bot's own snake, so bots can think in
+ * parallel.
+*/
+
+static Direction botDirection(ArenaState& arena, int index) {
+    ArenaSnake& snake = arena.snakes[index];
+    ArenaCell head = snake.segment(0);
+
+    // look for food within 8 buckets now and then; food that was eaten meanwhile just
+    // moved somewhere else, which is fine for a bot
+    if (snake.target < 0 || (arena.tick + index) % 32 == 0) {
+        snake.target = arena.food.findNear(head, 8);
+    }
+
+    Direction candidates[4];
+    int candidateCount = 0;
+    if (snake.target >= 0) {
+        ArenaCell goal = arena.food.item(snake.target).cell;
+        int dx = goal.x - head.x, dy = goal.y - head.y;
+        Direction horizontal = dx > 0 ? RIGHT : LEFT;
+        Direction vertical = dy > 0 ? UP : DOWN;
+        if (std::abs(dx) >= std::abs(dy)) {
+            if (dx != 0) candidates[candidateCount++] = horizontal;
+            if (dy != 0) candidates[candidateCount++] = vertical;
+        }
+        else {
+            candidates[candidateCount++] = vertical;
+            if (dx != 0) candidates[candidateCount++] = horizontal;
+        }
+    }
+    if ((nextRandom(snake.random) & 63) == 0) {
+        // a random turn first
+        static const Direction all[4] = { UP, DOWN, LEFT, RIGHT };
+        candidates[0] = all[nextRandom(snake.random) & 3];
+        candidateCount = std::max(candidateCount, 1);
+    }
+    candidates[candidateCount++] = snake.direction;
+
+    const int lookAhead = 6;
+    for (int c = 0; c < candidateCount; c++) {
+        Direction direction = candidates[c];
+        if (!isOppositeDirection(snake.direction, direction) && freeRun(arena, head, direction, lookAhead) >= lookAhead) {
+            return direction;
+        }
+    }
+    // nothing is clear far enough ahead: take the direction with the most room
+    static const Direction all[4] = { UP, DOWN, LEFT, RIGHT };
+    Direction best = snake.direction;
+    int bestRun = -1;
+    for (Direction direction : all) {
+        if (isOppositeDirection(snake.direction, direction)) {
+            continue;
+        }
+        int run = freeRun(arena, head, direction, 64);
+        if (run > bestRun) {
+            best = direction;
+            bestRun = run;
+        }
+    }
+    return best;
+}
+
+/*
+ * This function places a snake with a single segment on a free cell with room ahead of it.
+ * It grows to its full length over the next ticks.
+ * @return false if no place was found this time
+*/
+
+static bool spawnSnake(ArenaState& arena, int index) {
+    ArenaSnake& snake = arena.snakes[index];
+    const int margin = 16;
+    for (int attempt = 0; attempt < 64; attempt++) {
+        ArenaCell cell;
+        if (!arena.freeCells.sample(nextRandom(arena.rngState), cell)) {
+            return false;
+        }
+        Direction direction = static_cast<Direction>(nextRandom(arena.rngState) & 3);
+        if (cell.x < margin || cell.y < margin || cell.x >= arena.config.width - margin || cell.y >= arena.config.height - margin ||
+            freeRun(arena, cell, direction, margin) < margin) {
+            continue;
+        }
+        if (snake.ring.size() < ARENA_RING_CELLS) {
+            snake.ring.resize(ARENA_RING_CELLS);
+        }
+        snake.head = 0;
+        snake.ring[0] = cell;
+        snake.length = 1;
+        snake.pendingGrowth = arena.config.startLength - 1;
+        snake.direction = direction;
+        snake.alive = true;
+        snake.score = 0;
+        snake.target = -1;
+        occupyCell(arena, cell, static_cast<uint32_t>(index + 1));
+        return true;
+    }
+    // no room right now; try again on a later tick
+    return false;
+}
+
+/*
+ * This function fires when a big food item has been left alone for ARENA_BIG_FOOD_TICKS, or
+ * when an item that found no cell is due to try again
+*/
+
+static void expireFood(void* context, uint64_t index) {
+    ArenaState& arena = *static_cast<ArenaState*>(context);
+    arena.foodExpiry[index] = 0;
+    spawnFood(arena, static_cast<int>(index));
+}
+
+/*
+ * This function moves a food item to a random free cell, in bounded time however full the
+ * board is; one in eight is big, and moves on again if nobody eats it in time. On a
+ * completely full board, or one whose free cells all hold food already, the item is taken off
+ * and tries again every ARENA_FOOD_RETRY_TICKS until a cell opens up.
+*/
+
+static void spawnFood(ArenaState& arena, int index) {
+    bool big = (nextRandom(arena.rngState) & 7) == 0;
+    ArenaCell cell;
+    if (arena.foodExpiry[index] != 0) {
+        arena.timers.cancel(arena.foodExpiry[index]);
+        arena.foodExpiry[index] = 0;
+    }
+    // free cells can already hold food; try a few more cells before giving up on stacking
+    bool placed = false;
+    for (int attempt = 0; attempt < ARENA_FOOD_ATTEMPTS && !placed; attempt++) {
+        if (!arena.freeCells.sample(nextRandom(arena.rngState), cell)) {
+            break;
+        }
+        int other = arena.food.findOn(cell);
+        placed = other < 0 || other == index;
+    }
+    if (placed) {
+        arena.food.place(index, cell, big);
+        if (big) {
+            arena.foodExpiry[index] = arena.timers.schedule(ARENA_BIG_FOOD_TICKS, expireFood, &arena, index);
+        }
+    }
+    else {
+        arena.food.remove(index);
+        arena.foodExpiry[index] = arena.timers.schedule(ARENA_FOOD_RETRY_TICKS, expireFood, &arena, index);
+    }
+}
+
+/*
+ * This function hashes the whole arena, to check that runs on different thread counts agree
+*/
+
+uint32_t hashArena(const ArenaState& arena) {
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            hash ^= (value >> (i * 8)) & 255;
+            hash *= 16777619u;
+        }
+    };
+    mix(arena.tick);
+    mix(arena.rngState);
+    for (const ArenaSnake& snake : arena.snakes) {
+        mix(snake.alive);
+        mix(snake.length);
+        mix(snake.pendingGrowth);
+        mix(static_cast<uint32_t>(snake.score));
+        mix(snake.direction);
+        if (snake.alive) {
+            for (uint32_t s = 0; s < snake.length; s++) {
+                mix(uint16_t(snake.segment(s).x) | (uint32_t(uint16_t(snake.segment(s).y)) << 16));
+            }
+        }
+    }
+    for (int i = 0; i < arena.food.size(); i++) {
+        const FoodItem& food = arena.food.item(i);
+        mix(uint16_t(food.cell.x) | (uint32_t(uint16_t(food.cell.y)) << 16));
+        mix(food.big);
+    }
+    return hash;
+}
+
+/*
+ * This function lays a snake's body down on the given cells, freeing the old ones first
+ * @param arena: the arena holding the snake
+ * @param index: which snake
+ * @param body: the new cells, head first; they must be free
+ * @param direction: the way the head is facing
+*/
+
+void placeArenaSnake(ArenaState& arena, int index, const std::vector<ArenaCell>& body, Direction direction) {
+    ArenaSnake& snake = arena.snakes[index];
+    if (snake.alive) {
+        for (uint32_t s = 0; s < snake.length; s++) {
+            releaseCell(arena, snake.segment(s));
+        }
+    }
+    size_t capacity = ARENA_RING_CELLS;
+    while (capacity < body.size()) {
+        capacity *= 2;
+    }
+    snake.ring.assign(capacity, ArenaCell());
+    std::copy(body.begin(), body.end(), snake.ring.begin());
+    snake.head = 0;
+    snake.length = static_cast<uint32_t>(body.size());
+    snake.pendingGrowth = 0;
+    snake.direction = direction;
+    snake.alive = !body.empty();
+    snake.target = -1;
+    for (const ArenaCell& cell : body) {
+        occupyCell(arena, cell, static_cast<uint32_t>(index + 1));
+    }
+}
+
+glm::vec2 arenaPosition(ArenaCell cell) {
+    return glm::vec2(cell.x * MOVE_STRIDE, cell.y * MOVE_STRIDE);
+}
+
+/*
+ * This function returns the next value of an xorshift32 generator
+*/
+
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
@@ -0,0 +1,103 @@
+/*
+ * Title: Arena mode
+ * Description: A large board with hundreds of snakes (the player and bots) and many food items.
+ *      The board is a grid of MOVE_STRIDE sized cells, the same lattice the normal game's snakes
+ *      move on, and every cell records which snake occupies it, so a collision test is a single
+ *      lookup however many snakes there are.
+ *
+ *      A tick runs in phases so it can use every core and still give the same result on any
+ *      number of threads:
+ *        1. propose (parallel): each snake picks a direction and a target cell, reading only
+ *           the state from before the tick
+ *        2. claim (serial, in snake order): targets are sorted to find snakes heading for the
+ *           same cell, and food eaten by two snakes goes to the lower index
+ *        3. resolve (parallel): each snake checks its target against the grid
+ *        4. apply (serial, in snake order): tails leave, heads enter, food respawns
+ *      Then the timers due in the new tick fire: bots coming back after a crash, big food
+ *      moving on (TimerWheel.h).
+*/
+
+#pragma once
+
+#include "FoodField.h"
+#include "Game.h"
+#include "TimerWheel.h"
+#include "WorkerPool.h"
+#include <cstdint>
+#include <vector>
+
+const int ARENA_RESPAWN_TICKS = 120;      // a dead bot comes back after this many ticks
+const int ARENA_BIG_FOOD_TICKS = 600;     // big food nobody eats moves on after this many ticks
+const int ARENA_FOOD_ATTEMPTS = 16;       // free cells tried before food gives up on finding one without food
+const int ARENA_FOOD_RETRY_TICKS = 30;    // food that found no cell tries again after this many ticks
+const uint32_t ARENA_RING_CELLS = 4096;   // a snake's ring starts this big, so only record lengths allocate
+
+// Arena settings
+struct ArenaConfig {
+    int width = 1024;             // board size in cells
+    int height = 1024;
+    int snakeCount = 500;
+    int foodCount = 400;
+    int startLength = 40;         // segments a snake grows to after spawning
+    bool player = true;           // snake 0 follows the player's input instead of a bot
+    uint32_t seed = 1;
+};
+
+// One snake. The body is a ring buffer so that moving touches only the head and the tail.
+struct ArenaSnake {
+    std::vector<ArenaCell> ring;  // capacity is a power of two
+    uint32_t head = 0;            // ring index of the head
+    uint32_t length = 0;
+    uint32_t pendingGrowth = 0;   // segments still to be added, one per tick
+    Direction direction = RIGHT;
+    bool alive = false;
+    int score = 0;
+    uint32_t diedAt = 0;          // tick of death
+    uint32_t random = 1;          // the bot's own generator, so bots can think in parallel
+    int target = -1;              // food the bot is heading for
+
+    // i = 0 is the head
+    const ArenaCell& segment(uint32_t i) const { return ring[(head + i) & (ring.size() - 1)]; }
+    const ArenaCell& tail() const { return segment(length - 1); }
+};
+
+// Per-snake result of the propose and resolve phases
+struct ArenaMove {
+    ArenaCell target;
+    Direction direction = RIGHT;
+    int food = -1;                // food within reach of the target cell
+    bool dies = false;
+    bool blocked = false;         // another snake heads for the same cell
+};
+
+struct ArenaState {
+    ArenaConfig config;
+    std::vector<ArenaSnake> snakes;
+    std::vector<uint32_t> grid;   // per cell: 0 if free, otherwise snake index + 1
+    FreeCells freeCells;          // kept in step with grid, for placing food and snakes
+    FoodField food;
+    uint32_t rngState = 1;
+    uint32_t tick = 0;
+    std::vector<ArenaCell> changed; // cells that were taken or freed during the last tick, for renderers
+    TimerWheel timers;            // respawns and big food expiry; advanced to tick at the end of each tick
+    std::vector<TimerId> foodExpiry; // per food item: its expiry timer while it is big, or its retry timer while it is off the board, else 0
+
+    // scratch space reused every tick
+    std::vector<ArenaMove> moves;
+    std::vector<uint64_t> claims;
+    std::vector<int> foodTaken;
+};
+
+// Timed arena logic (GameTask.h) finds the arena's wheel through this
+inline TimerWheel& timerWheelOf(ArenaState& arena) {
+    return arena.timers;
+}
+
+void initArena(ArenaState& arena, const ArenaConfig& config);
+// Advances the arena by one tick. playerInput steers snake 0 when config.player is set.
+void stepArena(ArenaState& arena, Direction playerInput, WorkerPool& pool);
+uint32_t hashArena(const ArenaState& arena);
+// Replaces a snake's body with the given cells, head first, for benchmarks and tools
+void placeArenaSnake(ArenaState& arena, int index, const std::vector<ArenaCell>& body, Direction direction);
+// Pixel position of a cell's center, in the same units as the normal game
+glm::vec2 arenaPosition(ArenaCell cell);
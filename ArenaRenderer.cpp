@@ -0,0 +1,361 @@
+/*
+ * Title: Arena renderer
+ * Description: Implementation of the chunked, instanced arena renderer declared in
+ *      ArenaRenderer.h.
+*/
+
+#include "ArenaRenderer.h"
+#include "Shader.h"
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+
+// The quad is scaled by size and turned the same way drawSquare() turns a Square. A quad with
+// a span covers the squares of span more cells ahead of it, and repeats the texture along them.
+static const char* instancedVertexSource = R"glsl(
+    #version 330 core
+    layout (location = 0) in vec2 aPos;
+    layout (location = 1) in vec2 aTexCoord;
+    layout (location = 2) in vec4 aInstance;    // cell x, cell y, direction, span
+    uniform mat4 projection;
+    uniform float size;
+    out vec2 TexCoord;
+    const float stride = 2.5;                   // MOVE_STRIDE
+    // UP, DOWN, LEFT, RIGHT as in the Direction enum
+    const vec2 axes[4] = vec2[4](vec2(0.0, 1.0), vec2(0.0, -1.0), vec2(-1.0, 0.0), vec2(1.0, 0.0));
+    void main() {
+        vec2 along = axes[int(aInstance.z)];
+        vec2 across = vec2(-along.y, along.x);
+        float length = size + aInstance.w * stride;
+        vec2 local = aPos * vec2(length, size);
+        vec2 world = (aInstance.xy + 0.5 * aInstance.w * along) * stride + local.x * along + local.y * across;
+        gl_Position = projection * vec4(world, 0.0, 1.0);
+        TexCoord = vec2(aTexCoord.x * length / size, aTexCoord.y);
+    }
+)glsl";
+
+static const char* instancedFragmentSource = R"glsl(
+    #version 330 core
+    out vec4 FragColor;
+    in vec2 TexCoord;
+    uniform sampler2D texture1;
+    void main() {
+        vec4 texColor = texture(texture1, TexCoord);
+        if (texColor.a < 0.1) // Discard nearly transparent pixels
+            discard;
+        FragColor = texColor;
+    }
+)glsl";
+
+
+/*
+ * This function compiles the shader and sets up the quad every instance is drawn with
+ * @param arena: the arena that will be drawn; its size decides the number of chunks
+ * @param textures: body, head and food textures
+*/
+
+void ArenaRenderer::init(const ArenaState& arena, const ArenaTextures& textures) {
+    this->textures = textures;
+    chunksX = (arena.config.width + RENDER_CHUNK_CELLS - 1) / RENDER_CHUNK_CELLS;
+    chunksY = (arena.config.height + RENDER_CHUNK_CELLS - 1) / RENDER_CHUNK_CELLS;
+    chunks.clear();
+    chunks.resize(size_t(chunksX) * chunksY);
+
+    program = registry.add(GlProgram(createShaderProgram(instancedVertexSource, instancedFragmentSource)));
+    projectionLocation = glGetUniformLocation(program, "projection");
+    sizeLocation = glGetUniformLocation(program, "size");
+
+    // a unit square around the origin, with the same texture coordinates as the game's squares
+    float vertices[] = {
+        // positions     // texture coords
+         0.5f,  0.5f,    1.0f, 1.0f,  // top right
+         0.5f, -0.5f,    1.0f, 0.0f,  // bottom right
+        -0.5f, -0.5f,    0.0f, 0.0f,  // bottom left
+        -0.5f,  0.5f,    0.0f, 1.0f   // top left
+    };
+    unsigned int indices[] = {
+        0, 1, 3,
+        1, 2, 3
+    };
+    quadVBO = registry.create(GL_OBJECT_BUFFER);
+    quadEBO = registry.create(GL_OBJECT_BUFFER);
+    streamBuffer = registry.create(GL_OBJECT_BUFFER);
+    quadVAO = registry.create(GL_OBJECT_VERTEX_ARRAY);
+    glBindVertexArray(quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    // attribute 2 advances once per instance; drawInstances() points it at a buffer
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/*
+ * This function marks the chunks holding a cell that was taken or freed during the last tick
+*/
+
+void ArenaRenderer::noteTick(const ArenaState& arena) {
+    for (const ArenaCell& cell : arena.changed) {
+        chunks[(cell.y / RENDER_CHUNK_CELLS) * chunksX + cell.x / RENDER_CHUNK_CELLS].dirtyLevels = (1u << RENDER_LOD_LEVELS) - 1;
+    }
+}
+
+void ArenaRenderer::noteRestart(const ArenaState& arena) {
+    int width = (arena.config.width + RENDER_CHUNK_CELLS - 1) / RENDER_CHUNK_CELLS;
+    int height = (arena.config.height + RENDER_CHUNK_CELLS - 1) / RENDER_CHUNK_CELLS;
+    if (width != chunksX || height != chunksY) {
+        chunksX = width;
+        chunksY = height;
+        chunks.clear();
+        chunks.resize(size_t(chunksX) * chunksY);
+    }
+    for (Chunk& chunk : chunks) {
+        chunk.dirtyLevels = (1u << RENDER_LOD_LEVELS) - 1;
+    }
+}
+
+/*
+ * This function picks the level of detail for a zoom: single squares while a cell is at
+ * least LOD_SEGMENT_PIXELS wide, then runs of cells, then runs of blocks just big enough
+ * to cover a pixel
+ * @param zoom: screen pixels per world unit
+*/
+
+int ArenaRenderer::levelForZoom(float zoom) {
+    float cellPixels = MOVE_STRIDE * zoom;
+    if (cellPixels >= LOD_SEGMENT_PIXELS) {
+        return 0;
+    }
+    int level = 1;
+    for (float blockPixels = cellPixels; blockPixels < 1.0f && level < RENDER_LOD_LEVELS - 1; blockPixels *= 2.0f) {
+        level++;
+    }
+    return level;
+}
+
+/*
+ * This function turns the occupancy in blocks into quads: first each row's runs of two or more
+ * blocks, then columns of the blocks no row run took
+ * @param blocks: the occupancy, a byte per block, row by row; the blocks left alone get marked
+ * @param quads: receives the quads, room for one per block
+ * @param x0, y0: first cell of the chunk
+ * @param blocksX, blocksY: size of the occupancy in blocks
+ * @param block: block width in cells
+ * @return the number of quads
+*/
+
+size_t ArenaRenderer::addRuns(uint8_t* blocks, QuadInstance* quads, int x0, int y0, int blocksX, int blocksY, int block) {
+    const uint8_t ALONE = 2;    // occupied, and in no row run
+    size_t count = 0;
+    for (int y = 0; y < blocksY; y++) {
+        uint8_t* row = &blocks[size_t(y) * blocksX];
+        for (int x = 0; x < blocksX;) {
+            if (!row[x]) {
+                x++;
+                continue;
+            }
+            int end = x + 1;
+            while (end < blocksX && row[end]) {
+                end++;
+            }
+            if (end - x == 1) {
+                row[x] = ALONE;
+            }
+            else {
+                quads[count++] = { static_cast<int16_t>(x0 + x * block), static_cast<int16_t>(y0 + y * block), RIGHT,
+                    static_cast<uint16_t>((end - x - 1) * block) };
+            }
+            x = end;
+        }
+    }
+    for (int x = 0; x < blocksX; x++) {
+        for (int y = 0; y < blocksY;) {
+            if (blocks[size_t(y) * blocksX + x] != ALONE) {
+                y++;
+                continue;
+            }
+            int end = y + 1;
+            while (end < blocksY && blocks[size_t(end) * blocksX + x] == ALONE) {
+                end++;
+            }
+            quads[count++] = { static_cast<int16_t>(x0 + x * block), static_cast<int16_t>(y0 + y * block), UP,
+                static_cast<uint16_t>((end - y - 1) * block) };
+            y = end;
+        }
+    }
+    return count;
+}
+
+/*
+ * This function collects the occupied cells of a chunk from the grid and uploads them as the
+ * quads of one level of detail. Its scratch space is handed back to the frame arena before it
+ * returns.
+ * @param cx, cy: the chunk's column and row
+ * @param level: level of detail, see ArenaRenderer.h
+ * @param scratch: the frame's scratch arena
+*/
+
+void ArenaRenderer::rebuildChunk(const ArenaState& arena, int cx, int cy, int level, FrameArena& scratch) {
+    Chunk& chunk = chunks[cy * chunksX + cx];
+    int x0 = cx * RENDER_CHUNK_CELLS, x1 = std::min(x0 + RENDER_CHUNK_CELLS, arena.config.width);
+    int y0 = cy * RENDER_CHUNK_CELLS, y1 = std::min(y0 + RENDER_CHUNK_CELLS, arena.config.height);
+    size_t mark = scratch.mark();
+    size_t quadCount = 0;
+    QuadInstance* quads;
+    if (level == 0) {
+        quads = scratch.allocate<QuadInstance>(size_t(x1 - x0) * (y1 - y0));
+        for (int y = y0; y < y1; y++) {
+            const uint32_t* row = &arena.grid[size_t(y) * arena.config.width];
+            for (int x = x0; x < x1; x++) {
+                if (row[x] != 0) {
+                    quads[quadCount++] = { static_cast<int16_t>(x), static_cast<int16_t>(y), RIGHT, 0 };
+                }
+            }
+        }
+    }
+    else {
+        int block = 1 << (level - 1);
+        int blocksX = (x1 - x0 + block - 1) / block, blocksY = (y1 - y0 + block - 1) / block;
+        uint8_t* blocks = scratch.allocate<uint8_t>(size_t(blocksX) * blocksY);
+        std::fill(blocks, blocks + size_t(blocksX) * blocksY, uint8_t(0));
+        quads = scratch.allocate<QuadInstance>(size_t(blocksX) * blocksY);
+        for (int y = y0; y < y1; y++) {
+            const uint32_t* row = &arena.grid[size_t(y) * arena.config.width];
+            uint8_t* blockRow = &blocks[size_t((y - y0) / block) * blocksX];
+            for (int x = x0; x < x1; x++) {
+                blockRow[(x - x0) / block] |= row[x] != 0 ? 1 : 0;
+            }
+        }
+        quadCount = addRuns(blocks, quads, x0, y0, blocksX, blocksY, block);
+    }
+    uint32_t& count = chunk.counts[level];
+    GlBuffer& buffer = chunk.buffers[level];
+    count = static_cast<uint32_t>(quadCount);
+    chunk.dirtyLevels &= ~(1u << level);
+    if (count != 0) {
+        if (!buffer) {
+            buffer = GlBuffer::create();
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.get());
+        glBufferData(GL_ARRAY_BUFFER, quadCount * sizeof(QuadInstance), quads, GL_DYNAMIC_DRAW);
+    }
+    scratch.rewind(mark);
+}
+
+/*
+ * This function draws count instances starting at instance first of a buffer. OpenGL 3.3 has
+ * no base instance, so the instance attribute is pointed at the first one instead.
+*/
+
+void ArenaRenderer::drawInstances(unsigned int buffer, size_t first, uint32_t count, unsigned int texture, float size) {
+    if (count == 0) {
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1f(sizeLocation, size);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(2, 4, GL_SHORT, GL_FALSE, sizeof(QuadInstance), (void*)(first * sizeof(QuadInstance)));
+    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, count);
+    lastFrame.drawCalls++;
+    lastFrame.instances += count;
+}
+
+/*
+ * This function draws food, bodies and heads, in that order, for the part of the board the
+ * camera sees. Chunks that changed since they were last drawn are rebuilt first. What is
+ * gathered for the upload comes from the frame's scratch arena.
+*/
+
+void ArenaRenderer::draw(const ArenaState& arena, const Camera& camera, FrameArena& scratch, float pixelScale) {
+    lastFrame = ArenaRenderStats();
+    int level = lodEnabled ? levelForZoom(camera.zoom() * pixelScale) : 0;
+    lastFrame.level = level;
+
+    // cells whose squares can reach into the view; big food reaches furthest
+    ViewRect view = camera.visibleRect();
+    float margin = SQUARE_SIZE;
+    int cellLeft = std::max(0, static_cast<int>(std::floor((view.left - margin) / MOVE_STRIDE)));
+    int cellBottom = std::max(0, static_cast<int>(std::floor((view.bottom - margin) / MOVE_STRIDE)));
+    int cellRight = std::min(arena.config.width - 1, static_cast<int>(std::ceil((view.right + margin) / MOVE_STRIDE)));
+    int cellTop = std::min(arena.config.height - 1, static_cast<int>(std::ceil((view.top + margin) / MOVE_STRIDE)));
+    if (cellLeft > cellRight || cellBottom > cellTop) {
+        return;
+    }
+    auto visible = [&](ArenaCell cell) {
+        return cell.x >= cellLeft && cell.x <= cellRight && cell.y >= cellBottom && cell.y <= cellTop;
+    };
+
+    // food and heads go into one buffer: small food, big food, the player's head, bot heads
+    QuadInstance* stream = scratch.allocate<QuadInstance>(size_t(arena.food.size()) + arena.snakes.size());
+    size_t streamCount = 0;
+    size_t smallFood = 0;
+    for (int big = 0; big < 2; big++) {
+        for (int i = 0; i < arena.food.size(); i++) {
+            const FoodItem& food = arena.food.item(i);
+            if (food.bucket >= 0 && food.big == (big != 0) && visible(food.cell)) {
+                stream[streamCount++] = { food.cell.x, food.cell.y, RIGHT, 0 };
+            }
+        }
+        if (big == 0) {
+            smallFood = streamCount;
+        }
+    }
+    size_t bigFood = streamCount - smallFood;
+    size_t heads = streamCount;
+    for (size_t s = 0; s < arena.snakes.size(); s++) {
+        const ArenaSnake& snake = arena.snakes[s];
+        if (snake.alive && visible(snake.segment(0))) {
+            stream[streamCount++] = { snake.segment(0).x, snake.segment(0).y, static_cast<uint16_t>(snake.direction), 0 };
+        }
+    }
+    bool playerHead = !arena.snakes.empty() && arena.snakes[0].alive && visible(arena.snakes[0].segment(0));
+    if (streamCount != 0) {
+        // a new store each frame, so the driver doesn't wait for last frame's draws
+        glBindBuffer(GL_ARRAY_BUFFER, streamBuffer);
+        glBufferData(GL_ARRAY_BUFFER, streamCount * sizeof(QuadInstance), stream, GL_STREAM_DRAW);
+    }
+
+    glUseProgram(program);
+    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, glm::value_ptr(camera.projection()));
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(quadVAO);
+
+    drawInstances(streamBuffer, 0, static_cast<uint32_t>(smallFood), textures.food, SQUARE_SIZE);
+    drawInstances(streamBuffer, smallFood, static_cast<uint32_t>(bigFood), textures.food, 2.0f * SQUARE_SIZE);
+
+    int chunkLeft = cellLeft / RENDER_CHUNK_CELLS, chunkRight = cellRight / RENDER_CHUNK_CELLS;
+    int chunkBottom = cellBottom / RENDER_CHUNK_CELLS, chunkTop = cellTop / RENDER_CHUNK_CELLS;
+    for (int cy = chunkBottom; cy <= chunkTop; cy++) {
+        for (int cx = chunkLeft; cx <= chunkRight; cx++) {
+            Chunk& chunk = chunks[cy * chunksX + cx];
+            if (chunk.dirtyLevels & (1u << level)) {
+                rebuildChunk(arena, cx, cy, level, scratch);
+                lastFrame.chunksRebuilt++;
+            }
+            lastFrame.chunksVisible++;
+            drawInstances(chunk.buffers[level].get(), 0, chunk.counts[level], textures.body, SQUARE_SIZE);
+        }
+    }
+
+    size_t botHeads = heads + (playerHead ? 1 : 0);
+    drawInstances(streamBuffer, heads, playerHead ? 1 : 0, textures.playerHead, SQUARE_SIZE);
+    drawInstances(streamBuffer, botHeads, static_cast<uint32_t>(streamCount - botHeads), textures.botHead, SQUARE_SIZE);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ArenaRenderer::release() {
+    // the chunks' handles delete their buffers
+    chunks.clear();
+    registry.release();
+    streamBuffer = quadEBO = quadVBO = quadVAO = program = 0;
+}
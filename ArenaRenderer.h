@@ -0,0 +1,108 @@
+/*
+ * Title: Arena renderer
+ * Description: Draws the arena with instanced quads, one draw call per batch instead of one
+ *      per square, and only for the part of the board the camera sees.
+ *
+ *      The board is split into square chunks of RENDER_CHUNK_CELLS cells. Each chunk keeps its
+ *      own instance buffer with one instance per occupied cell, rebuilt from the grid only
+ *      when a cell inside it changed (ArenaState::changed lists them every tick) and only
+ *      once the chunk comes into view. A frame draws the chunks that overlap the view, so its
+ *      cost follows what is on screen rather than the size of the board or the length of the
+ *      snakes. Heads and food are few and are gathered again every frame.
+ *
+ *      Bodies have levels of detail, picked from how big a cell is on screen:
+ *        0: one square per segment, when zoomed in far enough to tell segments apart
+ *        1: each row of touching cells becomes one stretched quad, the same shape as the
+ *           overlapping squares it replaces; cells left on their own are joined into columns
+ *        2+: the same over blocks of 2, 4, 8... cells, so that a block is about a pixel
+ *      From level 1 on the quad count depends on how many runs the view holds, which is
+ *      bounded by its size in pixels, and not on how long the snakes are. A chunk keeps a
+ *      buffer per level; a change invalidates them all, and only the level in use is rebuilt.
+*/
+
+#pragma once
+
+#include "Arena.h"
+#include "Camera.h"
+#include "FrameArena.h"
+#include "GlResources.h"
+#include <cstdint>
+#include <vector>
+
+const int RENDER_CHUNK_CELLS = 64;        // chunk width in cells
+const int RENDER_LOD_LEVELS = 7;          // per segment, runs of cells, runs of 2..32 cell blocks
+const float LOD_SEGMENT_PIXELS = 8.0f;    // squares are drawn one by one from this many pixels per cell
+
+// Textures the arena is drawn with
+struct ArenaTextures {
+    unsigned int body = 0;
+    unsigned int playerHead = 0;  // snake 0
+    unsigned int botHead = 0;
+    unsigned int food = 0;
+};
+
+// Per-instance data: the quad's cell, the way it faces, and how many cells further in that
+// direction it stretches
+struct QuadInstance {
+    int16_t x;
+    int16_t y;
+    uint16_t direction;
+    uint16_t span;
+};
+
+// What the last frame drew
+struct ArenaRenderStats {
+    int chunksVisible = 0;
+    int chunksRebuilt = 0;
+    int level = 0;                // level of detail of the bodies
+    int drawCalls = 0;
+    uint32_t instances = 0;
+};
+
+class ArenaRenderer {
+public:
+    // Needs a current OpenGL 3.3 context
+    void init(const ArenaState& arena, const ArenaTextures& textures);
+    // Call after every stepArena so the chunks that changed get rebuilt
+    void noteTick(const ArenaState& arena);
+    // Call after initArena started a new game; every chunk is rebuilt into the buffers it
+    // has. A board of another size gets new chunks, and the old ones' buffers are deleted.
+    void noteRestart(const ArenaState& arena);
+    // Draws the arena into the current framebuffer with the camera's projection. pixelScale is
+    // the size of the framebuffer against the one the camera was set up for, which is less than
+    // 1 when the scene is drawn at a lower resolution and scaled up. Scratch space comes from
+    // the frame arena, which the caller resets once a frame.
+    void draw(const ArenaState& arena, const Camera& camera, FrameArena& scratch, float pixelScale = 1.0f);
+    // Level of detail for a zoom; see the description at the top
+    static int levelForZoom(float zoom);
+    // Draws every segment on its own whatever the zoom, for comparisons
+    void setLodEnabled(bool enabled) { lodEnabled = enabled; }
+    void release();
+    const ArenaRenderStats& stats() const { return lastFrame; }
+
+private:
+    struct Chunk {
+        GlBuffer buffers[RENDER_LOD_LEVELS];          // instance buffer of each level, made when first needed
+        uint32_t counts[RENDER_LOD_LEVELS] = {};
+        uint32_t dirtyLevels = (1u << RENDER_LOD_LEVELS) - 1; // bit per level
+    };
+
+    void rebuildChunk(const ArenaState& arena, int cx, int cy, int level, FrameArena& scratch);
+    static size_t addRuns(uint8_t* blocks, QuadInstance* quads, int x0, int y0, int blocksX, int blocksY, int block);
+    void drawInstances(unsigned int buffer, size_t first, uint32_t count, unsigned int texture, float size);
+
+    std::vector<Chunk> chunks;
+    int chunksX = 0;
+    int chunksY = 0;
+    ArenaTextures textures;
+    GlRegistry registry;          // the program, the quad and the stream buffer
+    unsigned int program = 0;
+    unsigned int quadVAO = 0;
+    unsigned int quadVBO = 0;
+    unsigned int quadEBO = 0;
+    unsigned int streamBuffer = 0; // heads and food, refilled every frame
+    int projectionLocation = -1;
+    int sizeLocation = -1;
+    ArenaRenderStats lastFrame;
+    bool lodEnabled = true;
+};
@@ -0,0 +1,1825 @@
+/*
+ * Title: Snake Game benchmarks
+ * Description: Headless benchmarks and self-checks for the simulation and networking code.
+ *      This program does not open a window and does not link GLFW or OpenGL.
+ * Usage: ./SnakeBench <benchmark> [options], run without arguments to list the benchmarks
+*/
+
+#include "Allocations.h"
+#include "Arena.h"
+#include "Bot.h"
+#include "Ecs.h"
+#include "FlightRecorder.h"
+#include "FrameArena.h"
+#include "Game.h"
+#include "GameTask.h"
+#include "Log.h"
+#include "Metrics.h"
+#include "Netplay.h"
+#include "Replay.h"
+#include "SnapshotCodec.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+typedef std::chrono::steady_clock BenchClock;
+
+// One frame at 60 FPS, the budget rollback has to fit into
+const double FRAME_BUDGET_US = 1000000.0 / 60.0;
+
+/*
+ * This function returns the microseconds elapsed between two clock readings
+*/
+
+static double microseconds(BenchClock::time_point start, BenchClock::time_point end) {
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+/*
+ * This function returns the given percentile of a list of samples (the list gets sorted)
+*/
+
+static double percentile(std::vector<double>& samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    size_t index = std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()));
+    return samples[index];
+}
+
+/*
+ * This function lays a snake body of the given length out in rows below the heads,
+ * so that a few ticks of straight movement can not collide with anything
+ * @param snake: the snake whose body is replaced; its head keeps its position
+ * @param length: total number of segments including the head
+*/
+
+static void fillBody(Snake& snake, size_t length) {
+    Square head = snake.body[0];
+    snake.body.assign(length, head);
+    const float left = 70.0f, right = 720.0f, bottom = 70.0f, top = 400.0f;
+    float x = left, y = bottom;
+    float step = MOVE_STRIDE;
+    for (size_t i = 1; i < length; i++) {
+        snake.body[i].position = glm::vec2(x, y);
+        snake.body[i].direction = step > 0 ? RIGHT : LEFT;
+        x += step;
+        if (x > right || x < left) {
+            // turn around one row up, wrapping back to the bottom once the area is full
+            step = -step;
+            x += step;
+            y += 5.0f;
+            if (y > top) {
+                y = bottom;
+            }
+        }
+    }
+}
+
+/*
+ * Benchmark: restore a snapshot and re-simulate 8-10 ticks, like a netplay rollback does,
+ * for a range of snake lengths, and compare the cost with a 60 FPS frame.
+*/
+
+static int benchRollback(int argc, char** argv) {
+    int iterations = argc > 0 ? atoi(argv[0]) : 2000;
+    const size_t lengths[] = { 100, 1000, 10000, 100000 };
+    const int depths[] = { 8, 10 };
+
+    printf("%-10s %-6s %12s %12s %12s %12s\n", "length", "ticks", "mean us", "p99 us", "max us", "% of frame");
+    for (size_t length : lengths) {
+        GameState start;
+        initGame(start, 2, 12345);
+        start.snakes[0].body[0] = { glm::vec2(100.0f, 500.0f), RIGHT };
+        start.snakes[1].body[0] = { glm::vec2(700.0f, 450.0f), LEFT };
+        fillBody(start.snakes[0], length);
+        fillBody(start.snakes[1], length);
+        start.smallFood.position = glm::vec2(400.0f, 530.0f);
+
+        for (int depth : depths) {
+            GameState snapshots[ROLLBACK_WINDOW];
+            for (GameState& snapshot : snapshots) {
+                snapshot = start;
+            }
+            GameState current = start;
+            Direction inputs[MAX_PLAYERS] = { RIGHT, LEFT };
+
+            std::vector<double> samples;
+            samples.reserve(iterations);
+            for (int i = 0; i < iterations; i++) {
+                auto begin = BenchClock::now();
+                current = snapshots[0];
+                for (int t = 0; t < depth; t++) {
+                    snapshots[t % ROLLBACK_WINDOW] = current;
+                    stepGame(current, inputs);
+                }
+                auto end = BenchClock::now();
+                samples.push_back(microseconds(begin, end));
+                snapshots[0] = start;
+                if (current.gameOver) {
+                    fprintf(stderr, "rollback benchmark collided, results are not valid\n");
+                    return 1;
+                }
+            }
+
+            double mean = 0.0;
+            for (double sample : samples) {
+                mean += sample;
+            }
+            mean /= samples.size();
+            double p99 = percentile(samples, 0.99);
+            double maximum = samples.back();
+            printf("%-10zu %-6d %12.2f %12.2f %12.2f %11.2f%%\n", length, depth, mean, p99, maximum, 100.0 * p99 / FRAME_BUDGET_US);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Self-check: run both netplay peers in this process over UDP loopback. The peers advance in
+ * random bursts so each regularly runs ahead of the other and has to roll back. At the end both
+ * must hold exactly the same state.
+*/
+
+static int benchLoopback(int argc, char** argv) {
+    int frames = argc > 0 ? atoi(argv[0]) : 3000;
+    uint16_t basePort = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 47000);
+
+    NetAddress address[2];
+    parseAddress("127.0.0.1:" + std::to_string(basePort), address[0]);
+    parseAddress("127.0.0.1:" + std::to_string(basePort + 1), address[1]);
+    NetplaySession sessions[2];
+    for (int p = 0; p < 2; p++) {
+        if (!sessions[p].start(basePort + p, address[1 - p], p, 777)) {
+            fprintf(stderr, "could not open UDP port %d\n", basePort + p);
+            return 1;
+        }
+    }
+
+    auto handshakeStart = BenchClock::now();
+    while (!sessions[0].isConnected() || !sessions[1].isConnected()) {
+        sessions[0].poll();
+        sessions[1].poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (microseconds(handshakeStart, BenchClock::now()) > 5e6) {
+            fprintf(stderr, "handshake timed out\n");
+            return 1;
+        }
+    }
+
+    uint32_t schedule = 99991;
+    uint32_t botRandom[2] = { 1, 2 };
+    auto begin = BenchClock::now();
+    while (sessions[0].frame() < uint32_t(frames) || sessions[1].frame() < uint32_t(frames)) {
+        schedule = schedule * 1664525u + 1013904223u;
+        int p = (schedule >> 16) & 1;
+        int burst = (schedule >> 20) % 6;
+        for (int i = 0; i < burst && sessions[p].frame() < uint32_t(frames); i++) {
+            Direction input = botDirection(sessions[p].state(), p, botRandom[p]);
+            sessions[p].advance(input, nullptr);
+        }
+        sessions[1 - p].poll();
+    }
+
+    // Wait until each side has every input of the other, then apply the last corrections
+    while (sessions[0].confirmedFrames() < uint32_t(frames) || sessions[1].confirmedFrames() < uint32_t(frames)) {
+        sessions[0].advance(RIGHT, nullptr);
+        sessions[1].advance(RIGHT, nullptr);
+    }
+    sessions[0].synchronize();
+    sessions[1].synchronize();
+    double elapsed = microseconds(begin, BenchClock::now());
+
+    uint32_t hash[2] = { hashGameState(sessions[0].state()), hashGameState(sessions[1].state()) };
+    for (int p = 0; p < 2; p++) {
+        const NetplayStats& stats = sessions[p].stats();
+        printf("player %d: tick %u hash %08x rollbacks %d resimulated %d max depth %d stalls %d sent %d received %d\n",
+            p, sessions[p].state().tick, hash[p], stats.rollbacks, stats.resimulatedTicks, stats.maxRollbackDepth,
+            stats.stalls, stats.packetsSent, stats.packetsReceived);
+    }
+    printf("%d frames in %.1f ms\n", frames, elapsed / 1000.0);
+    if (hash[0] != hash[1]) {
+        printf("FAIL: peers diverged\n");
+        return 1;
+    }
+    printf("PASS: peers agree\n");
+    return 0;
+}
+
+/*
+ * This function advances a benchmark state by one tick without the game rules: both snakes
+ * walk a large square (so their heads stay in range), grow now and then and the food moves.
+ * The codec only sees the result, so this is all it needs and it never ends in a collision.
+*/
+
+static void advanceSynthetic(GameState& state) {
+    state.tick++;
+    for (size_t s = 0; s < state.snakes.size(); s++) {
+        Snake& snake = state.snakes[s];
+        static const Direction turns[4] = { RIGHT, UP, LEFT, DOWN };
+        Direction direction = turns[((state.tick + 20 * s) / 40) % 4];
+        std::copy_backward(snake.body.begin(), snake.body.end() - 1, snake.body.end());
+        Square& head = snake.body[0];
+        head.direction = direction;
+        switch (direction) {
+        case UP: head.position.y += MOVE_STRIDE; break;
+        case DOWN: head.position.y -= MOVE_STRIDE; break;
+        case LEFT: head.position.x -= MOVE_STRIDE; break;
+        case RIGHT: head.position.x += MOVE_STRIDE; break;
+        }
+        if ((state.tick + 31 * s) % 97 == 0) {
+            Square tail = snake.body.back();
+            snake.body.insert(snake.body.end(), SMALL_FOOD_GROWTH, tail);
+            snake.score++;
+        }
+    }
+    if (state.tick % 97 == 0) {
+        state.smallFood.position = glm::vec2(100.0f + state.tick % 600, 100.0f + state.tick % 400);
+    }
+}
+
+/*
+ * Benchmark: placing food on a board that is 50-99% full, with the free cell index and with
+ * rejection sampling, and head pickup checks with the spatial hash and with a linear scan.
+ * Every sampled cell must be free and both pickup checks must give the same answer.
+*/
+
+static int benchFood(int argc, char** argv) {
+    int samples = argc > 0 ? atoi(argv[0]) : 100000;
+    const int width = 1024, height = 1024;
+    const double fills[] = { 0.5, 0.9, 0.95, 0.99 };
+    uint32_t random = 12345;
+    auto next = [&random]() {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return random;
+    };
+
+    printf("%-6s %14s %14s %16s %16s\n", "full", "index ns", "reject ns", "reject attempts", "worst attempts");
+    for (double fill : fills) {
+        std::vector<uint32_t> grid(size_t(width) * height, 0);
+        FreeCells freeCells;
+        freeCells.init(width, height);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                if (next() % 10000 < fill * 10000) {
+                    grid[size_t(y) * width + x] = 1;
+                    freeCells.occupy({ static_cast<int16_t>(x), static_cast<int16_t>(y) });
+                }
+            }
+        }
+
+        auto begin = BenchClock::now();
+        for (int i = 0; i < samples; i++) {
+            ArenaCell cell;
+            if (!freeCells.sample(next(), cell) || grid[size_t(cell.y) * width + cell.x] != 0) {
+                printf("FAIL: sampled an occupied cell\n");
+                return 1;
+            }
+        }
+        double indexNs = 1000.0 * microseconds(begin, BenchClock::now()) / samples;
+
+        unsigned long long attempts = 0, worst = 0;
+        begin = BenchClock::now();
+        for (int i = 0; i < samples; i++) {
+            unsigned long long tries = 0;
+            uint32_t index;
+            do {
+                index = next() % (width * height);
+                tries++;
+            } while (grid[index] != 0);
+            attempts += tries;
+            worst = std::max(worst, tries);
+        }
+        double rejectNs = 1000.0 * microseconds(begin, BenchClock::now()) / samples;
+        printf("%5.0f%% %14.1f %14.1f %16.1f %16llu\n", 100.0 * fill, indexNs, rejectNs, double(attempts) / samples, worst);
+    }
+
+    const int counts[] = { 400, 4000 };
+    printf("\n%-6s %14s %14s\n", "food", "hash ns", "linear ns");
+    for (int count : counts) {
+        FoodField field;
+        field.init(width, height, count);
+        for (int i = 0; i < count; i++) {
+            field.place(i, { static_cast<int16_t>(next() % width), static_cast<int16_t>(next() % height) }, (next() & 7) == 0);
+        }
+        std::vector<ArenaCell> heads(samples);
+        for (ArenaCell& head : heads) {
+            head = { static_cast<int16_t>(next() % width), static_cast<int16_t>(next() % height) };
+        }
+
+        std::vector<int> hashed(samples), linear(samples);
+        auto begin = BenchClock::now();
+        for (int i = 0; i < samples; i++) {
+            hashed[i] = field.findAt(heads[i]);
+        }
+        double hashNs = 1000.0 * microseconds(begin, BenchClock::now()) / samples;
+        begin = BenchClock::now();
+        for (int i = 0; i < samples; i++) {
+            linear[i] = -1;
+            for (int id = 0; id < count; id++) {
+                const FoodItem& item = field.item(id);
+                int dx = item.cell.x - heads[i].x, dy = item.cell.y - heads[i].y;
+                int radius = item.big ? BIG_FOOD_RADIUS : SMALL_FOOD_RADIUS;
+                if (dx * dx + dy * dy < radius * radius) {
+                    linear[i] = id;
+                    break;
+                }
+            }
+        }
+        double linearNs = 1000.0 * microseconds(begin, BenchClock::now()) / samples;
+        if (hashed != linear) {
+            printf("FAIL: spatial hash and linear scan disagree\n");
+            return 1;
+        }
+        printf("%-6d %14.1f %14.1f\n", count, hashNs, linearNs);
+    }
+    printf("PASS: sampled cells were free and pickups matched\n");
+    return 0;
+}
+
+/*
+ * Benchmark: size and speed of the snapshot codec for a range of snake lengths. Every tick one
+ * message is encoded against a baseline `lag` ticks old (the acknowledgement round trip) and
+ * applied to a receiver copy, which must match the sender exactly at the end.
+*/
+
+static int benchCodec(int argc, char** argv) {
+    int ticks = argc > 0 ? atoi(argv[0]) : 600;
+    const size_t lengths[] = { 10, 100, 1000, 10000, 100000 };
+    const uint32_t lags[] = { 1, 8 };
+
+    printf("%-8s %10s %10s %9s %9s %5s %9s %11s %11s\n", "length", "raw B", "key B", "key enc", "key dec",
+        "lag", "delta B", "enc ns", "dec ns");
+    for (size_t length : lengths) {
+        GameState start;
+        initGame(start, 2, 4242);
+        fillBody(start.snakes[0], length);
+        fillBody(start.snakes[1], length);
+
+        // keyframe cost, averaged over a few runs
+        SnapshotEncoder encoder;
+        encoder.reset(start);
+        std::vector<unsigned char> message;
+        GameState mirror;
+        const int keyRuns = 20;
+        auto begin = BenchClock::now();
+        for (int i = 0; i < keyRuns; i++) {
+            message.clear();
+            encoder.encodeKeyframe(start, message);
+        }
+        double keyEncode = microseconds(begin, BenchClock::now()) / keyRuns;
+        begin = BenchClock::now();
+        for (int i = 0; i < keyRuns; i++) {
+            decodeSnapshot(message.data(), message.size(), mirror);
+        }
+        double keyDecode = microseconds(begin, BenchClock::now()) / keyRuns;
+        size_t keyBytes = message.size();
+        if (hashVisibleState(mirror) != hashVisibleState(start)) {
+            printf("FAIL: keyframe does not reproduce the state at length %zu\n", length);
+            return 1;
+        }
+        // what sending every segment as x, y, direction (5 bytes) would cost
+        size_t rawBytes = 2 * length * 5;
+
+        for (uint32_t lag : lags) {
+            GameState state = start;
+            encoder.reset(state);
+            mirror = start;
+            double encodeNs = 0.0, decodeNs = 0.0;
+            size_t bytes = 0;
+            for (int t = 0; t < ticks; t++) {
+                advanceSynthetic(state);
+                encoder.recordTick(state);
+                uint32_t ack = state.tick >= lag ? state.tick - lag : 0;
+
+                message.clear();
+                auto encodeStart = BenchClock::now();
+                encoder.encode(state, ack, message);
+                auto encodeEnd = BenchClock::now();
+                SnapshotResult result = decodeSnapshot(message.data(), message.size(), mirror);
+                auto decodeEnd = BenchClock::now();
+                if (result != SNAPSHOT_APPLIED) {
+                    printf("FAIL: snapshot for tick %u was not applied (result %d)\n", state.tick, result);
+                    return 1;
+                }
+                encodeNs += 1000.0 * microseconds(encodeStart, encodeEnd);
+                decodeNs += 1000.0 * microseconds(encodeEnd, decodeEnd);
+                bytes += message.size();
+            }
+            if (hashVisibleState(mirror) != hashVisibleState(state)) {
+                printf("FAIL: receiver diverged at length %zu lag %u\n", length, lag);
+                return 1;
+            }
+            printf("%-8zu %10zu %10zu %7.1fus %7.1fus %5u %9.2f %11.0f %11.0f\n", length, rawBytes, keyBytes, keyEncode,
+                keyDecode, lag, double(bytes) / ticks, encodeNs / ticks, decodeNs / ticks);
+        }
+    }
+    // Broken deltas must leave the receiver as it was: one cut in half, and one that claims
+    // a snake grew by 0xF0000000 segments
+    GameState sender;
+    initGame(sender, 2, 4242);
+    fillBody(sender.snakes[0], 1000);
+    fillBody(sender.snakes[1], 1000);
+    SnapshotEncoder encoder;
+    encoder.reset(sender);
+    GameState receiver = sender;
+    for (int t = 0; t < 8; t++) {
+        advanceSynthetic(sender);
+        encoder.recordTick(sender);
+    }
+    std::vector<unsigned char> message;
+    encoder.encode(sender, receiver.tick, message);
+    uint32_t before = hashVisibleState(receiver);
+    if (decodeSnapshot(message.data(), message.size() / 2, receiver) != SNAPSHOT_NEED_KEYFRAME ||
+        hashVisibleState(receiver) != before) {
+        printf("FAIL: a truncated delta changed the receiver\n");
+        return 1;
+    }
+    if (decodeSnapshot(message.data(), message.size(), receiver) != SNAPSHOT_APPLIED ||
+        hashVisibleState(receiver) != hashVisibleState(sender)) {
+        printf("FAIL: the whole delta was not applied after the truncated one\n");
+        return 1;
+    }
+    std::vector<unsigned char> crafted;
+    BitWriter writer(crafted);
+    writer.flag(false);                       // delta
+    writer.bits(receiver.tick + 1, 32);
+    writer.varint(1);                         // span: the tick after the receiver's
+    writer.bits(0, 3);                        // flags
+    writer.flag(false);                       // food unchanged
+    writer.bits(2, 2);                        // snakes
+    writer.flag(false);                       // scores unchanged
+    writer.flag(false);
+    writer.flag(false);                       // first snake: didn't move, then grew
+    writer.flag(true);
+    writer.flag(true);
+    writer.varint(0xF0000000u - 1);
+    writer.flag(false);
+    writer.flag(false);                       // second snake: nothing
+    writer.flag(false);
+    writer.flag(false);                       // no checksum
+    writer.flush();
+    before = hashVisibleState(receiver);
+    if (decodeSnapshot(crafted.data(), crafted.size(), receiver) != SNAPSHOT_NEED_KEYFRAME ||
+        hashVisibleState(receiver) != before) {
+        printf("FAIL: a delta growing a snake by 0xF0000000 segments was not rejected\n");
+        return 1;
+    }
+    printf("PASS: every receiver matched its sender, and broken deltas changed nothing\n");
+    return 0;
+}
+
+/*
+ * Benchmark: arena ticks with many bots, on one thread and on the whole pool. Both runs start
+ * from the same seed and must end in the same state, which checks that the parallel phases
+ * are deterministic.
+*/
+
+static int benchArena(int argc, char** argv) {
+    int snakes = argc > 0 ? atoi(argv[0]) : 500;
+    int ticks = argc > 1 ? atoi(argv[1]) : 600;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    const double tickBudgetUs = 1000000.0 / 60.0;
+
+    ArenaConfig config;
+    config.snakeCount = snakes;
+    config.player = false;
+    config.seed = 99;
+
+    WorkerPool single(1), pool(threads);
+    WorkerPool* pools[2] = { &single, &pool };
+    uint32_t hash[2];
+    printf("%d snakes on %dx%d cells, %d food, %d ticks\n", snakes, config.width, config.height, config.foodCount, ticks);
+    printf("%-8s %12s %12s %12s %12s %10s\n", "threads", "mean us", "p99 us", "ticks/s", "% of 60Hz", "alive");
+    for (int run = 0; run < 2; run++) {
+        ArenaState arena;
+        initArena(arena, config);
+        std::vector<double> samples;
+        samples.reserve(ticks);
+        for (int t = 0; t < ticks; t++) {
+            auto begin = BenchClock::now();
+            stepArena(arena, RIGHT, *pools[run]);
+            samples.push_back(microseconds(begin, BenchClock::now()));
+        }
+        hash[run] = hashArena(arena);
+        for (int id = 0; id < arena.food.size(); id++) {
+            const FoodItem& item = arena.food.item(id);
+            if (item.bucket >= 0 && arena.food.findOn(item.cell) != id) {
+                printf("FAIL: food %d shares cell (%d, %d) with food %d\n", id, item.cell.x, item.cell.y,
+                    arena.food.findOn(item.cell));
+                return 1;
+            }
+        }
+        int alive = 0;
+        for (const ArenaSnake& snake : arena.snakes) {
+            alive += snake.alive ? 1 : 0;
+        }
+        double mean = 0.0;
+        for (double sample : samples) {
+            mean += sample;
+        }
+        mean /= samples.size();
+        double p99 = percentile(samples, 0.99);
+        printf("%-8d %12.1f %12.1f %12.0f %11.1f%% %10d\n", pools[run]->size(), mean, p99, 1000000.0 / mean,
+            100.0 * p99 / tickBudgetUs, alive);
+    }
+    if (hash[0] != hash[1]) {
+        printf("FAIL: %08x on one thread, %08x on %d\n", hash[0], hash[1], pool.size());
+        return 1;
+    }
+    printf("PASS: same state (%08x) on 1 and %d threads\n", hash[0], pool.size());
+
+    // More food than cells: an item that finds no cell must keep trying as cells open up,
+    // not drop off the board for good
+    ArenaConfig crowded;
+    crowded.width = crowded.height = 48;
+    crowded.snakeCount = 8;
+    crowded.foodCount = 2400;
+    crowded.player = false;
+    crowded.seed = 7;
+    ArenaState arena;
+    initArena(arena, crowded);
+    auto foodOnBoard = [&arena]() {
+        int placed = 0;
+        for (int id = 0; id < arena.food.size(); id++) {
+            placed += arena.food.item(id).bucket >= 0 ? 1 : 0;
+        }
+        return placed;
+    };
+    int placedAtStart = foodOnBoard();
+    for (int t = 0; t < ticks; t++) {
+        stepArena(arena, RIGHT, single);
+        for (int id = 0; id < arena.food.size(); id++) {
+            if (arena.food.item(id).bucket < 0 && arena.foodExpiry[id] == 0) {
+                printf("FAIL: food %d is off the board with no retry scheduled after tick %u\n", id, arena.tick);
+                return 1;
+            }
+        }
+    }
+    int placedAtEnd = foodOnBoard();
+    int openCells = 0;
+    for (int y = 0; y < crowded.height; y++) {
+        for (int x = 0; x < crowded.width; x++) {
+            ArenaCell cell = { static_cast<int16_t>(x), static_cast<int16_t>(y) };
+            openCells += arena.grid[size_t(y) * crowded.width + x] == 0 && arena.food.findOn(cell) < 0 ? 1 : 0;
+        }
+    }
+    printf("crowded %dx%d board, %d food: %d on the board at the start, %d after %d ticks with %d free cells left without food\n",
+        crowded.width, crowded.height, crowded.foodCount, placedAtStart, placedAtEnd, ticks, openCells);
+    printf("PASS: every food item off the board is waiting to try again\n");
+    return 0;
+}
+
+// Components of the entity benchmark: snake heads, food, obstacles and sparks on one board
+struct EcsPosition { float x, y; };
+struct EcsVelocity { float x, y; };
+struct EcsHead { int snake; };
+struct EcsFood { float radius; int score; };
+struct EcsObstacle { float halfWidth, halfHeight; };
+struct EcsLifetime { float age, life; };
+struct EcsSprite { uint32_t texture; float size; };
+// Data outside the world that systems write, each with a bit of its own
+struct EcsEatenList {};
+struct EcsCrashList {};
+struct EcsDrawList {};
+
+const float ECS_BOARD = 1024.0f;
+const float ECS_DT = 1.0f / 60.0f;
+
+// The same objects the way a growing set of globals would end up: one struct with every field,
+// and a kind that says which of them mean anything
+enum EcsKind { KIND_HEAD, KIND_FOOD, KIND_OBSTACLE, KIND_SPARK };
+
+struct GameObject {
+    EcsKind kind;
+    bool removed;
+    EcsPosition position;
+    EcsVelocity velocity;
+    EcsHead head;
+    EcsFood food;
+    EcsObstacle obstacle;
+    EcsLifetime lifetime;
+    EcsSprite sprite;
+};
+
+struct EcsDraw {
+    float x, y;
+    uint32_t texture;
+    float size;
+};
+
+/*
+ * This function hashes two numbers into a spread of bits, so that where a respawned item
+ * goes depends only on the item and the tick and not on the order items are visited in
+*/
+
+static uint32_t ecsHash(uint32_t a, uint32_t b) {
+    uint32_t h = a * 0x9E3779B1u ^ (b + 0x7F4A7C15u + (a << 6) + (a >> 2));
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    return h ^ (h >> 16);
+}
+
+static float ecsUnit(uint32_t h) {
+    return (h & 0xFFFFFF) / 16777216.0f;
+}
+
+static uint32_t ecsQuantize(const EcsPosition& p) {
+    return static_cast<uint32_t>(p.x * 16.0f) * 4099u + static_cast<uint32_t>(p.y * 16.0f);
+}
+
+/*
+ * This function gives a spark a new start from where an old one ended
+*/
+
+static void respawnSpark(uint32_t tick, const EcsPosition& from, EcsPosition& position, EcsVelocity& velocity,
+    EcsLifetime& lifetime) {
+    uint32_t h = ecsHash(tick, ecsQuantize(from));
+    position.x = ecsUnit(h) * ECS_BOARD;
+    position.y = ecsUnit(ecsHash(h, 1)) * ECS_BOARD;
+    velocity.x = (ecsUnit(ecsHash(h, 2)) - 0.5f) * 200.0f;
+    velocity.y = (ecsUnit(ecsHash(h, 3)) - 0.5f) * 200.0f;
+    lifetime.age = 0.0f;
+    lifetime.life = 0.2f + ecsUnit(ecsHash(h, 4));
+}
+
+static void respawnFood(uint32_t tick, const EcsPosition& from, EcsPosition& position) {
+    uint32_t h = ecsHash(tick ^ 0x5555u, ecsQuantize(from));
+    position.x = ecsUnit(h) * ECS_BOARD;
+    position.y = ecsUnit(ecsHash(h, 1)) * ECS_BOARD;
+}
+
+/*
+ * This function moves a head or spark and bounces it off the board's edges
+*/
+
+static void moveBody(EcsPosition& position, EcsVelocity& velocity) {
+    position.x += velocity.x * ECS_DT;
+    position.y += velocity.y * ECS_DT;
+    if (position.x < 0.0f || position.x > ECS_BOARD) {
+        velocity.x = -velocity.x;
+    }
+    if (position.y < 0.0f || position.y > ECS_BOARD) {
+        velocity.y = -velocity.y;
+    }
+}
+
+// What a tick of either version did, summed so that visiting order does not matter
+struct EcsTickTotals {
+    uint64_t eaten = 0;
+    uint64_t crashes = 0;
+    uint64_t drawn = 0;
+    uint64_t expired = 0;
+    uint32_t positions = 0;
+};
+
+/*
+ * This function runs the entity benchmark: the same board of snake heads, food, obstacles
+ * and sparks ticked as one array of catch-all objects, and as archetype chunks with systems
+ * run in order and scheduled side by side. Every version has to end with the same totals.
+*/
+
+static int benchEcs(int argc, char** argv) {
+    int ticks = argc > 0 ? atoi(argv[0]) : 300;
+    int sparks = argc > 1 ? atoi(argv[1]) : 60000;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    const int heads = 64, foods = 20000, obstacles = 4000;
+    WorkerPool pool(threads);
+
+    // The starting board, shared by both versions
+    std::vector<GameObject> start;
+    for (int i = 0; i < heads + foods + obstacles + sparks; i++) {
+        GameObject object;
+        memset(&object, 0, sizeof(object));
+        uint32_t h = ecsHash(0xABCDu, i);
+        object.position.x = ecsUnit(h) * ECS_BOARD;
+        object.position.y = ecsUnit(ecsHash(h, 1)) * ECS_BOARD;
+        if (i < heads) {
+            object.kind = KIND_HEAD;
+            object.head.snake = i;
+            object.velocity.x = (ecsUnit(ecsHash(h, 2)) - 0.5f) * 600.0f;
+            object.velocity.y = (ecsUnit(ecsHash(h, 3)) - 0.5f) * 600.0f;
+            object.sprite = { 1, 8.0f };
+        }
+        else if (i < heads + foods) {
+            object.kind = KIND_FOOD;
+            object.food = { (i % 10 == 0) ? 16.0f : 8.0f, (i % 10 == 0) ? 2 : 1 };
+            object.sprite = { 2, object.food.radius };
+        }
+        else if (i < heads + foods + obstacles) {
+            object.kind = KIND_OBSTACLE;
+            object.obstacle = { 4.0f + ecsUnit(ecsHash(h, 4)) * 8.0f, 4.0f + ecsUnit(ecsHash(h, 5)) * 8.0f };
+            object.sprite = { 3, object.obstacle.halfWidth * 2.0f };
+        }
+        else {
+            object.kind = KIND_SPARK;
+            respawnSpark(0, object.position, object.position, object.velocity, object.lifetime);
+            object.lifetime.age = ecsUnit(ecsHash(h, 6)) * object.lifetime.life;
+            object.sprite = { 4, 2.0f };
+        }
+        start.push_back(object);
+    }
+    printf("%d heads, %d food, %d obstacles, %d sparks, %d ticks, %d threads\n", heads, foods, obstacles, sparks,
+        ticks, pool.size());
+
+    // Catch-all objects: every pass walks every object and skips the kinds it does not want
+    EcsTickTotals objectTotals;
+    double objectUs = 0.0;
+    {
+        std::vector<GameObject> objects = start;
+        std::vector<EcsPosition> headPositions;
+        std::vector<EcsDraw> draws;
+        auto begin = BenchClock::now();
+        for (uint32_t tick = 1; tick <= static_cast<uint32_t>(ticks); tick++) {
+            for (GameObject& object : objects) {
+                if (object.kind == KIND_HEAD || object.kind == KIND_SPARK) {
+                    moveBody(object.position, object.velocity);
+                }
+                if (object.kind == KIND_SPARK) {
+                    object.lifetime.age += ECS_DT;
+                }
+            }
+            headPositions.clear();
+            for (const GameObject& object : objects) {
+                if (object.kind == KIND_HEAD) {
+                    headPositions.push_back(object.position);
+                }
+            }
+            for (GameObject& object : objects) {
+                if (object.kind == KIND_FOOD) {
+                    for (const EcsPosition& head : headPositions) {
+                        float dx = head.x - object.position.x, dy = head.y - object.position.y;
+                        if (dx * dx + dy * dy < object.food.radius * object.food.radius) {
+                            object.removed = true;
+                            break;
+                        }
+                    }
+                }
+                else if (object.kind == KIND_OBSTACLE) {
+                    for (const EcsPosition& head : headPositions) {
+                        if (fabsf(head.x - object.position.x) < object.obstacle.halfWidth &&
+                            fabsf(head.y - object.position.y) < object.obstacle.halfHeight) {
+                            objectTotals.crashes++;
+                        }
+                    }
+                }
+            }
+            draws.clear();
+            for (const GameObject& object : objects) {
+                draws.push_back({ object.position.x, object.position.y, object.sprite.texture, object.sprite.size });
+            }
+            objectTotals.drawn += draws.size();
+            for (GameObject& object : objects) {
+                if (object.kind == KIND_FOOD && object.removed) {
+                    objectTotals.eaten++;
+                    respawnFood(tick, object.position, object.position);
+                    object.removed = false;
+                }
+                else if (object.kind == KIND_SPARK && object.lifetime.age >= object.lifetime.life) {
+                    objectTotals.expired++;
+                    respawnSpark(tick, object.position, object.position, object.velocity, object.lifetime);
+                }
+            }
+        }
+        objectUs = microseconds(begin, BenchClock::now()) / ticks;
+        for (const GameObject& object : objects) {
+            objectTotals.positions += ecsQuantize(object.position);
+        }
+    }
+
+    // Archetype chunks, the same rules as systems; run twice, in order and scheduled
+    EcsTickTotals chunkTotals[2];
+    double chunkUs[2] = {};
+    size_t phaseCount = 0, chunkCount = 0, archetypeCount = 0;
+    for (int run = 0; run < 2; run++) {
+        EntityWorld world;
+        for (const GameObject& object : start) {
+            switch (object.kind) {
+            case KIND_HEAD: world.create(object.position, object.velocity, object.head, object.sprite); break;
+            case KIND_FOOD: world.create(object.position, object.food, object.sprite); break;
+            case KIND_OBSTACLE: world.create(object.position, object.obstacle, object.sprite); break;
+            case KIND_SPARK: world.create(object.position, object.velocity, object.lifetime, object.sprite); break;
+            }
+        }
+        EcsTickTotals& totals = chunkTotals[run];
+        std::vector<EcsPosition> headPositions;
+        std::vector<Entity> eaten, expired;
+        std::vector<EcsDraw> draws;
+        uint64_t crashes = 0;
+        uint32_t tick = 0;
+
+        SystemScheduler scheduler;
+        scheduler.add("movement", componentMask<EcsVelocity>(), componentMask<EcsPosition>(), [&]() {
+            world.each<EcsPosition, EcsVelocity>([](uint32_t count, Entity*, EcsPosition* position,
+                EcsVelocity* velocity) {
+                for (uint32_t i = 0; i < count; i++) {
+                    moveBody(position[i], velocity[i]);
+                }
+            });
+        });
+        scheduler.add("aging", 0, componentMask<EcsLifetime>(), [&]() {
+            world.each<EcsLifetime>([](uint32_t count, Entity*, EcsLifetime* lifetime) {
+                for (uint32_t i = 0; i < count; i++) {
+                    lifetime[i].age += ECS_DT;
+                }
+            });
+        });
+        scheduler.add("pickup", componentMask<EcsPosition, EcsHead, EcsFood>(), componentMask<EcsEatenList>(), [&]() {
+            headPositions.clear();
+            world.each<EcsPosition, EcsHead>([&](uint32_t count, Entity*, EcsPosition* position, EcsHead*) {
+                headPositions.insert(headPositions.end(), position, position + count);
+            });
+            eaten.clear();
+            world.each<EcsPosition, EcsFood>([&](uint32_t count, Entity* entities, EcsPosition* position, EcsFood* food) {
+                for (uint32_t i = 0; i < count; i++) {
+                    float radius2 = food[i].radius * food[i].radius;
+                    for (const EcsPosition& head : headPositions) {
+                        float dx = head.x - position[i].x, dy = head.y - position[i].y;
+                        if (dx * dx + dy * dy < radius2) {
+                            eaten.push_back(entities[i]);
+                            break;
+                        }
+                    }
+                }
+            });
+        });
+        scheduler.add("collision", componentMask<EcsPosition, EcsHead, EcsObstacle>(), componentMask<EcsCrashList>(),
+            [&]() {
+            // Gathers its own copy of the heads, as pickup may be filling headPositions meanwhile
+            EcsPosition local[64];
+            int localCount = 0;
+            world.each<EcsPosition, EcsHead>([&](uint32_t count, Entity*, EcsPosition* position, EcsHead*) {
+                for (uint32_t i = 0; i < count && localCount < 64; i++) {
+                    local[localCount++] = position[i];
+                }
+            });
+            world.each<EcsPosition, EcsObstacle>([&](uint32_t count, Entity*, EcsPosition* position,
+                EcsObstacle* obstacle) {
+                for (uint32_t i = 0; i < count; i++) {
+                    for (int h = 0; h < localCount; h++) {
+                        if (fabsf(local[h].x - position[i].x) < obstacle[i].halfWidth &&
+                            fabsf(local[h].y - position[i].y) < obstacle[i].halfHeight) {
+                            crashes++;
+                        }
+                    }
+                }
+            });
+        });
+        scheduler.add("render prep", componentMask<EcsPosition, EcsSprite>(), componentMask<EcsDrawList>(), [&]() {
+            draws.clear();
+            world.each<EcsPosition, EcsSprite>([&](uint32_t count, Entity*, EcsPosition* position, EcsSprite* sprite) {
+                for (uint32_t i = 0; i < count; i++) {
+                    draws.push_back({ position[i].x, position[i].y, sprite[i].texture, sprite[i].size });
+                }
+            });
+        });
+        phaseCount = scheduler.phaseCount();
+
+        auto begin = BenchClock::now();
+        for (tick = 1; tick <= static_cast<uint32_t>(ticks); tick++) {
+            if (run == 0) {
+                scheduler.runSerial();
+            }
+            else {
+                scheduler.run(pool);
+            }
+            totals.drawn += draws.size();
+            // Adding and removing entities moves rows between chunks, so it waits until the
+            // systems are done
+            for (Entity entity : eaten) {
+                EcsPosition position = *world.get<EcsPosition>(entity);
+                EcsFood food = *world.get<EcsFood>(entity);
+                EcsSprite sprite = *world.get<EcsSprite>(entity);
+                world.destroy(entity);
+                respawnFood(tick, position, position);
+                world.create(position, food, sprite);
+            }
+            totals.eaten += eaten.size();
+            expired.clear();
+            world.each<EcsLifetime>([&](uint32_t count, Entity* entities, EcsLifetime* lifetime) {
+                for (uint32_t i = 0; i < count; i++) {
+                    if (lifetime[i].age >= lifetime[i].life) {
+                        expired.push_back(entities[i]);
+                    }
+                }
+            });
+            for (Entity entity : expired) {
+                EcsPosition position = *world.get<EcsPosition>(entity);
+                EcsVelocity velocity;
+                EcsLifetime lifetime;
+                EcsSprite sprite = *world.get<EcsSprite>(entity);
+                world.destroy(entity);
+                respawnSpark(tick, position, position, velocity, lifetime);
+                world.create(position, velocity, lifetime, sprite);
+            }
+            totals.expired += expired.size();
+        }
+        chunkUs[run] = microseconds(begin, BenchClock::now()) / ticks;
+        totals.crashes = crashes;
+        world.each<EcsPosition>([&](uint32_t count, Entity*, EcsPosition* position) {
+            for (uint32_t i = 0; i < count; i++) {
+                totals.positions += ecsQuantize(position[i]);
+            }
+        });
+        chunkCount = world.chunkCount();
+        archetypeCount = world.archetypeCount();
+    }
+
+    printf("%zu archetypes in %zu chunks of %zu bytes, %zu system phases\n", archetypeCount, chunkCount,
+        ECS_CHUNK_BYTES, phaseCount);
+    printf("%-22s %12s %10s\n", "layout", "us/tick", "speedup");
+    printf("%-22s %12.1f %10.2f\n", "objects", objectUs, 1.0);
+    printf("%-22s %12.1f %10.2f\n", "archetypes, in order", chunkUs[0], objectUs / chunkUs[0]);
+    printf("%-22s %12.1f %10.2f\n", "archetypes, scheduled", chunkUs[1], objectUs / chunkUs[1]);
+    printf("eaten %llu, crashes %llu, sparks expired %llu\n", (unsigned long long)objectTotals.eaten,
+        (unsigned long long)objectTotals.crashes, (unsigned long long)objectTotals.expired);
+    for (int run = 0; run < 2; run++) {
+        const EcsTickTotals& totals = chunkTotals[run];
+        if (totals.eaten != objectTotals.eaten || totals.crashes != objectTotals.crashes ||
+            totals.drawn != objectTotals.drawn || totals.expired != objectTotals.expired ||
+            totals.positions != objectTotals.positions) {
+            printf("FAIL: %s archetypes differ from the objects\n", run == 0 ? "in order" : "scheduled");
+            return 1;
+        }
+    }
+    printf("PASS: every layout ends with the same board\n");
+    return 0;
+}
+
+// State of one timer in the timer benchmark: its own generator, so the delays it draws do not
+// depend on the order timers fire in
+struct BenchTimer {
+    uint32_t random;
+    uint32_t due;
+};
+
+struct TimerBenchRun {
+    TimerWheel* wheel;
+    std::vector<BenchTimer>* timers;
+    uint32_t maxDelay;
+    uint64_t fired;
+};
+
+/*
+ * This function draws a timer's next delay, 1 to maxDelay ticks
+*/
+
+static uint32_t nextDelay(BenchTimer& timer, uint32_t maxDelay) {
+    timer.random ^= timer.random << 13;
+    timer.random ^= timer.random >> 17;
+    timer.random ^= timer.random << 5;
+    return 1 + timer.random % maxDelay;
+}
+
+static void rearmTimer(void* context, uint64_t index) {
+    TimerBenchRun& run = *static_cast<TimerBenchRun*>(context);
+    run.fired++;
+    BenchTimer& timer = (*run.timers)[index];
+    run.wheel->schedule(nextDelay(timer, run.maxDelay), rearmTimer, context, index);
+}
+
+/*
+ * This function is the coroutine version of a re-arming timer; it is destroyed by the wheel
+ * when the benchmark ends. The body never uses the wheel: the promise finds it through the
+ * first argument.
+*/
+
+static GameTask rearmTask([[maybe_unused]] TimerWheel& wheel, BenchTimer& timer, uint32_t maxDelay, uint64_t& fired) {
+    for (;;) {
+        co_await ticks(nextDelay(timer, maxDelay));
+        fired++;
+    }
+}
+
+/*
+ * This function runs the timer benchmark: many timers pending at once, each re-armed with a
+ * new random delay when it fires. The wheel (with callbacks and with coroutines) is compared
+ * with a binary heap and with checking every timer every tick. All of them must fire the
+ * same number of times.
+*/
+
+static int benchTimers(int argc, char** argv) {
+    int count = argc > 0 ? atoi(argv[0]) : 100000;
+    int ticks = argc > 1 ? atoi(argv[1]) : 3600;
+    uint32_t maxDelay = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 36000;
+
+    auto makeTimers = [count]() {
+        std::vector<BenchTimer> timers(count);
+        for (int i = 0; i < count; i++) {
+            timers[i].random = 2654435761u * (i + 1) | 1;
+            timers[i].due = 0;
+        }
+        return timers;
+    };
+    printf("%d timers pending, delays of 1 to %u ticks, %d ticks\n", count, maxDelay, ticks);
+    printf("%-20s %12s %12s %12s %12s\n", "method", "mean us", "p99 us", "fired", "ns/fired");
+    uint64_t expected = 0;
+    bool same = true;
+    auto report = [&](const char* name, std::vector<double>& samples, uint64_t fired) {
+        double total = 0.0;
+        for (double sample : samples) {
+            total += sample;
+        }
+        printf("%-20s %12.2f %12.2f %12llu %12.1f\n", name, total / samples.size(), percentile(samples, 0.99),
+            (unsigned long long)fired, fired > 0 ? total * 1000.0 / fired : 0.0);
+        if (expected == 0) {
+            expected = fired;
+        }
+        same = same && fired == expected;
+    };
+    std::vector<double> samples;
+    samples.reserve(ticks);
+
+    // Timer wheel with plain callbacks
+    {
+        std::vector<BenchTimer> timers = makeTimers();
+        TimerWheel wheel;
+        TimerBenchRun run = { &wheel, &timers, maxDelay, 0 };
+        for (int i = 0; i < count; i++) {
+            wheel.schedule(nextDelay(timers[i], maxDelay), rearmTimer, &run, i);
+        }
+        samples.clear();
+        for (int t = 1; t <= ticks; t++) {
+            auto begin = BenchClock::now();
+            wheel.advanceTo(t);
+            samples.push_back(microseconds(begin, BenchClock::now()));
+        }
+        report("wheel", samples, run.fired);
+        printf("%-20s %llu timers moved down a level\n", "", (unsigned long long)wheel.cascadedCount());
+    }
+
+    // Timer wheel with one coroutine per timer
+    {
+        std::vector<BenchTimer> timers = makeTimers();
+        TimerWheel wheel;
+        uint64_t fired = 0;
+        for (int i = 0; i < count; i++) {
+            rearmTask(wheel, timers[i], maxDelay, fired);
+        }
+        samples.clear();
+        for (int t = 1; t <= ticks; t++) {
+            auto begin = BenchClock::now();
+            wheel.advanceTo(t);
+            samples.push_back(microseconds(begin, BenchClock::now()));
+        }
+        report("wheel, coroutines", samples, fired);
+    }
+
+    // Binary heap ordered by due tick
+    {
+        std::vector<BenchTimer> timers = makeTimers();
+        typedef std::pair<uint32_t, uint32_t> Due;
+        std::priority_queue<Due, std::vector<Due>, std::greater<Due>> heap;
+        for (int i = 0; i < count; i++) {
+            heap.push(Due(nextDelay(timers[i], maxDelay), i));
+        }
+        uint64_t fired = 0;
+        samples.clear();
+        for (uint32_t t = 1; t <= static_cast<uint32_t>(ticks); t++) {
+            auto begin = BenchClock::now();
+            while (!heap.empty() && heap.top().first <= t) {
+                uint32_t index = heap.top().second;
+                heap.pop();
+                fired++;
+                heap.push(Due(t + nextDelay(timers[index], maxDelay), index));
+            }
+            samples.push_back(microseconds(begin, BenchClock::now()));
+        }
+        report("binary heap", samples, fired);
+    }
+
+    // Every timer checked every tick, the way dead bots used to be
+    {
+        std::vector<BenchTimer> timers = makeTimers();
+        for (BenchTimer& timer : timers) {
+            timer.due = nextDelay(timer, maxDelay);
+        }
+        uint64_t fired = 0;
+        samples.clear();
+        for (uint32_t t = 1; t <= static_cast<uint32_t>(ticks); t++) {
+            auto begin = BenchClock::now();
+            for (BenchTimer& timer : timers) {
+                if (timer.due <= t) {
+                    fired++;
+                    timer.due = t + nextDelay(timer, maxDelay);
+                }
+            }
+            samples.push_back(microseconds(begin, BenchClock::now()));
+        }
+        report("scan every tick", samples, fired);
+    }
+
+    if (!same) {
+        printf("FAIL: the methods fired a different number of timers\n");
+        return 1;
+    }
+    printf("PASS: every method fired %llu timers\n", (unsigned long long)expected);
+    return 0;
+}
+
+/*
+ * This function runs the logging benchmark: the food spawn message written the old way (a
+ * stream with std::endl, and fprintf with a flush) and through the log ring, all into the
+ * same file. Bursts of messages are timed, and the ring is drained between bursts so they
+ * measure the cost to the caller. Then several threads log at once and every message has
+ * to be either written or counted as dropped.
+*/
+
+static int benchLog(int argc, char** argv) {
+    int bursts = argc > 0 ? atoi(argv[0]) : 200;
+    const char* path = argc > 1 ? argv[1] : "/dev/null";
+    const int burst = 1000;
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        printf("could not open %s\n", path);
+        return 1;
+    }
+    std::ofstream stream(path);
+    logSetOutput(file, file);
+
+    printf("%d bursts of %d messages into %s\n", bursts, burst, path);
+    printf("%-22s %12s %12s\n", "method", "mean ns", "p99 ns");
+    std::vector<double> samples;
+    auto report = [&](const char* name) {
+        double total = 0.0;
+        for (double sample : samples) {
+            total += sample;
+        }
+        printf("%-22s %12.1f %12.1f\n", name, total * 1000.0 / (samples.size() * burst), percentile(samples, 0.99) * 1000.0 / burst);
+        samples.clear();
+    };
+    float x = 120.0f, y = 45.5f;
+    for (int b = 0; b < bursts; b++) {
+        auto begin = BenchClock::now();
+        for (int i = 0; i < burst; i++) {
+            stream << "Small" << " Food spawned at: (" << x + i << ", " << y << ")" << std::endl;
+        }
+        samples.push_back(microseconds(begin, BenchClock::now()));
+    }
+    report("stream, std::endl");
+    for (int b = 0; b < bursts; b++) {
+        auto begin = BenchClock::now();
+        for (int i = 0; i < burst; i++) {
+            fprintf(file, "%s Food spawned at: (%g, %g)\n", "Small", x + i, y);
+            fflush(file);
+        }
+        samples.push_back(microseconds(begin, BenchClock::now()));
+    }
+    report("fprintf, fflush");
+    LogStats before = logStats();
+    for (int b = 0; b < bursts; b++) {
+        auto begin = BenchClock::now();
+        for (int i = 0; i < burst; i++) {
+            LOG_INFO("%s Food spawned at: (%g, %g)", "Small", x + i, y);
+        }
+        samples.push_back(microseconds(begin, BenchClock::now()));
+        logFlush();
+    }
+    report("log ring");
+    LogStats after = logStats();
+    printf("written %llu, dropped %llu\n", (unsigned long long)(after.written - before.written),
+        (unsigned long long)(after.dropped - before.dropped));
+
+    // Several threads at once, each in bursts the size of the ring
+    const int threads = 4, perThread = 50000;
+    before = logStats();
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; t++) {
+        writers.emplace_back([t]() {
+            for (int i = 0; i < perThread; i++) {
+                LOG_INFO("thread %d message %d", t, i);
+                if (i % static_cast<int>(LOG_RING_RECORDS) == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        });
+    }
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+    logFlush();
+    after = logStats();
+    uint64_t written = after.written - before.written, dropped = after.dropped - before.dropped;
+    printf("%d threads x %d messages: written %llu, dropped %llu (%.1f%%)\n", threads, perThread, (unsigned long long)written,
+        (unsigned long long)dropped, 100.0 * dropped / (uint64_t(threads) * perThread));
+    logShutdown();
+    logSetOutput(stdout, stderr);
+    fclose(file);
+    if (written + dropped != uint64_t(threads) * perThread) {
+        printf("FAIL: %llu messages went missing\n", (unsigned long long)(uint64_t(threads) * perThread - written - dropped));
+        return 1;
+    }
+    printf("PASS: every message was written or counted as dropped\n");
+    return 0;
+}
+
+/*
+ * This function measures what a trace scope costs with and without a recording running, then
+ * ticks a busy arena on a pool of threads with and without recording, writes the trace and
+ * checks every recorded span made it into the file
+*/
+
+static int benchTrace(int argc, char** argv) {
+    int ticks = argc > 0 ? atoi(argv[0]) : 300;
+    const char* path = argc > 1 ? argv[1] : "/tmp/snake-bench-trace.json";
+    const int scopes = 1000000;
+    volatile int sink = 0;        // keeps the empty scopes from being optimized away
+    TRACE_THREAD("bench");
+
+    printf("%-26s %12s\n", "trace scope", "ns");
+    for (int recording = 0; recording < 2; recording++) {
+        if (recording) {
+            traceStart();
+        }
+        auto begin = BenchClock::now();
+        for (int i = 0; i < scopes; i++) {
+            TRACE_SCOPE("empty");
+            sink = sink + 1;
+        }
+        printf("%-26s %12.1f\n", recording ? "recording" : "not recording", microseconds(begin, BenchClock::now()) * 1000.0 / scopes);
+        traceStop();
+    }
+
+    ArenaConfig config;
+    config.snakeCount = 500;
+    config.player = false;
+    config.seed = 99;
+    WorkerPool pool(4);
+    printf("\n%d snakes, %d ticks on %d threads\n", config.snakeCount, ticks, pool.size());
+    printf("%-26s %12s %12s\n", "arena tick", "mean us", "p99 us");
+    for (int recording = 0; recording < 2; recording++) {
+        ArenaState arena;
+        initArena(arena, config);
+        if (recording) {
+            traceStart();
+        }
+        std::vector<double> samples;
+        for (int t = 0; t < ticks; t++) {
+            auto begin = BenchClock::now();
+            TRACE_SCOPE("tick");
+            stepArena(arena, RIGHT, pool);
+            samples.push_back(microseconds(begin, BenchClock::now()));
+        }
+        traceStop();
+        double mean = 0.0;
+        for (double sample : samples) {
+            mean += sample / samples.size();
+        }
+        printf("%-26s %12.1f %12.1f\n", recording ? "recording" : "not recording", mean, percentile(samples, 0.99));
+    }
+
+    TraceStats stats = traceStats();
+    auto begin = BenchClock::now();
+    if (!traceWrite(path)) {
+        printf("could not write %s\n", path);
+        return 1;
+    }
+    double writeMs = microseconds(begin, BenchClock::now()) / 1000.0;
+    std::ifstream file(path);
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    uint64_t spans = 0;
+    for (size_t at = text.find("\"ph\":\"X\""); at != std::string::npos; at = text.find("\"ph\":\"X\"", at + 1)) {
+        spans++;
+    }
+    printf("\n%llu spans on %d threads written to %s in %.1f ms (%zu KB), %llu overwritten\n", (unsigned long long)spans,
+        stats.threads, path, writeMs, text.size() / 1024, (unsigned long long)stats.overwritten);
+    if (spans != stats.recorded - stats.overwritten) {
+        printf("FAIL: %llu spans recorded, %llu written\n", (unsigned long long)(stats.recorded - stats.overwritten),
+            (unsigned long long)spans);
+        return 1;
+    }
+    printf("PASS: every span kept in the rings was written\n");
+    return 0;
+}
+
+/*
+ * This function measures what the flight recorder costs per event, then plays an arena with
+ * it running, makes one tick stall, and checks the dump it writes: the replay next to it must
+ * play back to the very state the hitch happened in
+*/
+
+static int benchHitch(int argc, char** argv) {
+    int ticks = argc > 0 ? atoi(argv[0]) : 600;
+    const char* directory = argc > 1 ? argv[1] : "/tmp";
+    const int events = 1000000;
+    FlightConfig config;
+    config.directory = directory;
+    config.frameMilliseconds = 0.0f;
+    config.tickMilliseconds = 10.0f;
+    FlightRecorder recorder;
+    recorder.init(config, 0.0);
+    auto begin = BenchClock::now();
+    for (int i = 0; i < events; i++) {
+        recorder.tick(i * 0.001, i, 1.0f);
+    }
+    printf("recording an event: %.1f ns\n", microseconds(begin, BenchClock::now()) * 1000.0 / events);
+
+    // a directory that can't exist must be refused up front, not lose the dump later
+    FlightConfig unwritable = config;
+    unwritable.directory = "/dev/null/hitch";
+    if (recorder.init(unwritable, 0.0)) {
+        printf("FAIL: the recorder accepted %s\n", unwritable.directory.c_str());
+        return 1;
+    }
+
+    Replay replay;
+    replay.mode = REPLAY_ARENA;
+    replay.arena.snakeCount = 200;
+    replay.arena.player = true;
+    replay.arena.seed = 4242;
+    ArenaState arena;
+    initArena(arena, replay.arena);
+    WorkerPool pool(1);
+    recorder.init(config, 0.0);
+    uint32_t seed = 5;
+    int stallAt = ticks / 2;
+    uint32_t dumpedTick = 0, dumpedHash = 0;
+    auto start = BenchClock::now();
+    for (int t = 0; t < ticks; t++) {
+        // the player turns now and then; the replay has to get the inputs right
+        seed = seed * 1664525u + 1013904223u;
+        Direction input = static_cast<Direction>((seed >> 28) & 3);
+        auto tickStart = BenchClock::now();
+        replay.record(&input);
+        stepArena(arena, input, pool);
+        if (t == stallAt) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(25));
+        }
+        double now = microseconds(start, BenchClock::now()) / 1e6;
+        if (recorder.tick(now, arena.tick, static_cast<float>(microseconds(tickStart, BenchClock::now()) / 1000.0))) {
+            dumpedTick = arena.tick;
+            dumpedHash = hashArena(arena);
+            recorder.dump(&replay, dumpedTick, dumpedHash);
+        }
+    }
+    recorder.finish();
+    printf("%d ticks, tick %d stalled for 25 ms: %d dump%s\n", ticks, stallAt + 1, recorder.dumps(), recorder.dumps() == 1 ? "" : "s");
+    if (recorder.dumps() != 1) {
+        printf("FAIL: expected exactly one dump\n");
+        return 1;
+    }
+    if (recorder.poll() != DUMP_WRITTEN) {
+        printf("FAIL: the dump to %s was not written\n", recorder.lastDump().c_str());
+        return 1;
+    }
+
+    std::ifstream file(recorder.lastDump());
+    std::string line, text;
+    unsigned int fileTick = 0, fileHash = 0;
+    int tickLines = 0;
+    while (std::getline(file, line)) {
+        sscanf(line.c_str(), "state: tick %u, hash %x", &fileTick, &fileHash);
+        char kind[16];
+        tickLines += sscanf(line.c_str(), "%*f %15s", kind) == 1 && strcmp(kind, "tick") == 0 ? 1 : 0;
+    }
+    std::string replayPath = recorder.lastDump().substr(0, recorder.lastDump().size() - 4) + ".replay";
+    Replay loaded;
+    if (!loadReplay(loaded, replayPath.c_str())) {
+        printf("FAIL: could not load %s\n", replayPath.c_str());
+        return 1;
+    }
+    ReplayPlayer player;
+    player.start(loaded);
+    auto replayStart = BenchClock::now();
+    while (player.tick() < fileTick && player.step(pool)) {
+    }
+    double replayMs = microseconds(replayStart, BenchClock::now()) / 1000.0;
+    printf("%s: %d tick events, replay of %u ticks (%zu bytes of input) played in %.1f ms\n", recorder.lastDump().c_str(),
+        tickLines, loaded.ticks(), loaded.inputs.size(), replayMs);
+    if (fileTick != dumpedTick || fileHash != dumpedHash || player.hash() != dumpedHash) {
+        printf("FAIL: replay reached tick %u hash %08x, the hitch was at tick %u hash %08x\n", player.tick(), player.hash(),
+            dumpedTick, dumpedHash);
+        return 1;
+    }
+    printf("PASS: the replay reproduces the state at the hitch (tick %u, hash %08x)\n", dumpedTick, dumpedHash);
+
+    // a classic game goes through the same file and player
+    Replay classic;
+    classic.seed = 77;
+    GameState game;
+    initGame(game, 1, classic.seed);
+    Direction direction = RIGHT;
+    for (int t = 0; t < ticks && !game.gameOver; t++) {
+        seed = seed * 1664525u + 1013904223u;
+        Direction turn = static_cast<Direction>((seed >> 28) & 3);
+        if (t % 20 == 0 && !isOppositeDirection(turn, direction)) {
+            direction = turn;
+        }
+        classic.record(&direction);
+        stepGame(game, &direction);
+    }
+    std::string classicPath = std::string(directory) + "/snake-bench-classic.replay";
+    Replay classicLoaded;
+    if (!saveReplay(classic, classicPath.c_str()) || !loadReplay(classicLoaded, classicPath.c_str())) {
+        printf("FAIL: could not save and load %s\n", classicPath.c_str());
+        return 1;
+    }
+    player.start(classicLoaded);
+    while (player.step(pool)) {
+    }
+    if (player.hash() != hashGameState(game)) {
+        printf("FAIL: the classic replay of %u ticks ended in a different state\n", classicLoaded.ticks());
+        return 1;
+    }
+    printf("PASS: a classic game of %u ticks replays to the same state\n", classicLoaded.ticks());
+    return 0;
+}
+
+/*
+ * This function fetches a path from a local HTTP server the way a scraper would
+ * @return the whole response, headers included, or "" if the connection failed
+*/
+
+static std::string httpGet(uint16_t port, const char* path) {
+    SocketHandle handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    NetAddress address;
+    address.host = htonl(INADDR_LOOPBACK);
+    address.port = htons(port);
+    sockaddr_in server = toSockaddr(address);
+    std::string response;
+    if (connect(handle, reinterpret_cast<sockaddr*>(&server), sizeof(server)) == 0) {
+        std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+        send(handle, request.data(), static_cast<int>(request.size()), 0);
+        char buffer[4096];
+        int received;
+        while ((received = recv(handle, buffer, sizeof(buffer), 0)) > 0) {
+            response.append(buffer, static_cast<size_t>(received));
+        }
+    }
+#ifdef _WIN32
+    closesocket(handle);
+#else
+    close(handle);
+#endif
+    return response;
+}
+
+/*
+ * This function reads the value of one sample line ("name value") from a metrics page
+ * @return the value, or -1 if the line is missing
+*/
+
+static double metricValue(const std::string& page, const std::string& name) {
+    size_t at = page.find("\n" + name + " ");
+    return at == std::string::npos ? -1.0 : atof(page.c_str() + at + name.size() + 2);
+}
+
+/*
+ * This function measures what recording a metric costs on one thread and on several at once,
+ * checks the histogram's quantiles against exact ones, and scrapes the metrics server over
+ * loopback while a thread keeps recording, to show scrapes don't slow recording down
+*/
+
+static int benchMetrics(int argc, char** argv) {
+    int samples = argc > 0 ? atoi(argv[0]) : 2000000;
+    int scrapes = argc > 1 ? atoi(argv[1]) : 200;
+    const int threads = 4;
+
+    printf("%-30s %12s\n", "recording", "ns");
+    {
+        Histogram histogram;
+        auto begin = BenchClock::now();
+        for (int i = 0; i < samples; i++) {
+            histogram.record(static_cast<uint64_t>(i & 65535));
+        }
+        printf("%-30s %12.1f\n", "histogram, 1 thread", microseconds(begin, BenchClock::now()) * 1000.0 / samples);
+
+        Counter counter;
+        begin = BenchClock::now();
+        for (int i = 0; i < samples; i++) {
+            counter.add();
+        }
+        printf("%-30s %12.1f\n", "counter, 1 thread", microseconds(begin, BenchClock::now()) * 1000.0 / samples);
+
+        Histogram shared;
+        std::vector<std::thread> workers;
+        begin = BenchClock::now();
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&shared, samples, t]() {
+                for (int i = 0; i < samples / threads; i++) {
+                    shared.record(static_cast<uint64_t>((i * 7 + t) & 65535));
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        char label[64];
+        snprintf(label, sizeof(label), "histogram, %d threads", threads);
+        printf("%-30s %12.1f\n", label, microseconds(begin, BenchClock::now()) * 1000.0 / samples);
+        if (shared.count() != static_cast<uint64_t>(samples / threads * threads)) {
+            printf("FAIL: %llu samples counted, %d recorded\n", (unsigned long long)shared.count(), samples / threads * threads);
+            return 1;
+        }
+    }
+
+    // frame-like times from 1 us to 100 ms, spread over five orders of magnitude
+    Histogram spread;
+    std::vector<double> exact;
+    uint32_t seed = 7;
+    for (int i = 0; i < 100000; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        uint64_t value = static_cast<uint64_t>(std::pow(10.0, 5.0 * (seed >> 8) / 16777216.0));
+        spread.record(value);
+        exact.push_back(static_cast<double>(value));
+    }
+    printf("\n%-30s %12s %12s %8s\n", "quantile", "exact us", "histogram", "error");
+    double worst = 0.0;
+    for (double fraction : { 0.5, 0.9, 0.99, 0.999 }) {
+        double truth = percentile(exact, fraction);
+        double found = static_cast<double>(spread.quantile(fraction));
+        double error = std::fabs(found - truth) / truth;
+        worst = std::max(worst, error);
+        printf("%-30.3f %12.0f %12.0f %7.2f%%\n", fraction, truth, found, error * 100.0);
+    }
+    if (worst > 0.02) {
+        printf("FAIL: a quantile is off by %.2f%%\n", worst * 100.0);
+        return 1;
+    }
+
+    // a game-like thread records frames and ticks while the server is scraped
+    GameMetrics metrics;
+    MetricsServer server;
+    if (!server.start(0, [&metrics]() { return metricsPage(metrics); })) {
+        printf("FAIL: could not open a port for the metrics server\n");
+        return 1;
+    }
+    std::atomic<bool> running{ true };
+    std::atomic<uint64_t> recorded{ 0 };
+    std::thread game([&]() {
+        uint64_t frames = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            metrics.frameTime.record(16000 + frames % 1000);
+            metrics.tickTime.record(100 + frames % 50);
+            metrics.foodEaten.add();
+            frames++;
+        }
+        recorded.store(frames);
+    });
+    std::vector<double> latencies;
+    size_t pageBytes = 0;
+    for (int i = 0; i < scrapes; i++) {
+        auto begin = BenchClock::now();
+        std::string response = httpGet(server.port(), "/metrics");
+        latencies.push_back(microseconds(begin, BenchClock::now()));
+        if (response.compare(0, 15, "HTTP/1.1 200 OK") != 0) {
+            printf("FAIL: scrape %d got \"%.40s\"\n", i, response.c_str());
+            running = false;
+            game.join();
+            return 1;
+        }
+        pageBytes = response.size();
+    }
+    running = false;
+    game.join();
+    uint64_t frames = recorded.load();
+    printf("\n%d scrapes of %zu bytes on port %u while %llu frames were recorded: p50 %.0f us, p99 %.0f us\n", scrapes, pageBytes,
+        server.port(), (unsigned long long)frames, percentile(latencies, 0.5), percentile(latencies, 0.99));
+
+    std::string response = httpGet(server.port(), "/metrics");
+    std::string page = response.substr(std::min(response.size(), response.find("\r\n\r\n") + 4));
+    if (metricValue(page, "snake_frame_seconds_count") != static_cast<double>(frames) ||
+        metricValue(page, "snake_frame_seconds_bucket{le=\"+Inf\"}") != static_cast<double>(frames) ||
+        metricValue(page, "snake_food_eaten_total") != static_cast<double>(frames) ||
+        metricValue(page, "snake_frame_seconds_bucket{le=\"0.016667\"}") < 0.0 ||
+        metricValue(page, "snake_allocations_total") <= 0.0) {
+        printf("FAIL: the page doesn't add up to the %llu frames recorded:\n%s", (unsigned long long)frames, page.c_str());
+        return 1;
+    }
+    if (httpGet(server.port(), "/other").compare(0, 12, "HTTP/1.1 404") != 0) {
+        printf("FAIL: an unknown path was not answered with 404\n");
+        return 1;
+    }
+    server.stop();
+    printf("PASS: the page counts every sample recorded, and unknown paths get 404\n");
+    return 0;
+}
+
+/*
+ * This function feeds a snake every tick, in place: its head is put back in the middle of the
+ * board before each tick and the food in front of it, so the body grows by 25 or 75 segments
+ * a tick without the snake ever reaching a wall
+ * @return the heap allocations the ticks made
+*/
+
+static uint64_t feedSnake(GameState& game, int ticks, std::vector<double>& samples) {
+    glm::vec2 center(windowWIDTH / 2.0f, windowHEIGHT / 2.0f);
+    Direction input = RIGHT;
+    uint64_t before = allocationCounts().allocations;
+    for (int t = 0; t < ticks; t++) {
+        game.snakes[0].body[0] = { center, RIGHT };
+        game.smallFood.position = center + glm::vec2(MOVE_STRIDE, 0.0f);
+        game.bigFood.position = game.smallFood.position;
+        auto begin = BenchClock::now();
+        stepGame(game, &input);
+        samples.push_back(microseconds(begin, BenchClock::now()));
+    }
+    return allocationCounts().allocations - before;
+}
+
+/*
+ * This function prints and checks the allocations of a steady-state run
+ * @return true if there were none
+*/
+
+static bool reportSteady(const char* what, uint64_t allocations, uint64_t steps) {
+    printf("%-34s %10llu %12llu\n", what, (unsigned long long)steps, (unsigned long long)allocations);
+    return allocations == 0;
+}
+
+/*
+ * This function measures what reserving the snake's body saves when it grows, then runs the
+ * simulations in their steady state, after a warm-up, and fails if any of them allocates:
+ * classic ticks with a bot, netplay-style rollbacks, arena ticks on worker threads with bots
+ * dying and respawning, replay recording and the frame scratch arena
+*/
+
+static int benchAlloc(int argc, char** argv) {
+    int ticks = argc > 0 ? atoi(argv[0]) : 20000;
+    const int feedTicks = 200;
+
+    printf("%-34s %10s %12s %12s %12s\n", "snake fed every tick", "segments", "allocations", "mean us", "max us");
+    for (int reserved = 0; reserved < 2; reserved++) {
+        GameState game;
+        initGame(game, 1, 77);
+        // a neck behind the head, so the new segments, which copy the tail, trail behind it
+        glm::vec2 center(windowWIDTH / 2.0f, windowHEIGHT / 2.0f);
+        game.snakes[0].body.assign({ { center, RIGHT }, { center - glm::vec2(MOVE_STRIDE, 0.0f), RIGHT } });
+        if (!reserved) {
+            game.snakes[0].body.shrink_to_fit();
+        }
+        std::vector<double> samples;
+        samples.reserve(feedTicks);
+        uint64_t allocations = feedSnake(game, feedTicks, samples);
+        double mean = 0.0;
+        for (double sample : samples) {
+            mean += sample / samples.size();
+        }
+        printf("%-34s %10zu %12llu %12.2f %12.2f\n", reserved ? "body reserved" : "body grown by push_back", game.snakes[0].body.size(),
+            (unsigned long long)allocations, mean, percentile(samples, 1.0));
+    }
+
+    printf("\n%-34s %10s %12s\n", "steady state", "steps", "allocations");
+    bool passed = true;
+
+    // classic: a bot plays, and a new game starts in the same state whenever it crashes
+    {
+        GameState game;
+        initGame(game, 1, 5);
+        uint32_t random = 11;
+        auto play = [&](int count) {
+            for (int t = 0; t < count; t++) {
+                if (game.gameOver) {
+                    initGame(game, 1, 5 + t);
+                }
+                Direction input = botDirection(game, 0, random);
+                stepGame(game, &input);
+            }
+        };
+        play(1000);
+        uint64_t before = allocationCounts().allocations;
+        play(ticks);
+        passed &= reportSteady("classic ticks and restarts", allocationCounts().allocations - before, ticks);
+    }
+
+    // rollback: snapshots saved every tick and restored every 8 ticks, as NetplaySession does
+    {
+        GameState current;
+        initGame(current, 2, 9);
+        GameState snapshots[ROLLBACK_WINDOW];
+        for (GameState& snapshot : snapshots) {
+            snapshot = current;
+            reserveGame(snapshot);
+        }
+        uint32_t random[MAX_PLAYERS] = { 3, 4 };
+        uint32_t frame = 0;
+        auto play = [&](int count) {
+            for (int t = 0; t < count; t++) {
+                if (current.gameOver) {
+                    initGame(current, 2, 9 + t);
+                }
+                if (frame % 8 == 7) {
+                    current = snapshots[(frame - 4) % ROLLBACK_WINDOW];
+                    frame -= 4;
+                }
+                snapshots[frame % ROLLBACK_WINDOW] = current;
+                Direction inputs[MAX_PLAYERS] = { botDirection(current, 0, random[0]), botDirection(current, 1, random[1]) };
+                stepGame(current, inputs);
+                frame++;
+            }
+        };
+        play(1000);
+        uint64_t before = allocationCounts().allocations;
+        play(ticks);
+        passed &= reportSteady("rollback saves and restores", allocationCounts().allocations - before, ticks);
+    }
+
+    // arena: 500 bots on 4 threads; bots crash and respawn through timed tasks all the time
+    {
+        ArenaConfig config;
+        config.snakeCount = 500;
+        config.player = false;
+        config.seed = 31;
+        ArenaState arena;
+        initArena(arena, config);
+        WorkerPool pool(4);
+        int arenaTicks = std::max(1, ticks / 10);
+        for (int t = 0; t < 3000; t++) {
+            stepArena(arena, RIGHT, pool);
+        }
+        uint64_t before = allocationCounts().allocations;
+        for (int t = 0; t < arenaTicks; t++) {
+            stepArena(arena, RIGHT, pool);
+        }
+        passed &= reportSteady("arena ticks, 500 bots, 4 threads", allocationCounts().allocations - before, arenaTicks);
+    }
+
+    // replay recording within the reserved hour, and a frame's scratch space
+    {
+        Replay replay;
+        replay.reserve(ticks);
+        FrameArena scratch(64 * 1024);
+        for (int frame = 0; frame < 10; frame++) {
+            scratch.reset();
+            scratch.allocate<ArenaCell>(20000);
+        }
+        uint64_t before = allocationCounts().allocations;
+        Direction direction = UP;
+        for (int t = 0; t < ticks; t++) {
+            replay.record(&direction);
+            scratch.reset();
+            size_t mark = scratch.mark();
+            scratch.allocate<ArenaCell>(4096);
+            scratch.rewind(mark);
+            scratch.allocate<ArenaCell>(static_cast<size_t>(t % 20000));
+        }
+        passed &= reportSteady("replay recording and frame arena", allocationCounts().allocations - before, ticks);
+        printf("frame arena grew to %zu KB after %llu heap fallbacks\n", scratch.capacity() / 1024, (unsigned long long)scratch.overflows());
+    }
+
+    if (!passed) {
+        printf("FAIL: the steady state allocated\n");
+        return 1;
+    }
+    printf("PASS: nothing allocated in the steady state\n");
+    return 0;
+}
+
+// Table of available benchmarks
+struct Benchmark {
+    const char* name;
+    int (*run)(int argc, char** argv);
+    const char* description;
+};
+
+static const Benchmark benchmarks[] = {
+    { "rollback", benchRollback, "[iterations] restore + re-simulate 8/10 ticks at several snake lengths" },
+    { "loopback", benchLoopback, "[frames] [port] two netplay peers over UDP loopback must end in the same state" },
+    { "arena", benchArena, "[snakes] [ticks] [threads] arena tick time, and the same result on 1 and N threads" },
+    { "food", benchFood, "[samples] food placement on a 50-99% full board and pickup checks" },
+    { "ecs", benchEcs, "[ticks] [sparks] [threads] heads, food, obstacles and sparks as objects and as archetype chunks" },
+    { "timers", benchTimers, "[timers] [ticks] [max delay] timer wheel against a heap and a scan, many timers pending" },
+    { "trace", benchTrace, "[ticks] [file] cost of a trace scope, arena ticks with and without recording, and the trace file" },
+    { "hitch", benchHitch, "[ticks] [directory] flight recorder cost, and a stalled tick's dump replayed to the same state" },
+    { "metrics", benchMetrics, "[samples] [scrapes] cost of recording a metric, quantile accuracy, and scrapes over loopback" },
+    { "alloc", benchAlloc, "[ticks] body growth with and without reserving, and no allocations in steady-state ticks" },
+    { "log", benchLog, "[bursts] [file] cost to the caller of a log message, against writing it directly" },
+    { "codec", benchCodec, "[ticks] snapshot bytes per tick and encode/decode time at several snake lengths" },
+};
+
+/*
+ * main method runs the benchmark named on the command line
+*/
+
+int main(int argc, char** argv) {
+    if (argc >= 2) {
+        for (const Benchmark& benchmark : benchmarks) {
+            if (strcmp(argv[1], benchmark.name) == 0) {
+                return benchmark.run(argc - 2, argv + 2);
+            }
+        }
+    }
+    printf("usage: %s <benchmark> [options]\n", argv[0]);
+    for (const Benchmark& benchmark : benchmarks) {
+        printf("  %-12s %s\n", benchmark.name, benchmark.description);
+    }
+    return argc >= 2 ? 1 : 0;
+}
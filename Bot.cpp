@@ -0,0 +1,70 @@
+/*
+ * Title: Test bots
+ * Description: Implementation of the bot helpers declared in Bot.h.
+*/
+
+#include "Bot.h"
+#include <cmath>
+
+/*
+ * This function checks whether moving the head one stride in a direction would end the game
+*/
+
+bool isSafeMove(const GameState& state, int player, Direction direction) {
+    const Square& head = state.snakes[player].body[0];
+    if (isOppositeDirection(head.direction, direction)) {
+        return false;
+    }
+    glm::vec2 next = head.position;
+    next.x += direction == RIGHT ? MOVE_STRIDE : (direction == LEFT ? -MOVE_STRIDE : 0.0f);
+    next.y += direction == UP ? MOVE_STRIDE : (direction == DOWN ? -MOVE_STRIDE : 0.0f);
+    // stay a little further from the walls than needed so there is room to turn
+    const float margin = WALL_THICKNESS + SQUARE_SIZE;
+    if (next.x < margin || next.x >= windowWIDTH - margin || next.y < margin || next.y >= windowHEIGHT - margin) {
+        return false;
+    }
+    // keep half a square away from every body; the bot's own neck is always that close, so
+    // its own segments are only checked from one square behind the head onwards
+    const size_t neck = static_cast<size_t>(SQUARE_SIZE / MOVE_STRIDE);
+    for (size_t s = 0; s < state.snakes.size(); s++) {
+        const std::vector<Square>& body = state.snakes[s].body;
+        for (size_t i = (int(s) == player ? neck : 0); i < body.size(); i++) {
+            if (glm::distance(next, body[i].position) < SQUARE_SIZE / 2) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * This function picks a direction for a test bot: head towards the food and avoid dying
+ * @param state: the bot's view of the game
+ * @param player: index of the bot's snake
+ * @param random: the bot's own random generator state, updated on every call
+*/
+
+Direction botDirection(const GameState& state, int player, uint32_t& random) {
+    const Square& head = state.snakes[player].body[0];
+    glm::vec2 target = state.bigFoodOnScreen ? state.bigFood.position : state.smallFood.position;
+    glm::vec2 delta = target - head.position;
+    Direction preferred;
+    if (std::abs(delta.x) > std::abs(delta.y)) {
+        preferred = delta.x > 0 ? RIGHT : LEFT;
+    }
+    else {
+        preferred = delta.y > 0 ? UP : DOWN;
+    }
+    // now and then do something unexpected so the other side mispredicts
+    random = random * 1664525u + 1013904223u;
+    if ((random >> 24) < 16) {
+        preferred = static_cast<Direction>((random >> 8) % 4);
+    }
+    for (int i = 0; i < 4; i++) {
+        Direction candidate = static_cast<Direction>((preferred + i) % 4);
+        if (isSafeMove(state, player, candidate)) {
+            return candidate;
+        }
+    }
+    return preferred;
+}
@@ -0,0 +1,13 @@
+/*
+ * Title: Test bots
+ * Description: Simple computer players used by the benchmarks and the load-test client.
+ *      A bot heads for the food, avoids walls and bodies one step ahead, and now and then
+ *      turns at random so that netplay predictions are wrong often enough to be exercised.
+*/
+
+#pragma once
+
+#include "Game.h"
+
+bool isSafeMove(const GameState& state, int player, Direction direction);
+Direction botDirection(const GameState& state, int player, uint32_t& random);
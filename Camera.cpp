@@ -0,0 +1,91 @@
+/*
+ * Title: Camera
+ * Description: Implementation of the camera declared in Camera.h.
+*/
+
+#include "Camera.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+
+const float CAMERA_FOLLOW_RATE = 10.0f;   // per second; higher follows more tightly
+const float CAMERA_MAX_ZOOM = 4.0f;
+
+void Camera::setBounds(float width, float height) {
+    boundsWidth = width;
+    boundsHeight = height;
+    clamp();
+}
+
+void Camera::setViewport(int width, int height) {
+    viewportWidth = std::max(1, width);
+    viewportHeight = std::max(1, height);
+    clamp();
+}
+
+/*
+ * This function moves the camera part of the way to a target. The fraction depends on the
+ * time passed in a way that gives the same motion at any frame rate.
+ * @param target: the point to look at, in world units
+ * @param deltaTime: seconds since the last call
+*/
+
+void Camera::follow(glm::vec2 target, float deltaTime) {
+    float blend = 1.0f - std::exp(-CAMERA_FOLLOW_RATE * deltaTime);
+    position += (target - position) * blend;
+    clamp();
+}
+
+void Camera::lookAt(glm::vec2 target) {
+    position = target;
+    clamp();
+}
+
+void Camera::zoomBy(float factor) {
+    setZoom(scale * factor);
+}
+
+void Camera::setZoom(float zoom) {
+    scale = std::min(CAMERA_MAX_ZOOM, std::max(minimumZoom(), zoom));
+    clamp();
+}
+
+float Camera::minimumZoom() const {
+    if (boundsWidth <= 0.0f || boundsHeight <= 0.0f) {
+        return 1.0f / 64.0f;
+    }
+    // zooming out further would only add empty space on both sides
+    return std::min(viewportWidth / boundsWidth, viewportHeight / boundsHeight);
+}
+
+glm::mat4 Camera::projection() const {
+    ViewRect view = visibleRect();
+    return glm::ortho(view.left, view.right, view.bottom, view.top);
+}
+
+/*
+ * This function returns the world rectangle the projection maps onto the framebuffer. Its
+ * shape always matches the framebuffer, so nothing gets stretched.
+*/
+
+ViewRect Camera::visibleRect() const {
+    float halfWidth = 0.5f * viewportWidth / scale;
+    float halfHeight = 0.5f * viewportHeight / scale;
+    return { position.x - halfWidth, position.y - halfHeight, position.x + halfWidth, position.y + halfHeight };
+}
+
+/*
+ * This function keeps the view on the board. Along an axis where the board is smaller than
+ * the view, the board is centered instead.
+*/
+
+void Camera::clamp() {
+    if (boundsWidth <= 0.0f || boundsHeight <= 0.0f) {
+        return;
+    }
+    scale = std::max(scale, minimumZoom());
+    float halfWidth = 0.5f * viewportWidth / scale;
+    float halfHeight = 0.5f * viewportHeight / scale;
+    position.x = halfWidth * 2.0f >= boundsWidth ? boundsWidth * 0.5f : std::min(boundsWidth - halfWidth, std::max(halfWidth, position.x));
+    position.y = halfHeight * 2.0f >= boundsHeight ? boundsHeight * 0.5f : std::min(boundsHeight - halfHeight, std::max(halfHeight, position.y));
+}
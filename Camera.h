@@ -0,0 +1,51 @@
+/*
+ * Title: Camera
+ * Description: A 2D camera for boards larger than the window. It follows a point smoothly,
+ *      zooms, keeps the view on the board and builds the projection for the current
+ *      framebuffer size, so the picture keeps its aspect ratio when the window is resized.
+ *      World units are the game's pixels; at zoom 1 one of them covers one screen pixel.
+*/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// The part of the world that is on screen, in world units
+struct ViewRect {
+    float left;
+    float bottom;
+    float right;
+    float top;
+};
+
+class Camera {
+public:
+    // Size of the board in world units; the view is kept on it
+    void setBounds(float width, float height);
+    // Size of the framebuffer in pixels
+    void setViewport(int width, int height);
+    // Moves toward target, covering most of the way in about a quarter of a second
+    void follow(glm::vec2 target, float deltaTime);
+    // Jumps straight to target
+    void lookAt(glm::vec2 target);
+    // Multiplies the zoom, within the limits; factor > 1 zooms in
+    void zoomBy(float factor);
+    void setZoom(float zoom);
+    // Smallest zoom that still has the board fill the view in one direction
+    float minimumZoom() const;
+
+    glm::mat4 projection() const;
+    ViewRect visibleRect() const;
+    glm::vec2 center() const { return position; }
+    float zoom() const { return scale; }
+
+private:
+    void clamp();
+
+    glm::vec2 position = glm::vec2(0.0f);
+    float scale = 1.0f;
+    float boundsWidth = 0.0f;     // 0 means no bounds
+    float boundsHeight = 0.0f;
+    int viewportWidth = 1;
+    int viewportHeight = 1;
+};
@@ -0,0 +1,29 @@
+/*
+ * Title: Classic backend
+ * Description: The walk over a classic game state declared in ClassicBackend.h.
+*/
+
+#include "ClassicBackend.h"
+
+void drawClassicBoard(ClassicBackend& backend, const GameState& state, const glm::mat4& projection) {
+    backend.beginBoard(projection);
+    // Draw each segment of every snake
+    for (size_t s = 0; s < state.snakes.size(); s++) {
+        const std::vector<Square>& snake = state.snakes[s].body;
+        for (size_t i = 0; i < snake.size(); i++) {
+            if (i == 0) {// the head; the second player gets a different one
+                backend.drawSprite(snake[i], s == 0 ? CLASSIC_HEAD_1 : CLASSIC_HEAD_2);
+            }
+            else {// body segments
+                backend.drawSprite(snake[i], CLASSIC_BODY);
+            }
+        }
+    }
+    // Draw the food depending on which one needs to be rendered
+    if (state.bigFoodOnScreen) {
+        backend.drawSprite(state.bigFood, CLASSIC_BIG_FOOD);
+    }
+    else {
+        backend.drawSprite(state.smallFood, CLASSIC_FOOD);
+    }
+}
@@ -0,0 +1,41 @@
+/*
+ * Title: Classic backend
+ * Description: What drawing the classic game asks of a renderer: the background, and a sprite
+ *      on a square for each snake segment and the food. ClassicRenderer.h does it with OpenGL
+ *      and SoftwareRenderer.h on the CPU, and drawClassicBoard() walks the game state the same
+ *      way for both, so they draw the same squares in the same order.
+*/
+
+#pragma once
+
+#include "Game.h"
+#include <glm/glm.hpp>
+
+enum ClassicSprite {
+    CLASSIC_BODY,
+    CLASSIC_HEAD_1,
+    CLASSIC_HEAD_2,                       // the second player's head
+    CLASSIC_FOOD,
+    CLASSIC_BIG_FOOD,                     // the food texture on a square twice the size
+    CLASSIC_SPRITES
+};
+
+// Half the width of a sprite's square in world units
+inline float classicHalfSize(ClassicSprite sprite) {
+    return sprite == CLASSIC_BIG_FOOD ? SQUARE_SIZE : SQUARE_SIZE / 2.0f;
+}
+
+class ClassicBackend {
+public:
+    virtual ~ClassicBackend() {}
+    // Draws the background over the whole board
+    virtual void drawBackground(const glm::mat4& projection) = 0;
+    // Called before the squares of a board are drawn
+    virtual void beginBoard(const glm::mat4& projection) = 0;
+    // Draws a sprite on a square around square.position, turned to face square.direction.
+    // Texels with alpha under 0.1 are left out.
+    virtual void drawSprite(const Square& square, ClassicSprite sprite) = 0;
+};
+
+// Draws every snake, head first, then the food that is on screen
+void drawClassicBoard(ClassicBackend& backend, const GameState& state, const glm::mat4& projection);
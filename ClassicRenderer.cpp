@@ -0,0 +1,333 @@
+/*
+ * Title: Classic renderer
+ * Description: Implementation of the classic game's drawing declared in ClassicRenderer.h.
+*/
+
+#include "ClassicRenderer.h"
+#include "GlStats.h"
+#include "Log.h"
+#include "Shader.h"
+#include "stb_image.h"
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Vertex shader source code
+static const char* vertexShaderSource = R"glsl(
+    #version 330 core
+    layout (location = 0) in vec2 aPos;
+    layout (location = 1) in vec2 aTexCoord;
+    uniform mat4 model;
+    uniform mat4 projection;
+    out vec2 TexCoord;
+    void main() {
+        // apply projection to map the coordinates to the window
+        gl_Position = projection * model * vec4(aPos, 0.0, 1.0);
+        TexCoord = aTexCoord;
+    }
+)glsl";
+
+// Fragment shader souce code
+static const char* fragmentShaderSource = R"glsl(
+    #version 330 core
+    out vec4 FragColor;
+    in vec2 TexCoord;
+    uniform sampler2D texture1;
+    uniform vec4 color;
+    uniform bool useTexture;
+    void main() {
+        if (useTexture) {
+        vec4 texColor = texture(texture1, TexCoord);
+            if (texColor.a < 0.1) // Discard nearly transparent pixels
+                discard;
+                FragColor = texColor;
+        } else {
+            FragColor = color;
+        }
+    }
+)glsl";
+
+/*
+ * This function sets up the vertex buffer objects and vertex array object for the snake segments and food
+ * @param registry: keeps the vertex array and its vertex and index buffers
+ * @param isBigFood: boolean flag indicating whether to set up buffers for big food (true) or regular square (false)
+ * @return the Vertex Array Object for the square
+*/
+
+static GLuint setupSnakeBuffers(GlRegistry& registry, bool isBigFood) {
+    // Determine the size of the square based on whether it's big food or not
+    float halfSquareSize;
+    if (isBigFood == true) {
+        halfSquareSize = SQUARE_SIZE;
+    
+    } 
+    else{
+        halfSquareSize = SQUARE_SIZE / 2.0;
+    }
+    // Define vertex data for the square, including positions and texture coordinates
+    float vertices[] = {
+        // positions                         // texture coords
+         halfSquareSize,  halfSquareSize, 0.0f,  1.0f, 1.0f,  // top right
+         halfSquareSize, -halfSquareSize, 0.0f,  1.0f, 0.0f,  // bottom right
+        -halfSquareSize, -halfSquareSize, 0.0f,  0.0f, 0.0f,  // bottom left
+        -halfSquareSize,  halfSquareSize, 0.0f,  0.0f, 1.0f   // top left
+    };
+    // Define indices for drawing the square using two triangles
+    unsigned int indices[] = {
+        0, 1, 3,
+        1, 2, 3
+    };
+
+    // Generate and bind Vertex Array Object (VAO) and a buffer; the registry owns them from here
+    GLuint squareVBO = registry.create(GL_OBJECT_BUFFER);
+    GLuint EBO = registry.create(GL_OBJECT_BUFFER);
+    GLuint squareVAO = registry.create(GL_OBJECT_VERTEX_ARRAY);
+    glBindVertexArray(squareVAO);
+    // bind the VBO
+    glBindBuffer(GL_ARRAY_BUFFER, squareVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // bind the VBE
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    // Position attribute
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    // Texture coordinate attribute
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // Unbind the VBO and VAO to prevent accidental modifications
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    return squareVAO;
+}
+
+/*
+* This function renders a square to the screen after applying transformation
+* @param square: snake segment or food of type Square
+* @param shaderProgram: the integer id of shader program to render the square
+* @param VAO: Vertex Array Object that contains information about the square
+*/
+
+static void drawSquare(const Square& square, unsigned int shaderProgram, unsigned int VAO, bool useTexture, unsigned int textureID, glm::vec3 color) {
+    GL_SITE("drawSquare");
+    // Initialize identity matrix
+    glm::mat4 identity = glm::mat4(1.0f);
+    // Pass the identity matrix to the model matrix to do the translation operation
+    glm::mat4 model = glm::translate(identity, glm::vec3(square.position, 0.0f));
+
+    if (square.direction == UP) {
+        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+    else if (square.direction == DOWN) {
+        model = glm::rotate(model, glm::radians(270.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+    else if (square.direction == RIGHT) {
+        model = glm::rotate(model, glm::radians(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+    else { // direction LEFT
+        model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+
+
+
+    // Send the model matrix to the vertex shader 
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    // Get the location of "useTexture" variable in the fragment shader and set the useTexture field to either true or false
+    glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), useTexture);
+    // Get the location of "color" variable in the fragment shader and give it a color
+    glUniform4f(glGetUniformLocation(shaderProgram, "color"), color.x, color.y, color.z, 1.0f);
+
+    // If a food or snake has a texture, then use that texture in the fragment shader and bypass color attribute
+    if (useTexture) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
+    }
+
+    glBindVertexArray(VAO);
+    // Draw the square as two triangles, from the four vertices in the buffer (past them the
+    // driver fetches whatever it likes)
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+}
+
+/*
+ * This function sets up the vertex buffer objects and vertex array object for the background texture
+ * @param registry: keeps the vertex array and its buffer
+ * @return the Vertex Array Object for the background
+*/
+
+static GLuint setupBackgroundBuffers(GlRegistry& registry) {
+    // Wall vertices (outline of the game window)
+    /*
+        Texture coordinate for background that covers the entire screen
+        It forms two triangles with 3 vertices, each with its texture coordinates
+    */
+
+    float backgroundVertices[] = {
+    0.0f, 0.0f, 0.0f, 0.0f,        // Bottom-left
+    windowWIDTH, 0.0f, 1.0f, 0.0f, // Bottom-right
+    windowWIDTH, windowHEIGHT, 1.0f, 1.0f, // Top-right
+    0.0f, windowHEIGHT, 0.0f, 1.0f // Top-left
+    };
+
+    // Generate the VAO and VBO
+    GLuint backgroundVBO = registry.create(GL_OBJECT_BUFFER);
+    GLuint backgroundVAO = registry.create(GL_OBJECT_VERTEX_ARRAY);
+
+    // Bind the VAO
+    glBindVertexArray(backgroundVAO);
+
+    // Bind the VBO and set the buffer data
+    glBindBuffer(GL_ARRAY_BUFFER, backgroundVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(backgroundVertices), backgroundVertices, GL_STATIC_DRAW);
+
+    // Set up vertex attribute pointers
+    // first 2 elements in the background vertex is for position
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    // second 2 elements in the background vertex is for texture
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // Unbind the VBO and VAO to avoid accidental modifications
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    return backgroundVAO;
+}
+
+/*
+ * This function renders the background texture to the screen
+ * @param shaderProgram: the integer id of shader program to render the background
+ * @param backgroundVAO: Vertex Array Object that contains information about the background quad
+ * @param backgroundTextureID: the ID of the background texture to be rendered
+ * @param projection: the projection matrix for transforming coordinates
+*/
+
+static void useBackgroundTexture(unsigned int shaderProgram, GLuint backgroundVAO, unsigned int backgroundTextureID, glm::mat4 projection) {
+
+    glm::mat4 backgroundModel = glm::mat4(1.0f);
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(backgroundModel));
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+
+    glBindVertexArray(backgroundVAO);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, backgroundTextureID);
+    glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
+    glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), GL_TRUE);
+
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glBindVertexArray(0);
+}
+
+/*
+* This function loads a texture from a user provided file path and generates an int texture ID
+* @param path: path to the texture to be loaded as string
+* @return textureID: the loaded texture, or no texture if the file could not be loaded
+*/
+
+static GlTexture loadTexture(char const* path)
+{
+    stbi_set_flip_vertically_on_load(true);
+    // Generate a texture object with its ID as well; the handle deletes it again on failure
+    GlTexture textureID = GlTexture::create();
+
+    // Variables to hold texture dimensions and component count
+    int width, height, nrComponents;
+    // Load the texture data
+    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
+
+    if (data) // Check if the texture data was loaded witout any issues
+    {
+        // Determine the format based on the number of components
+        GLenum format = GL_RGB; //rgb is the default
+        if (nrComponents == 1)
+            format = GL_RED;
+        else if (nrComponents == 3)
+            format = GL_RGB;
+        else if (nrComponents == 4)
+            format = GL_RGBA;
+
+        glBindTexture(GL_TEXTURE_2D, textureID.get());
+        // Set the texture image data
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        // create a mipmaps for the texture
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        // Set the texture wrapping and filtering parameters
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        // Free the loaded image data
+        stbi_image_free(data);
+    }
+    else // Handle loading failure
+    {
+        LOG_ERROR("Texture failed to load at path: %s", path);
+        stbi_image_free(data);
+        return GlTexture();
+    }
+    //return the texture ID
+    return textureID;
+}
+
+/*
+ * This function makes every GL object the classic game draws with. The head and the small food
+ * get vertex arrays of their own, the same shape as the body's, and the big food a larger one.
+*/
+
+void ClassicRenderer::init() {
+    shaderProgram = registry.add(GlProgram(createShaderProgram(vertexShaderSource, fragmentShaderSource)));
+    squareVAO = setupSnakeBuffers(registry, false);
+    headVAO = setupSnakeBuffers(registry, false);
+    smallFoodVAO = setupSnakeBuffers(registry, false);
+    bigFoodVAO = setupSnakeBuffers(registry, true);
+    backgroundVAO = setupBackgroundBuffers(registry);
+    body = registry.add(loadTexture("textures/body3.png"));
+    heads[0] = registry.add(loadTexture("textures/head1.png"));
+    heads[1] = registry.add(loadTexture("textures/head2.png"));
+    food = registry.add(loadTexture("textures/food.png"));
+    background = registry.add(loadTexture("textures/snakeBackground.png"));
+}
+
+void ClassicRenderer::drawBackground(const glm::mat4& projection) {
+    glUseProgram(shaderProgram);
+    useBackgroundTexture(shaderProgram, backgroundVAO, background, projection);
+    draws++;
+}
+
+void ClassicRenderer::beginBoard(const glm::mat4& projection) {
+    // Use shader program to render
+    glUseProgram(shaderProgram);
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+
+    // Bind the VAO
+    glBindVertexArray(squareVAO);
+}
+
+void ClassicRenderer::drawSprite(const Square& square, ClassicSprite sprite) {
+    switch (sprite) {
+    case CLASSIC_BODY:
+        drawSquare(square, shaderProgram, squareVAO, true, body, glm::vec3(0.0, 1.0, 0.0));
+        break;
+    case CLASSIC_HEAD_1:
+    case CLASSIC_HEAD_2:
+        drawSquare(square, shaderProgram, headVAO, true, heads[sprite - CLASSIC_HEAD_1], glm::vec3(0.0, 1.0, 0.0));
+        break;
+    case CLASSIC_FOOD:
+        drawSquare(square, shaderProgram, smallFoodVAO, true, food, glm::vec3(0.0, 1.0, 0.0));
+        break;
+    default:
+        drawSquare(square, shaderProgram, bigFoodVAO, true, food, glm::vec3(0.0, 1.0, 0.0));
+        break;
+    }
+    draws++;
+}
+
+void ClassicRenderer::release() {
+    registry.release();
+}
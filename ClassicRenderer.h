@@ -0,0 +1,52 @@
+/*
+ * Title: Classic renderer
+ * Description: Draws the classic game: the background, then a textured square per snake
+ *      segment and one for the food, each with its own draw call.
+ *
+ *      init() makes every GL object the game draws with (the shader program, the squares'
+ *      and background's buffers and the textures) into one GlRegistry, and release() deletes
+ *      them together. Nothing in between makes or deletes any, so restarting a game only
+ *      resets its GameState and the next frame draws with the same objects.
+ *
+ *      It is the OpenGL ClassicBackend; SoftwareRenderer.h draws the same frames on the CPU.
+*/
+
+#pragma once
+
+#include "ClassicBackend.h"
+#include "GlResources.h"
+
+class ClassicRenderer : public ClassicBackend {
+public:
+    // Needs a current OpenGL 3.3 context; loads the textures from textures/
+    void init();
+    void drawBackground(const glm::mat4& projection) override;
+    void beginBoard(const glm::mat4& projection) override;
+    void drawSprite(const Square& square, ClassicSprite sprite) override;
+    // Draws every snake, then the food that is on screen
+    void drawBoard(const GameState& state, const glm::mat4& projection) { drawClassicBoard(*this, state, projection); }
+    void release();
+
+    // The arena renderer draws with the same textures
+    unsigned int bodyTexture() const { return body; }
+    unsigned int headTexture(int player) const { return heads[player]; }
+    unsigned int foodTexture() const { return food; }
+    // Every GL object made by init()
+    const GlRegistry& resources() const { return registry; }
+    // Draw calls made since init(), counted here so that nothing has to wrap the GL calls
+    uint64_t drawCalls() const { return draws; }
+
+private:
+    GlRegistry registry;
+    unsigned int shaderProgram = 0;
+    unsigned int squareVAO = 0;
+    unsigned int headVAO = 0;
+    unsigned int smallFoodVAO = 0;
+    unsigned int bigFoodVAO = 0;
+    unsigned int backgroundVAO = 0;
+    unsigned int body = 0;
+    unsigned int heads[MAX_PLAYERS] = {};  // the second player gets a different head
+    unsigned int food = 0;
+    unsigned int background = 0;
+    uint64_t draws = 0;
+};
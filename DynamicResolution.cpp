@@ -0,0 +1,150 @@
+/*
+ * Title: Dynamic resolution
+ * Description: Implementation of the dynamic resolution framebuffer declared in
+ *      DynamicResolution.h.
+*/
+
+#include "DynamicResolution.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+
+const float RESOLUTION_DEAD_BAND = 0.05f;  // changes smaller than this fraction are ignored
+const float RESOLUTION_MAX_GROWTH = 0.05f; // grow at most this fraction per measurement
+const float RESOLUTION_SMOOTHING = 0.25f;  // weight of a new timing in the shown average
+
+ViewportRect letterbox(int windowWidth, int windowHeight, float aspect) {
+    int width = windowWidth, height = static_cast<int>(windowWidth / aspect + 0.5f);
+    if (height > windowHeight) {
+        height = windowHeight;
+        width = static_cast<int>(windowHeight * aspect + 0.5f);
+    }
+    return { (windowWidth - width) / 2, (windowHeight - height) / 2, width, height };
+}
+
+void DynamicResolution::init(float targetMilliseconds, float minimumScale) {
+    this->targetMilliseconds = targetMilliseconds;
+    minScale = minimumScale;
+    currentScale = 1.0f;
+    for (unsigned int& query : queries) {
+        query = registry.create(GL_OBJECT_QUERY);
+    }
+    framebuffer = registry.create(GL_OBJECT_FRAMEBUFFER);
+    color = registry.create(GL_OBJECT_TEXTURE);
+}
+
+/*
+ * This function makes the color buffer big enough for a frame of the given size
+*/
+
+void DynamicResolution::resize(int width, int height) {
+    bufferWidth = width;
+    bufferHeight = height;
+    glBindTexture(GL_TEXTURE_2D, color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+}
+
+/*
+ * This function reads the timer queries that have finished, oldest first, and moves the scale
+ * toward the size that would have met the budget. Each timing is judged against the scale
+ * its frame was drawn at, so timings that are a few frames old don't cause overshoot.
+*/
+
+void DynamicResolution::collectTimings() {
+    for (int i = 0; i < RESOLUTION_QUERIES; i++) {
+        int index = (nextQuery + i) % RESOLUTION_QUERIES;
+        if (!pending[index]) {
+            continue;
+        }
+        GLint available = 0;
+        glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;                // later ones can't have finished either
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &nanoseconds);
+        pending[index] = false;
+        float milliseconds = static_cast<float>(nanoseconds / 1.0e6);
+        measuredMilliseconds = measuredMilliseconds == 0.0f ? milliseconds
+            : measuredMilliseconds + RESOLUTION_SMOOTHING * (milliseconds - measuredMilliseconds);
+        if (!enabled || milliseconds <= 0.0f) {
+            continue;
+        }
+        float wanted = queryScales[index] * std::sqrt(targetMilliseconds / milliseconds);
+        if (std::fabs(wanted - currentScale) < RESOLUTION_DEAD_BAND * currentScale) {
+            continue;
+        }
+        // shrink at once when over budget, grow slowly so one quiet frame doesn't cause a spike
+        wanted = std::min(wanted, currentScale * (1.0f + RESOLUTION_MAX_GROWTH));
+        currentScale = std::min(1.0f, std::max(minScale, wanted));
+    }
+}
+
+/*
+ * This function starts a frame: the framebuffer that is bound now receives the result in end()
+ * @param output: where the frame goes in that framebuffer
+*/
+
+void DynamicResolution::begin(const ViewportRect& output) {
+    collectTimings();
+    if (!enabled) {
+        currentScale = 1.0f;
+    }
+    GLint target = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    outputFramebuffer = static_cast<unsigned int>(target);
+    outputRect = output;
+    sceneWidth = std::max(1, static_cast<int>(output.width * currentScale + 0.5f));
+    sceneHeight = std::max(1, static_cast<int>(output.height * currentScale + 0.5f));
+    if (output.width > bufferWidth || output.height > bufferHeight) {
+        resize(std::max(output.width, bufferWidth), std::max(output.height, bufferHeight));
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, sceneWidth, sceneHeight);
+
+    activeQuery = -1;
+    if (!pending[nextQuery]) {
+        activeQuery = nextQuery;
+        queryScales[activeQuery] = currentScale;
+        glBeginQuery(GL_TIME_ELAPSED, queries[activeQuery]);
+    }
+}
+
+void DynamicResolution::end() {
+    if (activeQuery >= 0) {
+        glEndQuery(GL_TIME_ELAPSED);
+        pending[activeQuery] = true;
+        nextQuery = (activeQuery + 1) % RESOLUTION_QUERIES;
+        activeQuery = -1;
+    }
+    // clear the whole target first, so letterbox bars stay black
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBlitFramebuffer(0, 0, sceneWidth, sceneHeight, outputRect.x, outputRect.y, outputRect.x + outputRect.width,
+        outputRect.y + outputRect.height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+    glViewport(outputRect.x, outputRect.y, outputRect.width, outputRect.height);
+}
+
+void DynamicResolution::cancelTiming() {
+    if (activeQuery >= 0) {
+        // the query stays free, so the next frame reuses it
+        glEndQuery(GL_TIME_ELAPSED);
+        activeQuery = -1;
+    }
+}
+
+void DynamicResolution::release() {
+    registry.release();
+    framebuffer = color = 0;
+    for (unsigned int& query : queries) {
+        query = 0;
+    }
+    bufferWidth = bufferHeight = 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Title: Dynamic resolution
+ * Description: Renders the scene into an offscreen framebuffer whose size follows how long the
+ *      GPU took for the last frames, then stretches it over the window. On a big or HiDPI
+ *      window the scene is drawn at fewer pixels whenever it would miss the frame budget,
+ *      and at full size again once there is room.
+ *
+ *      GPU time comes from GL_TIME_ELAPSED queries around the scene. Results are read a few
+ *      frames late, from a ring of queries, so waiting for them never stalls the CPU. Pixel
+ *      count grows with the square of the scale, so each correction moves the scale by the
+ *      square root of budget over measured time, with a dead band to keep it from hunting.
+ *      The color buffer is made at the full output size and the scene drawn into its lower
+ *      left part, so changing the scale never reallocates anything.
+*/
+
+#pragma once
+
+#include "GlResources.h"
+
+const int RESOLUTION_QUERIES = 4;         // timer queries in flight
+
+// A rectangle of the window, in pixels
+struct ViewportRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// The largest rectangle with the given aspect ratio centered in a window, for a fixed size
+// playfield that should keep its shape
+ViewportRect letterbox(int windowWidth, int windowHeight, float aspect);
+
+class DynamicResolution {
+public:
+    // targetMilliseconds: GPU budget for the scene. minimumScale: smallest fraction of the
+    // output size, per axis, the scene may be drawn at.
+    void init(float targetMilliseconds, float minimumScale);
+    // Reads finished timings, picks this frame's size, binds the offscreen framebuffer with the
+    // viewport set to it and starts timing. output is where the frame goes in the window.
+    void begin(const ViewportRect& output);
+    // Stops timing and stretches the frame over the output rectangle of the window. Draw
+    // overlays that should stay sharp after this.
+    void end();
+    // Drops this frame's timing, for a frame that reuses the last one instead of drawing; call
+    // between begin() and end()
+    void cancelTiming();
+    void release();
+
+    // Switches scaling off; frames are drawn at the output size (still through the framebuffer)
+    void setEnabled(bool enabled) { this->enabled = enabled; }
+    void setTarget(float milliseconds) { targetMilliseconds = milliseconds; }
+    float scale() const { return currentScale; }
+    int width() const { return sceneWidth; }
+    int height() const { return sceneHeight; }
+    // Average GPU time of the last measured frames, 0 before the first result
+    float gpuMilliseconds() const { return measuredMilliseconds; }
+
+private:
+    void collectTimings();
+    void resize(int width, int height);
+
+    GlRegistry registry;          // the framebuffer, its color texture and the queries
+    unsigned int framebuffer = 0;
+    unsigned int color = 0;
+    int bufferWidth = 0;
+    int bufferHeight = 0;
+    unsigned int queries[RESOLUTION_QUERIES] = {};
+    bool pending[RESOLUTION_QUERIES] = {};
+    float queryScales[RESOLUTION_QUERIES] = {}; // scale of the frame each query timed
+    int nextQuery = 0;
+    int activeQuery = -1;         // query running in this frame, or -1
+
+    unsigned int outputFramebuffer = 0;
+    ViewportRect outputRect = { 0, 0, 0, 0 };
+    int sceneWidth = 0;
+    int sceneHeight = 0;
+    float targetMilliseconds = 14.0f;
+    float minScale = 0.5f;
+    float currentScale = 1.0f;
+    float measuredMilliseconds = 0.0f;
+    bool enabled = true;
+};
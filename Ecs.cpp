@@ -0,0 +1,341 @@
+/*
+ * Title: Entity component store
+ * Description: Implementation of the archetype storage and system scheduler declared in Ecs.h.
+*/
+
+#include "Ecs.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+// Size of every component type registered so far, indexed by its bit
+static size_t componentSizes[ECS_MAX_COMPONENTS];
+static int componentTypes = 0;
+
+// Each array of a chunk starts on this boundary, so SIMD loads of a column line up
+const size_t ECS_COLUMN_ALIGN = 16;
+
+/*
+ * This function rounds a byte offset up to the column alignment
+*/
+
+static size_t alignColumn(size_t offset) {
+    return (offset + ECS_COLUMN_ALIGN - 1) & ~(ECS_COLUMN_ALIGN - 1);
+}
+
+int registerComponentType(size_t size) {
+    // Only called from the static initialiser in componentId, which the language serialises
+    if (componentTypes >= ECS_MAX_COMPONENTS) {
+        fprintf(stderr, "Too many component types (at most %d)\n", ECS_MAX_COMPONENTS);
+        abort();
+    }
+    // a chunk must hold at least one entity with just this component
+    if (alignColumn(sizeof(Entity)) + size > ECS_CHUNK_BYTES) {
+        fprintf(stderr, "Component of %zu bytes does not fit a chunk of %zu bytes\n", size, ECS_CHUNK_BYTES);
+        abort();
+    }
+    componentSizes[componentTypes] = size;
+    return componentTypes++;
+}
+
+size_t componentSize(int id) {
+    return componentSizes[id];
+}
+
+/*
+ * This function returns the archetype with exactly the given components, making it if needed
+ * @param mask: the components of the archetype
+ * @return index of the archetype
+*/
+
+int EntityWorld::findArchetype(ComponentMask mask) {
+    for (size_t i = 0; i < archetypes.size(); i++) {
+        if (archetypes[i].mask == mask) {
+            return static_cast<int>(i);
+        }
+    }
+    Archetype archetype;
+    archetype.mask = mask;
+    // Bytes one entity takes over all columns, then as many entities as fit a chunk once
+    // every column has been aligned
+    size_t rowBytes = sizeof(Entity);
+    for (int id = 0; id < ECS_MAX_COMPONENTS; id++) {
+        if (mask & (1u << id)) {
+            rowBytes += componentSizes[id];
+        }
+    }
+    uint32_t capacity = std::max<uint32_t>(1, static_cast<uint32_t>(ECS_CHUNK_BYTES / rowBytes));
+    size_t offset = 0;
+    for (;;) {
+        offset = alignColumn(capacity * sizeof(Entity));
+        for (int id = 0; id < ECS_MAX_COMPONENTS; id++) {
+            if (mask & (1u << id)) {
+                archetype.offsets[id] = offset;
+                offset = alignColumn(offset + capacity * componentSizes[id]);
+            }
+        }
+        if (offset <= ECS_CHUNK_BYTES) {
+            break;
+        }
+        if (capacity == 1) {
+            // each component fits on its own, but not all of them together
+            fprintf(stderr, "An entity of %zu bytes does not fit a chunk of %zu bytes\n", rowBytes, ECS_CHUNK_BYTES);
+            abort();
+        }
+        capacity--;
+    }
+    archetype.capacity = capacity;
+    archetypes.push_back(std::move(archetype));
+    return static_cast<int>(archetypes.size() - 1);
+}
+
+/*
+ * This function takes a free entity slot and a row at the end of the archetype's last chunk
+ * @param mask: the components of the new entity
+ * @return where the entity's components go; the caller fills them in
+*/
+
+EntityWorld::Location EntityWorld::allocate(ComponentMask mask) {
+    int archetypeIndex = findArchetype(mask);
+    Archetype& archetype = archetypes[archetypeIndex];
+    if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity) {
+        Chunk chunk;
+        if (!spareChunks.empty()) {
+            chunk.data = std::move(spareChunks.back());
+            spareChunks.pop_back();
+        }
+        else {
+            chunk.data.reset(new unsigned char[ECS_CHUNK_BYTES]);
+        }
+        archetype.chunks.push_back(std::move(chunk));
+    }
+    uint32_t chunkIndex = static_cast<uint32_t>(archetype.chunks.size() - 1);
+    Chunk& chunk = archetype.chunks.back();
+    uint32_t row = chunk.count++;
+
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else {
+        slot = static_cast<uint32_t>(records.size());
+        records.push_back(Record());
+        records[slot].generation = 1;
+    }
+    Record& record = records[slot];
+    record.archetype = archetypeIndex;
+    record.chunk = chunkIndex;
+    record.row = row;
+    liveCount++;
+
+    Location location;
+    location.entity.index = slot;
+    location.entity.generation = record.generation;
+    location.archetype = &archetype;
+    location.chunk = &chunk;
+    location.row = row;
+    chunk.entities()[row] = location.entity;
+    return location;
+}
+
+/*
+ * This function copies a component value into a freshly allocated row
+*/
+
+void EntityWorld::write(const Location& location, int id, const void* value) {
+    size_t size = componentSizes[id];
+    memcpy(location.chunk->data.get() + location.archetype->offsets[id] + location.row * size, value, size);
+}
+
+/*
+ * This function removes an entity. The archetype's last entity moves into its row, so the
+ * chunks stay packed; the slot's generation goes up so old handles stop matching.
+ * @param entity: handle of the entity; a stale handle is ignored
+*/
+
+void EntityWorld::destroy(Entity entity) {
+    if (!alive(entity)) {
+        return;
+    }
+    Record& record = records[entity.index];
+    Archetype& archetype = archetypes[record.archetype];
+    Chunk& chunk = archetype.chunks[record.chunk];
+    Chunk& last = archetype.chunks.back();
+    uint32_t lastRow = last.count - 1;
+    if (&chunk != &last || record.row != lastRow) {
+        Entity moved = last.entities()[lastRow];
+        chunk.entities()[record.row] = moved;
+        for (int id = 0; id < ECS_MAX_COMPONENTS; id++) {
+            if (archetype.mask & (1u << id)) {
+                size_t size = componentSizes[id];
+                memcpy(chunk.data.get() + archetype.offsets[id] + record.row * size,
+                    last.data.get() + archetype.offsets[id] + lastRow * size, size);
+            }
+        }
+        records[moved.index].chunk = record.chunk;
+        records[moved.index].row = record.row;
+    }
+    last.count--;
+    if (last.count == 0) {
+        spareChunks.push_back(std::move(last.data));
+        archetype.chunks.pop_back();
+    }
+    record.archetype = -1;
+    record.generation++;
+    freeSlots.push_back(entity.index);
+    liveCount--;
+}
+
+/*
+ * This function tells whether a handle still refers to a live entity
+*/
+
+bool EntityWorld::alive(Entity entity) const {
+    return entity.index < records.size() && records[entity.index].archetype >= 0 &&
+        records[entity.index].generation == entity.generation;
+}
+
+/*
+ * This function returns a pointer to one component of an entity
+ * @return nullptr when the handle is stale or the entity has no such component
+*/
+
+void* EntityWorld::component(Entity entity, int id) {
+    if (!alive(entity)) {
+        return nullptr;
+    }
+    const Record& record = records[entity.index];
+    Archetype& archetype = archetypes[record.archetype];
+    if (!(archetype.mask & (1u << id))) {
+        return nullptr;
+    }
+    return archetype.chunks[record.chunk].data.get() + archetype.offsets[id] + record.row * componentSizes[id];
+}
+
+/*
+ * This function makes room for count entities with the given components, so creating and
+ * destroying up to that many afterwards allocates nothing
+ * @param mask: the components of the entities
+ * @param count: entities of that archetype at most
+*/
+
+void EntityWorld::reserve(ComponentMask mask, size_t count) {
+    Archetype& archetype = archetypes[findArchetype(mask)];
+    size_t chunks = (count + archetype.capacity - 1) / archetype.capacity;
+    archetype.chunks.reserve(chunks);
+    for (size_t have = archetype.chunks.size() + spareChunks.size(); have < chunks; have++) {
+        spareChunks.emplace_back(new unsigned char[ECS_CHUNK_BYTES]);
+    }
+    // every chunk may end up spare at once
+    spareChunks.reserve(chunkCount() + spareChunks.size());
+    records.reserve(count);
+    freeSlots.reserve(records.capacity());
+}
+
+/*
+ * This function removes every entity; the archetypes stay so their layouts are not worked
+ * out again, and the chunks are kept for the next entities
+*/
+
+void EntityWorld::clear() {
+    for (Archetype& archetype : archetypes) {
+        for (Chunk& chunk : archetype.chunks) {
+            spareChunks.push_back(std::move(chunk.data));
+        }
+        archetype.chunks.clear();
+    }
+    freeSlots.clear();
+    for (uint32_t slot = static_cast<uint32_t>(records.size()); slot-- > 0;) {
+        if (records[slot].archetype >= 0) {
+            records[slot].archetype = -1;
+            records[slot].generation++;
+        }
+        freeSlots.push_back(slot);
+    }
+    liveCount = 0;
+}
+
+size_t EntityWorld::chunkCount() const {
+    size_t count = 0;
+    for (const Archetype& archetype : archetypes) {
+        count += archetype.chunks.size();
+    }
+    return count;
+}
+
+void SystemScheduler::add(const char* name, ComponentMask reads, ComponentMask writes, std::function<void()> run) {
+    System system;
+    system.name = name;
+    system.reads = reads | writes;
+    system.writes = writes;
+    system.run = std::move(run);
+    system.phase = 0;
+    systems.push_back(std::move(system));
+    built = false;
+}
+
+/*
+ * This function groups the systems into phases. A system goes one phase after the latest
+ * earlier system it conflicts with, so conflicting systems keep the order they were added in
+ * and the others share a phase.
+*/
+
+void SystemScheduler::build() {
+    phases.clear();
+    for (size_t i = 0; i < systems.size(); i++) {
+        int phase = 0;
+        for (size_t j = 0; j < i; j++) {
+            bool conflict = (systems[i].writes & systems[j].reads) || (systems[j].writes & systems[i].reads);
+            if (conflict && systems[j].phase + 1 > phase) {
+                phase = systems[j].phase + 1;
+            }
+        }
+        systems[i].phase = phase;
+        if (phase >= static_cast<int>(phases.size())) {
+            phases.resize(phase + 1);
+        }
+        phases[phase].push_back(static_cast<int>(i));
+    }
+    built = true;
+}
+
+/*
+ * This function runs every phase in turn, the systems of a phase side by side on the pool
+*/
+
+void SystemScheduler::run(WorkerPool& pool) {
+    if (!built) {
+        build();
+    }
+    for (const std::vector<int>& phase : phases) {
+        if (phase.size() == 1) {
+            systems[phase[0]].run();
+            continue;
+        }
+        pool.parallelFor(phase.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                systems[phase[i]].run();
+            }
+        });
+    }
+}
+
+void SystemScheduler::runSerial() {
+    for (System& system : systems) {
+        system.run();
+    }
+}
+
+size_t SystemScheduler::phaseCount() {
+    if (!built) {
+        build();
+    }
+    return phases.size();
+}
+
+void SystemScheduler::clear() {
+    systems.clear();
+    phases.clear();
+    built = false;
+}
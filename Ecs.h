@@ -0,0 +1,247 @@
+/*
+ * Title: Entity component store
+ * Description: Entities made of plain data components, stored by archetype so that systems
+ *      walk contiguous arrays.
+ *
+ *      Every distinct set of components is an archetype. An archetype keeps its entities in
+ *      chunks of ECS_CHUNK_BYTES, and inside a chunk each component has its own array (one
+ *      column per component, structure of arrays), so a system that reads positions and
+ *      velocities touches only those two arrays and nothing else of the entity. Removing an
+ *      entity moves the archetype's last entity into its row, which keeps every chunk but the
+ *      last one full; a chunk that empties is kept for the next one needed. Entity handles
+ *      carry a generation, so a handle to a removed entity is recognised as stale instead of
+ *      reaching whatever took its slot. The particle effects (Particles.h) live in one.
+ *
+ *      Systems are registered with the components they read and write. The scheduler puts
+ *      each system into the first phase after every earlier system it conflicts with (one
+ *      writes what the other reads or writes); systems in the same phase run in parallel on a
+ *      worker pool, and the result is the same as running them one by one in order.
+ *
+ *      Components must be trivially copyable: they are moved around as bytes.
+*/
+
+#pragma once
+
+#include "WorkerPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#if !defined(__GNUC__) && !defined(__clang__) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+const size_t ECS_CHUNK_BYTES = 16384;     // fits comfortably in L1 alongside the system's code
+const int ECS_MAX_COMPONENTS = 32;        // one bit of a ComponentMask each
+
+typedef uint32_t ComponentMask;
+
+// Handle to an entity; index 0 generation 0 is never handed out
+struct Entity {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+};
+
+// Gives a component type its bit the first time it is used; the bits are shared by all worlds
+int registerComponentType(size_t size);
+size_t componentSize(int id);
+
+template<typename T>
+int componentId() {
+    static_assert(std::is_trivially_copyable<T>::value, "components are copied as bytes");
+    static const int id = registerComponentType(sizeof(T));
+    return id;
+}
+
+template<typename... Components>
+ComponentMask componentMask() {
+    ComponentMask mask = 0;
+    int expand[] = { 0, (mask |= 1u << componentId<Components>(), 0)... };
+    (void)expand;
+    return mask;
+}
+
+// Asks for the first two cache lines of a column ahead of use; does nothing on compilers
+// without a prefetch hint
+inline void prefetchColumn(const void* column) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(column);
+    __builtin_prefetch(static_cast<const char*>(column) + 64);
+#elif defined(_M_X64) || defined(_M_IX86)
+    _mm_prefetch(static_cast<const char*>(column), _MM_HINT_T0);
+    _mm_prefetch(static_cast<const char*>(column) + 64, _MM_HINT_T0);
+#endif
+}
+
+class EntityWorld {
+public:
+    EntityWorld() = default;
+    EntityWorld(const EntityWorld&) = delete;
+    EntityWorld& operator=(const EntityWorld&) = delete;
+
+    // Makes an entity with the given components (at most one of each type)
+    template<typename... Components>
+    Entity create(const Components&... components) {
+        Location location = allocate(componentMask<Components...>());
+        int expand[] = { 0, (write(location, componentId<Components>(), &components), 0)... };
+        (void)expand;
+        return location.entity;
+    }
+
+    void destroy(Entity entity);
+    bool alive(Entity entity) const;
+    size_t size() const { return liveCount; }
+    void clear();
+
+    // Sets aside chunks and slots for count entities with Components, so that keeping up to
+    // that many alive allocates nothing
+    template<typename... Components>
+    void reserve(size_t count) {
+        reserve(componentMask<Components...>(), count);
+    }
+
+    // Component of an entity, or nullptr when the entity is gone or has no such component
+    template<typename T>
+    T* get(Entity entity) {
+        return static_cast<T*>(component(entity, componentId<T>()));
+    }
+
+    // Calls f(count, entities, Components*...) once per chunk holding all of Components,
+    // with the arrays of that chunk. The next chunk's arrays are fetched into the cache while
+    // f works, since a column is too short for the hardware to pick up the stream by itself.
+    template<typename... Components, typename F>
+    void each(F f) {
+        ComponentMask mask = componentMask<Components...>();
+        for (Archetype& archetype : archetypes) {
+            if ((archetype.mask & mask) != mask) {
+                continue;
+            }
+            for (size_t c = 0; c < archetype.chunks.size(); c++) {
+                Chunk& chunk = archetype.chunks[c];
+                if (c + 1 < archetype.chunks.size()) {
+                    archetype.chunks[c + 1].template prefetch<Components...>(archetype);
+                }
+                if (chunk.count > 0) {
+                    f(chunk.count, chunk.entities(), chunk.template column<Components>(archetype)...);
+                }
+            }
+        }
+    }
+
+    // Same as each, with the chunks spread over a worker pool; f must only touch its own rows
+    template<typename... Components, typename F>
+    void eachParallel(WorkerPool& pool, F f) {
+        ComponentMask mask = componentMask<Components...>();
+        std::vector<ChunkRef> work;
+        for (Archetype& archetype : archetypes) {
+            if ((archetype.mask & mask) == mask) {
+                for (Chunk& chunk : archetype.chunks) {
+                    if (chunk.count > 0) {
+                        work.push_back({ &archetype, &chunk });
+                    }
+                }
+            }
+        }
+        pool.parallelFor(work.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                Chunk& chunk = *work[i].chunk;
+                f(chunk.count, chunk.entities(), chunk.template column<Components>(*work[i].archetype)...);
+            }
+        });
+    }
+
+    // Number of archetypes and chunks, for reports
+    size_t archetypeCount() const { return archetypes.size(); }
+    size_t chunkCount() const;
+
+private:
+    struct Archetype;
+
+    struct Chunk {
+        std::unique_ptr<unsigned char[]> data;
+        uint32_t count = 0;
+
+        Entity* entities() { return reinterpret_cast<Entity*>(data.get()); }
+        template<typename T>
+        T* column(const Archetype& archetype) {
+            return reinterpret_cast<T*>(data.get() + archetype.offsets[componentId<T>()]);
+        }
+        // Starts loading the first lines of each of the columns
+        template<typename... Components>
+        void prefetch(const Archetype& archetype) {
+            int expand[] = { 0, (prefetchColumn(column<Components>(archetype)), 0)... };
+            (void)expand;
+        }
+    };
+
+    struct Archetype {
+        ComponentMask mask = 0;
+        uint32_t capacity = 0;                    // entities per chunk
+        size_t offsets[ECS_MAX_COMPONENTS] = {};  // start of each component's array in a chunk
+        std::vector<Chunk> chunks;                // all full except the last
+    };
+
+    struct Record {
+        uint32_t generation = 0;
+        int32_t archetype = -1;                   // -1 while the slot is free
+        uint32_t chunk = 0;
+        uint32_t row = 0;
+    };
+
+    struct Location {
+        Entity entity;
+        Archetype* archetype;
+        Chunk* chunk;
+        uint32_t row;
+    };
+
+    struct ChunkRef {
+        Archetype* archetype;
+        Chunk* chunk;
+    };
+
+    void reserve(ComponentMask mask, size_t count);
+    Location allocate(ComponentMask mask);
+    int findArchetype(ComponentMask mask);
+    void write(const Location& location, int id, const void* value);
+    void* component(Entity entity, int id);
+
+    std::vector<Archetype> archetypes;
+    std::vector<Record> records;
+    std::vector<uint32_t> freeSlots;
+    std::vector<std::unique_ptr<unsigned char[]>> spareChunks;  // emptied chunks, reused before allocating
+    size_t liveCount = 0;
+};
+
+// Runs systems in order, in parallel where their component access allows it
+class SystemScheduler {
+public:
+    // reads and writes are the components the system touches (write implies read); data
+    // outside the world gets a tag type of its own, e.g. componentMask<DrawList>(). A system
+    // run by run() may share the pool's threads with others, so it must not use the pool itself.
+    void add(const char* name, ComponentMask reads, ComponentMask writes, std::function<void()> run);
+    void run(WorkerPool& pool);
+    // Runs every system on the calling thread in the order they were added
+    void runSerial();
+    size_t phaseCount();
+    void clear();
+
+private:
+    struct System {
+        const char* name;
+        ComponentMask reads;
+        ComponentMask writes;
+        std::function<void()> run;
+        int phase;
+    };
+
+    void build();
+
+    std::vector<System> systems;
+    std::vector<std::vector<int>> phases;
+    bool built = false;
+};
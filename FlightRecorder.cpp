@@ -0,0 +1,180 @@
+/*
+ * Title: Flight recorder
+ * Description: Implementation of the hitch flight recorder declared in FlightRecorder.h.
+*/
+
+#include "FlightRecorder.h"
+#include "Allocations.h"
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <system_error>
+
+static const char* const kindNames[] = { "frame", "tick", "input" };
+static const char* const directionNames[] = { "up", "down", "left", "right" };
+
+FlightRecorder::FlightRecorder() : events(FLIGHT_EVENTS) {
+}
+
+FlightRecorder::~FlightRecorder() {
+    finish();
+}
+
+bool FlightRecorder::init(const FlightConfig& config, double now) {
+    finish();
+    state.store(DUMP_IDLE, std::memory_order_relaxed);
+    this->config = config;
+    count = 0;
+    startTime = now;
+    lastAllocations = allocationCounts().allocations;
+    frameNumber = 0;
+    lastDumpTime = -1e9;
+    dumpCount = 0;
+    reason[0] = '\0';
+    // a missing directory would lose every dump, so it is made now rather than at the hitch
+    bool dumping = config.frameMilliseconds > 0.0f || config.tickMilliseconds > 0.0f;
+    std::error_code error;
+    std::filesystem::create_directories(config.directory, error);
+    if (dumping && !std::filesystem::is_directory(config.directory, error)) {
+        this->config.frameMilliseconds = 0.0f;
+        this->config.tickMilliseconds = 0.0f;
+        return false;
+    }
+    return true;
+}
+
+FlightEvent& FlightRecorder::push(double now, FlightKind kind) {
+    FlightEvent& event = events[count++ & (FLIGHT_EVENTS - 1)];
+    uint64_t allocations = allocationCounts().allocations;
+    event.time = now - startTime;
+    event.milliseconds = 0.0f;
+    event.workMilliseconds = 0.0f;
+    event.number = 0;
+    event.allocations = static_cast<uint32_t>(allocations - lastAllocations);
+    event.kind = kind;
+    event.detail = 0;
+    lastAllocations = allocations;
+    return event;
+}
+
+/*
+ * This function decides whether a time over its threshold gets a dump: not while the last one
+ * is cooling down, and not once the run has had its share
+*/
+
+bool FlightRecorder::hitch(double now, const char* what, float milliseconds, float threshold) {
+    if (threshold <= 0.0f || milliseconds <= threshold || dumpCount >= config.maxDumps ||
+        now - lastDumpTime < config.coolDownSeconds) {
+        return false;
+    }
+    snprintf(reason, sizeof(reason), "%s took %.1f ms, over the %.1f ms threshold, at %.3f s", what, milliseconds, threshold,
+        now - startTime);
+    lastDumpTime = now;
+    return true;
+}
+
+bool FlightRecorder::frame(double now, float milliseconds, float workMilliseconds) {
+    FlightEvent& event = push(now, FLIGHT_FRAME);
+    event.number = ++frameNumber;
+    event.milliseconds = milliseconds;
+    event.workMilliseconds = workMilliseconds;
+    // the first frame's time since the last includes starting up
+    return frameNumber > 1 && hitch(now, "a frame", milliseconds, config.frameMilliseconds);
+}
+
+bool FlightRecorder::tick(double now, uint32_t number, float milliseconds) {
+    FlightEvent& event = push(now, FLIGHT_TICK);
+    event.number = number;
+    event.milliseconds = milliseconds;
+    return hitch(now, "a tick", milliseconds, config.tickMilliseconds);
+}
+
+void FlightRecorder::input(double now, uint8_t direction) {
+    FlightEvent& event = push(now, FLIGHT_INPUT);
+    event.number = frameNumber;
+    event.detail = direction;
+}
+
+/*
+ * This function copies the ring and the replay and writes them on the writer thread. A hitch
+ * while the last dump is still being written is skipped. The writer reports through state
+ * whether both files made it to disk.
+*/
+
+bool FlightRecorder::dump(const Replay* replay, uint32_t tick, uint32_t stateHash) {
+    if (reason[0] == '\0' || state.load(std::memory_order_acquire) == DUMP_WRITING) {
+        return false;
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+    dumpCount++;
+    char stamp[32];
+    time_t wallClock = time(nullptr);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&wallClock));
+    char name[96];
+    snprintf(name, sizeof(name), "/hitch-%s-%d", stamp, dumpCount);
+    std::string base = config.directory + name;
+    lastPath = base + ".txt";
+
+    uint64_t first = count > FLIGHT_EVENTS ? count - FLIGHT_EVENTS : 0;
+    std::vector<FlightEvent> recent;
+    recent.reserve(static_cast<size_t>(count - first));
+    for (uint64_t i = first; i < count; i++) {
+        recent.push_back(events[i & (FLIGHT_EVENTS - 1)]);
+    }
+    std::string why = reason;
+    reason[0] = '\0';
+    bool withReplay = replay != nullptr;
+    Replay replayCopy;
+    if (withReplay) {
+        replayCopy = *replay;
+    }
+
+    state.store(DUMP_WRITING, std::memory_order_release);
+    writer = std::thread([this, base, why, recent = std::move(recent), withReplay, replayCopy = std::move(replayCopy), tick, stateHash]() {
+        std::string replayPath = base + ".replay";
+        bool replaySaved = withReplay && saveReplay(replayCopy, replayPath.c_str());
+        bool written = false;
+        FILE* file = fopen((base + ".txt").c_str(), "w");
+        if (file != nullptr) {
+            fprintf(file, "# Snake hitch dump\nreason: %s\n", why.c_str());
+            if (replaySaved) {
+                fprintf(file, "replay: %s (%s, %u ticks)\nstate: tick %u, hash %08x\n", replayPath.c_str(),
+                    replayCopy.mode == REPLAY_ARENA ? "arena" : "classic", replayCopy.ticks(), tick, stateHash);
+            }
+            else {
+                fprintf(file, "replay: none\nstate: tick %u, hash %08x\n", tick, stateHash);
+            }
+            AllocationCounts allocations = allocationCounts();
+            fprintf(file, "allocations: %llu (%llu bytes), frees: %llu\n", (unsigned long long)allocations.allocations,
+                (unsigned long long)allocations.bytes, (unsigned long long)allocations.frees);
+            fprintf(file, "# time_s kind number ms work_ms allocations detail\n");
+            for (const FlightEvent& event : recent) {
+                fprintf(file, "%.4f %s %u %.3f %.3f %u %s\n", event.time, kindNames[event.kind], event.number,
+                    event.milliseconds, event.workMilliseconds, event.allocations,
+                    event.kind == FLIGHT_INPUT ? directionNames[event.detail & 3] : "-");
+            }
+            written = !ferror(file);
+            written = fclose(file) == 0 && written;
+        }
+        // a dump without the replay it should have can't reproduce the hitch
+        bool complete = written && (replaySaved || !withReplay);
+        state.store(complete ? DUMP_WRITTEN : DUMP_FAILED, std::memory_order_release);
+    });
+    return true;
+}
+
+void FlightRecorder::finish() {
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+DumpState FlightRecorder::poll() {
+    DumpState current = state.load(std::memory_order_acquire);
+    if (current == DUMP_WRITTEN || current == DUMP_FAILED) {
+        state.store(DUMP_IDLE, std::memory_order_relaxed);
+    }
+    return current;
+}
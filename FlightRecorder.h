@@ -0,0 +1,96 @@
+/*
+ * Title: Flight recorder
+ * Description: Keeps the last few seconds of frame times, tick times, inputs and allocation
+ *      counts, and writes them out when a frame or tick takes too long, so a rare stutter on
+ *      a machine nobody is watching can be looked at afterwards.
+ *
+ *      Recording is always on and cheap: each event is one write into a fixed ring of
+ *      FLIGHT_EVENTS entries, allocated once. When frame() or tick() sees a time over its
+ *      threshold it returns true, and the caller hands dump() the replay of the game so far
+ *      (Replay.h) and a hash of the current state. The dump is a short text file with the
+ *      reason and the ring, oldest event first, plus the replay next to it; playing the replay
+ *      to the dumped tick and comparing the hash reproduces the state the hitch happened in.
+ *      Files are written on a thread of their own, so a dump doesn't cause the next hitch. A
+ *      cool-down and a cap on the number of dumps keep a machine that is slow all the time
+ *      from filling its disk.
+*/
+
+#pragma once
+
+#include "Replay.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+const size_t FLIGHT_EVENTS = 2048;        // about 10 seconds at 60 frames and 60 ticks a second; power of two
+
+enum FlightKind : uint8_t { FLIGHT_FRAME, FLIGHT_TICK, FLIGHT_INPUT };
+
+// What became of the last dump, as poll() reports it
+enum DumpState : uint8_t { DUMP_IDLE, DUMP_WRITING, DUMP_WRITTEN, DUMP_FAILED };
+
+struct FlightEvent {
+    double time;                          // seconds since the recorder started
+    float milliseconds;                   // frame: since the last frame; tick: time to simulate it
+    float workMilliseconds;               // frame: CPU time before the buffer swap
+    uint32_t number;                      // frame or tick number
+    uint32_t allocations;                 // heap allocations since the previous event
+    FlightKind kind;
+    uint8_t detail;                       // input: the Direction
+};
+
+struct FlightConfig {
+    float frameMilliseconds = 100.0f;     // a frame longer than this is a hitch; 0 never dumps
+    float tickMilliseconds = 20.0f;       // a tick longer than this is a hitch; 0 never dumps
+    std::string directory = ".";
+    double coolDownSeconds = 10.0;        // least time between two dumps
+    int maxDumps = 5;                     // per run
+};
+
+class FlightRecorder {
+public:
+    FlightRecorder();
+    ~FlightRecorder();
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    // Creates the dump directory if it is missing. Returns false if it can't be; the recorder
+    // then records but never dumps.
+    bool init(const FlightConfig& config, double now);
+    // Records a frame; returns true when it was a hitch that should be dumped
+    bool frame(double now, float milliseconds, float workMilliseconds);
+    // Records a tick; returns true when it was a hitch that should be dumped
+    bool tick(double now, uint32_t number, float milliseconds);
+    void input(double now, uint8_t direction);
+    // Writes the ring and the replay (if any) for the hitch frame() or tick() reported. tick
+    // and stateHash describe the game right now. Returns false, and writes nothing, while the
+    // last dump is still being written.
+    bool dump(const Replay* replay, uint32_t tick, uint32_t stateHash);
+    // Waits for a dump being written
+    void finish();
+    // DUMP_WRITTEN or DUMP_FAILED once after a dump is done, for lastDump(); a dump that is
+    // done but not polled yet is forgotten by the next dump()
+    DumpState poll();
+    int dumps() const { return dumpCount; }
+    // Path of the text file of the last dump started
+    const std::string& lastDump() const { return lastPath; }
+
+private:
+    FlightEvent& push(double now, FlightKind kind);
+    bool hitch(double now, const char* what, float milliseconds, float threshold);
+
+    FlightConfig config;
+    std::vector<FlightEvent> events;
+    uint64_t count = 0;
+    double startTime = 0.0;
+    uint64_t lastAllocations = 0;
+    uint32_t frameNumber = 0;
+    double lastDumpTime = -1e9;
+    int dumpCount = 0;
+    char reason[128] = {};
+    std::thread writer;
+    std::atomic<DumpState> state{ DUMP_IDLE };
+    std::string lastPath;
+};
@@ -0,0 +1,229 @@
+/*
+ * Title: Arena food
+ * Description: Implementation of the food spatial hash and the free cell index declared in
+ *      FoodField.h.
+*/
+
+#include "FoodField.h"
+#include <algorithm>
+#include <cstdlib>
+
+void FoodField::init(int width, int height, int count) {
+    bucketsX = (width + FOOD_BUCKET_CELLS - 1) / FOOD_BUCKET_CELLS;
+    bucketsY = (height + FOOD_BUCKET_CELLS - 1) / FOOD_BUCKET_CELLS;
+    buckets.assign(size_t(bucketsX) * bucketsY, -1);
+    items.assign(count, FoodItem());
+}
+
+/*
+ * This function puts an item on the board, taking it out of its old bucket first
+ * @param id: index of the item
+ * @param cell: where it goes
+ * @param big: big food has the larger pickup radius
+*/
+
+void FoodField::place(int id, ArenaCell cell, bool big) {
+    remove(id);
+    FoodItem& item = items[id];
+    item.cell = cell;
+    item.big = big;
+    item.bucket = bucketOf(cell);
+    item.previous = -1;
+    item.next = buckets[item.bucket];
+    if (item.next >= 0) {
+        items[item.next].previous = id;
+    }
+    buckets[item.bucket] = id;
+}
+
+void FoodField::remove(int id) {
+    FoodItem& item = items[id];
+    if (item.bucket < 0) {
+        return;
+    }
+    if (item.previous >= 0) {
+        items[item.previous].next = item.next;
+    }
+    else {
+        buckets[item.bucket] = item.next;
+    }
+    if (item.next >= 0) {
+        items[item.next].previous = item.previous;
+    }
+    item.bucket = -1;
+}
+
+/*
+ * This function finds food a head on the given cell picks up. Only the 3x3 buckets around
+ * the cell can hold it. When several items are in reach the lowest id wins, so the answer
+ * doesn't depend on the order of the bucket lists.
+*/
+
+int FoodField::findAt(ArenaCell cell) const {
+    int bx = cell.x / FOOD_BUCKET_CELLS, by = cell.y / FOOD_BUCKET_CELLS;
+    int found = -1;
+    for (int y = std::max(0, by - 1); y <= std::min(bucketsY - 1, by + 1); y++) {
+        for (int x = std::max(0, bx - 1); x <= std::min(bucketsX - 1, bx + 1); x++) {
+            for (int id = buckets[y * bucketsX + x]; id >= 0; id = items[id].next) {
+                const FoodItem& item = items[id];
+                int dx = item.cell.x - cell.x, dy = item.cell.y - cell.y;
+                int radius = item.big ? BIG_FOOD_RADIUS : SMALL_FOOD_RADIUS;
+                if (dx * dx + dy * dy < radius * radius && (found < 0 || id < found)) {
+                    found = id;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+/*
+ * This function finds the item sitting on a cell itself; only its own bucket can hold it
+*/
+
+int FoodField::findOn(ArenaCell cell) const {
+    for (int id = buckets[bucketOf(cell)]; id >= 0; id = items[id].next) {
+        if (items[id].cell.x == cell.x && items[id].cell.y == cell.y) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+/*
+ * This function looks for food around a cell, ring by ring of buckets. Once something turns up
+ * one more ring is searched, since an item just over the bucket edge can be closer.
+*/
+
+int FoodField::findNear(ArenaCell cell, int maxRings) const {
+    int bx = cell.x / FOOD_BUCKET_CELLS, by = cell.y / FOOD_BUCKET_CELLS;
+    int best = -1, bestDistance = 0, lastRing = maxRings;
+    for (int ring = 0; ring <= lastRing; ring++) {
+        for (int y = by - ring; y <= by + ring; y++) {
+            if (y < 0 || y >= bucketsY) {
+                continue;
+            }
+            // inner rows of the ring only have their two end buckets
+            int step = (y == by - ring || y == by + ring) ? 1 : std::max(1, 2 * ring);
+            for (int x = bx - ring; x <= bx + ring; x += step) {
+                if (x < 0 || x >= bucketsX) {
+                    continue;
+                }
+                for (int id = buckets[y * bucketsX + x]; id >= 0; id = items[id].next) {
+                    int distance = std::abs(items[id].cell.x - cell.x) + std::abs(items[id].cell.y - cell.y);
+                    if (best < 0 || distance < bestDistance || (distance == bestDistance && id < best)) {
+                        best = id;
+                        bestDistance = distance;
+                    }
+                }
+            }
+        }
+        if (best >= 0 && lastRing > ring + 1) {
+            lastRing = ring + 1;
+        }
+    }
+    return best;
+}
+
+void FreeCells::init(int width, int height) {
+    this->width = width;
+    this->height = height;
+    bucketsX = (width + FOOD_BUCKET_CELLS - 1) / FOOD_BUCKET_CELLS;
+    int bucketsY = (height + FOOD_BUCKET_CELLS - 1) / FOOD_BUCKET_CELLS;
+    bucketCount = bucketsX * bucketsY;
+    topBit = 1;
+    while (topBit * 2 <= bucketCount) {
+        topBit *= 2;
+    }
+
+    rows.assign(size_t(height) * bucketsX, 0xFFFF);
+    if (width % FOOD_BUCKET_CELLS != 0) {
+        // the last bucket of every row is cut off by the edge of the board
+        for (int y = 0; y < height; y++) {
+            rows[size_t(y) * bucketsX + bucketsX - 1] = static_cast<uint16_t>((1u << (width % FOOD_BUCKET_CELLS)) - 1);
+        }
+    }
+
+    // build the tree in linear time from the per-bucket counts
+    tree.assign(bucketCount + 1, 0);
+    for (int by = 0; by < bucketsY; by++) {
+        for (int bx = 0; bx < bucketsX; bx++) {
+            int w = std::min(FOOD_BUCKET_CELLS, width - bx * FOOD_BUCKET_CELLS);
+            int h = std::min(FOOD_BUCKET_CELLS, height - by * FOOD_BUCKET_CELLS);
+            tree[by * bucketsX + bx + 1] = uint32_t(w * h);
+        }
+    }
+    for (int i = 1; i <= bucketCount; i++) {
+        int parent = i + (i & -i);
+        if (parent <= bucketCount) {
+            tree[parent] += tree[i];
+        }
+    }
+    total = uint32_t(width) * height;
+}
+
+void FreeCells::add(ArenaCell cell, int delta) {
+    uint16_t bit = static_cast<uint16_t>(1u << (cell.x % FOOD_BUCKET_CELLS));
+    uint16_t& row = rows[size_t(cell.y) * bucketsX + cell.x / FOOD_BUCKET_CELLS];
+    row = delta > 0 ? (row | bit) : (row & ~bit);
+    int bucket = (cell.y / FOOD_BUCKET_CELLS) * bucketsX + cell.x / FOOD_BUCKET_CELLS;
+    for (int i = bucket + 1; i <= bucketCount; i += i & -i) {
+        tree[i] += delta;
+    }
+    total += delta;
+}
+
+static int countBits(uint32_t value) {
+    int count = 0;
+    for (; value != 0; value &= value - 1) {
+        count++;
+    }
+    return count;
+}
+
+/*
+ * This function picks a random free cell in O(log buckets + rows per bucket)
+ * @param random: a random number
+ * @param cell: receives the cell
+ * @return false if no cell is free
+*/
+
+bool FreeCells::sample(uint32_t random, ArenaCell& cell) const {
+    if (total == 0) {
+        return false;
+    }
+    // walk down the tree to the bucket holding the n-th free cell
+    uint32_t n = random % total;
+    int position = 0;
+    for (int bit = topBit; bit > 0; bit >>= 1) {
+        int next = position + bit;
+        if (next <= bucketCount && tree[next] <= n) {
+            n -= tree[next];
+            position = next;
+        }
+    }
+    int bucket = position;
+
+    // then to the row holding the n-th free cell, and the n-th set bit of that row
+    int bx = bucket % bucketsX, y0 = (bucket / bucketsX) * FOOD_BUCKET_CELLS;
+    int y1 = std::min(y0 + FOOD_BUCKET_CELLS, height);
+    for (int y = y0; y < y1; y++) {
+        uint32_t row = rows[size_t(y) * bucketsX + bx];
+        uint32_t free = static_cast<uint32_t>(countBits(row));
+        if (n >= free) {
+            n -= free;
+            continue;
+        }
+        for (; n > 0; n--) {
+            row &= row - 1;
+        }
+        int x = 0;
+        while (!(row & (1u << x))) {
+            x++;
+        }
+        cell.x = static_cast<int16_t>(bx * FOOD_BUCKET_CELLS + x);
+        cell.y = static_cast<int16_t>(y);
+        return true;
+    }
+    return false; // the counts and masks disagree; can't happen
+}
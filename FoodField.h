@@ -0,0 +1,86 @@
+/*
+ * Title: Arena food
+ * Description: Food items for the arena, kept in a uniform spatial hash, and an index of free
+ *      cells to place them with.
+ *
+ *      The board is split into square buckets of FOOD_BUCKET_CELLS cells, at least as wide as
+ *      the largest pickup radius, so everything a head can reach is in its own bucket or one of
+ *      the eight around it. The same buckets count their free cells in a Fenwick tree, and each
+ *      bucket row keeps a 16-bit mask of its free cells. Placing food picks a bucket with
+ *      probability proportional to its free cells, then the n-th free cell inside it by counting
+ *      bits. That takes the same bounded time however full the board is, where rejection
+ *      sampling needs more and more attempts as the board fills up.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+const int FOOD_BUCKET_CELLS = 16;         // bucket width; >= the biggest pickup radius, and 16 bits
+const int SMALL_FOOD_RADIUS = 8;          // pickup distance in cells: SQUARE_SIZE / MOVE_STRIDE
+const int BIG_FOOD_RADIUS = 16;           // big food is drawn twice as large
+
+// A cell of the arena grid
+struct ArenaCell {
+    int16_t x;
+    int16_t y;
+};
+
+struct FoodItem {
+    ArenaCell cell = { -1, -1 };
+    bool big = false;
+    int bucket = -1;              // -1 while the item is not on the board
+    int previous = -1;            // neighbours in the bucket's list
+    int next = -1;
+};
+
+class FoodField {
+public:
+    // Sets up the buckets for a board and count items that are not on it yet
+    void init(int width, int height, int count);
+    // Puts an item on the board, or moves it there
+    void place(int id, ArenaCell cell, bool big);
+    void remove(int id);
+    // Lowest numbered item whose pickup radius covers the cell, or -1
+    int findAt(ArenaCell cell) const;
+    // The item placed exactly on the cell, or -1
+    int findOn(ArenaCell cell) const;
+    // An item close to the cell (nearest by bucket rings, not exactly), searching at most
+    // maxRings rings of buckets around it; -1 if there is none that close
+    int findNear(ArenaCell cell, int maxRings) const;
+    const FoodItem& item(int id) const { return items[id]; }
+    int size() const { return static_cast<int>(items.size()); }
+
+private:
+    int bucketOf(ArenaCell cell) const { return (cell.y / FOOD_BUCKET_CELLS) * bucketsX + cell.x / FOOD_BUCKET_CELLS; }
+
+    std::vector<FoodItem> items;
+    std::vector<int> buckets;     // first item of each bucket
+    int bucketsX = 0;
+    int bucketsY = 0;
+};
+
+// Free cell count per bucket, with weighted sampling of free cells
+class FreeCells {
+public:
+    // Every cell starts free
+    void init(int width, int height);
+    void occupy(ArenaCell cell) { add(cell, -1); }
+    void release(ArenaCell cell) { add(cell, 1); }
+    uint32_t freeCount() const { return total; }
+    // Picks a free cell uniformly at random. Returns false if the board is full.
+    bool sample(uint32_t random, ArenaCell& cell) const;
+
+private:
+    void add(ArenaCell cell, int delta);
+
+    std::vector<uint32_t> tree;   // Fenwick tree over buckets, 1-based
+    std::vector<uint16_t> rows;   // free cell mask of each bucket row, index y * bucketsX + bucket x
+    int width = 0;
+    int height = 0;
+    int bucketsX = 0;
+    int bucketCount = 0;
+    int topBit = 1;
+    uint32_t total = 0;
+};
@@ -0,0 +1,63 @@
+/*
+ * Title: Frame scratch arena
+ * Description: Implementation of the bump allocator declared in FrameArena.h.
+*/
+
+#include "FrameArena.h"
+#include <algorithm>
+
+const size_t FRAME_ARENA_GRANULE = 64 * 1024; // the block grows in steps of this
+
+FrameArena::FrameArena(size_t bytes) : block(new unsigned char[bytes]), size(bytes) {
+    overflow.reserve(16);
+}
+
+FrameArena::~FrameArena() {
+    for (unsigned char* memory : overflow) {
+        delete[] memory;
+    }
+    delete[] block;
+}
+
+/*
+ * This function takes memory from the block, or from the heap once the block is full
+ * @param bytes: how much
+ * @param alignment: a power of two, at most alignof(std::max_align_t)
+ * @return the memory; it stays valid until reset(), or rewind() to an earlier mark
+*/
+
+void* FrameArena::allocateBytes(size_t bytes, size_t alignment) {
+    size_t start = (used + alignment - 1) & ~(alignment - 1);
+    if (start + bytes <= size) {
+        used = start + bytes;
+        peak = std::max(peak, used + overflowBytes);
+        return block + start;
+    }
+    // new[] memory is aligned for any fundamental type
+    unsigned char* memory = new unsigned char[bytes != 0 ? bytes : 1];
+    overflow.push_back(memory);
+    overflowBytes += bytes;
+    overflowCount++;
+    peak = std::max(peak, used + overflowBytes);
+    return memory;
+}
+
+void FrameArena::rewind(size_t mark) {
+    used = std::min(used, mark);
+}
+
+void FrameArena::reset() {
+    for (unsigned char* memory : overflow) {
+        delete[] memory;
+    }
+    overflow.clear();
+    largest = std::max(largest, peak);
+    if (peak > size) {
+        delete[] block;
+        size = (peak + FRAME_ARENA_GRANULE - 1) / FRAME_ARENA_GRANULE * FRAME_ARENA_GRANULE;
+        block = new unsigned char[size];
+    }
+    used = 0;
+    overflowBytes = 0;
+    peak = 0;
+}
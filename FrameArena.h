@@ -0,0 +1,56 @@
+/*
+ * Title: Frame scratch arena
+ * Description: Memory for data that only lives until the end of a frame, like the instances
+ *      gathered for an upload. Taking memory moves a pointer along one block, and reset() at
+ *      the start of the next frame gives it all back at once; nothing is freed piece by piece.
+ *
+ *      A frame that needs more than the block holds gets the rest from the heap, and the next
+ *      reset() makes the block as big as that frame needed, so the arena stops allocating
+ *      once it has seen the busiest frame. mark() and rewind() hand back what was taken since
+ *      the mark, for scratch space inside a loop.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+const size_t FRAME_ARENA_BYTES = 1 << 20;
+
+class FrameArena {
+public:
+    explicit FrameArena(size_t bytes = FRAME_ARENA_BYTES);
+    ~FrameArena();
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Room for count objects, uninitialized; only for types that need no destructor
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "the arena never runs destructors");
+        return static_cast<T*>(allocateBytes(count * sizeof(T), alignof(T)));
+    }
+    void* allocateBytes(size_t bytes, size_t alignment);
+    size_t mark() const { return used; }
+    // Gives back the block memory taken since the mark; heap memory is kept until reset()
+    void rewind(size_t mark);
+    // Gives back everything, and grows the block if the frame outgrew it
+    void reset();
+
+    size_t capacity() const { return size; }
+    size_t highWater() const { return std::max(largest, peak); } // most one frame took, heap included
+    uint64_t overflows() const { return overflowCount; } // allocations that went to the heap
+
+private:
+    unsigned char* block = nullptr;
+    size_t size = 0;
+    size_t used = 0;
+    size_t peak = 0;              // most taken at once since the last reset, heap included
+    size_t largest = 0;           // peak of the busiest frame before this one
+    size_t overflowBytes = 0;     // heap memory taken this frame
+    uint64_t overflowCount = 0;
+    std::vector<unsigned char*> overflow;
+};
@@ -0,0 +1,130 @@
+/*
+ * Title: Frame layers
+ * Description: Implementation of the layer cache declared in FrameLayers.h.
+*/
+
+#include "FrameLayers.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+
+uint64_t combineVersion(uint64_t version, uint64_t value) {
+    // one 64 bit FNV-1a step over the whole value
+    return (version ^ value) * 1099511628211ull;
+}
+
+uint64_t combineVersion(uint64_t version, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return combineVersion(version, static_cast<uint64_t>(bits));
+}
+
+void FrameLayers::init() {
+    staticFramebuffer = registry.create(GL_OBJECT_FRAMEBUFFER);
+    staticColor = registry.create(GL_OBJECT_TEXTURE);
+}
+
+int FrameLayers::addLayer(LayerKind kind, std::function<void()> draw) {
+    Layer layer;
+    layer.kind = kind;
+    layer.draw = draw;
+    layers.push_back(layer);
+    return static_cast<int>(layers.size()) - 1;
+}
+
+/*
+ * This function tells whether a layer of the given kind has a version it wasn't drawn at
+*/
+
+bool FrameLayers::changed(LayerKind kind) const {
+    for (const Layer& layer : layers) {
+        if (layer.kind == kind && (!layer.drawn || layer.version != layer.drawnVersion)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * This function draws the static layers into their own framebuffer, growing it if needed.
+ * The framebuffer that was bound is bound again afterwards.
+*/
+
+void FrameLayers::drawStaticCache(int width, int height) {
+    GLint target = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    if (width > cacheWidth || height > cacheHeight) {
+        cacheWidth = std::max(width, cacheWidth);
+        cacheHeight = std::max(height, cacheHeight);
+        glBindTexture(GL_TEXTURE_2D, staticColor);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheWidth, cacheHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, staticFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, staticColor, 0);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, staticFramebuffer);
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    for (Layer& layer : layers) {
+        if (layer.kind == LAYER_STATIC) {
+            layer.draw();
+            layer.drawnVersion = layer.version;
+            layer.drawn = true;
+        }
+    }
+    staticWidth = width;
+    staticHeight = height;
+    counters.staticRedraws++;
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<unsigned int>(target));
+}
+
+bool FrameLayers::render(DynamicResolution& resolution, const ViewportRect& output) {
+    resolution.begin(output);
+    int width = resolution.width(), height = resolution.height();
+    bool sameTarget = width == lastWidth && height == lastHeight && output.x == lastOutput.x && output.y == lastOutput.y
+        && output.width == lastOutput.width && output.height == lastOutput.height;
+    if (cachingEnabled && sameTarget && !changed(LAYER_STATIC) && !changed(LAYER_DYNAMIC)) {
+        // the framebuffer still holds the last frame; only the copy to the window is needed
+        resolution.cancelTiming();
+        resolution.end();
+        counters.framesSkipped++;
+        return false;
+    }
+
+    bool hasStatic = std::any_of(layers.begin(), layers.end(), [](const Layer& layer) { return layer.kind == LAYER_STATIC; });
+    if (hasStatic) {
+        if (!cachingEnabled || changed(LAYER_STATIC) || width != staticWidth || height != staticHeight) {
+            drawStaticCache(width, height);
+        }
+        // copying the cache also stands in for the clear
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFramebuffer);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glViewport(0, 0, width, height);
+    }
+    else {
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    for (Layer& layer : layers) {
+        if (layer.kind == LAYER_DYNAMIC) {
+            layer.draw();
+            layer.drawnVersion = layer.version;
+            layer.drawn = true;
+        }
+    }
+    resolution.end();
+    lastWidth = width;
+    lastHeight = height;
+    lastOutput = output;
+    counters.framesDrawn++;
+    return true;
+}
+
+void FrameLayers::release() {
+    registry.release();
+    staticFramebuffer = staticColor = 0;
+    cacheWidth = cacheHeight = staticWidth = staticHeight = 0;
+    layers.clear();
+}
@@ -0,0 +1,80 @@
+/*
+ * Title: Frame layers
+ * Description: Splits a frame into layers that are only drawn again when what they show has
+ *      changed. Most frames between two ticks show exactly what the last one did, and the
+ *      background never changes at all, yet the loop used to redraw all of it every time.
+ *
+ *      Each layer has a version that the caller bumps whenever the layer would look different:
+ *      the tick for the snakes and food, the camera position for a scrolling board, nothing
+ *      for the background. Static layers are drawn once into a framebuffer of their own and
+ *      copied in under the rest, so a new frame starts from them instead of a clear. Dynamic
+ *      layers are drawn over that copy in the order they were added. When no version and
+ *      no size has changed since the last frame, nothing is drawn at all: the last composited
+ *      frame is still in the DynamicResolution framebuffer and is simply shown again.
+*/
+
+#pragma once
+
+#include "DynamicResolution.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+enum LayerKind {
+    LAYER_STATIC,                 // drawn once into the cache, under every dynamic layer
+    LAYER_DYNAMIC                 // drawn every time the frame is composited
+};
+
+// How many frames were composited and how many only shown again
+struct FrameLayerStats {
+    uint64_t framesDrawn = 0;
+    uint64_t framesSkipped = 0;
+    uint64_t staticRedraws = 0;   // times the static cache was drawn
+};
+
+// Mixes value into a version, for layers whose look depends on several things
+uint64_t combineVersion(uint64_t version, uint64_t value);
+uint64_t combineVersion(uint64_t version, float value);
+
+class FrameLayers {
+public:
+    // Needs a current OpenGL 3.3 context
+    void init();
+    // Adds a layer drawn by draw() into the bound framebuffer, with the viewport already set;
+    // returns its index for setVersion
+    int addLayer(LayerKind kind, std::function<void()> draw);
+    void setVersion(int layer, uint64_t version) { layers[layer].version = version; }
+    // Draws the layers that changed through resolution (begin() to end()), or shows the last
+    // frame again if none did. Returns true when the frame was composited.
+    bool render(DynamicResolution& resolution, const ViewportRect& output);
+    // Draws every layer on every frame, for comparisons
+    void setCachingEnabled(bool enabled) { cachingEnabled = enabled; }
+    void release();
+    const FrameLayerStats& stats() const { return counters; }
+
+private:
+    struct Layer {
+        LayerKind kind;
+        std::function<void()> draw;
+        uint64_t version = 0;
+        uint64_t drawnVersion = 0;
+        bool drawn = false;       // drawnVersion is valid
+    };
+
+    bool changed(LayerKind kind) const;
+    void drawStaticCache(int width, int height);
+
+    std::vector<Layer> layers;
+    GlRegistry registry;          // the static cache's framebuffer and texture
+    unsigned int staticFramebuffer = 0;
+    unsigned int staticColor = 0;
+    int cacheWidth = 0;           // size of the texture
+    int cacheHeight = 0;
+    int staticWidth = 0;          // size the static layers were last drawn at
+    int staticHeight = 0;
+    ViewportRect lastOutput = { 0, 0, 0, 0 };
+    int lastWidth = 0;            // scene size of the last composited frame
+    int lastHeight = 0;
+    bool cachingEnabled = true;
+    FrameLayerStats counters;
+};
@@ -0,0 +1,338 @@
+/*
+ * Title: Snake Game simulation rules
+ * Description: Implementation of the deterministic tick function declared in Game.h.
+ *      The rules are the ones the original main loop used; they were moved here so that
+ *      the same code can be re-run for rollback and on machines without a GPU.
+*/
+
+#include "Game.h"
+#include <algorithm>
+
+// Forward declarations of helpers used only inside this file
+static uint32_t nextRandom(GameState& state);
+static glm::vec2 spawnFood(GameState& state, bool isBigFood);
+static void growSnake(Snake& snake, int segments);
+
+/*
+ * This function resets a game state to the starting position
+ * @param state: the game state to reset
+ * @param playerCount: number of snakes on the board (1 for the local game, 2 for netplay)
+ * @param seed: seed for the food placement random generator; both peers must use the same one
+*/
+
+void initGame(GameState& state, int playerCount, uint32_t seed) {
+    state.snakes.resize(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        Snake& snake = state.snakes[i];
+        snake.body.clear();
+        snake.score = 0;
+        snake.alive = true;
+    }
+
+    if (playerCount == 1) {
+        // start the snake with one square in the middle of the screen going to the right
+        state.snakes[0].body.push_back({ glm::vec2(windowWIDTH / 2.0, windowHEIGHT / 2.0), RIGHT });
+    }
+    else {
+        // two players start on opposite sides of the middle going in opposite directions
+        state.snakes[0].body.push_back({ glm::vec2(windowWIDTH / 2.0, windowHEIGHT / 2.0 + 60.0), RIGHT });
+        state.snakes[1].body.push_back({ glm::vec2(windowWIDTH / 2.0, windowHEIGHT / 2.0 - 60.0), LEFT });
+    }
+
+    state.bigFoodOnScreen = false;
+    state.smallFoodOnScreen = true;
+    state.smallFoodEaten = 0;
+    // xorshift32 gets stuck at zero, so never let the state be zero
+    state.rngState = seed != 0 ? seed : 0x9E3779B9u;
+    state.tick = 0;
+    state.gameOver = false;
+    state.bigFood = { glm::vec2(0.0f), RIGHT };
+    state.smallFood = { glm::vec2(0.0f), RIGHT };
+
+    reserveGame(state);
+
+    // spawn the food in random place
+    spawnFood(state, false);
+}
+
+void reserveGame(GameState& state) {
+    for (Snake& snake : state.snakes) {
+        snake.body.reserve(SNAKE_RESERVE_SEGMENTS);
+    }
+}
+
+/*
+ * This function advances the game by one tick
+ * @param state: the game state to advance
+ * @param inputs: requested direction for each snake, indexed like state.snakes
+ * @return events: what happened during this tick (food eaten, food spawned, deaths)
+*/
+
+TickEvents stepGame(GameState& state, const Direction* inputs) {
+    TickEvents events;
+    if (state.gameOver) {
+        return events;
+    }
+    state.tick++;
+
+    for (size_t s = 0; s < state.snakes.size(); s++) {
+        std::vector<Square>& body = state.snakes[s].body;
+        if (!state.snakes[s].alive) {
+            continue;
+        }
+
+        // Move each segment of the snake by updating its position and direction:
+        // every segment takes the position and direction of the segment in front of it.
+        // Square is trivially copyable, so this compiles to a single memmove.
+        std::copy_backward(body.begin(), body.end() - 1, body.end());
+
+        // Move the head depending on direction player chooses.
+        // A request to reverse into the body is ignored here rather than only in the input
+        // handler, so that predicted or remote inputs can never break determinism.
+        Square& head = body[0];
+        if (!isOppositeDirection(head.direction, inputs[s])) {
+            head.direction = inputs[s];
+        }
+        switch (head.direction) {
+        case UP:
+            // Move snake head upward by increasing y-coordinate
+            head.position.y += MOVE_STRIDE;
+            break;
+        case DOWN:
+            // Move snake head downward by decreasing y-coordinate
+            head.position.y -= MOVE_STRIDE;
+            break;
+        case LEFT:
+            // Move snake head to the left by decreasing x-coordinate
+            head.position.x -= MOVE_STRIDE;
+            break;
+        case RIGHT:
+            // Move snake head to the right by increasing x-coordinate
+            head.position.x += MOVE_STRIDE;
+            break;
+        }
+    }
+
+    // Collisions are checked after every snake has moved so that the result does not
+    // depend on the order the snakes are stored in
+    for (size_t s = 0; s < state.snakes.size(); s++) {
+        Snake& snake = state.snakes[s];
+        if (!snake.alive) {
+            continue;
+        }
+        const Square& head = snake.body[0];
+        bool dead = false;
+
+        // Check collision with walls; if head collides with wall, game over.
+        if (head.position.x < 0 + WALL_THICKNESS ||             //left wall
+            head.position.x >= windowWIDTH - WALL_THICKNESS ||   //right wall
+            head.position.y < 0 + WALL_THICKNESS - 17.0 ||       //bottom wall
+            head.position.y >= windowHEIGHT - WALL_THICKNESS)   //top wall
+        {
+            dead = true;
+        }
+
+        // Check collision with every snake's body, including this snake's own body.
+        // If the distance between the head and a segment is less than one stride,
+        // then the head ran into that segment. Squared distances avoid a sqrt per segment.
+        for (size_t o = 0; o < state.snakes.size() && !dead; o++) {
+            const std::vector<Square>& other = state.snakes[o].body;
+            // skip own head, but another snake's head counts (head-on collision)
+            for (size_t i = (o == s ? 1 : 0); i < other.size(); ++i) {
+                glm::vec2 offset = head.position - other[i].position;
+                if (glm::dot(offset, offset) < MOVE_STRIDE * MOVE_STRIDE) {
+                    dead = true;
+                    break;
+                }
+            }
+        }
+
+        if (dead) {
+            events.snakeDied = true;
+            events.deathPosition = head.position;
+        }
+        // the snake is only marked dead after all checks, so head-on collisions kill both
+        snake.alive = snake.alive && !dead;
+    }
+
+    for (size_t s = 0; s < state.snakes.size(); s++) {
+        Snake& snake = state.snakes[s];
+        // a snake that crashed this tick doesn't get to eat on its way out
+        if (!snake.alive) {
+            continue;
+        }
+        const Square& head = snake.body[0];
+
+        // Check for small food collision
+        if (state.smallFoodOnScreen && glm::distance(head.position, state.smallFood.position) < SQUARE_SIZE) {
+            events.ateSmallFood = true;
+            events.eatenPosition = state.smallFood.position;
+            // Add new segments to snake and increase score and small food counter
+            growSnake(snake, SMALL_FOOD_GROWTH);
+            snake.score++;
+            state.smallFoodEaten++;
+
+            events.foodSpawned = true;
+            // Check if it's time for big food
+            if (state.smallFoodEaten == 3) {
+                // Time for big food
+                events.spawnedBigFood = true;
+                events.spawnPosition = spawnFood(state, true);
+                state.bigFoodOnScreen = true;
+                state.smallFoodOnScreen = false;
+                state.smallFoodEaten = 0;  // Reset the counter
+            }
+            else {
+                // Spawn new small food
+                events.spawnedBigFood = false;
+                events.spawnPosition = spawnFood(state, false);
+                state.smallFoodOnScreen = true;
+            }
+        }
+
+        // Check for big food collision
+        if (state.bigFoodOnScreen && glm::distance(head.position, state.bigFood.position) < SQUARE_SIZE * 2) {
+            events.ateBigFood = true;
+            events.eatenPosition = state.bigFood.position;
+            growSnake(snake, BIG_FOOD_GROWTH);
+            // Increase score
+            snake.score += 2;
+
+            // Spawn small food and remove big food
+            events.foodSpawned = true;
+            events.spawnedBigFood = false;
+            events.spawnPosition = spawnFood(state, false);
+            state.smallFoodOnScreen = true;
+            state.bigFoodOnScreen = false;
+        }
+    }
+
+    state.gameOver = events.snakeDied;
+    return events;
+}
+
+/*
+ * This function checks whether two directions point opposite ways
+ * @return true if turning from a to b would reverse the snake into its own body
+*/
+
+bool isOppositeDirection(Direction a, Direction b) {
+    return (a == UP && b == DOWN) || (a == DOWN && b == UP) ||
+        (a == LEFT && b == RIGHT) || (a == RIGHT && b == LEFT);
+}
+
+/*
+ * This function computes a 32-bit FNV-1a hash of the whole game state.
+ * Two peers compare these to detect that their simulations have diverged.
+ * @param state: the state to hash
+ * @return hash of the state
+*/
+
+uint32_t hashGameState(const GameState& state) {
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 16777619u;
+        }
+    };
+    auto mixSquare = [&mix](const Square& square) {
+        mix(&square.position.x, sizeof(float));
+        mix(&square.position.y, sizeof(float));
+        int direction = square.direction;
+        mix(&direction, sizeof(direction));
+    };
+
+    for (const Snake& snake : state.snakes) {
+        uint32_t length = static_cast<uint32_t>(snake.body.size());
+        mix(&length, sizeof(length));
+        for (const Square& segment : snake.body) {
+            mixSquare(segment);
+        }
+        mix(&snake.score, sizeof(snake.score));
+        unsigned char alive = snake.alive;
+        mix(&alive, 1);
+    }
+    mixSquare(state.smallFood);
+    mixSquare(state.bigFood);
+    unsigned char flags = (state.bigFoodOnScreen ? 1 : 0) | (state.smallFoodOnScreen ? 2 : 0) | (state.gameOver ? 4 : 0);
+    mix(&flags, 1);
+    mix(&state.smallFoodEaten, sizeof(state.smallFoodEaten));
+    mix(&state.rngState, sizeof(state.rngState));
+    mix(&state.tick, sizeof(state.tick));
+    return hash;
+}
+
+/*
+ * This function returns the next value of the game's xorshift32 random generator.
+ * rand() can't be used because its state is global and differs between C libraries.
+*/
+
+static uint32_t nextRandom(GameState& state) {
+    uint32_t x = state.rngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state.rngState = x;
+    return x;
+}
+
+/*
+ * This function spawns food (either big or small) at a random position on the screen
+ * @param state: the game state to place the food in
+ * @param isBigFood: boolean flag indicating whether to spawn big food (true) or small food (false)
+ * @return newPosition: where the food was placed
+ */
+
+static glm::vec2 spawnFood(GameState& state, bool isBigFood) {
+    glm::vec2 newPosition;
+    bool validPosition;
+    do {
+        //Get the new random position of food.
+        //"% xMax" and "% yMax" allows the new coordinate to stay within window size
+        int newX = int(WALL_THICKNESS + 40.0) + (nextRandom(state) % (int(windowWIDTH) - 2 * int(WALL_THICKNESS + 2 * SQUARE_SIZE) + 1));
+        int newY = int(WALL_THICKNESS + 40.0) + (nextRandom(state) % (int(windowHEIGHT) - 2 * int(WALL_THICKNESS + 2 * SQUARE_SIZE) + 1));
+        // Update the new postion of foood
+        newPosition = glm::vec2(newX, newY);
+
+        validPosition = true; // initialize the valid position to true
+
+        // Don't allow the food to spawn on top of any snake
+        for (const Snake& snake : state.snakes) {
+            for (const auto& segment : snake.body) {
+                // If the distance is less than the segment size (20.0f), then the new position is on
+                // top of the snake and a new position has to be calculated
+                if (glm::distance(segment.position, newPosition) < SQUARE_SIZE) {
+                    validPosition = false;
+                    break;
+                }
+            }
+            if (!validPosition) {
+                break;
+            }
+        }
+    } while (!validPosition); // if the food wants spawn on top of snake, re-calculate a new position for it
+
+    // Update the food's new position
+    if (isBigFood == true) {
+        state.bigFood.position = newPosition;
+    }
+    else {
+        state.smallFood.position = newPosition;
+    }
+    return newPosition;
+}
+
+/*
+ * This function adds segments to the end of a snake. The new segments sit on top of the
+ * current tail and unfold one by one as the snake moves. Within the room reserveGame gave the
+ * body this never allocates.
+ * @param snake: the snake to grow
+ * @param segments: number of segments to add
+*/
+
+static void growSnake(Snake& snake, int segments) {
+    Square newSegment = snake.body.back();
+    snake.body.insert(snake.body.end(), segments, newSegment);
+}
@@ -0,0 +1,78 @@
+/*
+ * Title: Snake Game simulation rules
+ * Description: Deterministic game state and tick function shared by the windowed game,
+ *      netplay and the headless tools. This file must not depend on GLFW or OpenGL so that
+ *      it can be linked into programs that have no window.
+ * Libraries required: GLM
+*/
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Constants for game window and object dimensions
+const float windowWIDTH = 800.0f;      // Width of the game window
+const float windowHEIGHT = 600.0f;     // Height of the game window
+const float SQUARE_SIZE = 20.0f;       // Size of game objects (snake segments, food)
+const float WALL_THICKNESS = 60.0f;    // Thickness of game boundaries
+
+// Movement constants
+const float MOVE_STRIDE = 2.5;         // Distance moved in a single step
+const int SMALL_FOOD_GROWTH = 25;      // Segments added when a small food is eaten
+const int BIG_FOOD_GROWTH = 75;        // Segments added when a big food is eaten
+const int MAX_PLAYERS = 2;             // Snakes supported on one board (local game uses one)
+const int SNAKE_RESERVE_SEGMENTS = 8192; // Body room reserved up front: a snake eats about 200 foods to outgrow it
+
+// Enum to represent possible movement directions of the snake
+enum Direction { UP, DOWN, LEFT, RIGHT };
+
+// Struct to represent snake segments and food items
+struct Square {
+    glm::vec2 position;           // Current position
+    Direction direction;          // Movement direction
+};
+
+// One player's snake; body[0] is the head
+struct Snake {
+    std::vector<Square> body;
+    int score = 0;
+    bool alive = true;
+};
+
+// Everything needed to reproduce a game. Copying a GameState is a complete snapshot:
+// there is no hidden state (the random generator lives in here too), so two machines
+// that start from the same seed and feed the same inputs will stay identical.
+struct GameState {
+    std::vector<Snake> snakes;
+    Square smallFood;
+    Square bigFood;
+    bool bigFoodOnScreen = false;
+    bool smallFoodOnScreen = true;
+    int smallFoodEaten = 0;       // small foods eaten since the last big food
+    uint32_t rngState = 1;        // xorshift32 state used for food placement
+    uint32_t tick = 0;            // number of ticks simulated so far
+    bool gameOver = false;
+};
+
+// Things that happened during one tick, so callers can print, play effects or count stats
+// without the simulation knowing about any of them
+struct TickEvents {
+    bool ateSmallFood = false;
+    bool ateBigFood = false;
+    glm::vec2 eatenPosition = glm::vec2(0.0f);
+    bool foodSpawned = false;
+    bool spawnedBigFood = false;
+    glm::vec2 spawnPosition = glm::vec2(0.0f);
+    bool snakeDied = false;
+    glm::vec2 deathPosition = glm::vec2(0.0f);
+};
+
+void initGame(GameState& state, int playerCount, uint32_t seed);
+// Gives every snake room for SNAKE_RESERVE_SEGMENTS, so eating doesn't reallocate and copy the
+// body. initGame does this; a copy of a state only gets the room its bodies use.
+void reserveGame(GameState& state);
+TickEvents stepGame(GameState& state, const Direction* inputs);
+bool isOppositeDirection(Direction a, Direction b);
+uint32_t hashGameState(const GameState& state);
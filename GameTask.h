@@ -0,0 +1,128 @@
+/*
+ * Title: Timed game tasks
+ * Description: C++20 coroutines that wait on a timer wheel, so timed game logic reads top to
+ *      bottom instead of being split over callbacks:
+ *
+ *          GameTask respawnLater(ArenaState& arena, int index) {
+ *              co_await ticks(ARENA_RESPAWN_TICKS);
+ *              spawnSnake(arena, index);
+ *          }
+ *
+ *      A task starts running when it is called and returns to the caller at its first
+ *      co_await. ticks(n) schedules the task's resumption on the wheel, so a waiting task is
+ *      one pending timer and costs nothing until it fires. The wheel comes from the task's
+ *      first parameter through timerWheelOf(), which TimerWheel.h defines for a wheel itself
+ *      and other headers can define for the objects that own one. A task still waiting when
+ *      its wheel is reset or destroyed is destroyed with it, so its locals are cleaned up.
+ *
+ *      Task frames are recycled: a finished task's frame goes on a free list of the thread it
+ *      finished on, for the next task of the same size, so starting tasks stops allocating
+ *      once the most that were ever waiting at once have finished.
+*/
+
+#pragma once
+
+#include "TimerWheel.h"
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+
+// Free lists of coroutine frames, one per frame size; each coroutine has a frame of its own size
+class TaskFramePool {
+public:
+    static const int SIZES = 8;
+
+    ~TaskFramePool() {
+        for (int i = 0; i < SIZES; i++) {
+            while (lists[i] != nullptr) {
+                FreeFrame* frame = lists[i];
+                lists[i] = frame->next;
+                ::operator delete(frame);
+            }
+        }
+    }
+
+    void* take(size_t size) {
+        for (int i = 0; i < SIZES; i++) {
+            if (sizes[i] == size && lists[i] != nullptr) {
+                FreeFrame* frame = lists[i];
+                lists[i] = frame->next;
+                return frame;
+            }
+        }
+        return ::operator new(size);
+    }
+
+    void give(void* memory, size_t size) {
+        for (int i = 0; i < SIZES; i++) {
+            if (sizes[i] == 0) {
+                sizes[i] = size;
+            }
+            if (sizes[i] == size) {
+                FreeFrame* frame = static_cast<FreeFrame*>(memory);
+                frame->next = lists[i];
+                lists[i] = frame;
+                return;
+            }
+        }
+        // more kinds of task than lists
+        ::operator delete(memory);
+    }
+
+private:
+    struct FreeFrame {
+        FreeFrame* next;
+    };
+
+    size_t sizes[SIZES] = {};
+    FreeFrame* lists[SIZES] = {};
+};
+
+inline TaskFramePool& taskFramePool() {
+    thread_local TaskFramePool pool;
+    return pool;
+}
+
+// A timed task with nothing to return; the caller does not wait for it
+class GameTask {
+public:
+    struct promise_type {
+        TimerWheel* wheel;
+
+        template<typename Owner, typename... Rest>
+        promise_type(Owner& owner, Rest&...) : wheel(&timerWheelOf(owner)) {
+        }
+
+        static void* operator new(size_t size) { return taskFramePool().take(size); }
+        static void operator delete(void* frame, size_t size) { taskFramePool().give(frame, size); }
+
+        GameTask get_return_object() { return GameTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Awaited with co_await inside a GameTask: resumes the task the given number of ticks later
+struct TickDelay {
+    uint32_t count;
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<GameTask::promise_type> task) const {
+        task.promise().wheel->schedule(count, resumeTask, task.address(), 0, destroyTask);
+    }
+    void await_resume() const {}
+
+    static void resumeTask(void* address, uint64_t) {
+        std::coroutine_handle<>::from_address(address).resume();
+    }
+    static void destroyTask(void* address, uint64_t) {
+        std::coroutine_handle<>::from_address(address).destroy();
+    }
+};
+
+inline TickDelay ticks(uint32_t count) {
+    return TickDelay{ count };
+}
@@ -0,0 +1,61 @@
+/*
+ * Title: GL resources
+ * Description: Implementation of the GL object handles and registry declared in GlResources.h.
+*/
+
+#include <glad/glad.h>
+#include "GlResources.h"
+
+unsigned int createGlObject(GlObjectKind kind) {
+    GLuint name = 0;
+    switch (kind) {
+    case GL_OBJECT_BUFFER: glGenBuffers(1, &name); break;
+    case GL_OBJECT_VERTEX_ARRAY: glGenVertexArrays(1, &name); break;
+    case GL_OBJECT_TEXTURE: glGenTextures(1, &name); break;
+    case GL_OBJECT_FRAMEBUFFER: glGenFramebuffers(1, &name); break;
+    case GL_OBJECT_PROGRAM: name = glCreateProgram(); break;
+    case GL_OBJECT_QUERY: glGenQueries(1, &name); break;
+    default: break;                       // shaders need a type; see Shader.h
+    }
+    return name;
+}
+
+void deleteGlObject(GlObjectKind kind, unsigned int name) {
+    switch (kind) {
+    case GL_OBJECT_BUFFER: glDeleteBuffers(1, &name); break;
+    case GL_OBJECT_VERTEX_ARRAY: glDeleteVertexArrays(1, &name); break;
+    case GL_OBJECT_TEXTURE: glDeleteTextures(1, &name); break;
+    case GL_OBJECT_FRAMEBUFFER: glDeleteFramebuffers(1, &name); break;
+    case GL_OBJECT_PROGRAM: glDeleteProgram(name); break;
+    case GL_OBJECT_SHADER: glDeleteShader(name); break;
+    case GL_OBJECT_QUERY: glDeleteQueries(1, &name); break;
+    default: break;
+    }
+}
+
+unsigned int GlRegistry::add(GlObjectKind kind, unsigned int name) {
+    if (name != 0) {
+        entries.push_back({ kind, name });
+    }
+    return name;
+}
+
+size_t GlRegistry::count(GlObjectKind kind) const {
+    size_t found = 0;
+    for (const Entry& entry : entries) {
+        found += entry.kind == kind ? 1 : 0;
+    }
+    return found;
+}
+
+/*
+ * This function deletes every object kept, newest first, so that a vertex array goes before
+ * the buffers it points into
+*/
+
+void GlRegistry::release() {
+    for (size_t i = entries.size(); i-- > 0;) {
+        deleteGlObject(entries[i].kind, entries[i].name);
+    }
+    entries.clear();
+}
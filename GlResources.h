@@ -0,0 +1,97 @@
+/*
+ * Title: GL resources
+ * Description: Owning handles for OpenGL objects, and a registry that keeps a set of them.
+ *
+ *      A GlHandle owns one object of one kind (GlBuffer, GlVertexArray, GlTexture, GlProgram...)
+ *      and deletes it when it goes out of scope or is given another one. Handles can be moved
+ *      but not copied, so every object has exactly one owner and nothing is deleted twice.
+ *
+ *      A GlRegistry takes handles over and keeps them until release(), which deletes them all,
+ *      newest first. Every renderer makes the objects it draws with into a registry of its own
+ *      in init(), a restart leaves them alone, and release() deletes them once before the
+ *      window goes; the live counts of GlStats.h show whether anything is made or leaked in
+ *      between. Objects made later, like the arena's chunk buffers, are held by handles.
+ *
+ *      Deleting needs the context the objects were made in to be current, so owners that
+ *      outlive it let go with release() first.
+*/
+
+#pragma once
+
+#include "GlStats.h"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Makes one object of a kind; programs and shaders are made by Shader.h instead and adopted
+unsigned int createGlObject(GlObjectKind kind);
+void deleteGlObject(GlObjectKind kind, unsigned int name);
+
+template <GlObjectKind KIND>
+class GlHandle {
+public:
+    GlHandle() = default;
+    explicit GlHandle(unsigned int name) : object(name) {}
+    ~GlHandle() { reset(); }
+    GlHandle(const GlHandle&) = delete;
+    GlHandle& operator=(const GlHandle&) = delete;
+    GlHandle(GlHandle&& other) noexcept : object(other.take()) {}
+    GlHandle& operator=(GlHandle&& other) noexcept {
+        if (this != &other) {
+            reset(other.take());
+        }
+        return *this;
+    }
+
+    static GlHandle create() { return GlHandle(createGlObject(KIND)); }
+    unsigned int get() const { return object; }
+    explicit operator bool() const { return object != 0; }
+    // Gives up ownership without deleting
+    unsigned int take() { return std::exchange(object, 0u); }
+    // Deletes the object held, if any, and holds the given one
+    void reset(unsigned int name = 0) {
+        if (object != 0) {
+            deleteGlObject(KIND, object);
+        }
+        object = name;
+    }
+
+private:
+    unsigned int object = 0;
+};
+
+typedef GlHandle<GL_OBJECT_BUFFER> GlBuffer;
+typedef GlHandle<GL_OBJECT_VERTEX_ARRAY> GlVertexArray;
+typedef GlHandle<GL_OBJECT_TEXTURE> GlTexture;
+typedef GlHandle<GL_OBJECT_FRAMEBUFFER> GlFramebuffer;
+typedef GlHandle<GL_OBJECT_PROGRAM> GlProgram;
+
+class GlRegistry {
+public:
+    GlRegistry() = default;
+    ~GlRegistry() { release(); }
+    GlRegistry(const GlRegistry&) = delete;
+    GlRegistry& operator=(const GlRegistry&) = delete;
+
+    // Takes the handle's object over; returns it
+    template <GlObjectKind KIND>
+    unsigned int add(GlHandle<KIND>&& handle) {
+        return add(KIND, handle.take());
+    }
+    // Makes an object of the kind and keeps it
+    unsigned int create(GlObjectKind kind) { return add(kind, createGlObject(kind)); }
+    size_t size() const { return entries.size(); }
+    size_t count(GlObjectKind kind) const;
+    // Deletes everything kept, newest first
+    void release();
+
+private:
+    struct Entry {
+        GlObjectKind kind;
+        unsigned int name;
+    };
+
+    unsigned int add(GlObjectKind kind, unsigned int name);
+
+    std::vector<Entry> entries;
+};
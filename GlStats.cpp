@@ -0,0 +1,704 @@
+/*
+ * Title: OpenGL call statistics
+ * Description: Implementation of the counting GL layer declared in GlStats.h.
+*/
+
+#include <glad/glad.h>
+#include "GlStats.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+const char* glStatsSite = "other";
+
+// Shadow values meaning "not known yet"
+const GLuint UNKNOWN_NAME = 0xFFFFFFFFu;
+const int SHADOW_TEXTURE_UNITS = 32;
+const int SHADOW_TEXTURE_TARGETS = 3;     // 2D, 2D array, cube map
+const int SHADOW_BUFFER_TARGETS = 4;      // array, pixel pack, pixel unpack, uniform
+const int UNIFORM_VALUE_BYTES = 64;       // a mat4
+
+static const char* const functionNames[GL_FUNCTION_COUNT] = {
+    "glDrawArrays", "glDrawElements", "glDrawArraysInstanced", "glDrawElementsInstanced",
+    "glBindVertexArray", "glUseProgram", "glActiveTexture", "glBindTexture", "glBindBuffer",
+    "glBindFramebuffer", "glEnable", "glDisable", "glBlendFunc", "glViewport",
+    "glUniform1i", "glUniform1f", "glUniform2f", "glUniform3f", "glUniform4f",
+    "glUniformMatrix4fv", "glGetUniformLocation",
+    "glBufferData", "glBufferSubData", "glTexImage2D", "glTexSubImage2D",
+    "glClear", "glBlitFramebuffer", "glReadPixels",
+    "glGenBuffers", "glDeleteBuffers", "glGenVertexArrays", "glDeleteVertexArrays",
+    "glGenTextures", "glDeleteTextures", "glGenFramebuffers", "glDeleteFramebuffers",
+    "glCreateProgram", "glDeleteProgram", "glCreateShader", "glDeleteShader",
+    "glGenQueries", "glDeleteQueries",
+};
+
+static const char* const objectNames[GL_OBJECT_KINDS] = {
+    "buffers", "vertex arrays", "textures", "framebuffers", "programs", "shaders", "queries",
+};
+
+// The pointers glad loaded, called by the counting versions
+static struct {
+    PFNGLDRAWARRAYSPROC drawArrays;
+    PFNGLDRAWELEMENTSPROC drawElements;
+    PFNGLDRAWARRAYSINSTANCEDPROC drawArraysInstanced;
+    PFNGLDRAWELEMENTSINSTANCEDPROC drawElementsInstanced;
+    PFNGLBINDVERTEXARRAYPROC bindVertexArray;
+    PFNGLUSEPROGRAMPROC useProgram;
+    PFNGLACTIVETEXTUREPROC activeTexture;
+    PFNGLBINDTEXTUREPROC bindTexture;
+    PFNGLBINDBUFFERPROC bindBuffer;
+    PFNGLBINDFRAMEBUFFERPROC bindFramebuffer;
+    PFNGLENABLEPROC enable;
+    PFNGLDISABLEPROC disable;
+    PFNGLBLENDFUNCPROC blendFunc;
+    PFNGLVIEWPORTPROC viewport;
+    PFNGLUNIFORM1IPROC uniform1i;
+    PFNGLUNIFORM1FPROC uniform1f;
+    PFNGLUNIFORM2FPROC uniform2f;
+    PFNGLUNIFORM3FPROC uniform3f;
+    PFNGLUNIFORM4FPROC uniform4f;
+    PFNGLUNIFORMMATRIX4FVPROC uniformMatrix4fv;
+    PFNGLGETUNIFORMLOCATIONPROC getUniformLocation;
+    PFNGLBUFFERDATAPROC bufferData;
+    PFNGLBUFFERSUBDATAPROC bufferSubData;
+    PFNGLTEXIMAGE2DPROC texImage2D;
+    PFNGLTEXSUBIMAGE2DPROC texSubImage2D;
+    PFNGLCLEARPROC clear;
+    PFNGLBLITFRAMEBUFFERPROC blitFramebuffer;
+    PFNGLREADPIXELSPROC readPixels;
+    PFNGLGENBUFFERSPROC genBuffers;
+    PFNGLDELETEBUFFERSPROC deleteBuffers;
+    PFNGLGENVERTEXARRAYSPROC genVertexArrays;
+    PFNGLDELETEVERTEXARRAYSPROC deleteVertexArrays;
+    PFNGLGENTEXTURESPROC genTextures;
+    PFNGLDELETETEXTURESPROC deleteTextures;
+    PFNGLGENFRAMEBUFFERSPROC genFramebuffers;
+    PFNGLDELETEFRAMEBUFFERSPROC deleteFramebuffers;
+    PFNGLCREATEPROGRAMPROC createProgram;
+    PFNGLDELETEPROGRAMPROC deleteProgram;
+    PFNGLCREATESHADERPROC createShader;
+    PFNGLDELETESHADERPROC deleteShader;
+    PFNGLGENQUERIESPROC genQueries;
+    PFNGLDELETEQUERIESPROC deleteQueries;
+} real;
+
+// Last value set through each uniform location
+struct UniformValue {
+    uint8_t size;
+    uint8_t bytes[UNIFORM_VALUE_BYTES];
+};
+
+// What the layer believes is bound right now
+static struct {
+    GLuint vertexArray;
+    GLuint program;
+    GLuint activeUnit;
+    GLuint textures[SHADOW_TEXTURE_UNITS][SHADOW_TEXTURE_TARGETS];
+    GLuint buffers[SHADOW_BUFFER_TARGETS];
+    GLuint drawFramebuffer;
+    GLuint readFramebuffer;
+    std::unordered_map<GLenum, bool> enabled;
+    std::unordered_map<uint64_t, UniformValue> uniforms; // program << 32 | location
+} shadow;
+
+static bool installed = false;
+static GlFrameReport current;
+static GlFrameReport lastFrame;
+static size_t lastSite = 0;               // index in current.sites of the site last counted
+static int64_t liveObjects[GL_OBJECT_KINDS];
+
+/*
+ * This function returns the statistics of the current call site in the frame being counted.
+ * Consecutive calls nearly always come from the same site, so that one is checked first.
+*/
+
+static GlSiteStats& siteStats() {
+    if (lastSite < current.sites.size() && current.sites[lastSite].site == glStatsSite) {
+        return current.sites[lastSite];
+    }
+    for (size_t i = 0; i < current.sites.size(); i++) {
+        if (current.sites[i].site == glStatsSite) {
+            lastSite = i;
+            return current.sites[i];
+        }
+    }
+    GlSiteStats site;
+    site.site = glStatsSite;
+    current.sites.push_back(site);
+    lastSite = current.sites.size() - 1;
+    return current.sites.back();
+}
+
+static GlSiteStats& noteCall(GlFunction function) {
+    current.calls[function]++;
+    current.totalCalls++;
+    GlSiteStats& site = siteStats();
+    site.calls++;
+    return site;
+}
+
+static void noteDraw(GlFunction function, uint64_t instances) {
+    GlSiteStats& site = noteCall(function);
+    site.draws++;
+    current.draws++;
+    current.instances += instances;
+}
+
+/*
+ * This function counts a bind or state change, and whether it changed anything
+ * @param shadowValue: what the layer believes is set; updated to value
+*/
+
+static void noteBind(GlFunction function, GLuint& shadowValue, GLuint value) {
+    GlSiteStats& site = noteCall(function);
+    site.binds++;
+    current.binds++;
+    if (shadowValue == value) {
+        site.redundant++;
+        current.redundantBinds++;
+    }
+    shadowValue = value;
+}
+
+/*
+ * This function counts a uniform upload to the current program, and whether the location
+ * already held the same value
+*/
+
+static void noteUniform(GlFunction function, GLint location, const void* value, size_t size) {
+    GlSiteStats& site = noteCall(function);
+    site.uniforms++;
+    current.uniformUploads++;
+    if (location < 0 || shadow.program == UNKNOWN_NAME) {
+        return;
+    }
+    uint64_t key = (uint64_t(shadow.program) << 32) | uint32_t(location);
+    UniformValue& stored = shadow.uniforms[key];
+    size = std::min(size, size_t(UNIFORM_VALUE_BYTES));
+    if (stored.size == size && memcmp(stored.bytes, value, size) == 0) {
+        site.redundant++;
+        current.redundantUniforms++;
+        return;
+    }
+    stored.size = static_cast<uint8_t>(size);
+    memcpy(stored.bytes, value, size);
+}
+
+static void noteBytes(GlFunction function, uint64_t bytes, bool texture) {
+    GlSiteStats& site = noteCall(function);
+    site.bytes += bytes;
+    (texture ? current.textureBytes : current.bufferBytes) += bytes;
+}
+
+static int textureTargetIndex(GLenum target) {
+    switch (target) {
+    case GL_TEXTURE_2D: return 0;
+    case GL_TEXTURE_2D_ARRAY: return 1;
+    case GL_TEXTURE_CUBE_MAP: return 2;
+    default: return -1;
+    }
+}
+
+static int bufferTargetIndex(GLenum target) {
+    switch (target) {
+    case GL_ARRAY_BUFFER: return 0;
+    case GL_PIXEL_PACK_BUFFER: return 1;
+    case GL_PIXEL_UNPACK_BUFFER: return 2;
+    case GL_UNIFORM_BUFFER: return 3;
+    default: return -1;               // element arrays belong to the VAO; not followed
+    }
+}
+
+/*
+ * This function returns the bytes of a width x height image in a format and type
+*/
+
+static uint64_t imageBytes(GLsizei width, GLsizei height, GLenum format, GLenum type) {
+    uint64_t channels = 4;
+    switch (format) {
+    case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: channels = 1; break;
+    case GL_RG: case GL_RG_INTEGER: channels = 2; break;
+    case GL_RGB: case GL_BGR: channels = 3; break;
+    default: break;
+    }
+    uint64_t channelBytes = 1;
+    switch (type) {
+    case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: channelBytes = 2; break;
+    case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: channelBytes = 4; break;
+    default: break;
+    }
+    return uint64_t(width) * uint64_t(height) * channels * channelBytes;
+}
+
+// The counting versions of the wrapped functions
+
+static void APIENTRY countedDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    noteDraw(GL_FN_DRAW_ARRAYS, 1);
+    real.drawArrays(mode, first, count);
+}
+
+static void APIENTRY countedDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+    noteDraw(GL_FN_DRAW_ELEMENTS, 1);
+    real.drawElements(mode, count, type, indices);
+}
+
+static void APIENTRY countedDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+    noteDraw(GL_FN_DRAW_ARRAYS_INSTANCED, instances);
+    real.drawArraysInstanced(mode, first, count, instances);
+}
+
+static void APIENTRY countedDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances) {
+    noteDraw(GL_FN_DRAW_ELEMENTS_INSTANCED, instances);
+    real.drawElementsInstanced(mode, count, type, indices, instances);
+}
+
+static void APIENTRY countedBindVertexArray(GLuint array) {
+    noteBind(GL_FN_BIND_VERTEX_ARRAY, shadow.vertexArray, array);
+    real.bindVertexArray(array);
+}
+
+static void APIENTRY countedUseProgram(GLuint program) {
+    noteBind(GL_FN_USE_PROGRAM, shadow.program, program);
+    real.useProgram(program);
+}
+
+static void APIENTRY countedActiveTexture(GLenum texture) {
+    noteBind(GL_FN_ACTIVE_TEXTURE, shadow.activeUnit, texture - GL_TEXTURE0);
+    real.activeTexture(texture);
+}
+
+static void APIENTRY countedBindTexture(GLenum target, GLuint texture) {
+    int index = textureTargetIndex(target);
+    if (index >= 0 && shadow.activeUnit < GLuint(SHADOW_TEXTURE_UNITS)) {
+        noteBind(GL_FN_BIND_TEXTURE, shadow.textures[shadow.activeUnit][index], texture);
+    }
+    else {
+        GLuint unknown = UNKNOWN_NAME;
+        noteBind(GL_FN_BIND_TEXTURE, unknown, texture);
+    }
+    real.bindTexture(target, texture);
+}
+
+static void APIENTRY countedBindBuffer(GLenum target, GLuint buffer) {
+    int index = bufferTargetIndex(target);
+    GLuint unknown = UNKNOWN_NAME;
+    noteBind(GL_FN_BIND_BUFFER, index >= 0 ? shadow.buffers[index] : unknown, buffer);
+    real.bindBuffer(target, buffer);
+}
+
+static void APIENTRY countedBindFramebuffer(GLenum target, GLuint framebuffer) {
+    if (target == GL_FRAMEBUFFER) {
+        // binds both; redundant only if both were already this one
+        GLuint both = shadow.drawFramebuffer == shadow.readFramebuffer ? shadow.drawFramebuffer : UNKNOWN_NAME;
+        noteBind(GL_FN_BIND_FRAMEBUFFER, both, framebuffer);
+        shadow.drawFramebuffer = shadow.readFramebuffer = framebuffer;
+    }
+    else {
+        noteBind(GL_FN_BIND_FRAMEBUFFER, target == GL_READ_FRAMEBUFFER ? shadow.readFramebuffer : shadow.drawFramebuffer, framebuffer);
+    }
+    real.bindFramebuffer(target, framebuffer);
+}
+
+/*
+ * This function counts enabling or disabling a capability, redundant if it already was
+*/
+
+static void noteCapability(GlFunction function, GLenum capability, bool on) {
+    GlSiteStats& site = noteCall(function);
+    site.binds++;
+    current.binds++;
+    auto known = shadow.enabled.find(capability);
+    if (known != shadow.enabled.end() && known->second == on) {
+        site.redundant++;
+        current.redundantBinds++;
+    }
+    shadow.enabled[capability] = on;
+}
+
+static void APIENTRY countedEnable(GLenum capability) {
+    noteCapability(GL_FN_ENABLE, capability, true);
+    real.enable(capability);
+}
+
+static void APIENTRY countedDisable(GLenum capability) {
+    noteCapability(GL_FN_DISABLE, capability, false);
+    real.disable(capability);
+}
+
+static void APIENTRY countedBlendFunc(GLenum source, GLenum destination) {
+    noteCall(GL_FN_BLEND_FUNC);
+    real.blendFunc(source, destination);
+}
+
+static void APIENTRY countedViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    noteCall(GL_FN_VIEWPORT);
+    real.viewport(x, y, width, height);
+}
+
+static void APIENTRY countedUniform1i(GLint location, GLint v0) {
+    noteUniform(GL_FN_UNIFORM_1I, location, &v0, sizeof(v0));
+    real.uniform1i(location, v0);
+}
+
+static void APIENTRY countedUniform1f(GLint location, GLfloat v0) {
+    noteUniform(GL_FN_UNIFORM_1F, location, &v0, sizeof(v0));
+    real.uniform1f(location, v0);
+}
+
+static void APIENTRY countedUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+    GLfloat value[2] = { v0, v1 };
+    noteUniform(GL_FN_UNIFORM_2F, location, value, sizeof(value));
+    real.uniform2f(location, v0, v1);
+}
+
+static void APIENTRY countedUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+    GLfloat value[3] = { v0, v1, v2 };
+    noteUniform(GL_FN_UNIFORM_3F, location, value, sizeof(value));
+    real.uniform3f(location, v0, v1, v2);
+}
+
+static void APIENTRY countedUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+    GLfloat value[4] = { v0, v1, v2, v3 };
+    noteUniform(GL_FN_UNIFORM_4F, location, value, sizeof(value));
+    real.uniform4f(location, v0, v1, v2, v3);
+}
+
+static void APIENTRY countedUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    // arrays of matrices are compared by their first one only
+    noteUniform(GL_FN_UNIFORM_MATRIX_4FV, location, value, count == 1 && !transpose ? 16 * sizeof(GLfloat) : 0);
+    real.uniformMatrix4fv(location, count, transpose, value);
+}
+
+static GLint APIENTRY countedGetUniformLocation(GLuint program, const GLchar* name) {
+    GlSiteStats& site = noteCall(GL_FN_GET_UNIFORM_LOCATION);
+    site.uniforms++;
+    current.uniformLookups++;
+    return real.getUniformLocation(program, name);
+}
+
+static void APIENTRY countedBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    noteBytes(GL_FN_BUFFER_DATA, data != nullptr ? uint64_t(size) : 0, false);
+    real.bufferData(target, size, data, usage);
+}
+
+static void APIENTRY countedBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    noteBytes(GL_FN_BUFFER_SUB_DATA, uint64_t(size), false);
+    real.bufferSubData(target, offset, size, data);
+}
+
+static void APIENTRY countedTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+    GLint border, GLenum format, GLenum type, const void* pixels) {
+    noteBytes(GL_FN_TEX_IMAGE_2D, pixels != nullptr ? imageBytes(width, height, format, type) : 0, true);
+    real.texImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+}
+
+static void APIENTRY countedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+    GLenum format, GLenum type, const void* pixels) {
+    noteBytes(GL_FN_TEX_SUB_IMAGE_2D, imageBytes(width, height, format, type), true);
+    real.texSubImage2D(target, level, x, y, width, height, format, type, pixels);
+}
+
+static void APIENTRY countedClear(GLbitfield mask) {
+    noteCall(GL_FN_CLEAR);
+    real.clear(mask);
+}
+
+static void APIENTRY countedBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0,
+    GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter) {
+    noteCall(GL_FN_BLIT_FRAMEBUFFER);
+    real.blitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+}
+
+static void APIENTRY countedReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels) {
+    noteCall(GL_FN_READ_PIXELS);
+    real.readPixels(x, y, width, height, format, type, pixels);
+}
+
+/*
+ * This function counts objects made, for the live object counts
+*/
+
+static void noteMade(GlFunction function, GlObjectKind kind, GLsizei count) {
+    noteCall(function);
+    liveObjects[kind] += count;
+}
+
+/*
+ * This function counts objects deleted and forgets any shadow binding of them, as deleting a
+ * bound object unbinds it
+*/
+
+static void noteDeleted(GlFunction function, GlObjectKind kind, GLsizei count, const GLuint* names) {
+    noteCall(function);
+    for (GLsizei i = 0; i < count; i++) {
+        GLuint name = names[i];
+        if (name == 0) {
+            continue;
+        }
+        liveObjects[kind]--;
+        switch (kind) {
+        case GL_OBJECT_VERTEX_ARRAY:
+            if (shadow.vertexArray == name) {
+                shadow.vertexArray = 0;
+            }
+            break;
+        case GL_OBJECT_TEXTURE:
+            for (int unit = 0; unit < SHADOW_TEXTURE_UNITS; unit++) {
+                for (int target = 0; target < SHADOW_TEXTURE_TARGETS; target++) {
+                    if (shadow.textures[unit][target] == name) {
+                        shadow.textures[unit][target] = 0;
+                    }
+                }
+            }
+            break;
+        case GL_OBJECT_BUFFER:
+            for (GLuint& buffer : shadow.buffers) {
+                if (buffer == name) {
+                    buffer = 0;
+                }
+            }
+            break;
+        case GL_OBJECT_FRAMEBUFFER:
+            if (shadow.drawFramebuffer == name) {
+                shadow.drawFramebuffer = 0;
+            }
+            if (shadow.readFramebuffer == name) {
+                shadow.readFramebuffer = 0;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void APIENTRY countedGenBuffers(GLsizei count, GLuint* names) {
+    noteMade(GL_FN_GEN_BUFFERS, GL_OBJECT_BUFFER, count);
+    real.genBuffers(count, names);
+}
+
+static void APIENTRY countedDeleteBuffers(GLsizei count, const GLuint* names) {
+    noteDeleted(GL_FN_DELETE_BUFFERS, GL_OBJECT_BUFFER, count, names);
+    real.deleteBuffers(count, names);
+}
+
+static void APIENTRY countedGenVertexArrays(GLsizei count, GLuint* names) {
+    noteMade(GL_FN_GEN_VERTEX_ARRAYS, GL_OBJECT_VERTEX_ARRAY, count);
+    real.genVertexArrays(count, names);
+}
+
+static void APIENTRY countedDeleteVertexArrays(GLsizei count, const GLuint* names) {
+    noteDeleted(GL_FN_DELETE_VERTEX_ARRAYS, GL_OBJECT_VERTEX_ARRAY, count, names);
+    real.deleteVertexArrays(count, names);
+}
+
+static void APIENTRY countedGenTextures(GLsizei count, GLuint* names) {
+    noteMade(GL_FN_GEN_TEXTURES, GL_OBJECT_TEXTURE, count);
+    real.genTextures(count, names);
+}
+
+static void APIENTRY countedDeleteTextures(GLsizei count, const GLuint* names) {
+    noteDeleted(GL_FN_DELETE_TEXTURES, GL_OBJECT_TEXTURE, count, names);
+    real.deleteTextures(count, names);
+}
+
+static void APIENTRY countedGenFramebuffers(GLsizei count, GLuint* names) {
+    noteMade(GL_FN_GEN_FRAMEBUFFERS, GL_OBJECT_FRAMEBUFFER, count);
+    real.genFramebuffers(count, names);
+}
+
+static void APIENTRY countedDeleteFramebuffers(GLsizei count, const GLuint* names) {
+    noteDeleted(GL_FN_DELETE_FRAMEBUFFERS, GL_OBJECT_FRAMEBUFFER, count, names);
+    real.deleteFramebuffers(count, names);
+}
+
+static GLuint APIENTRY countedCreateProgram() {
+    noteMade(GL_FN_CREATE_PROGRAM, GL_OBJECT_PROGRAM, 1);
+    return real.createProgram();
+}
+
+static void APIENTRY countedDeleteProgram(GLuint program) {
+    noteDeleted(GL_FN_DELETE_PROGRAM, GL_OBJECT_PROGRAM, 1, &program);
+    // a relinked or reused name must not match stale uniform values
+    for (auto entry = shadow.uniforms.begin(); entry != shadow.uniforms.end();) {
+        entry = (entry->first >> 32) == program ? shadow.uniforms.erase(entry) : std::next(entry);
+    }
+    real.deleteProgram(program);
+}
+
+static GLuint APIENTRY countedCreateShader(GLenum type) {
+    noteMade(GL_FN_CREATE_SHADER, GL_OBJECT_SHADER, 1);
+    return real.createShader(type);
+}
+
+static void APIENTRY countedDeleteShader(GLuint shader) {
+    noteDeleted(GL_FN_DELETE_SHADER, GL_OBJECT_SHADER, 1, &shader);
+    real.deleteShader(shader);
+}
+
+static void APIENTRY countedGenQueries(GLsizei count, GLuint* names) {
+    noteMade(GL_FN_GEN_QUERIES, GL_OBJECT_QUERY, count);
+    real.genQueries(count, names);
+}
+
+static void APIENTRY countedDeleteQueries(GLsizei count, const GLuint* names) {
+    noteDeleted(GL_FN_DELETE_QUERIES, GL_OBJECT_QUERY, count, names);
+    real.deleteQueries(count, names);
+}
+
+/*
+ * This function swaps one glad pointer for its counting version, or back
+*/
+
+template<typename Pointer>
+static void swapPointer(Pointer& gladPointer, Pointer& saved, Pointer counted, bool install) {
+    if (install) {
+        saved = gladPointer;
+        gladPointer = counted;
+    }
+    else {
+        gladPointer = saved;
+    }
+}
+
+static void swapAll(bool install) {
+    swapPointer(glad_glDrawArrays, real.drawArrays, countedDrawArrays, install);
+    swapPointer(glad_glDrawElements, real.drawElements, countedDrawElements, install);
+    swapPointer(glad_glDrawArraysInstanced, real.drawArraysInstanced, countedDrawArraysInstanced, install);
+    swapPointer(glad_glDrawElementsInstanced, real.drawElementsInstanced, countedDrawElementsInstanced, install);
+    swapPointer(glad_glBindVertexArray, real.bindVertexArray, countedBindVertexArray, install);
+    swapPointer(glad_glUseProgram, real.useProgram, countedUseProgram, install);
+    swapPointer(glad_glActiveTexture, real.activeTexture, countedActiveTexture, install);
+    swapPointer(glad_glBindTexture, real.bindTexture, countedBindTexture, install);
+    swapPointer(glad_glBindBuffer, real.bindBuffer, countedBindBuffer, install);
+    swapPointer(glad_glBindFramebuffer, real.bindFramebuffer, countedBindFramebuffer, install);
+    swapPointer(glad_glEnable, real.enable, countedEnable, install);
+    swapPointer(glad_glDisable, real.disable, countedDisable, install);
+    swapPointer(glad_glBlendFunc, real.blendFunc, countedBlendFunc, install);
+    swapPointer(glad_glViewport, real.viewport, countedViewport, install);
+    swapPointer(glad_glUniform1i, real.uniform1i, countedUniform1i, install);
+    swapPointer(glad_glUniform1f, real.uniform1f, countedUniform1f, install);
+    swapPointer(glad_glUniform2f, real.uniform2f, countedUniform2f, install);
+    swapPointer(glad_glUniform3f, real.uniform3f, countedUniform3f, install);
+    swapPointer(glad_glUniform4f, real.uniform4f, countedUniform4f, install);
+    swapPointer(glad_glUniformMatrix4fv, real.uniformMatrix4fv, countedUniformMatrix4fv, install);
+    swapPointer(glad_glGetUniformLocation, real.getUniformLocation, countedGetUniformLocation, install);
+    swapPointer(glad_glBufferData, real.bufferData, countedBufferData, install);
+    swapPointer(glad_glBufferSubData, real.bufferSubData, countedBufferSubData, install);
+    swapPointer(glad_glTexImage2D, real.texImage2D, countedTexImage2D, install);
+    swapPointer(glad_glTexSubImage2D, real.texSubImage2D, countedTexSubImage2D, install);
+    swapPointer(glad_glClear, real.clear, countedClear, install);
+    swapPointer(glad_glBlitFramebuffer, real.blitFramebuffer, countedBlitFramebuffer, install);
+    swapPointer(glad_glReadPixels, real.readPixels, countedReadPixels, install);
+    swapPointer(glad_glGenBuffers, real.genBuffers, countedGenBuffers, install);
+    swapPointer(glad_glDeleteBuffers, real.deleteBuffers, countedDeleteBuffers, install);
+    swapPointer(glad_glGenVertexArrays, real.genVertexArrays, countedGenVertexArrays, install);
+    swapPointer(glad_glDeleteVertexArrays, real.deleteVertexArrays, countedDeleteVertexArrays, install);
+    swapPointer(glad_glGenTextures, real.genTextures, countedGenTextures, install);
+    swapPointer(glad_glDeleteTextures, real.deleteTextures, countedDeleteTextures, install);
+    swapPointer(glad_glGenFramebuffers, real.genFramebuffers, countedGenFramebuffers, install);
+    swapPointer(glad_glDeleteFramebuffers, real.deleteFramebuffers, countedDeleteFramebuffers, install);
+    swapPointer(glad_glCreateProgram, real.createProgram, countedCreateProgram, install);
+    swapPointer(glad_glDeleteProgram, real.deleteProgram, countedDeleteProgram, install);
+    swapPointer(glad_glCreateShader, real.createShader, countedCreateShader, install);
+    swapPointer(glad_glDeleteShader, real.deleteShader, countedDeleteShader, install);
+    swapPointer(glad_glGenQueries, real.genQueries, countedGenQueries, install);
+    swapPointer(glad_glDeleteQueries, real.deleteQueries, countedDeleteQueries, install);
+}
+
+bool glStatsInstall() {
+    if (installed) {
+        return false;
+    }
+    shadow.vertexArray = shadow.program = shadow.activeUnit = UNKNOWN_NAME;
+    for (int unit = 0; unit < SHADOW_TEXTURE_UNITS; unit++) {
+        for (int target = 0; target < SHADOW_TEXTURE_TARGETS; target++) {
+            shadow.textures[unit][target] = UNKNOWN_NAME;
+        }
+    }
+    for (GLuint& buffer : shadow.buffers) {
+        buffer = UNKNOWN_NAME;
+    }
+    shadow.drawFramebuffer = shadow.readFramebuffer = UNKNOWN_NAME;
+    shadow.enabled.clear();
+    shadow.uniforms.clear();
+    for (int64_t& live : liveObjects) {
+        live = 0;
+    }
+    current = GlFrameReport();
+    lastFrame = GlFrameReport();
+    swapAll(true);
+    installed = true;
+    return true;
+}
+
+void glStatsUninstall() {
+    if (installed) {
+        swapAll(false);
+        installed = false;
+    }
+}
+
+bool glStatsInstalled() {
+    return installed;
+}
+
+void glStatsEndFrame() {
+    std::swap(lastFrame, current);
+    std::vector<GlSiteStats> sites;
+    sites.swap(current.sites);
+    current = GlFrameReport();
+    sites.clear();
+    current.sites.swap(sites);        // keeps the capacity, so later frames don't allocate
+    lastSite = 0;
+}
+
+const GlFrameReport& glStatsLastFrame() {
+    return lastFrame;
+}
+
+int64_t glStatsLiveObjects(GlObjectKind kind) {
+    return liveObjects[kind];
+}
+
+const char* glFunctionName(GlFunction function) {
+    return functionNames[function];
+}
+
+const char* glObjectKindName(GlObjectKind kind) {
+    return objectNames[kind];
+}
+
+std::vector<std::string> glStatsFormat(const GlFrameReport& report, int topFunctions) {
+    std::vector<std::string> lines;
+    char line[160];
+    snprintf(line, sizeof(line), "%u GL calls: %u draws (%llu instances), %u uniform uploads, %u uniform lookups, %u binds",
+        report.totalCalls, report.draws, (unsigned long long)report.instances, report.uniformUploads, report.uniformLookups,
+        report.binds);
+    lines.push_back(line);
+    snprintf(line, sizeof(line), "redundant: %u binds, %u uniforms; uploaded %llu buffer bytes, %llu texture bytes",
+        report.redundantBinds, report.redundantUniforms, (unsigned long long)report.bufferBytes,
+        (unsigned long long)report.textureBytes);
+    lines.push_back(line);
+    std::vector<int> order;
+    for (int f = 0; f < GL_FUNCTION_COUNT; f++) {
+        if (report.calls[f] > 0) {
+            order.push_back(f);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&report](int a, int b) { return report.calls[a] > report.calls[b]; });
+    for (int i = 0; i < static_cast<int>(order.size()) && i < topFunctions; i++) {
+        snprintf(line, sizeof(line), "  %-26s %8u", functionNames[order[i]], report.calls[order[i]]);
+        lines.push_back(line);
+    }
+    snprintf(line, sizeof(line), "  %-26s %8s %8s %8s %8s %10s %10s", "site", "calls", "draws", "uniforms", "binds",
+        "redundant", "bytes");
+    lines.push_back(line);
+    for (const GlSiteStats& site : report.sites) {
+        snprintf(line, sizeof(line), "  %-26s %8u %8u %8u %8u %10u %10llu", site.site, site.calls, site.draws, site.uniforms,
+            site.binds, site.redundant, (unsigned long long)site.bytes);
+        lines.push_back(line);
+    }
+    return lines;
+}
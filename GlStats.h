@@ -0,0 +1,110 @@
+/*
+ * Title: OpenGL call statistics
+ * Description: An optional layer between the game and the driver that counts what each frame
+ *      asks OpenGL to do.
+ *
+ *      glad loads every entry point into a function pointer (glad_glDrawArrays and so on), and
+ *      the gl* names are macros for those pointers. glStatsInstall() swaps the pointers of the
+ *      calls that matter for performance for counting versions that pass the call on, so no
+ *      code has to change and nothing is paid until it is installed. It counts per frame:
+ *        - calls per function, draw calls and instances
+ *        - uniform uploads and uniform location lookups
+ *        - bytes uploaded into buffers and textures
+ *        - binds and state changes, and which of them were redundant: binding the VAO,
+ *          program, texture, buffer or framebuffer that was already bound, enabling what was
+ *          already enabled, or setting a uniform of the current program to the value it
+ *          already has
+ *      and the same per call site, where a site is the name of the innermost GL_SITE scope.
+ *      It also keeps the number of live GL objects of each kind, to spot leaks.
+ *
+ *      The shadow copy of the state starts out unknown when the layer is installed, so the
+ *      first bind of anything is never counted as redundant.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum GlFunction {
+    GL_FN_DRAW_ARRAYS, GL_FN_DRAW_ELEMENTS, GL_FN_DRAW_ARRAYS_INSTANCED, GL_FN_DRAW_ELEMENTS_INSTANCED,
+    GL_FN_BIND_VERTEX_ARRAY, GL_FN_USE_PROGRAM, GL_FN_ACTIVE_TEXTURE, GL_FN_BIND_TEXTURE, GL_FN_BIND_BUFFER,
+    GL_FN_BIND_FRAMEBUFFER, GL_FN_ENABLE, GL_FN_DISABLE, GL_FN_BLEND_FUNC, GL_FN_VIEWPORT,
+    GL_FN_UNIFORM_1I, GL_FN_UNIFORM_1F, GL_FN_UNIFORM_2F, GL_FN_UNIFORM_3F, GL_FN_UNIFORM_4F,
+    GL_FN_UNIFORM_MATRIX_4FV, GL_FN_GET_UNIFORM_LOCATION,
+    GL_FN_BUFFER_DATA, GL_FN_BUFFER_SUB_DATA, GL_FN_TEX_IMAGE_2D, GL_FN_TEX_SUB_IMAGE_2D,
+    GL_FN_CLEAR, GL_FN_BLIT_FRAMEBUFFER, GL_FN_READ_PIXELS,
+    GL_FN_GEN_BUFFERS, GL_FN_DELETE_BUFFERS, GL_FN_GEN_VERTEX_ARRAYS, GL_FN_DELETE_VERTEX_ARRAYS,
+    GL_FN_GEN_TEXTURES, GL_FN_DELETE_TEXTURES, GL_FN_GEN_FRAMEBUFFERS, GL_FN_DELETE_FRAMEBUFFERS,
+    GL_FN_CREATE_PROGRAM, GL_FN_DELETE_PROGRAM, GL_FN_CREATE_SHADER, GL_FN_DELETE_SHADER,
+    GL_FN_GEN_QUERIES, GL_FN_DELETE_QUERIES,
+    GL_FUNCTION_COUNT
+};
+
+// Kinds of GL objects whose live count is kept
+enum GlObjectKind {
+    GL_OBJECT_BUFFER, GL_OBJECT_VERTEX_ARRAY, GL_OBJECT_TEXTURE, GL_OBJECT_FRAMEBUFFER, GL_OBJECT_PROGRAM,
+    GL_OBJECT_SHADER, GL_OBJECT_QUERY,
+    GL_OBJECT_KINDS
+};
+
+// What one call site did in a frame
+struct GlSiteStats {
+    const char* site = nullptr;
+    uint32_t calls = 0;
+    uint32_t draws = 0;
+    uint32_t uniforms = 0;                // uploads and lookups
+    uint32_t binds = 0;
+    uint32_t redundant = 0;
+    uint64_t bytes = 0;
+};
+
+struct GlFrameReport {
+    uint32_t calls[GL_FUNCTION_COUNT] = {};
+    uint32_t totalCalls = 0;
+    uint32_t draws = 0;
+    uint64_t instances = 0;               // 1 per draw that isn't instanced
+    uint32_t uniformUploads = 0;
+    uint32_t uniformLookups = 0;
+    uint32_t binds = 0;                   // binds and enables of every kind
+    uint32_t redundantBinds = 0;
+    uint32_t redundantUniforms = 0;
+    uint64_t bufferBytes = 0;
+    uint64_t textureBytes = 0;
+    std::vector<GlSiteStats> sites;       // in the order they were first seen in the frame
+};
+
+// Wraps glad's pointers; call once the GL functions are loaded. Returns false if already installed.
+bool glStatsInstall();
+// Puts glad's pointers back
+void glStatsUninstall();
+bool glStatsInstalled();
+// Closes the frame: its counts become glStatsLastFrame() and the next frame starts at zero
+void glStatsEndFrame();
+const GlFrameReport& glStatsLastFrame();
+// Live objects of a kind: made minus deleted since glStatsInstall
+int64_t glStatsLiveObjects(GlObjectKind kind);
+const char* glFunctionName(GlFunction function);
+const char* glObjectKindName(GlObjectKind kind);
+// The report as lines of text: totals, the busiest functions and every call site
+std::vector<std::string> glStatsFormat(const GlFrameReport& report, int topFunctions = 8);
+
+// Innermost call site name; a string literal
+extern const char* glStatsSite;
+
+// Names the GL calls made until the end of the enclosing scope
+class GlSiteScope {
+public:
+    explicit GlSiteScope(const char* site) : previous(glStatsSite) { glStatsSite = site; }
+    ~GlSiteScope() { glStatsSite = previous; }
+    GlSiteScope(const GlSiteScope&) = delete;
+    GlSiteScope& operator=(const GlSiteScope&) = delete;
+
+private:
+    const char* previous;
+};
+
+#define GL_SITE_JOIN2(a, b) a##b
+#define GL_SITE_JOIN(a, b) GL_SITE_JOIN2(a, b)
+#define GL_SITE(name) GlSiteScope GL_SITE_JOIN(glSiteScope, __LINE__)(name)
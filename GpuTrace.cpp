@@ -0,0 +1,103 @@
+/*
+ * Title: GPU tracing
+ * Description: Implementation of the GPU trace spans declared in GpuTrace.h.
+*/
+
+#include <glad/glad.h>
+#include "GpuTrace.h"
+
+void GpuTrace::init() {
+    for (unsigned int& query : queries) {
+        query = registry.create(GL_OBJECT_QUERY);
+    }
+    oldest = 0;
+    count = 0;
+    depth = 0;
+    calibratedAt = 0;
+}
+
+void GpuTrace::release() {
+    registry.release();
+    count = 0;
+    depth = 0;
+}
+
+void GpuTrace::begin(const char* name) {
+    int slot = -1;
+    if (traceRecording() && count < GPU_TRACE_SPANS) {
+        slot = (oldest + count) % GPU_TRACE_SPANS;
+        count++;
+        names[slot] = name;
+        closed[slot] = false;
+        glQueryCounter(queries[slot * 2], GL_TIMESTAMP);
+    }
+    else if (traceRecording()) {
+        skippedSpans++;
+    }
+    if (depth < GPU_TRACE_DEPTH) {
+        open[depth] = slot;
+    }
+    else if (slot >= 0) {
+        // too deep to remember: never closed, so take it back
+        count--;
+        skippedSpans++;
+    }
+    depth++;
+}
+
+void GpuTrace::end() {
+    if (depth == 0) {
+        return;
+    }
+    depth--;
+    if (depth < GPU_TRACE_DEPTH && open[depth] >= 0) {
+        glQueryCounter(queries[open[depth] * 2 + 1], GL_TIMESTAMP);
+        closed[open[depth]] = true;
+    }
+}
+
+/*
+ * This function reads the GPU clock and the trace clock one after the other; the GPU reading
+ * is taken without waiting for the GPU to finish its work
+*/
+
+void GpuTrace::calibrate() {
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    cpuReference = traceStamp();
+    gpuReference = gpuNow;
+    stampsPerNanosecond = traceStampsPerSecond() / 1e9;
+    calibratedAt = cpuReference;
+}
+
+/*
+ * This function records the finished spans, oldest first, and stops at the first one the GPU
+ * hasn't reached the end of yet
+*/
+
+void GpuTrace::collect() {
+    if (!traceRecording()) {
+        calibratedAt = 0;
+    }
+    else if (calibratedAt == 0 || (traceStamp() - calibratedAt) / stampsPerNanosecond > 1e9) {
+        calibrate();
+    }
+    while (count > 0 && closed[oldest]) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[oldest * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return;
+        }
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(queries[oldest * 2], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[oldest * 2 + 1], GL_QUERY_RESULT, &end);
+        if (calibratedAt != 0 && end >= start) {
+            double offset = static_cast<double>(static_cast<int64_t>(start) - gpuReference) * stampsPerNanosecond;
+            uint64_t cpuStart = cpuReference + static_cast<int64_t>(offset);
+            traceRecordGpu(names[oldest], cpuStart, cpuStart + static_cast<uint64_t>((end - start) * stampsPerNanosecond));
+        }
+        closed[oldest] = false;
+        oldest = (oldest + 1) % GPU_TRACE_SPANS;
+        count--;
+    }
+}
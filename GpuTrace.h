@@ -0,0 +1,69 @@
+/*
+ * Title: GPU tracing
+ * Description: Spans of GPU work for the trace timeline (Trace.h), from GL timestamp queries.
+ *
+ *      begin() and end() put a glQueryCounter(GL_TIMESTAMP) into the command stream, so the
+ *      span is when the GPU reached those points, not when the CPU issued them. Results are
+ *      read a few frames late by collect(), from a ring of query pairs, so reading them never
+ *      stalls the CPU; when the ring is full new spans are skipped. GPU time is turned into
+ *      trace clock readings with a pair of GPU and CPU readings taken together, renewed every
+ *      second to follow any drift. Timestamps don't nest inside anything, so the spans can
+ *      overlap the GL_TIME_ELAPSED query of DynamicResolution.
+*/
+
+#pragma once
+
+#include "GlResources.h"
+#include "Trace.h"
+#include <cstdint>
+
+const int GPU_TRACE_SPANS = 64;           // spans in flight, a few frames' worth
+const int GPU_TRACE_DEPTH = 8;            // spans open at once
+
+class GpuTrace {
+public:
+    void init();
+    void release();
+    // Opens a span (a string literal name) when a trace is recording
+    void begin(const char* name);
+    // Closes the innermost open span
+    void end();
+    // Reads the spans the GPU has finished and records them; call once a frame
+    void collect();
+    uint64_t skipped() const { return skippedSpans; }
+
+private:
+    void calibrate();
+
+    GlRegistry registry;          // the queries
+    unsigned int queries[GPU_TRACE_SPANS * 2] = {};
+    const char* names[GPU_TRACE_SPANS] = {};
+    bool closed[GPU_TRACE_SPANS] = {};
+    int oldest = 0;               // first span not yet read
+    int count = 0;                // spans in flight, open or closed
+    int open[GPU_TRACE_DEPTH] = {}; // slots of the open spans, -1 for a skipped one
+    int depth = 0;                // begin() calls still waiting for their end()
+    uint64_t skippedSpans = 0;
+    int64_t gpuReference = 0;     // GPU nanoseconds ...
+    uint64_t cpuReference = 0;    // ... and the trace clock at the same moment
+    double stampsPerNanosecond = 1.0;
+    uint64_t calibratedAt = 0;
+};
+
+// Times the GPU work issued in the enclosing scope
+class GpuTraceScope {
+public:
+    GpuTraceScope(GpuTrace& trace, const char* name) : trace(trace) { trace.begin(name); }
+    ~GpuTraceScope() { trace.end(); }
+    GpuTraceScope(const GpuTraceScope&) = delete;
+    GpuTraceScope& operator=(const GpuTraceScope&) = delete;
+
+private:
+    GpuTrace& trace;
+};
+
+#if TRACE_ENABLED
+#define GPU_TRACE_SCOPE(trace, name) GpuTraceScope TRACE_JOIN(gpuTraceScope, __LINE__)(trace, name)
+#else
+#define GPU_TRACE_SCOPE(trace, name) ((void)0)
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Title: Headless OpenGL
+ * Description: Implementation of the EGL context declared in HeadlessGL.h.
+*/
+
+#include "HeadlessGL.h"
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstdio>
+
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLContext context = EGL_NO_CONTEXT;
+
+/*
+ * This function opens an EGL display. The default display needs a display server, so the
+ * surfaceless platform is tried after it.
+*/
+
+static EGLDisplay openDisplay() {
+    EGLDisplay found = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (found != EGL_NO_DISPLAY && eglInitialize(found, nullptr, nullptr)) {
+        return found;
+    }
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay == nullptr) {
+        return EGL_NO_DISPLAY;
+    }
+    found = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (found != EGL_NO_DISPLAY && eglInitialize(found, nullptr, nullptr)) {
+        return found;
+    }
+    return EGL_NO_DISPLAY;
+}
+
+bool createHeadlessContext() {
+    display = openDisplay();
+    if (display == EGL_NO_DISPLAY) {
+        fprintf(stderr, "No EGL display\n");
+        return false;
+    }
+    EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+    eglBindAPI(EGL_OPENGL_API);
+    EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    // the surfaceless platform may offer no config; contexts work without one there
+    context = eglCreateContext(display, configCount > 0 ? config : nullptr, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        fprintf(stderr, "Failed to create an OpenGL 3.3 context (EGL error 0x%x)\n", eglGetError());
+        destroyHeadlessContext();
+        return false;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        fprintf(stderr, "Failed to initialize GLAD\n");
+        destroyHeadlessContext();
+        return false;
+    }
+    return true;
+}
+
+void destroyHeadlessContext() {
+    if (display == EGL_NO_DISPLAY) {
+        return;
+    }
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT) {
+        eglDestroyContext(display, context);
+    }
+    eglTerminate(display);
+    display = EGL_NO_DISPLAY;
+    context = EGL_NO_CONTEXT;
+}
@@ -0,0 +1,13 @@
+/*
+ * Title: Headless OpenGL
+ * Description: An OpenGL 3.3 core context without a window, through EGL, for benchmarks and
+ *      tools that render offscreen. With Mesa installed this also works without a GPU or a
+ *      display server, on the llvmpipe software rasterizer. Linux only; link with -lEGL.
+*/
+
+#pragma once
+
+// Creates a context, makes it current and loads the OpenGL functions with GLAD.
+// Returns false, after printing why, if no context could be made.
+bool createHeadlessContext();
+void destroyHeadlessContext();
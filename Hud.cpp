@@ -0,0 +1,303 @@
+/*
+ * Title: HUD
+ * Description: Implementation of the text overlay declared in Hud.h.
+*/
+
+#include "Hud.h"
+#include "Shader.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+const int FONT_FIRST = 32;                // the font covers ' ' to '_'
+const int FONT_GLYPHS = 64;
+const int FONT_WIDTH = 5;                 // font pixels
+const int FONT_HEIGHT = 7;
+const int FONT_ADVANCE = 6;               // font pixels from one character to the next
+const int FONT_LINE_HEIGHT = 10;
+const int FONT_PADDING = 1;               // room around a glyph for its outline, in font pixels
+const int FONT_TEXELS = 8;                // atlas texels per font pixel
+const float FONT_SPREAD = 1.0f;           // distances are kept up to this many font pixels
+const int ATLAS_COLUMNS = 16;
+
+const int CELL_WIDTH = (FONT_WIDTH + 2 * FONT_PADDING) * FONT_TEXELS;
+const int CELL_HEIGHT = (FONT_HEIGHT + 2 * FONT_PADDING) * FONT_TEXELS;
+const int ATLAS_WIDTH = ATLAS_COLUMNS * CELL_WIDTH;
+const int ATLAS_HEIGHT = (FONT_GLYPHS / ATLAS_COLUMNS) * CELL_HEIGHT;
+
+// One row per byte, top row first, leftmost pixel in bit 4
+static const uint8_t font[FONT_GLYPHS][FONT_HEIGHT] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // space
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 }, // !
+    { 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "
+    { 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A }, // #
+    { 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04 }, // $
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, // %
+    { 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D }, // &
+    { 0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00 }, // '
+    { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, // (
+    { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, // )
+    { 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 }, // *
+    { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 }, // +
+    { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 }, // ,
+    { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 }, // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C }, // .
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, // /
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, // 0
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E }, // 1
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, // 2
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E }, // 3
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, // 4
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E }, // 5
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, // 6
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // 7
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, // 8
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C }, // 9
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 }, // :
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08 }, // ;
+    { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, // <
+    { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 }, // =
+    { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, // >
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // ?
+    { 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E }, // @
+    { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // A
+    { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E }, // B
+    { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, // C
+    { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C }, // D
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, // E
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 }, // F
+    { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F }, // G
+    { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // H
+    { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, // I
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C }, // J
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // K
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F }, // L
+    { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, // M
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, // N
+    { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // O
+    { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 }, // P
+    { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, // Q
+    { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 }, // R
+    { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E }, // S
+    { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // T
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // U
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 }, // V
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A }, // W
+    { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 }, // X
+    { 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04 }, // Y
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }, // Z
+    { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E }, // [
+    { 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 }, // backslash
+    { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E }, // ]
+    { 0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00 }, // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F }, // _
+};
+
+// The quad's corners come from gl_VertexID; one instance per character. Glyph rows go down
+// the atlas cell and the text goes down the screen, so y is flipped only once, here.
+static const char* hudVertexSource = R"glsl(
+    #version 330 core
+    layout (location = 0) in vec2 cell;       // font pixels from the top left of the text
+    layout (location = 1) in float glyph;
+    layout (location = 2) in vec4 glyphColor;
+    uniform vec2 screenSize;
+    uniform vec2 origin;                      // top left of the text in window pixels
+    uniform float scale;
+    out vec2 uv;
+    out vec4 color;
+    const vec2 quad = vec2(7.0, 9.0);         // a glyph with its padding, in font pixels
+    const vec2 atlasCells = vec2(16.0, 4.0);
+    void main() {
+        vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+        vec2 local = cell - 1.0 + corner * quad;
+        vec2 pixel = origin + vec2(local.x, -local.y) * scale;
+        gl_Position = vec4(pixel / screenSize * 2.0 - 1.0, 0.0, 1.0);
+        vec2 atlasCell = vec2(mod(glyph, atlasCells.x), floor(glyph / atlasCells.x));
+        uv = (atlasCell + corner) / atlasCells;
+        color = glyphColor;
+    }
+)glsl";
+
+// The edge is where the distance field crosses 0.5; the outline is a band just outside it
+static const char* hudFragmentSource = R"glsl(
+    #version 330 core
+    in vec2 uv;
+    in vec4 color;
+    out vec4 FragColor;
+    uniform sampler2D atlas;
+    void main() {
+        float distance = texture(atlas, uv).r;
+        float width = max(fwidth(distance) * 0.7, 0.001);
+        float fill = smoothstep(0.5 - width, 0.5 + width, distance);
+        float outline = smoothstep(0.2 - width, 0.2 + width, distance);
+        FragColor = vec4(color.rgb * fill, max(fill, 0.85 * outline) * color.a);
+    }
+)glsl";
+
+/*
+ * This function returns the distance from a point to a square of one font pixel
+*/
+
+static float distanceToPixel(float x, float y, int px, int py) {
+    float dx = std::max(std::max(px - x, x - (px + 1)), 0.0f);
+    float dy = std::max(std::max(py - y, y - (py + 1)), 0.0f);
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+static bool fontPixel(int glyph, int x, int y) {
+    if (x < 0 || y < 0 || x >= FONT_WIDTH || y >= FONT_HEIGHT) {
+        return false;
+    }
+    return (font[glyph][y] >> (FONT_WIDTH - 1 - x)) & 1;
+}
+
+/*
+ * This function fills one atlas cell with a glyph's signed distance field, positive inside.
+ * A glyph is a union of square pixels, so the distance to its edge is the distance to the
+ * nearest pixel of the other kind, worked out exactly for each texel.
+*/
+
+static void buildGlyph(std::vector<uint8_t>& texels, int glyph) {
+    int cellX = (glyph % ATLAS_COLUMNS) * CELL_WIDTH, cellY = (glyph / ATLAS_COLUMNS) * CELL_HEIGHT;
+    for (int ty = 0; ty < CELL_HEIGHT; ty++) {
+        for (int tx = 0; tx < CELL_WIDTH; tx++) {
+            // texel center in font pixels, from the top left of the glyph
+            float x = (tx + 0.5f) / FONT_TEXELS - FONT_PADDING, y = (ty + 0.5f) / FONT_TEXELS - FONT_PADDING;
+            float nearest = FONT_SPREAD;
+            // distances stop at one font pixel, so only the pixels next to this one can be nearer
+            int cx = static_cast<int>(std::floor(x)), cy = static_cast<int>(std::floor(y));
+            bool inside = fontPixel(glyph, cx, cy);
+            for (int py = cy - 1; py <= cy + 1; py++) {
+                for (int px = cx - 1; px <= cx + 1; px++) {
+                    if (fontPixel(glyph, px, py) != inside) {
+                        nearest = std::min(nearest, distanceToPixel(x, y, px, py));
+                    }
+                }
+            }
+            float signedDistance = inside ? nearest : -nearest;
+            float value = 0.5f + 0.5f * signedDistance / FONT_SPREAD;
+            texels[size_t(cellY + ty) * ATLAS_WIDTH + cellX + tx] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+        }
+    }
+}
+
+void Hud::init() {
+    std::vector<uint8_t> texels(size_t(ATLAS_WIDTH) * ATLAS_HEIGHT);
+    for (int glyph = 0; glyph < FONT_GLYPHS; glyph++) {
+        buildGlyph(texels, glyph);
+    }
+    atlas = registry.create(GL_OBJECT_TEXTURE);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // no mipmaps: a distance field stays smooth when shrunk a little, and making them takes
+    // longer than building the atlas in software GL
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    program = registry.add(GlProgram(createShaderProgram(hudVertexSource, hudFragmentSource)));
+    screenSizeLocation = glGetUniformLocation(program, "screenSize");
+    originLocation = glGetUniformLocation(program, "origin");
+    scaleLocation = glGetUniformLocation(program, "scale");
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "atlas"), 0);
+
+    instanceBuffer = registry.create(GL_OBJECT_BUFFER);
+    vao = registry.create(GL_OBJECT_VERTEX_ARRAY);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, HUD_MAX_GLYPHS * sizeof(GlyphInstance), nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_SHORT, GL_FALSE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, x));
+    glVertexAttribPointer(1, 1, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, glyph));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, color));
+    for (int attribute = 0; attribute < 3; attribute++) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    instances.reserve(HUD_MAX_GLYPHS);
+}
+
+void Hud::setLine(int line, const char* text, uint32_t color) {
+    if (line < 0 || line >= HUD_LINES || (this->text[line] == text && colors[line] == color)) {
+        return;
+    }
+    this->text[line] = text;
+    colors[line] = color;
+    dirty = true;
+}
+
+/*
+ * This function turns the lines into glyph instances and uploads them. Spaces take room but
+ * get no instance.
+*/
+
+void Hud::rebuild() {
+    instances.clear();
+    for (int line = 0; line < HUD_LINES; line++) {
+        uint8_t color[4] = { uint8_t(colors[line] >> 24), uint8_t(colors[line] >> 16), uint8_t(colors[line] >> 8), uint8_t(colors[line]) };
+        for (size_t i = 0; i < text[line].size() && instances.size() < HUD_MAX_GLYPHS; i++) {
+            int character = static_cast<unsigned char>(text[line][i]);
+            if (character >= 'a' && character <= 'z') {
+                character -= 'a' - 'A';
+            }
+            if (character == ' ') {
+                continue;
+            }
+            if (character < FONT_FIRST || character >= FONT_FIRST + FONT_GLYPHS) {
+                character = '?';
+            }
+            GlyphInstance glyph;
+            glyph.x = static_cast<int16_t>(i * FONT_ADVANCE);
+            glyph.y = static_cast<int16_t>(line * FONT_LINE_HEIGHT);
+            glyph.glyph = static_cast<uint16_t>(character - FONT_FIRST);
+            glyph.unused = 0;
+            std::copy(color, color + 4, glyph.color);
+            instances.push_back(glyph);
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(GlyphInstance), instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    dirty = false;
+    counters.rebuilds++;
+}
+
+/*
+ * This function draws every line with one instanced draw call
+ * @param framebufferWidth, framebufferHeight: size of the target in pixels
+*/
+
+void Hud::draw(int framebufferWidth, int framebufferHeight) {
+    if (dirty) {
+        rebuild();
+    }
+    counters.glyphs = static_cast<uint32_t>(instances.size());
+    if (instances.empty()) {
+        return;
+    }
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
+    glUseProgram(program);
+    glUniform2f(screenSizeLocation, static_cast<float>(framebufferWidth), static_cast<float>(framebufferHeight));
+    glUniform2f(originLocation, static_cast<float>(HUD_MARGIN), static_cast<float>(framebufferHeight - HUD_MARGIN));
+    glUniform1f(scaleLocation, HUD_SCALE);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(instances.size()));
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+}
+
+void Hud::release() {
+    registry.release();
+    vao = instanceBuffer = program = atlas = 0;
+    dirty = true;
+}
@@ -0,0 +1,78 @@
+/*
+ * Title: HUD
+ * Description: Text drawn over the game: score, length, speed and FPS, and the performance
+ *      overlay. All of it goes out as one instanced draw call, one instance per character.
+ *
+ *      The font is a 5x7 pixel font kept in the source. At start-up every glyph is turned into
+ *      a signed distance field (the distance from each texel to the glyph's edge) in one atlas
+ *      texture, so the text stays sharp at any size and gets its dark outline from the same
+ *      texture. The HUD holds a few lines of text; setting a line to the text it already has
+ *      does nothing, and the glyph instances are only rebuilt and uploaded in a frame where
+ *      some line actually changed.
+*/
+
+#pragma once
+
+#include "GlResources.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const int HUD_LINES = 8;                  // lines of text, from the top left corner down
+const int HUD_MAX_GLYPHS = 1024;          // characters over all lines
+const float HUD_SCALE = 3.0f;             // screen pixels per font pixel
+const int HUD_MARGIN = 12;                // distance from the top left corner
+
+// Colors of a line, as 0xRRGGBBAA
+const uint32_t HUD_WHITE = 0xFFFFFFFF;
+const uint32_t HUD_YELLOW = 0xFFD933FF;
+const uint32_t HUD_RED = 0xFF4D4DFF;
+
+// Per-instance data: where the character is, in font pixels from the top left of the text,
+// which glyph it is and its color
+struct GlyphInstance {
+    int16_t x;
+    int16_t y;
+    uint16_t glyph;
+    uint16_t unused;
+    uint8_t color[4];
+};
+
+// What the HUD has done since it was made
+struct HudStats {
+    uint64_t rebuilds = 0;        // frames that rebuilt the glyph instances
+    uint32_t glyphs = 0;          // characters drawn by the last frame
+};
+
+class Hud {
+public:
+    // Needs a current OpenGL 3.3 context; builds the font atlas
+    void init();
+    // Sets a line of text. Lower case letters are drawn as upper case, characters the font
+    // doesn't have as '?'. An empty line leaves a gap. Setting the text a line already has
+    // costs a comparison, and a line's storage is reused, so this doesn't allocate once a line
+    // has held text as long.
+    void setLine(int line, const char* text, uint32_t color = HUD_WHITE);
+    void clearLine(int line) { setLine(line, ""); }
+    // Draws the text into the top left corner of a framebuffer of the given size
+    void draw(int framebufferWidth, int framebufferHeight);
+    void release();
+    const HudStats& stats() const { return counters; }
+
+private:
+    void rebuild();
+
+    std::string text[HUD_LINES];
+    uint32_t colors[HUD_LINES] = {};
+    bool dirty = true;
+    std::vector<GlyphInstance> instances;
+    GlRegistry registry;          // the atlas, program, vertex array and instance buffer
+    unsigned int atlas = 0;
+    unsigned int program = 0;
+    unsigned int vao = 0;
+    unsigned int instanceBuffer = 0;
+    int screenSizeLocation = -1;
+    int originLocation = -1;
+    int scaleLocation = -1;
+    HudStats counters;
+};
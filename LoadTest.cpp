@@ -0,0 +1,328 @@
+/*
+ * Title: Snake Game server load test
+ * Description: Runs many bot clients against SnakeServer. Every bot has its own UDP socket,
+ *      rebuilds the match from the server's snapshots exactly like a real client would, steers
+ *      with the test bot from Bot.h and joins a new match whenever one ends. A snapshot that
+ *      can't be applied (baseline gone or checksum mismatch) makes the bot ask for a keyframe,
+ *      so the resync count doubles as a correctness check of the snapshot codec.
+ *      With --view the bots are viewers of a SnakeRelay instead and only decode the stream.
+ * Platform: Linux (epoll)
+ * Usage: ./SnakeLoadTest [--server 127.0.0.1:9000] [--bots 1000] [--seconds 30] [--think-every 4] [--view 127.0.0.1:9200]
+*/
+
+#include "Bot.h"
+#include "Game.h"
+#include "Net.h"
+#include "Protocol.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+const double JOIN_RETRY_SECONDS = 0.5;
+const double SILENCE_TIMEOUT_SECONDS = 2.0;
+const double RESYNC_RETRY_SECONDS = 0.1;
+const double VIEW_KEEPALIVE_SECONDS = 1.0;
+const uint32_t ACK_TICKS = 8;   // resend the input at least this often; it carries the ack
+
+typedef std::chrono::steady_clock LoadClock;
+
+// One simulated player
+struct LoadBot {
+    UdpSocket socket;
+    bool inMatch = false;
+    bool haveState = false;
+    uint32_t matchId = 0;
+    int player = 0;
+    GameState mirror;
+    Direction lastSent = RIGHT;
+    uint32_t lastSentTick = 0;
+    uint32_t random = 1;
+    double lastSend = -1.0;
+    double lastReceive = 0.0;
+    double lastResync = -1.0;
+};
+
+// Totals for one reporting interval
+struct LoadStats {
+    unsigned long long packetsIn = 0, bytesIn = 0, deltas = 0, deltaBytes = 0, keyframes = 0, keyframeBytes = 0;
+    unsigned long long packetsOut = 0, resyncs = 0, gamesFinished = 0, timeouts = 0;
+};
+
+static double secondsSince(LoadClock::time_point start) {
+    return std::chrono::duration<double>(LoadClock::now() - start).count();
+}
+
+/*
+ * This function sends a message with no body
+*/
+
+static void sendSimple(LoadBot& bot, const NetAddress& server, MessageType type, LoadStats& stats) {
+    std::vector<unsigned char> message;
+    ByteWriter writer(message);
+    writeHeader(writer, type);
+    bot.socket.send(server, message.data(), message.size());
+    stats.packetsOut++;
+}
+
+/*
+ * This function sends the bot's direction to the server
+*/
+
+static void sendInput(LoadBot& bot, const NetAddress& server, Direction direction, LoadStats& stats) {
+    std::vector<unsigned char> message;
+    ByteWriter writer(message);
+    writeHeader(writer, MSG_INPUT);
+    writer.u8(static_cast<uint8_t>(direction));
+    writer.u32(bot.mirror.tick);
+    bot.socket.send(server, message.data(), message.size());
+    bot.lastSent = direction;
+    bot.lastSentTick = bot.mirror.tick;
+    stats.packetsOut++;
+}
+
+/*
+ * This function handles one message from the server
+*/
+
+static void handleMessage(LoadBot& bot, const NetAddress& server, const unsigned char* data, int size, double now, int thinkEvery, LoadStats& stats) {
+    ByteReader reader(data, size);
+    MessageType type;
+    if (!readHeader(reader, type)) {
+        return;
+    }
+    bot.lastReceive = now;
+    uint32_t matchId = 0;
+
+    if (type == MSG_WELCOME) {
+        matchId = reader.u32();
+        if (!bot.inMatch || matchId != bot.matchId) {
+            bot.inMatch = true;
+            bot.haveState = false;
+            bot.matchId = matchId;
+            bot.player = reader.u8();
+        }
+    }
+    else if (type == MSG_SNAPSHOT && bot.inMatch) {
+        matchId = reader.u32();
+        const unsigned char* payload = data + SNAPSHOT_HEADER_SIZE;
+        size_t payloadSize = size - SNAPSHOT_HEADER_SIZE;
+        uint32_t tick;
+        bool keyframe;
+        if (!reader.ok || matchId != bot.matchId || !peekSnapshot(payload, payloadSize, tick, keyframe)) {
+            return;
+        }
+        if (keyframe) {
+            stats.keyframes++;
+            stats.keyframeBytes += size;
+        }
+        else {
+            stats.deltas++;
+            stats.deltaBytes += size;
+        }
+        // a delta is only usable on top of a state of this match
+        SnapshotResult result = bot.haveState || keyframe ? decodeSnapshot(payload, payloadSize, bot.mirror) : SNAPSHOT_NEED_KEYFRAME;
+        if (result == SNAPSHOT_NEED_KEYFRAME) {
+            bot.haveState = false;
+            if (now - bot.lastResync >= RESYNC_RETRY_SECONDS) {
+                bot.lastResync = now;
+                stats.resyncs++;
+                sendSimple(bot, server, MSG_RESYNC, stats);
+            }
+        }
+        else if (result == SNAPSHOT_APPLIED) {
+            bot.haveState = true;
+            if (bot.mirror.gameOver) {
+                stats.gamesFinished++;
+                bot.inMatch = false;
+                bot.lastSend = -1.0;
+                return;
+            }
+            Direction direction = bot.lastSent;
+            if (bot.mirror.tick % thinkEvery == 0) {
+                direction = botDirection(bot.mirror, bot.player, bot.random);
+            }
+            if (direction != bot.lastSent || bot.mirror.tick - bot.lastSentTick >= ACK_TICKS) {
+                sendInput(bot, server, direction, stats);
+            }
+        }
+    }
+}
+
+/*
+ * This function handles one message from a relay, for a bot that only watches
+*/
+
+static void handleViewerMessage(LoadBot& bot, const NetAddress& relay, const unsigned char* data, int size, double now, LoadStats& stats) {
+    ByteReader reader(data, size);
+    MessageType type;
+    if (!readHeader(reader, type) || type != MSG_SNAPSHOT) {
+        return;
+    }
+    bot.lastReceive = now;
+    uint32_t matchId = reader.u32();
+    uint32_t tick;
+    bool keyframe;
+    if (!reader.ok || !peekSnapshot(data + SNAPSHOT_HEADER_SIZE, size - SNAPSHOT_HEADER_SIZE, tick, keyframe)) {
+        return;
+    }
+    if (keyframe) {
+        stats.keyframes++;
+        stats.keyframeBytes += size;
+    }
+    else {
+        stats.deltas++;
+        stats.deltaBytes += size;
+    }
+    if (matchId != bot.matchId) {
+        // the relay moved on to another match, which starts with a keyframe
+        bot.matchId = matchId;
+        bot.haveState = false;
+    }
+    if (!bot.haveState && !keyframe) {
+        return;
+    }
+    SnapshotResult result = decodeSnapshot(data + SNAPSHOT_HEADER_SIZE, size - SNAPSHOT_HEADER_SIZE, bot.mirror);
+    if (result == SNAPSHOT_NEED_KEYFRAME) {
+        bot.haveState = false;
+        if (now - bot.lastResync >= RESYNC_RETRY_SECONDS) {
+            bot.lastResync = now;
+            stats.resyncs++;
+            sendSimple(bot, relay, MSG_RESYNC, stats);
+        }
+    }
+    else if (result == SNAPSHOT_APPLIED) {
+        if (bot.haveState && bot.mirror.gameOver) {
+            stats.gamesFinished++;
+        }
+        bot.haveState = true;
+    }
+}
+
+/*
+ * main method starts the bots and prints throughput every second
+*/
+
+int main(int argc, char** argv) {
+    std::string serverText = "127.0.0.1:9000";
+    int botCount = 1000;
+    double duration = 30.0;
+    int thinkEvery = 4;
+    std::string viewText;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--server") == 0) serverText = argv[i + 1];
+        else if (strcmp(argv[i], "--bots") == 0) botCount = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seconds") == 0) duration = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--think-every") == 0) thinkEvery = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--view") == 0) viewText = argv[i + 1];
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    bool viewing = !viewText.empty();
+    NetAddress server;
+    if (!parseAddress(viewing ? viewText : serverText, server)) {
+        fprintf(stderr, "bad server address %s\n", (viewing ? viewText : serverText).c_str());
+        return 1;
+    }
+
+    int epoll = epoll_create1(0);
+    std::vector<std::unique_ptr<LoadBot>> bots;
+    for (int i = 0; i < botCount; i++) {
+        std::unique_ptr<LoadBot> bot(new LoadBot());
+        if (!bot->socket.open(0)) {
+            fprintf(stderr, "could only open %d sockets (check ulimit -n)\n", i);
+            break;
+        }
+        bot->random = 2654435761u * (i + 1);
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = static_cast<uint32_t>(i);
+        epoll_ctl(epoll, EPOLL_CTL_ADD, bot->socket.handle(), &event);
+        bots.push_back(std::move(bot));
+    }
+    printf("%zu %s against %s for %.0f s\n", bots.size(), viewing ? "viewers" : "bots", addressToString(server).c_str(), duration);
+
+    LoadStats interval, total;
+    auto start = LoadClock::now();
+    double lastReport = 0.0;
+    std::vector<epoll_event> events(1024);
+    unsigned char buffer[MAX_DATAGRAM];
+    for (;;) {
+        double now = secondsSince(start);
+        if (now >= duration) {
+            break;
+        }
+
+        int count = epoll_wait(epoll, events.data(), static_cast<int>(events.size()), 5);
+        for (int i = 0; i < count; i++) {
+            LoadBot& bot = *bots[events[i].data.u32];
+            NetAddress from;
+            int size;
+            while ((size = bot.socket.receive(from, buffer, sizeof(buffer))) >= 0) {
+                interval.packetsIn++;
+                interval.bytesIn += size;
+                if (viewing) {
+                    handleViewerMessage(bot, server, buffer, size, now, interval);
+                }
+                else {
+                    handleMessage(bot, server, buffer, size, now, thinkEvery, interval);
+                }
+            }
+        }
+
+        // joining, and recovering from a server that went quiet
+        for (std::unique_ptr<LoadBot>& pointer : bots) {
+            LoadBot& bot = *pointer;
+            if (viewing) {
+                if (now - bot.lastSend >= VIEW_KEEPALIVE_SECONDS) {
+                    bot.lastSend = now;
+                    sendSimple(bot, server, MSG_VIEW, interval);
+                }
+                continue;
+            }
+            if (bot.inMatch && now - bot.lastReceive > SILENCE_TIMEOUT_SECONDS) {
+                bot.inMatch = false;
+                interval.timeouts++;
+            }
+            if (!bot.inMatch && now - bot.lastSend >= JOIN_RETRY_SECONDS) {
+                bot.lastSend = now;
+                bot.lastReceive = now;
+                sendSimple(bot, server, MSG_JOIN, interval);
+            }
+        }
+
+        if (now - lastReport >= 1.0) {
+            double seconds = now - lastReport;
+            lastReport = now;
+            printf("in %7.0f pkt/s %8.1f KB/s  deltas %7.0f/s avg %5.1f B  keyframes %4llu  out %7.0f pkt/s  games %4llu  resyncs %4llu  timeouts %llu\n",
+                interval.packetsIn / seconds, interval.bytesIn / seconds / 1024.0, interval.deltas / seconds,
+                interval.deltas ? double(interval.deltaBytes) / interval.deltas : 0.0, interval.keyframes,
+                interval.packetsOut / seconds, interval.gamesFinished, interval.resyncs, interval.timeouts);
+            fflush(stdout);
+            total.packetsIn += interval.packetsIn;
+            total.deltas += interval.deltas;
+            total.deltaBytes += interval.deltaBytes;
+            total.keyframes += interval.keyframes;
+            total.keyframeBytes += interval.keyframeBytes;
+            total.gamesFinished += interval.gamesFinished;
+            total.resyncs += interval.resyncs;
+            total.timeouts += interval.timeouts;
+            interval = LoadStats();
+        }
+    }
+
+    for (std::unique_ptr<LoadBot>& bot : bots) {
+        sendSimple(*bot, server, MSG_LEAVE, interval);
+    }
+    close(epoll);
+    printf("total: %llu deltas (avg %.1f bytes), %llu keyframes (avg %.0f bytes), %llu games finished, %llu resyncs, %llu timeouts\n",
+        total.deltas, total.deltas ? double(total.deltaBytes) / total.deltas : 0.0, total.keyframes,
+        total.keyframes ? double(total.keyframeBytes) / total.keyframes : 0.0, total.gamesFinished, total.resyncs, total.timeouts);
+    return 0;
+}
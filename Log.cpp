@@ -0,0 +1,411 @@
+/*
+ * Title: Logging
+ * Description: Implementation of the lock-free log ring and its writer thread declared in Log.h.
+*/
+
+#include "Log.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// On x86 records are stamped with the time stamp counter, which is several times cheaper to
+// read than the system clock; the writer thread converts it to seconds
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LOG_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define LOG_TSC 0
+#endif
+
+// How long the writer sleeps when the ring is empty, unless a burst wakes it sooner
+const int LOG_IDLE_MILLISECONDS = 2;
+// The writer only sleeps on an empty ring, so a writer that claims a position on a multiple
+// of this wakes it before the ring gets more than a quarter full
+const uint64_t LOG_WAKE_RECORDS = LOG_RING_RECORDS / 4;
+
+namespace {
+
+struct LogSlot {
+    std::atomic<uint64_t> sequence;
+    LogRecord record;
+};
+
+// The ring, the writer thread and their counters. One instance lives for the whole program
+// and stops its thread when the program ends.
+struct Logger {
+    LogSlot slots[LOG_RING_RECORDS];
+    alignas(64) std::atomic<uint64_t> enqueuePosition{ 0 };
+    alignas(64) uint64_t dequeuePosition = 0;
+    std::atomic<uint64_t> readPosition{ 0 }; // dequeuePosition as of the writer's last record, for wake-ups
+    std::atomic<uint64_t> written{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+    std::atomic<bool> running{ false };
+    std::atomic<bool> stopping{ false };
+    std::mutex control;                   // start and stop only, never taken by a writer
+    std::mutex sleep;                     // the writer thread's idle wait, and the wake-ups ending it
+    std::condition_variable wake;
+    bool woken = false;                   // under sleep
+    std::thread thread;
+    FILE* outputs[2] = { nullptr, nullptr };
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t startStamp = 0;
+    double secondsPerStamp = 1e-9;        // worked out again by the writer on every batch
+
+    Logger() {
+#if LOG_TSC
+        startStamp = __rdtsc();
+#endif
+        for (size_t i = 0; i < LOG_RING_RECORDS; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~Logger() {
+        logShutdown();
+    }
+};
+
+Logger logger;
+
+uint64_t readStamp() {
+#if LOG_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - logger.start).count());
+#endif
+}
+
+/*
+ * This function measures the stamp rate against the system clock over everything since the
+ * logger started, which gets more exact the longer the program runs
+*/
+
+void calibrateStamps() {
+#if LOG_TSC
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - logger.start).count();
+    uint64_t stamps = __rdtsc() - logger.startStamp;
+    if (seconds > 0.0 && stamps > 0) {
+        logger.secondsPerStamp = seconds / stamps;
+    }
+#endif
+}
+
+/*
+ * This function formats one conversion of a record, with the flags and width of its format
+ * but the length modifier that matches the value that was stored
+*/
+
+void formatArg(std::string& line, const char* spec, size_t specLength, char conversion, const LogRecord& record, int arg) {
+    char format[32];
+    char text[256];
+    size_t length = specLength < 20 ? specLength : 20;
+    memcpy(format, spec, length);
+    uint64_t value = record.values[arg];
+    int written = 0;
+    switch (record.types[arg]) {
+    case LOG_ARG_SIGNED:
+    case LOG_ARG_UNSIGNED: {
+        // a bare %d or %u, the most common conversion, skips snprintf
+        if (specLength == 1 && (conversion == 'd' || conversion == 'i' || conversion == 'u')) {
+            bool negative = record.types[arg] == LOG_ARG_SIGNED && conversion != 'u' && static_cast<int64_t>(value) < 0;
+            uint64_t magnitude = negative ? 0 - value : value;
+            int count = 0;
+            do {
+                text[count++] = static_cast<char>('0' + magnitude % 10);
+                magnitude /= 10;
+            } while (magnitude > 0);
+            if (negative) {
+                line.push_back('-');
+            }
+            while (count > 0) {
+                line.push_back(text[--count]);
+            }
+            return;
+        }
+        bool integer = strchr("diuoxXc", conversion) != nullptr;
+        if (!integer) {
+            conversion = record.types[arg] == LOG_ARG_SIGNED ? 'd' : 'u';
+        }
+        if (conversion == 'c') {
+            memcpy(format + length, "c", 2);
+            written = snprintf(text, sizeof(text), format, static_cast<int>(value));
+        }
+        else {
+            format[length] = 'l';
+            format[length + 1] = 'l';
+            format[length + 2] = conversion;
+            format[length + 3] = '\0';
+            if (record.types[arg] == LOG_ARG_SIGNED && (conversion == 'd' || conversion == 'i')) {
+                written = snprintf(text, sizeof(text), format, static_cast<long long>(value));
+            }
+            else {
+                written = snprintf(text, sizeof(text), format, static_cast<unsigned long long>(value));
+            }
+        }
+        break;
+    }
+    case LOG_ARG_DOUBLE: {
+        double number;
+        memcpy(&number, &value, sizeof(number));
+        format[length] = strchr("fFeEgGaA", conversion) != nullptr ? conversion : 'g';
+        format[length + 1] = '\0';
+        written = snprintf(text, sizeof(text), format, number);
+        break;
+    }
+    case LOG_ARG_STRING:
+        format[length] = 's';
+        format[length + 1] = '\0';
+        written = snprintf(text, sizeof(text), format, record.text + value);
+        break;
+    case LOG_ARG_POINTER:
+        written = snprintf(text, sizeof(text), "%p", reinterpret_cast<void*>(static_cast<uintptr_t>(value)));
+        break;
+    }
+    if (written > 0) {
+        line.append(text, static_cast<size_t>(written) < sizeof(text) ? written : sizeof(text) - 1);
+    }
+}
+
+/*
+ * This function writes a record's time as "[%9.3f] " would, with integer arithmetic only;
+ * formatting the double took most of the writer's time per record
+*/
+
+void appendStamp(std::string& line, double seconds) {
+    int64_t millis = seconds > 0.0 ? static_cast<int64_t>(seconds * 1000.0 + 0.5) : 0;
+    char digits[24];
+    int count = 0;
+    int64_t whole = millis / 1000;
+    do {
+        digits[count++] = static_cast<char>('0' + whole % 10);
+        whole /= 10;
+    } while (whole > 0);
+    line.push_back('[');
+    for (int pad = count; pad < 5; pad++) {
+        line.push_back(' ');
+    }
+    while (count > 0) {
+        line.push_back(digits[--count]);
+    }
+    int fraction = static_cast<int>(millis % 1000);
+    line.push_back('.');
+    line.push_back(static_cast<char>('0' + fraction / 100));
+    line.push_back(static_cast<char>('0' + fraction / 10 % 10));
+    line.push_back(static_cast<char>('0' + fraction % 10));
+    line.append("] ");
+}
+
+/*
+ * This function turns a record into its line of text: the time, then the format with every
+ * conversion replaced by the next stored argument
+*/
+
+void formatRecord(std::string& line, const LogRecord& record) {
+    static const char* const levels[] = { "debug: ", "", "warning: ", "error: " };
+    double seconds = static_cast<int64_t>(record.stamp - logger.startStamp) * logger.secondsPerStamp;
+    line.clear();
+    appendStamp(line, seconds);
+    line.append(levels[record.level & 3]);
+    int arg = 0;
+    const char* p = record.format;
+    while (*p != '\0') {
+        if (*p != '%') {
+            const char* next = strchr(p, '%');
+            size_t length = next != nullptr ? static_cast<size_t>(next - p) : strlen(p);
+            line.append(p, length);
+            p += length;
+            continue;
+        }
+        if (p[1] == '%') {
+            line.push_back('%');
+            p += 2;
+            continue;
+        }
+        // %[flags][width][.precision][length]conversion; the length is replaced
+        const char* spec = p++;
+        while (*p != '\0' && strchr("-+ #0", *p) != nullptr) {
+            p++;
+        }
+        while ((*p >= '0' && *p <= '9') || *p == '.') {
+            p++;
+        }
+        size_t specLength = static_cast<size_t>(p - spec);
+        while (*p != '\0' && strchr("hlLqjzt", *p) != nullptr) {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        char conversion = *p++;
+        if (arg < record.argCount) {
+            formatArg(line, spec, specLength, conversion, record, arg++);
+        }
+    }
+    line.push_back('\n');
+}
+
+/*
+ * This function is the writer thread: it takes records out in order, formats them and writes
+ * them, flushing once per batch rather than once per line
+*/
+
+void writerLoop() {
+    std::string line;
+    line.reserve(256);
+    for (;;) {
+        bool wrote = false;
+        calibrateStamps();
+        for (;;) {
+            LogSlot& slot = logger.slots[logger.dequeuePosition & (LOG_RING_RECORDS - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != logger.dequeuePosition + 1) {
+                break;
+            }
+            formatRecord(line, slot.record);
+            FILE* output = slot.record.level >= LOG_LEVEL_WARN ? logger.outputs[1] : logger.outputs[0];
+            slot.sequence.store(logger.dequeuePosition + LOG_RING_RECORDS, std::memory_order_release);
+            logger.dequeuePosition++;
+            logger.readPosition.store(logger.dequeuePosition, std::memory_order_relaxed);
+            fwrite(line.data(), 1, line.size(), output != nullptr ? output : stdout);
+            logger.written.fetch_add(1, std::memory_order_relaxed);
+            wrote = true;
+        }
+        if (wrote) {
+            fflush(logger.outputs[0] != nullptr ? logger.outputs[0] : stdout);
+            fflush(logger.outputs[1] != nullptr ? logger.outputs[1] : stderr);
+            continue;
+        }
+        if (logger.stopping.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(logger.sleep);
+        logger.wake.wait_for(lock, std::chrono::milliseconds(LOG_IDLE_MILLISECONDS), [] { return logger.woken; });
+        logger.woken = false;
+    }
+}
+
+/*
+ * This function wakes the writer thread up early, for a burst that would otherwise fill the
+ * ring before its sleep is over. Only one record in LOG_WAKE_RECORDS pays for it.
+*/
+
+void wakeWriter() {
+    {
+        std::lock_guard<std::mutex> lock(logger.sleep);
+        logger.woken = true;
+    }
+    logger.wake.notify_one();
+}
+
+/*
+ * This function starts the writer thread if it is not running
+*/
+
+void startWriter() {
+    std::lock_guard<std::mutex> lock(logger.control);
+    if (logger.running.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (logger.outputs[0] == nullptr) {
+        logger.outputs[0] = stdout;
+        logger.outputs[1] = stderr;
+    }
+    logger.stopping.store(false, std::memory_order_relaxed);
+    logger.thread = std::thread(writerLoop);
+    logger.running.store(true, std::memory_order_release);
+}
+
+}
+
+/*
+ * This function claims the next slot of the ring for a record. Writers race for a position
+ * with a compare-and-swap; a slot whose sequence number still belongs to the previous lap is
+ * not read yet, which means the ring is full.
+ * @return the record to fill in, or nullptr when it was dropped
+*/
+
+LogRecord* logBegin(int level, const char* format) {
+    if (!logger.running.load(std::memory_order_acquire)) {
+        startWriter();
+    }
+    uint64_t position = logger.enqueuePosition.load(std::memory_order_relaxed);
+    LogSlot* slot;
+    for (;;) {
+        slot = &logger.slots[position & (LOG_RING_RECORDS - 1)];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t difference = static_cast<int64_t>(sequence - position);
+        if (difference == 0) {
+            if (logger.enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (difference < 0) {
+            logger.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        else {
+            position = logger.enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+    LogRecord& record = slot->record;
+    record.format = format;
+    record.position = position;
+    record.stamp = readStamp();
+    record.level = static_cast<uint8_t>(level);
+    record.argCount = 0;
+    record.textUsed = 0;
+    return &record;
+}
+
+void logCommit(LogRecord* record) {
+    logger.slots[record->position & (LOG_RING_RECORDS - 1)].sequence.store(record->position + 1, std::memory_order_release);
+    if ((record->position & (LOG_WAKE_RECORDS - 1)) == LOG_WAKE_RECORDS - 1) {
+        wakeWriter();
+        // with more busy threads than cores the woken writer may not get a core before the
+        // ring fills; past half full, this thread gives it the rest of its time slice
+        if (record->position + 1 - logger.readPosition.load(std::memory_order_relaxed) > LOG_RING_RECORDS / 2) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void logFlush() {
+    if (!logger.running.load(std::memory_order_acquire)) {
+        return;
+    }
+    uint64_t target = logger.enqueuePosition.load(std::memory_order_acquire);
+    while (logger.written.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void logShutdown() {
+    std::lock_guard<std::mutex> lock(logger.control);
+    if (!logger.running.load(std::memory_order_acquire)) {
+        return;
+    }
+    logger.stopping.store(true, std::memory_order_release);
+    wakeWriter();
+    logger.thread.join();
+    logger.running.store(false, std::memory_order_release);
+}
+
+void logSetOutput(FILE* info, FILE* errors) {
+    logFlush();
+    std::lock_guard<std::mutex> lock(logger.control);
+    logger.outputs[0] = info;
+    logger.outputs[1] = errors;
+}
+
+LogStats logStats() {
+    LogStats stats;
+    stats.written = logger.written.load(std::memory_order_relaxed);
+    stats.dropped = logger.dropped.load(std::memory_order_relaxed);
+    return stats;
+}
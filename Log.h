@@ -0,0 +1,156 @@
+/*
+ * Title: Logging
+ * Description: printf-style logging that never waits on the console.
+ *
+ *      LOG_INFO("Small Food spawned at: (%g, %g)", x, y) does not format anything. It copies
+ *      the format string's address, the arguments as raw values (strings copied inline) and a
+ *      timestamp into a fixed-size record in a lock-free ring buffer, which takes a few tens of
+ *      nanoseconds. A background thread takes the records out, formats them and writes them
+ *      in batches, so a slow terminal or a redirected file only slows that thread down. When
+ *      the ring is full the record is dropped and counted rather than blocking the caller.
+ *      The writer sleeps while the ring is empty and is woken by every LOG_RING_RECORDS / 4th
+ *      record, so a burst is written while it comes in instead of after the sleep; if the
+ *      ring is past half full by then, the waking thread also yields its time slice.
+ *
+ *      Levels below LOG_MIN_LEVEL are removed by the preprocessor, arguments and all; build
+ *      with -DLOG_MIN_LEVEL=0 to keep the debug messages. Info goes to stdout, warnings and
+ *      errors to stderr.
+ *
+ *      The ring takes records from any number of threads (a per-slot sequence number tells
+ *      writers and the reader whose turn a slot is), and the format must be a string literal,
+ *      as only its address is stored.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+const int LOG_MAX_ARGS = 8;
+const int LOG_TEXT_BYTES = 120;           // room for the string arguments of one record
+const size_t LOG_RING_RECORDS = 4096;     // power of two
+
+enum LogArgType : uint8_t { LOG_ARG_SIGNED, LOG_ARG_UNSIGNED, LOG_ARG_DOUBLE, LOG_ARG_STRING, LOG_ARG_POINTER };
+
+// One message as it waits in the ring: still unformatted
+struct LogRecord {
+    const char* format;
+    uint64_t position;                    // place in the ring, for logCommit
+    uint64_t stamp;                       // clock reading: TSC ticks on x86, nanoseconds elsewhere
+    uint8_t level;
+    uint8_t argCount;
+    uint8_t textUsed;
+    LogArgType types[LOG_MAX_ARGS];
+    uint64_t values[LOG_MAX_ARGS];        // numbers as bits; strings as their offset in text
+    char text[LOG_TEXT_BYTES];
+};
+
+struct LogStats {
+    uint64_t written = 0;
+    uint64_t dropped = 0;                 // the ring was full
+};
+
+// Takes a slot in the ring, or returns nullptr (and counts a drop) when it is full
+LogRecord* logBegin(int level, const char* format);
+// Hands a filled record to the writer thread
+void logCommit(LogRecord* record);
+// Waits until everything logged so far has been written
+void logFlush();
+// Writes what is left and stops the writer thread; logging afterwards starts it again
+void logShutdown();
+// Where each level's lines go (by default stdout for info and below, stderr above)
+void logSetOutput(FILE* info, FILE* errors);
+LogStats logStats();
+
+// Argument encoders, one per kind of value
+inline void logArg(LogRecord& record, const char* value) {
+    size_t room = LOG_TEXT_BYTES - record.textUsed;
+    if (value == nullptr) {
+        value = "(null)";
+    }
+    size_t length = strlen(value);
+    if (room == 0) {
+        record.values[record.argCount] = LOG_TEXT_BYTES - 1; // the last byte is always 0
+    }
+    else {
+        length = length < room - 1 ? length : room - 1;
+        memcpy(record.text + record.textUsed, value, length);
+        record.text[record.textUsed + length] = '\0';
+        record.values[record.argCount] = record.textUsed;
+        record.textUsed = static_cast<uint8_t>(record.textUsed + length + 1);
+    }
+    record.types[record.argCount++] = LOG_ARG_STRING;
+}
+
+inline void logArg(LogRecord& record, char* value) {
+    logArg(record, static_cast<const char*>(value));
+}
+
+inline void logArg(LogRecord& record, const std::string& value) {
+    logArg(record, value.c_str());
+}
+
+inline void logArg(LogRecord& record, const void* value) {
+    record.values[record.argCount] = reinterpret_cast<uintptr_t>(value);
+    record.types[record.argCount++] = LOG_ARG_POINTER;
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type logArg(LogRecord& record, T value) {
+    if (std::is_signed<T>::value) {
+        record.values[record.argCount] = static_cast<uint64_t>(static_cast<int64_t>(value));
+        record.types[record.argCount++] = LOG_ARG_SIGNED;
+    }
+    else {
+        record.values[record.argCount] = static_cast<uint64_t>(value);
+        record.types[record.argCount++] = LOG_ARG_UNSIGNED;
+    }
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value>::type logArg(LogRecord& record, T value) {
+    double number = static_cast<double>(value);
+    memcpy(&record.values[record.argCount], &number, sizeof(number));
+    record.types[record.argCount++] = LOG_ARG_DOUBLE;
+}
+
+template<typename... Args>
+void logWrite(int level, const char* format, const Args&... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+    LogRecord* record = logBegin(level, format);
+    if (record == nullptr) {
+        return;
+    }
+    int expand[] = { 0, (logArg(*record, args), 0)... };
+    (void)expand;
+    logCommit(record);
+}
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+#define LOG_ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
@@ -0,0 +1,337 @@
+/*
+ * Title: Metrics
+ * Description: Implementation of the histograms, the Prometheus text writers and the HTTP
+ *      server declared in Metrics.h.
+*/
+
+#include "Metrics.h"
+#include "Allocations.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;      // a client hanging up must not raise SIGPIPE
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+const uint64_t HISTOGRAM_MAX = (1ull << 33) - 1;
+const int METRICS_POLL_MILLISECONDS = 100; // how soon the server notices stop()
+const int METRICS_REQUEST_MILLISECONDS = 1000;
+const size_t METRICS_REQUEST_BYTES = 4096;
+
+// Bucket bounds of the published histograms, in microseconds: from well under a frame to a second
+const uint64_t PUBLISHED_BOUNDS[] = { 250, 500, 1000, 2000, 4000, 8000, 16667, 33333, 50000, 100000, 250000, 500000, 1000000 };
+const double PUBLISHED_QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+
+namespace {
+
+bool validSocket(SocketHandle handle) {
+#ifdef _WIN32
+    return handle != INVALID_SOCKET;
+#else
+    return handle >= 0;
+#endif
+}
+
+void closeSocket(SocketHandle handle) {
+#ifdef _WIN32
+    closesocket(handle);
+#else
+    ::close(handle);
+#endif
+}
+
+/*
+ * This function waits until a socket has something to read
+ * @return true if it does, false on timeout or error
+*/
+
+bool waitReadable(SocketHandle handle, int milliseconds) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(handle, &readable);
+    timeval timeout;
+    timeout.tv_sec = milliseconds / 1000;
+    timeout.tv_usec = (milliseconds % 1000) * 1000;
+    return select(static_cast<int>(handle) + 1, &readable, nullptr, nullptr, &timeout) > 0;
+}
+
+bool sendAll(SocketHandle handle, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int result = send(handle, data.data() + sent, static_cast<int>(data.size() - sent), SEND_FLAGS);
+        if (result <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+/*
+ * This function writes a number of seconds the way Prometheus expects a float: shortest
+ * exact form, no trailing zeros
+*/
+
+std::string seconds(double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.9g", value);
+    return text;
+}
+
+/*
+ * This function finds a quantile in a snapshot of bucket counts
+ * @return the top of the bucket holding it, 0 without samples
+*/
+
+uint64_t quantileOf(const uint64_t* counts, uint64_t all, double fraction) {
+    if (all == 0) {
+        return 0;
+    }
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(all))));
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= target) {
+            return Histogram::bucketTop(i);
+        }
+    }
+    return Histogram::bucketTop(HISTOGRAM_BUCKETS - 1);
+}
+
+}
+
+/*
+ * This function records one sample: two relaxed atomic adds, so it never waits on another
+ * thread recording or on the server reading
+ * @param value: the sample; values of 2^33 and up are counted in the top bucket
+*/
+
+void Histogram::record(uint64_t value) {
+    buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(value, std::memory_order_relaxed);
+}
+
+int Histogram::bucketOf(uint64_t value) {
+    if (value < static_cast<uint64_t>(HISTOGRAM_LINEAR)) {
+        return static_cast<int>(value);
+    }
+    value = std::min(value, HISTOGRAM_MAX);
+    int top = std::bit_width(value) - 1;
+    // The highest bit picks the power of two, the HISTOGRAM_SUB_BITS - 1 bits below it the bucket in it
+    int shift = top - (HISTOGRAM_SUB_BITS - 1);
+    return HISTOGRAM_LINEAR + (top - HISTOGRAM_SUB_BITS) * HISTOGRAM_HALF + static_cast<int>(value >> shift) - HISTOGRAM_HALF;
+}
+
+uint64_t Histogram::bucketTop(int bucket) {
+    if (bucket < HISTOGRAM_LINEAR) {
+        return static_cast<uint64_t>(bucket);
+    }
+    int power = (bucket - HISTOGRAM_LINEAR) / HISTOGRAM_HALF;
+    uint64_t sub = static_cast<uint64_t>((bucket - HISTOGRAM_LINEAR) % HISTOGRAM_HALF + HISTOGRAM_HALF);
+    int shift = power + 1;
+    return ((sub + 1) << shift) - 1;
+}
+
+uint64_t Histogram::quantile(double fraction) const {
+    std::vector<uint64_t> counts(HISTOGRAM_BUCKETS);
+    return quantileOf(counts.data(), snapshot(counts.data()), fraction);
+}
+
+uint64_t Histogram::count() const {
+    std::vector<uint64_t> counts(HISTOGRAM_BUCKETS);
+    return snapshot(counts.data());
+}
+
+uint64_t Histogram::snapshot(uint64_t* counts) const {
+    uint64_t all = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        all += counts[i];
+    }
+    return all;
+}
+
+void metricsCounter(std::string& out, const char* name, const char* help, uint64_t value) {
+    char line[256];
+    snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", name, help, name, name,
+        static_cast<unsigned long long>(value));
+    out += line;
+}
+
+void metricsGauge(std::string& out, const char* name, const char* help, double value) {
+    out += "# HELP " + std::string(name) + " " + help + "\n# TYPE " + name + " gauge\n" + name + " " + seconds(value) + "\n";
+}
+
+/*
+ * This function writes a histogram of microseconds as a Prometheus histogram in seconds, with
+ * the buckets of PUBLISHED_BOUNDS, followed by a gauge of its quantiles named <name>_quantile.
+ * A published bucket counts the HDR buckets that end at or below its bound, so it can be short
+ * by the samples of the one HDR bucket it cuts through, under 1.6% of its width.
+ * @param out: the page being built
+ * @param name: metric name, ending in _seconds
+ * @param help: one line describing it
+ * @param histogram: the samples, in microseconds
+*/
+
+void metricsHistogram(std::string& out, const char* name, const char* help, const Histogram& histogram) {
+    // The count is taken from the copied buckets, so the page adds up even while samples are
+    // being recorded
+    std::vector<uint64_t> counts(HISTOGRAM_BUCKETS);
+    uint64_t all = histogram.snapshot(counts.data());
+
+    std::string base = name;
+    out += "# HELP " + base + " " + help + "\n# TYPE " + base + " histogram\n";
+    uint64_t seen = 0;
+    int bucket = 0;
+    for (uint64_t bound : PUBLISHED_BOUNDS) {
+        while (bucket < HISTOGRAM_BUCKETS && Histogram::bucketTop(bucket) <= bound) {
+            seen += counts[bucket++];
+        }
+        out += base + "_bucket{le=\"" + seconds(bound / 1e6) + "\"} " + std::to_string(seen) + "\n";
+    }
+    out += base + "_bucket{le=\"+Inf\"} " + std::to_string(all) + "\n";
+    out += base + "_sum " + seconds(histogram.sum() / 1e6) + "\n";
+    out += base + "_count " + std::to_string(all) + "\n";
+
+    out += "# HELP " + base + "_quantile " + help + ", quantiles from the full resolution\n# TYPE " + base + "_quantile gauge\n";
+    for (double fraction : PUBLISHED_QUANTILES) {
+        uint64_t value = quantileOf(counts.data(), all, fraction);
+        out += base + "_quantile{quantile=\"" + seconds(fraction) + "\"} " + seconds(value / 1e6) + "\n";
+    }
+}
+
+std::string metricsPage(const GameMetrics& metrics) {
+    std::string out;
+    out.reserve(8192);
+    metricsHistogram(out, "snake_frame_seconds", "Time from the start of one frame to the start of the next", metrics.frameTime);
+    metricsHistogram(out, "snake_tick_seconds", "Time taken by a game tick", metrics.tickTime);
+    metricsHistogram(out, "snake_input_latency_seconds", "Time from a direction key to the frame that shows it", metrics.inputLatency);
+    metricsCounter(out, "snake_games_played_total", "Games that reached game over", metrics.gamesPlayed.value());
+    metricsCounter(out, "snake_food_eaten_total", "Food eaten by any snake", metrics.foodEaten.value());
+    metricsCounter(out, "snake_draw_calls_total", "GL draw calls, counted while GL call counting is on", metrics.drawCalls.value());
+    AllocationCounts allocations = allocationCounts();
+    metricsCounter(out, "snake_allocations_total", "Heap allocations through operator new", allocations.allocations);
+    metricsCounter(out, "snake_allocated_bytes_total", "Bytes asked of operator new", allocations.bytes);
+    metricsCounter(out, "snake_frees_total", "Heap frees through operator delete", allocations.frees);
+    return out;
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+/*
+ * This function opens the listening socket on 127.0.0.1 and starts the server thread. Only
+ * the local machine can connect.
+ * @param port: the TCP port to listen on, 0 lets the system pick one
+ * @param page: builds the /metrics page; called on the server thread for every scrape
+ * @return false if the socket could not be opened or bound
+*/
+
+bool MetricsServer::start(uint16_t port, std::function<std::string()> page) {
+    stop();
+    if (!netInit()) {
+        return false;
+    }
+    listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (!validSocket(listener)) {
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    local.sin_port = htons(port);
+    socklen_t length = sizeof(local);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0 || listen(listener, 8) != 0 ||
+        getsockname(listener, reinterpret_cast<sockaddr*>(&local), &length) != 0) {
+        closeSocket(listener);
+#ifdef _WIN32
+        listener = INVALID_SOCKET;
+#else
+        listener = -1;
+#endif
+        return false;
+    }
+    boundPort = ntohs(local.sin_port);
+    this->page = std::move(page);
+    stopping.store(false, std::memory_order_relaxed);
+    thread = std::thread(&MetricsServer::serve, this);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (thread.joinable()) {
+        stopping.store(true, std::memory_order_relaxed);
+        thread.join();
+    }
+    if (validSocket(listener)) {
+        closeSocket(listener);
+#ifdef _WIN32
+        listener = INVALID_SOCKET;
+#else
+        listener = -1;
+#endif
+    }
+}
+
+/*
+ * This function is the server thread: it answers one connection at a time, GET /metrics with
+ * the page and anything else with 404, and closes the connection after each answer
+*/
+
+void MetricsServer::serve() {
+    std::string request;
+    while (!stopping.load(std::memory_order_relaxed)) {
+        if (!waitReadable(listener, METRICS_POLL_MILLISECONDS)) {
+            continue;
+        }
+        SocketHandle client = accept(listener, nullptr, nullptr);
+        if (!validSocket(client)) {
+            continue;
+        }
+
+        // Read the request head; a client that sends nothing for a second is dropped
+        request.clear();
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < METRICS_REQUEST_BYTES &&
+            waitReadable(client, METRICS_REQUEST_MILLISECONDS)) {
+            int received = recv(client, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                break;
+            }
+            request.append(buffer, static_cast<size_t>(received));
+        }
+
+        std::string response;
+        if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0) {
+            std::string body = page();
+            response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: " +
+                std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+            served.fetch_add(1, std::memory_order_relaxed);
+        }
+        else {
+            response = "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\nConnection: close\r\n\r\nnot found\n";
+        }
+        sendAll(client, response);
+        closeSocket(client);
+    }
+}
@@ -0,0 +1,154 @@
+/*
+ * Title: Minimap
+ * Description: Implementation of the minimap declared in Minimap.h.
+*/
+
+#include "Minimap.h"
+#include "Shader.h"
+#include <glad/glad.h>
+#include <vector>
+
+// Texel values; the shader turns them into colors
+const uint8_t MINIMAP_FREE = 0;
+const uint8_t MINIMAP_BOT = 128;
+const uint8_t MINIMAP_PLAYER = 255;
+
+// The corners of the quad come from gl_VertexID, so no vertex buffer is needed
+static const char* minimapVertexSource = R"glsl(
+    #version 330 core
+    uniform vec4 screenRect;    // left, bottom, right, top in normalized device coordinates
+    out vec2 uv;
+    void main() {
+        vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+        uv = corner;
+        gl_Position = vec4(mix(screenRect.xy, screenRect.zw, corner), 0.0, 1.0);
+    }
+)glsl";
+
+// Several cells fall on each pixel of the map, so it takes the largest of four linear samples
+// spread over the pixel; a snake one cell wide would flicker in and out otherwise
+static const char* minimapFragmentSource = R"glsl(
+    #version 330 core
+    in vec2 uv;
+    out vec4 FragColor;
+    uniform sampler2D occupancy;
+    uniform vec4 viewRect;      // the camera's view in texture coordinates
+    void main() {
+        vec2 quarter = 0.25 * fwidth(uv);
+        float value = max(max(texture(occupancy, uv + vec2(-quarter.x, -quarter.y)).r, texture(occupancy, uv + vec2(quarter.x, -quarter.y)).r),
+                          max(texture(occupancy, uv + vec2(-quarter.x, quarter.y)).r, texture(occupancy, uv + vec2(quarter.x, quarter.y)).r));
+        vec4 color = vec4(0.0, 0.0, 0.0, 0.6);
+        if (value > 0.75)
+            color = vec4(1.0, 0.85, 0.2, 1.0);      // the player
+        else if (value > 0.25)
+            color = vec4(0.3, 0.8, 0.3, 1.0);       // bots
+        // one pixel wide outline of the view and of the map
+        vec2 pixel = fwidth(uv);
+        bool inView = all(greaterThanEqual(uv, viewRect.xy - pixel)) && all(lessThanEqual(uv, viewRect.zw + pixel));
+        bool inside = all(greaterThan(uv, viewRect.xy)) && all(lessThan(uv, viewRect.zw));
+        bool border = any(lessThan(uv, pixel)) || any(greaterThan(uv, 1.0 - pixel));
+        if ((inView && !inside) || border)
+            color = vec4(1.0);
+        FragColor = color;
+    }
+)glsl";
+
+/*
+ * This function makes the occupancy texture from the current grid and compiles the shader
+ * @param arena: the arena to map
+*/
+
+void Minimap::init(const ArenaState& arena) {
+    boardWidth = arena.config.width;
+    boardHeight = arena.config.height;
+    player = arena.config.player;
+    texture = registry.create(GL_OBJECT_TEXTURE);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, boardWidth, boardHeight, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    noteRestart(arena);
+    // no mipmaps: they would have to be rebuilt from the whole board after every change
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    program = registry.add(GlProgram(createShaderProgram(minimapVertexSource, minimapFragmentSource)));
+    vao = registry.create(GL_OBJECT_VERTEX_ARRAY);
+}
+
+void Minimap::noteRestart(const ArenaState& arena) {
+    std::vector<uint8_t> texels(size_t(boardWidth) * boardHeight);
+    for (int y = 0; y < boardHeight; y++) {
+        for (int x = 0; x < boardWidth; x++) {
+            texels[size_t(y) * boardWidth + x] = texel(arena, { static_cast<int16_t>(x), static_cast<int16_t>(y) });
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, boardWidth, boardHeight, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+uint8_t Minimap::texel(const ArenaState& arena, ArenaCell cell) const {
+    uint32_t occupant = arena.grid[size_t(cell.y) * boardWidth + cell.x];
+    if (occupant == 0) {
+        return MINIMAP_FREE;
+    }
+    return occupant == 1 && player ? MINIMAP_PLAYER : MINIMAP_BOT;
+}
+
+/*
+ * This function rewrites the texels of the cells taken or freed during the last tick, one
+ * texel each. A crash frees a whole body at once, which is the only time this does more than
+ * two texels per snake.
+*/
+
+void Minimap::noteTick(const ArenaState& arena) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (const ArenaCell& cell : arena.changed) {
+        uint8_t value = texel(arena, cell);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, cell.x, cell.y, 1, 1, GL_RED, GL_UNSIGNED_BYTE, &value);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    updates = static_cast<uint32_t>(arena.changed.size());
+}
+
+/*
+ * This function draws the map, keeping the board's aspect ratio, with the camera's view on it
+ * @param framebufferWidth, framebufferHeight: size of the target in pixels
+ * @param camera: the camera whose view is outlined
+*/
+
+void Minimap::draw(int framebufferWidth, int framebufferHeight, const Camera& camera) {
+    float width = MINIMAP_PIXELS, height = MINIMAP_PIXELS;
+    if (boardWidth > boardHeight) {
+        height = MINIMAP_PIXELS * float(boardHeight) / boardWidth;
+    }
+    else {
+        width = MINIMAP_PIXELS * float(boardWidth) / boardHeight;
+    }
+    float right = framebufferWidth - MINIMAP_MARGIN, top = framebufferHeight - MINIMAP_MARGIN;
+    float left = right - width, bottom = top - height;
+    ViewRect view = camera.visibleRect();
+    float worldWidth = boardWidth * MOVE_STRIDE, worldHeight = boardHeight * MOVE_STRIDE;
+
+    glUseProgram(program);
+    glUniform4f(glGetUniformLocation(program, "screenRect"), 2.0f * left / framebufferWidth - 1.0f, 2.0f * bottom / framebufferHeight - 1.0f,
+        2.0f * right / framebufferWidth - 1.0f, 2.0f * top / framebufferHeight - 1.0f);
+    glUniform4f(glGetUniformLocation(program, "viewRect"), view.left / worldWidth, view.bottom / worldHeight, view.right / worldWidth, view.top / worldHeight);
+    glUniform1i(glGetUniformLocation(program, "occupancy"), 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+}
+
+void Minimap::release() {
+    registry.release();
+    vao = program = texture = 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * Title: Minimap
+ * Description: A map of the whole arena in a corner of the screen. The board's occupancy is
+ *      kept in an R8 texture with one texel per cell, and a tick only rewrites the texels of
+ *      the cells that changed (ArenaState::changed: each snake's new head and freed tail), so
+ *      keeping it current costs the same on any board size. The map is one textured quad; its
+ *      shader also outlines the part of the board the camera sees.
+*/
+
+#pragma once
+
+#include "Arena.h"
+#include "Camera.h"
+#include "GlResources.h"
+#include <cstdint>
+
+const int MINIMAP_PIXELS = 192;           // size on screen
+const int MINIMAP_MARGIN = 12;            // distance from the top right corner
+
+class Minimap {
+public:
+    // Needs a current OpenGL 3.3 context; uploads the whole board once
+    void init(const ArenaState& arena);
+    // Call after every stepArena to update the cells that changed
+    void noteTick(const ArenaState& arena);
+    // Call after initArena started a new game on a board of the same size; uploads the whole
+    // board into the same texture
+    void noteRestart(const ArenaState& arena);
+    // Draws the map into the top right corner of a framebuffer of the given size
+    void draw(int framebufferWidth, int framebufferHeight, const Camera& camera);
+    void release();
+    // Texels written by the last noteTick
+    uint32_t lastUpdates() const { return updates; }
+
+private:
+    uint8_t texel(const ArenaState& arena, ArenaCell cell) const;
+
+    GlRegistry registry;          // everything below, made by init() and kept across restarts
+    unsigned int texture = 0;
+    unsigned int program = 0;
+    unsigned int vao = 0;         // empty; the quad's corners come from gl_VertexID
+    int boardWidth = 0;
+    int boardHeight = 0;
+    bool player = false;
+    uint32_t updates = 0;
+};
@@ -0,0 +1,182 @@
+/*
+ * Title: UDP socket helpers
+ * Description: Implementation of the non-blocking UDP wrapper declared in Net.h.
+*/
+
+#include "Net.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+bool operator==(const NetAddress& a, const NetAddress& b) {
+    return a.host == b.host && a.port == b.port;
+}
+
+/*
+ * This function initializes the socket library. It only does work on Windows
+ * and is safe to call more than once.
+ * @return true if sockets can be used
+*/
+
+bool netInit() {
+#ifdef _WIN32
+    static bool initialized = false;
+    if (!initialized) {
+        WSADATA data;
+        initialized = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }
+    return initialized;
+#else
+    return true;
+#endif
+}
+
+/*
+ * This function parses "host:port" (or just "port", meaning localhost) into an address
+ * @param text: the address as typed on the command line
+ * @param address: receives the parsed address
+ * @return true if the text could be parsed and the host resolved
+*/
+
+bool parseAddress(const std::string& text, NetAddress& address) {
+    std::string host = "127.0.0.1";
+    std::string port = text;
+    size_t colon = text.rfind(':');
+    if (colon != std::string::npos) {
+        host = text.substr(0, colon);
+        port = text.substr(colon + 1);
+    }
+    int portNumber = atoi(port.c_str());
+    if (portNumber <= 0 || portNumber > 65535) {
+        return false;
+    }
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+        return false;
+    }
+    address.host = reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr.s_addr;
+    address.port = htons(static_cast<uint16_t>(portNumber));
+    freeaddrinfo(result);
+    return true;
+}
+
+std::string addressToString(const NetAddress& address) {
+    char text[32];
+    uint32_t host = ntohl(address.host);
+    snprintf(text, sizeof(text), "%u.%u.%u.%u:%u", host >> 24, (host >> 16) & 255, (host >> 8) & 255, host & 255, ntohs(address.port));
+    return text;
+}
+
+sockaddr_in toSockaddr(const NetAddress& address) {
+    sockaddr_in result;
+    memset(&result, 0, sizeof(result));
+    result.sin_family = AF_INET;
+    result.sin_addr.s_addr = address.host;
+    result.sin_port = address.port;
+    return result;
+}
+
+NetAddress fromSockaddr(const sockaddr_in& address) {
+    NetAddress result;
+    result.host = address.sin_addr.s_addr;
+    result.port = address.sin_port;
+    return result;
+}
+
+UdpSocket::~UdpSocket() {
+    close();
+}
+
+/*
+ * This function opens a non-blocking UDP socket bound to all interfaces
+ * @param port: local port to bind, 0 lets the system pick one
+ * @return true if the socket was opened and bound
+*/
+
+bool UdpSocket::open(uint16_t port) {
+    close();
+    if (!netInit()) {
+        return false;
+    }
+    socketHandle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#ifdef _WIN32
+    if (socketHandle == INVALID_SOCKET) {
+        return false;
+    }
+    u_long nonBlocking = 1;
+    ioctlsocket(socketHandle, FIONBIO, &nonBlocking);
+#else
+    if (socketHandle < 0) {
+        return false;
+    }
+    fcntl(socketHandle, F_SETFL, fcntl(socketHandle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    if (bind(socketHandle, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void UdpSocket::close() {
+#ifdef _WIN32
+    if (socketHandle != INVALID_SOCKET) {
+        closesocket(socketHandle);
+        socketHandle = INVALID_SOCKET;
+    }
+#else
+    if (socketHandle >= 0) {
+        ::close(socketHandle);
+        socketHandle = -1;
+    }
+#endif
+}
+
+bool UdpSocket::send(const NetAddress& to, const void* data, size_t size) {
+    sockaddr_in address = toSockaddr(to);
+    int sent = sendto(socketHandle, static_cast<const char*>(data), static_cast<int>(size), 0,
+        reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    return sent == static_cast<int>(size);
+}
+
+int UdpSocket::receive(NetAddress& from, void* buffer, size_t capacity) {
+    sockaddr_in address;
+    socklen_t length = sizeof(address);
+    int received = recvfrom(socketHandle, static_cast<char*>(buffer), static_cast<int>(capacity), 0,
+        reinterpret_cast<sockaddr*>(&address), &length);
+    if (received < 0) {
+        return -1;
+    }
+    from = fromSockaddr(address);
+    return received;
+}
+
+uint16_t UdpSocket::localPort() const {
+    sockaddr_in address;
+    socklen_t length = sizeof(address);
+    if (getsockname(socketHandle, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        return 0;
+    }
+    return ntohs(address.sin_port);
+}
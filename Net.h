@@ -0,0 +1,58 @@
+/*
+ * Title: UDP socket helpers
+ * Description: Small non-blocking UDP wrapper over BSD sockets / Winsock used by netplay
+ *      and the headless server tools.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+#else
+#include <netinet/in.h>
+typedef int SocketHandle;
+#endif
+
+// IPv4 address and port in network byte order
+struct NetAddress {
+    uint32_t host = 0;
+    uint16_t port = 0;
+};
+
+bool operator==(const NetAddress& a, const NetAddress& b);
+
+bool netInit();
+bool parseAddress(const std::string& text, NetAddress& address);
+std::string addressToString(const NetAddress& address);
+sockaddr_in toSockaddr(const NetAddress& address);
+NetAddress fromSockaddr(const sockaddr_in& address);
+
+// Non-blocking UDP socket bound to a local port
+class UdpSocket {
+public:
+    UdpSocket() = default;
+    ~UdpSocket();
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    bool open(uint16_t port);
+    void close();
+    bool send(const NetAddress& to, const void* data, size_t size);
+    // Returns the number of bytes received, or -1 when nothing is waiting
+    int receive(NetAddress& from, void* buffer, size_t capacity);
+    SocketHandle handle() const { return socketHandle; }
+    uint16_t localPort() const;
+
+private:
+#ifdef _WIN32
+    SocketHandle socketHandle = INVALID_SOCKET;
+#else
+    SocketHandle socketHandle = -1;
+#endif
+};
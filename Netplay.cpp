@@ -0,0 +1,285 @@
+/*
+ * Title: Rollback netplay
+ * Description: Implementation of the UDP rollback session declared in Netplay.h.
+ *
+ * Packet layout (all integers little endian):
+ *      HELLO: magic(4) type(1) player(1) seed(4)
+ *      INPUT: magic(4) type(1) ack(4) firstFrame(4) count(1) directions(count)
+ *      ack is the number of ticks of the receiver's inputs the sender already has.
+*/
+
+#include "Netplay.h"
+#include <algorithm>
+
+const uint32_t NETPLAY_MAGIC = 0x4E4B4E53; // "SNKN"
+const unsigned char PACKET_HELLO = 1;
+const unsigned char PACKET_INPUT = 2;
+const int HELLO_INTERVAL_MS = 100;
+
+// Little endian helpers for reading and writing packet fields
+static void writeU32(unsigned char* out, uint32_t value) {
+    out[0] = value & 255;
+    out[1] = (value >> 8) & 255;
+    out[2] = (value >> 16) & 255;
+    out[3] = (value >> 24) & 255;
+}
+
+static uint32_t readU32(const unsigned char* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | (uint32_t(in[3]) << 24);
+}
+
+// Direction each player starts with; used for the ticks before the first delayed input
+static Direction startDirection(int player) {
+    return player == 0 ? RIGHT : LEFT;
+}
+
+/*
+ * This function opens the socket and prepares the session for the handshake
+ * @param localPort: UDP port to listen on
+ * @param remote: address of the other player
+ * @param localPlayer: 0 or 1; player 0 decides the random seed
+ * @param seedValue: seed for the game, only used by player 0
+ * @return true if the socket could be opened
+*/
+
+bool NetplaySession::start(uint16_t localPort, const NetAddress& remote, int localPlayer, uint32_t seedValue) {
+    if (!socket.open(localPort)) {
+        return false;
+    }
+    remoteAddress = remote;
+    localIndex = localPlayer;
+    // player 1 waits to learn the seed, so a seed of 0 means "unknown"
+    seed = localPlayer == 0 ? (seedValue != 0 ? seedValue : 1) : 0;
+    connected = false;
+    lastHello = std::chrono::steady_clock::time_point();
+
+    currentFrame = 0;
+    remoteConfirmed = INPUT_DELAY;
+    localScheduled = INPUT_DELAY;
+    remoteAck = INPUT_DELAY;
+    rollbackFrame = UINT32_MAX;
+    counters = NetplayStats();
+    // Nobody can have pressed anything for the first INPUT_DELAY ticks
+    for (int p = 0; p < MAX_PLAYERS; p++) {
+        for (int f = 0; f < INPUT_HISTORY; f++) {
+            inputs[p][f] = startDirection(p);
+        }
+    }
+    return true;
+}
+
+/*
+ * This function receives every waiting packet and, while connecting, re-sends the handshake
+*/
+
+void NetplaySession::poll() {
+    unsigned char buffer[512];
+    NetAddress from;
+    int size;
+    while ((size = socket.receive(from, buffer, sizeof(buffer))) >= 0) {
+        if (from == remoteAddress) {
+            handlePacket(buffer, size);
+        }
+    }
+
+    if (!connected) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastHello >= std::chrono::milliseconds(HELLO_INTERVAL_MS)) {
+            lastHello = now;
+            sendHello();
+        }
+    }
+}
+
+/*
+ * This function simulates one tick. The local input is scheduled INPUT_DELAY ticks ahead,
+ * any pending correction is applied, and then the next tick is simulated using the latest
+ * confirmed remote direction as the prediction for ticks we have not heard about yet.
+ * @param localInput: direction the local player is holding this tick
+ * @param events: receives what happened in the newly simulated tick, may be null
+ * @return false if the session stalled waiting for the remote player
+*/
+
+bool NetplaySession::advance(Direction localInput, TickEvents* events) {
+    poll();
+    if (!connected) {
+        return false;
+    }
+
+    // Never get so far ahead that the oldest unconfirmed tick falls out of the snapshot ring
+    if (currentFrame + 1 >= remoteConfirmed + ROLLBACK_WINDOW) {
+        counters.stalls++;
+        sendInputs();
+        return false;
+    }
+
+    if (localScheduled == currentFrame + INPUT_DELAY) {
+        inputs[localIndex][localScheduled % INPUT_HISTORY] = localInput;
+        localScheduled++;
+    }
+    sendInputs();
+
+    synchronize();
+    simulateFrame(currentFrame, events);
+    currentFrame++;
+    return true;
+}
+
+/*
+ * This function rolls back to the earliest mispredicted tick and re-simulates up to the present
+*/
+
+void NetplaySession::synchronize() {
+    if (rollbackFrame == UINT32_MAX || rollbackFrame >= currentFrame) {
+        rollbackFrame = UINT32_MAX;
+        return;
+    }
+
+    uint32_t depth = currentFrame - rollbackFrame;
+    counters.rollbacks++;
+    counters.resimulatedTicks += depth;
+    counters.maxRollbackDepth = std::max(counters.maxRollbackDepth, static_cast<int>(depth));
+
+    // Assigning into the existing state reuses the vectors' storage, so no allocation here
+    current = snapshots[rollbackFrame % ROLLBACK_WINDOW];
+    for (uint32_t f = rollbackFrame; f < currentFrame; f++) {
+        simulateFrame(f, nullptr);
+    }
+    rollbackFrame = UINT32_MAX;
+}
+
+/*
+ * This function keeps the connection going without simulating, e.g. while quitting
+*/
+
+void NetplaySession::flush() {
+    poll();
+    if (connected) {
+        sendInputs();
+    }
+}
+
+/*
+ * This function starts the game once both players agree on the seed. The snapshots get the
+ * same room for the snakes as the game, so saving one never allocates.
+*/
+
+void NetplaySession::startGame() {
+    initGame(current, 2, seed);
+    for (GameState& snapshot : snapshots) {
+        snapshot = current;
+        reserveGame(snapshot);
+    }
+    connected = true;
+}
+
+/*
+ * This function saves the snapshot for a tick and simulates it
+ * @param frame: tick to simulate; current must hold the state before it
+ * @param events: receives the tick's events, may be null
+*/
+
+void NetplaySession::simulateFrame(uint32_t frame, TickEvents* events) {
+    snapshots[frame % ROLLBACK_WINDOW] = current;
+
+    int remoteIndex = 1 - localIndex;
+    if (frame >= remoteConfirmed) {
+        // Predict that the remote player keeps the last direction we know about
+        inputs[remoteIndex][frame % INPUT_HISTORY] = inputs[remoteIndex][(remoteConfirmed - 1) % INPUT_HISTORY];
+    }
+
+    Direction tickInputs[MAX_PLAYERS];
+    tickInputs[0] = inputs[0][frame % INPUT_HISTORY];
+    tickInputs[1] = inputs[1][frame % INPUT_HISTORY];
+    TickEvents tickEvents = stepGame(current, tickInputs);
+    if (events != nullptr) {
+        *events = tickEvents;
+    }
+}
+
+void NetplaySession::sendHello() {
+    unsigned char packet[10];
+    writeU32(packet, NETPLAY_MAGIC);
+    packet[4] = PACKET_HELLO;
+    packet[5] = static_cast<unsigned char>(localIndex);
+    writeU32(packet + 6, seed);
+    socket.send(remoteAddress, packet, sizeof(packet));
+    counters.packetsSent++;
+}
+
+/*
+ * This function sends every local input the remote has not acknowledged yet
+*/
+
+void NetplaySession::sendInputs() {
+    uint32_t first = std::max(remoteAck, localScheduled > MAX_INPUTS_PER_PACKET ? localScheduled - MAX_INPUTS_PER_PACKET : 0u);
+    uint32_t count = localScheduled - first;
+
+    unsigned char packet[14 + MAX_INPUTS_PER_PACKET];
+    writeU32(packet, NETPLAY_MAGIC);
+    packet[4] = PACKET_INPUT;
+    writeU32(packet + 5, remoteConfirmed);
+    writeU32(packet + 9, first);
+    packet[13] = static_cast<unsigned char>(count);
+    for (uint32_t i = 0; i < count; i++) {
+        packet[14 + i] = static_cast<unsigned char>(inputs[localIndex][(first + i) % INPUT_HISTORY]);
+    }
+    socket.send(remoteAddress, packet, 14 + count);
+    counters.packetsSent++;
+}
+
+/*
+ * This function handles one packet from the remote player
+ * @param data: packet bytes
+ * @param size: packet size in bytes
+*/
+
+void NetplaySession::handlePacket(const unsigned char* data, int size) {
+    if (size < 5 || readU32(data) != NETPLAY_MAGIC) {
+        return;
+    }
+    counters.packetsReceived++;
+
+    if (data[4] == PACKET_HELLO && size >= 10) {
+        uint32_t remoteSeed = readU32(data + 6);
+        if (localIndex == 1) {
+            // Player 1 adopts player 0's seed and answers with it so player 0 knows it arrived
+            if (!connected && data[5] == 0) {
+                seed = remoteSeed;
+                startGame();
+            }
+            sendHello();
+        }
+        else if (!connected && remoteSeed == seed) {
+            startGame();
+        }
+        return;
+    }
+
+    if (data[4] != PACKET_INPUT || size < 14 || !connected) {
+        return;
+    }
+    uint32_t ack = readU32(data + 5);
+    uint32_t first = readU32(data + 9);
+    uint32_t count = data[13];
+    if (size < static_cast<int>(14 + count)) {
+        return;
+    }
+    remoteAck = std::max(remoteAck, std::min(ack, localScheduled));
+
+    int remoteIndex = 1 - localIndex;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t frame = first + i;
+        // Only accept the next tick we are missing, which keeps confirmed inputs contiguous
+        if (frame != remoteConfirmed || data[14 + i] > RIGHT) {
+            continue;
+        }
+        Direction actual = static_cast<Direction>(data[14 + i]);
+        Direction& slot = inputs[remoteIndex][frame % INPUT_HISTORY];
+        if (frame < currentFrame && slot != actual) {
+            rollbackFrame = std::min(rollbackFrame, frame);
+        }
+        slot = actual;
+        remoteConfirmed++;
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * Title: Rollback netplay
+ * Description: Two-player head-to-head session over UDP. Both peers run the deterministic
+ *      simulation from Game.h on the same inputs. The remote player's direction is predicted
+ *      (it keeps its last known direction); when the real input arrives and differs, the
+ *      session restores the snapshot taken before that tick and re-simulates up to the present.
+*/
+
+#pragma once
+
+#include "Game.h"
+#include "Net.h"
+#include <chrono>
+
+const int ROLLBACK_WINDOW = 16;        // snapshots kept, i.e. how far back a correction can reach
+const int INPUT_DELAY = 2;             // local inputs are scheduled this many ticks ahead
+const int INPUT_HISTORY = 64;          // ring size for per-tick inputs of both players
+const int MAX_INPUTS_PER_PACKET = 32;  // unacknowledged inputs resent in every packet
+
+// Counters that show how much work rollback is doing
+struct NetplayStats {
+    int rollbacks = 0;            // number of times a misprediction forced a rollback
+    int resimulatedTicks = 0;     // total ticks re-run because of rollbacks
+    int maxRollbackDepth = 0;     // longest single rollback in ticks
+    int stalls = 0;               // ticks skipped waiting for the remote player
+    int packetsSent = 0;
+    int packetsReceived = 0;
+};
+
+class NetplaySession {
+public:
+    bool start(uint16_t localPort, const NetAddress& remote, int localPlayer, uint32_t seed);
+    // Reads every waiting packet and keeps the handshake going; call once per frame
+    void poll();
+    bool isConnected() const { return connected; }
+    // Simulates one tick with the given local direction. Returns false (and does not
+    // simulate) if the remote player is too far behind for a rollback to catch up.
+    bool advance(Direction localInput, TickEvents* events);
+    // Re-simulates from the earliest mispredicted tick, if any, without advancing
+    void synchronize();
+    // Receives packets and re-sends unacknowledged inputs without simulating
+    void flush();
+
+    const GameState& state() const { return current; }
+    int localPlayer() const { return localIndex; }
+    uint32_t frame() const { return currentFrame; }
+    // Number of ticks for which the remote input is known for certain
+    uint32_t confirmedFrames() const { return remoteConfirmed; }
+    const NetplayStats& stats() const { return counters; }
+
+private:
+    void sendHello();
+    void sendInputs();
+    void handlePacket(const unsigned char* data, int size);
+    void simulateFrame(uint32_t frame, TickEvents* events);
+    void startGame();
+
+    UdpSocket socket;
+    NetAddress remoteAddress;
+    int localIndex = 0;
+    uint32_t seed = 0;
+    bool connected = false;
+    std::chrono::steady_clock::time_point lastHello;
+
+    GameState current;
+    GameState snapshots[ROLLBACK_WINDOW];       // snapshots[f % ROLLBACK_WINDOW] is the state before tick f
+    Direction inputs[MAX_PLAYERS][INPUT_HISTORY];
+    uint32_t currentFrame = 0;                  // next tick to simulate
+    uint32_t localScheduled = 0;                // local inputs are known for ticks < localScheduled
+    uint32_t remoteConfirmed = 0;               // remote inputs are known for ticks < remoteConfirmed
+    uint32_t remoteAck = 0;                     // the remote has our inputs for ticks < remoteAck
+    uint32_t rollbackFrame = UINT32_MAX;        // earliest tick simulated with a wrong prediction
+    NetplayStats counters;
+};
@@ -0,0 +1,125 @@
+/*
+ * Title: Observations
+ * Description: Implementation of the batched offscreen rendering declared in Observations.h.
+*/
+
+#include "Observations.h"
+#include "Log.h"
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <cstring>
+
+const GLuint64 FENCE_TIMEOUT_NS = 1000000000; // a second, between checks while waiting
+
+bool ObservationRenderer::init(int width, int height, int games) {
+    tileWidth = width;
+    tileHeight = height;
+    maxGames = games;
+    columns = (int)std::ceil(std::sqrt((double)games));
+    int rows = (games + columns - 1) / columns;
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if (columns * tileWidth > maxSize || rows * tileHeight > maxSize) {
+        LOG_ERROR("%d tiles of %dx%d do not fit in a %dx%d framebuffer", games, width, height, maxSize, maxSize);
+        return false;
+    }
+    renderer.init();
+
+    // One texture holding every tile
+    GLuint color = registry.create(GL_OBJECT_TEXTURE);
+    glBindTexture(GL_TEXTURE_2D, color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, columns * tileWidth, rows * tileHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    framebuffer = registry.create(GL_OBJECT_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+
+    // A pixel buffer per slot, big enough for every tile
+    for (Slot& slot : slots) {
+        slot.buffer = registry.create(GL_OBJECT_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)columns * tileWidth * rows * tileHeight * 3, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    nextSlot = 0;
+    waitingSlots = 0;
+    return true;
+}
+
+bool ObservationRenderer::submit(const GameState* games, int count) {
+    if (waitingSlots == OBSERVATION_SLOTS || count <= 0 || count > maxGames) {
+        return false;
+    }
+    glm::mat4 projection = glm::ortho(0.0f, windowWIDTH, 0.0f, windowHEIGHT);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    // Each game in its own tile, left to right from the bottom row of tiles up
+    for (int i = 0; i < count; i++) {
+        glViewport((i % columns) * tileWidth, (i / columns) * tileHeight, tileWidth, tileHeight);
+        renderer.drawBackground(projection);
+        renderer.drawBoard(games[i], projection);
+    }
+
+    // Only the rows of tiles in use are read back
+    Slot& slot = slots[nextSlot];
+    slot.count = count;
+    slot.rows = (count + columns - 1) / columns;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, columns * tileWidth, slot.rows * tileHeight, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    nextSlot = (nextSlot + 1) % OBSERVATION_SLOTS;
+    waitingSlots++;
+    return true;
+}
+
+int ObservationRenderer::receive(unsigned char* const* observations) {
+    if (waitingSlots == 0) {
+        return 0;
+    }
+    Slot& slot = slots[(nextSlot + OBSERVATION_SLOTS - waitingSlots) % OBSERVATION_SLOTS];
+    GLsync fence = (GLsync)slot.fence;
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS) == GL_TIMEOUT_EXPIRED) {
+        // still drawing or copying
+    }
+    glDeleteSync(fence);
+    slot.fence = nullptr;
+    waitingSlots--;
+
+    size_t rowBytes = (size_t)tileWidth * 3;
+    size_t stride = (size_t)columns * rowBytes;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+        (GLsizeiptr)stride * slot.rows * tileHeight, GL_MAP_READ_BIT);
+    if (pixels == nullptr) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        LOG_ERROR("Could not map the observations' pixel buffer");
+        return 0;
+    }
+    // GL rows go bottom up; the observations go top down
+    for (int i = 0; i < slot.count; i++) {
+        const unsigned char* tile = pixels + (size_t)(i / columns) * tileHeight * stride + (i % columns) * rowBytes;
+        for (int y = 0; y < tileHeight; y++) {
+            memcpy(observations[i] + (size_t)y * rowBytes, tile + (size_t)(tileHeight - 1 - y) * stride, rowBytes);
+        }
+    }
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return slot.count;
+}
+
+void ObservationRenderer::release() {
+    for (Slot& slot : slots) {
+        if (slot.fence != nullptr) {
+            glDeleteSync((GLsync)slot.fence);
+            slot.fence = nullptr;
+        }
+    }
+    waitingSlots = 0;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    renderer.release();
+    registry.release();
+}
@@ -0,0 +1,60 @@
+/*
+ * Title: Observations
+ * Description: Renders many classic games at once without a window, as RGB pictures for agents
+ *      that learn from pixels. Needs a current OpenGL 3.3 context, such as the headless EGL one
+ *      of HeadlessGL.h, which runs on llvmpipe where there is no GPU.
+ *
+ *      A batch of games is drawn in one pass into one large framebuffer, each game into its own
+ *      tile with the ClassicRenderer, and the tiles in use are read back with one glReadPixels
+ *      into a pixel buffer object. That call returns at once; a fence marks when the copy is
+ *      done, and receive() only waits on it then, so the caller can step its games or submit
+ *      the next batch while the last one is still being drawn and copied. receive() cuts the
+ *      tiles out into the caller's buffers, one per game, top row first.
+*/
+
+#pragma once
+
+#include "ClassicRenderer.h"
+#include "GlResources.h"
+
+const int OBSERVATION_SLOTS = 2;          // batches that can be waiting to be received
+
+class ObservationRenderer {
+public:
+    // Makes the renderer and a framebuffer with room for a batch of that many games' tiles;
+    // returns false if that is larger than the context allows
+    bool init(int width, int height, int games);
+    // Draws the games into their tiles and starts reading them back, without waiting.
+    // Returns false if OBSERVATION_SLOTS batches are already waiting to be received.
+    bool submit(const GameState* games, int count);
+    // Waits for the oldest batch submitted and copies game i's picture into observations[i],
+    // width() * height() * 3 bytes, RGB, top row first. Returns the number of games, or 0 if
+    // no batch was waiting.
+    int receive(unsigned char* const* observations);
+    void release();
+
+    int width() const { return tileWidth; }
+    int height() const { return tileHeight; }
+    // Batches submitted and not yet received
+    int waiting() const { return waitingSlots; }
+
+private:
+    // A batch being read back
+    struct Slot {
+        unsigned int buffer = 0;  // the pixel buffer object
+        void* fence = nullptr;    // GLsync of the readback
+        int count = 0;
+        int rows = 0;             // rows of tiles read back
+    };
+
+    ClassicRenderer renderer;
+    GlRegistry registry;
+    Slot slots[OBSERVATION_SLOTS];
+    unsigned int framebuffer = 0;
+    int tileWidth = 0;
+    int tileHeight = 0;
+    int columns = 0;
+    int maxGames = 0;
+    int nextSlot = 0;
+    int waitingSlots = 0;
+};
@@ -0,0 +1,369 @@
+/*
+ * Title: Particles
+ * Description: Implementation of the particle system declared in Particles.h.
+*/
+
+#include "Particles.h"
+#include "Shader.h"
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PARTICLES_SSE 1
+#endif
+
+const float PARTICLE_DRAG = 0.15f;        // fraction of its speed a particle keeps after a second
+const float EMISSION_SHRINK = 0.9f;       // per frame over budget
+const float EMISSION_GROWTH = 1.02f;      // per frame comfortably under budget
+const float FRAME_SMOOTHING = 0.2f;       // weight of a new frame time in the average
+const int SPLAT_DIVISOR = 2;              // the splat image is this many times smaller than the viewport
+
+// A particle's components. Position and velocity keep x and y side by side, so one SSE
+// register holds two particles of them.
+struct SparkPosition { float x, y; };
+struct SparkVelocity { float x, y; };
+struct SparkAge { float seconds; };
+struct SparkLife { float inverse; };      // 1 / lifetime in seconds
+struct SparkFade { float value; };        // age / life, 0 when born, 1 when gone
+struct SparkColor { uint32_t rgba; };     // bytes in R, G, B, A order
+
+// Renderers that rasterize on the CPU, where points are expensive
+static const char* softwareRenderers[] = { "llvmpipe", "softpipe", "SwiftShader", "GDI Generic" };
+
+// Vertices come from the particles' arrays: positions, fades and colors each fill one part
+// of the buffer
+static const char* particleVertexSource = R"glsl(
+    #version 330 core
+    layout (location = 0) in vec2 position;
+    layout (location = 2) in float fade;
+    layout (location = 3) in vec4 particleColor;
+    uniform mat4 projection;
+    uniform float size;                       // in pixels
+    out vec4 color;
+    void main() {
+        gl_Position = projection * vec4(position, 0.0, 1.0);
+        gl_PointSize = size * (1.0 - 0.5 * fade);
+        color = vec4(particleColor.rgb, particleColor.a * (1.0 - fade));
+    }
+)glsl";
+
+// A soft round dot
+static const char* particleFragmentSource = R"glsl(
+    #version 330 core
+    in vec4 color;
+    out vec4 FragColor;
+    void main() {
+        vec2 local = gl_PointCoord * 2.0 - 1.0;
+        float falloff = 1.0 - dot(local, local);
+        if (falloff <= 0.0)
+            discard;
+        FragColor = vec4(color.rgb, color.a * falloff);
+    }
+)glsl";
+
+// The splat image over the whole viewport; linear filtering softens each texel into a dot
+static const char* splatVertexSource = R"glsl(
+    #version 330 core
+    out vec2 uv;
+    void main() {
+        vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+        uv = corner;
+        gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+    }
+)glsl";
+
+static const char* splatFragmentSource = R"glsl(
+    #version 330 core
+    in vec2 uv;
+    out vec4 FragColor;
+    uniform sampler2D splat;
+    void main() {
+        FragColor = texture(splat, uv);
+    }
+)glsl";
+
+void ParticleSystem::init(int capacity) {
+    this->capacity = capacity;
+    world.clear();
+    world.reserve<SparkPosition, SparkVelocity, SparkAge, SparkLife, SparkFade, SparkColor>(capacity);
+    dying.clear();
+    dying.reserve(capacity);
+
+    program = registry.add(GlProgram(createShaderProgram(particleVertexSource, particleFragmentSource)));
+    projectionLocation = glGetUniformLocation(program, "projection");
+    sizeLocation = glGetUniformLocation(program, "size");
+    vertexBuffer = registry.create(GL_OBJECT_BUFFER);
+    vao = registry.create(GL_OBJECT_VERTEX_ARRAY);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, size_t(capacity) * 4 * sizeof(float), nullptr, GL_STREAM_DRAW);
+    // positions take the first half, fades and colors a quarter each
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SparkPosition), (void*)0);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(SparkFade), (void*)(size_t(capacity) * 2 * sizeof(float)));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SparkColor), (void*)(size_t(capacity) * 3 * sizeof(float)));
+    for (int attribute : { 0, 2, 3 }) {
+        glEnableVertexAttribArray(attribute);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    splatProgram = registry.add(GlProgram(createShaderProgram(splatVertexSource, splatFragmentSource)));
+    splatVAO = registry.create(GL_OBJECT_VERTEX_ARRAY);
+    splatTexture = registry.create(GL_OBJECT_TEXTURE);
+    glBindTexture(GL_TEXTURE_2D, splatTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    splatWidth = splatHeight = 0;
+
+    drawMode = PARTICLE_DRAW_POINTS;
+    const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    for (const char* name : softwareRenderers) {
+        if (renderer != nullptr && strstr(renderer, name) != nullptr) {
+            drawMode = PARTICLE_DRAW_SPLAT;
+        }
+    }
+}
+
+/*
+ * This function returns a random number in [0, 1) from the pool's own xorshift generator, so
+ * effects never touch the game's random state
+*/
+
+float ParticleSystem::random() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return (randomState >> 8) * (1.0f / 16777216.0f);
+}
+
+void ParticleSystem::emit(glm::vec2 position, int count, float speed, float life, uint32_t color) {
+    int wanted = static_cast<int>(count * counters.emission + 0.5f);
+    int room = capacity - static_cast<int>(world.size());
+    int emitted = std::min(wanted, room);
+    counters.dropped += count - std::max(emitted, 0);
+    // 0xRRGGBBAA to bytes in R, G, B, A order
+    uint32_t packed = (color >> 24) | ((color >> 8) & 0xFF00) | ((color << 8) & 0xFF0000) | (color << 24);
+    for (int i = 0; i < emitted; i++) {
+        float angle = random() * 6.2831853f, velocity = speed * (0.3f + 0.7f * random());
+        float inverseLife = 1.0f / (life * (0.6f + 0.4f * random()));
+        world.create(SparkPosition{ position.x, position.y },
+            SparkVelocity{ std::cos(angle) * velocity, std::sin(angle) * velocity },
+            SparkAge{ 0.0f }, SparkLife{ inverseLife }, SparkFade{ 0.0f }, SparkColor{ packed });
+    }
+    if (emitted > 0) {
+        counters.emitted += emitted;
+        counters.live = static_cast<uint32_t>(world.size());
+        changes++;
+    }
+}
+
+/*
+ * This function moves the count particles of one chunk, ages them and adds the ones that
+ * burnt out to dying. Chunk columns start on 16 byte boundaries but hold any number of
+ * particles, so the vector loop leaves the last few to the scalar one.
+*/
+
+static void integrate(uint32_t count, const Entity* entities, SparkPosition* position, SparkVelocity* velocity,
+    SparkAge* age, const SparkLife* life, SparkFade* fade, float deltaTime, float drag, bool vectorized,
+    std::vector<Entity>& dying) {
+    uint32_t i = 0;
+#ifdef PARTICLES_SSE
+    if (vectorized) {
+        float* positions = &position[0].x;
+        float* velocities = &velocity[0].x;
+        __m128 dt = _mm_set1_ps(deltaTime), keep = _mm_set1_ps(drag), one = _mm_set1_ps(1.0f);
+        for (; i + 4 <= count; i += 4) {
+            // a few lines ahead in every column; past the end of a column this only warms
+            // the next one
+            _mm_prefetch(reinterpret_cast<const char*>(&positions[2 * i + 64]), _MM_HINT_T0);
+            _mm_prefetch(reinterpret_cast<const char*>(&velocities[2 * i + 64]), _MM_HINT_T0);
+            _mm_prefetch(reinterpret_cast<const char*>(&age[i + 32]), _MM_HINT_T0);
+            _mm_prefetch(reinterpret_cast<const char*>(&life[i + 32]), _MM_HINT_T0);
+            _mm_prefetch(reinterpret_cast<const char*>(&fade[i + 32]), _MM_HINT_T0);
+            // x and y of four particles take two registers
+            for (uint32_t half = 2 * i; half < 2 * i + 8; half += 4) {
+                __m128 moving = _mm_mul_ps(_mm_loadu_ps(&velocities[half]), keep);
+                _mm_storeu_ps(&velocities[half], moving);
+                _mm_storeu_ps(&positions[half], _mm_add_ps(_mm_loadu_ps(&positions[half]), _mm_mul_ps(moving, dt)));
+            }
+            __m128 older = _mm_add_ps(_mm_loadu_ps(&age[i].seconds), dt);
+            __m128 faded = _mm_mul_ps(older, _mm_loadu_ps(&life[i].inverse));
+            _mm_storeu_ps(&age[i].seconds, older);
+            _mm_storeu_ps(&fade[i].value, faded);
+            int burnt = _mm_movemask_ps(_mm_cmpge_ps(faded, one));
+            for (uint32_t lane = 0; burnt != 0; lane++, burnt >>= 1) {
+                if (burnt & 1) {
+                    dying.push_back(entities[i + lane]);
+                }
+            }
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        velocity[i].x *= drag;
+        velocity[i].y *= drag;
+        position[i].x += velocity[i].x * deltaTime;
+        position[i].y += velocity[i].y * deltaTime;
+        age[i].seconds += deltaTime;
+        fade[i].value = age[i].seconds * life[i].inverse;
+        if (fade[i].value >= 1.0f) {
+            dying.push_back(entities[i]);
+        }
+    }
+}
+
+void ParticleSystem::update(float deltaTime) {
+    if (world.size() == 0) {
+        return;
+    }
+    float drag = std::pow(PARTICLE_DRAG, deltaTime);
+    world.each<SparkPosition, SparkVelocity, SparkAge, SparkLife, SparkFade>(
+        [&](uint32_t count, Entity* entities, SparkPosition* position, SparkVelocity* velocity, SparkAge* age, SparkLife* life, SparkFade* fade) {
+            integrate(count, entities, position, velocity, age, life, fade, deltaTime, drag, vectorized, dying);
+        });
+    // the world moves its last particle into each freed row; the order doesn't matter with
+    // additive blending, and the handles stay good however the rows move
+    for (Entity entity : dying) {
+        world.destroy(entity);
+    }
+    dying.clear();
+    counters.live = static_cast<uint32_t>(world.size());
+    changes++;
+}
+
+/*
+ * This function draws every live particle at once
+ * @param projection: world to clip space, as the rest of the scene uses
+ * @param size: diameter of a new particle in pixels, for points
+*/
+
+void ParticleSystem::draw(const glm::mat4& projection, float size) {
+    counters.live = static_cast<uint32_t>(world.size());
+    if (world.size() == 0) {
+        return;
+    }
+    if (drawMode == PARTICLE_DRAW_SPLAT) {
+        drawSplat(projection);
+    }
+    else {
+        drawPoints(projection, size);
+    }
+}
+
+/*
+ * This function copies the position, fade and color arrays of every chunk into the vertex
+ * buffer, one chunk after another, and draws them as points. The buffer is mapped rather
+ * than filled with a glBufferSubData per chunk and array.
+*/
+
+void ParticleSystem::drawPoints(const glm::mat4& projection, float size) {
+    size_t region = size_t(capacity) * sizeof(float);
+    uint32_t count = static_cast<uint32_t>(world.size());
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    unsigned char* vertices = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, 4 * region,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (vertices == nullptr) {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+    size_t written = 0;
+    world.each<SparkPosition, SparkFade, SparkColor>(
+        [&](uint32_t chunkCount, Entity*, SparkPosition* position, SparkFade* fade, SparkColor* color) {
+            memcpy(vertices + written * sizeof(SparkPosition), position, chunkCount * sizeof(SparkPosition));
+            memcpy(vertices + 2 * region + written * sizeof(SparkFade), fade, chunkCount * sizeof(SparkFade));
+            memcpy(vertices + 3 * region + written * sizeof(SparkColor), color, chunkCount * sizeof(SparkColor));
+            written += chunkCount;
+        });
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glUseProgram(program);
+    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform1f(sizeLocation, size);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+    glBindVertexArray(0);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+    glDisable(GL_BLEND);
+}
+
+/*
+ * This function adds every particle into the texel under it, brightness falling off with
+ * age, then uploads the image and draws it over the viewport. The projections used here
+ * only scale and move, so a particle's texel comes from the diagonal and the last column.
+*/
+
+void ParticleSystem::drawSplat(const glm::mat4& projection) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    int width = std::max(1, viewport[2] / SPLAT_DIVISOR), height = std::max(1, viewport[3] / SPLAT_DIVISOR);
+    glBindTexture(GL_TEXTURE_2D, splatTexture);
+    if (width != splatWidth || height != splatHeight) {
+        splatWidth = width;
+        splatHeight = height;
+        splatImage.resize(size_t(width) * height * 4);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    std::fill(splatImage.begin(), splatImage.end(), uint8_t(0));
+    float scaleX = 0.5f * width * projection[0][0], offsetX = 0.5f * width * (projection[3][0] + 1.0f);
+    float scaleY = 0.5f * height * projection[1][1], offsetY = 0.5f * height * (projection[3][1] + 1.0f);
+    world.each<SparkPosition, SparkFade, SparkColor>(
+        [&](uint32_t count, Entity*, SparkPosition* position, SparkFade* fade, SparkColor* color) {
+            for (uint32_t i = 0; i < count; i++) {
+                int tx = static_cast<int>(position[i].x * scaleX + offsetX), ty = static_cast<int>(position[i].y * scaleY + offsetY);
+                if (tx < 0 || ty < 0 || tx >= width || ty >= height) {
+                    continue;
+                }
+                const uint8_t* source = reinterpret_cast<const uint8_t*>(&color[i].rgba);
+                int brightness = static_cast<int>(source[3] * (1.0f - fade[i].value));
+                uint8_t* texel = &splatImage[(size_t(ty) * width + tx) * 4];
+                for (int channel = 0; channel < 3; channel++) {
+                    texel[channel] = static_cast<uint8_t>(std::min(255, texel[channel] + source[channel] * brightness / 255));
+                }
+            }
+        });
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, splatImage.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glUseProgram(splatProgram);
+    glUniform1i(glGetUniformLocation(splatProgram, "splat"), 0);
+    glActiveTexture(GL_TEXTURE0);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBindVertexArray(splatVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+}
+
+/*
+ * This function shrinks bursts quickly while the average frame time is over budget and lets
+ * them grow back slowly once it is clearly under
+*/
+
+void ParticleSystem::adapt(float frameMilliseconds, float budgetMilliseconds) {
+    averageFrame = averageFrame == 0.0f ? frameMilliseconds : averageFrame + FRAME_SMOOTHING * (frameMilliseconds - averageFrame);
+    if (averageFrame > budgetMilliseconds) {
+        counters.emission = std::max(PARTICLE_MIN_EMISSION, counters.emission * EMISSION_SHRINK);
+    }
+    else if (averageFrame < 0.85f * budgetMilliseconds) {
+        counters.emission = std::min(1.0f, counters.emission * EMISSION_GROWTH);
+    }
+}
+
+void ParticleSystem::release() {
+    registry.release();
+    vao = vertexBuffer = program = splatVAO = splatProgram = splatTexture = 0;
+    world.clear();
+    counters.live = 0;
+}
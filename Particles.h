@@ -0,0 +1,99 @@
+/*
+ * Title: Particles
+ * Description: Short-lived sparks for eating food and crashing. Each particle is an entity
+ *      of the system's own EntityWorld (Ecs.h) with a position, velocity, age, life, fade and
+ *      color component, so the particles sit in chunks with one flat array per component and
+ *      the update walks them four at a time with SSE, noting the ones that burn out as it
+ *      goes. Room for the full capacity is reserved once; a burnt out particle is destroyed
+ *      after the walk, which moves the last one into its row.
+ *
+ *      Every live particle is drawn with one draw call, in one of two ways:
+ *        points: one GL point per particle; the position, fade and color arrays of every
+ *           chunk are copied into the vertex buffer one after another. Nearly free on a GPU.
+ *        splat: each particle is added into one texel of a half resolution image on the CPU,
+ *           which is uploaded and drawn as a single quad. A software rasterizer such as
+ *           llvmpipe spends about half a microsecond setting up every point, so 100k points
+ *           would take 50 ms or more; the splat costs about the same for any count.
+ *      init() picks splat when the OpenGL renderer is a known software one.
+ *
+ *      Bursts are scaled by an emission factor that drops while the frame time stays over its
+ *      budget and recovers once it is back under, so effects thin out before the frame rate
+ *      does.
+*/
+
+#pragma once
+
+#include "Ecs.h"
+#include "GlResources.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+const int PARTICLE_CAPACITY = 131072;     // live particles at most
+const float PARTICLE_MIN_EMISSION = 0.05f; // bursts never shrink below this fraction
+
+enum ParticleDrawMode {
+    PARTICLE_DRAW_POINTS,
+    PARTICLE_DRAW_SPLAT
+};
+
+// What the particle system has done
+struct ParticleStats {
+    uint32_t live = 0;
+    uint64_t emitted = 0;
+    uint64_t dropped = 0;         // left out of bursts by the emission factor or a full pool
+    float emission = 1.0f;        // fraction of each burst that is emitted
+};
+
+class ParticleSystem {
+public:
+    // Needs a current OpenGL 3.3 context; allocates the pool and its instance buffer
+    void init(int capacity = PARTICLE_CAPACITY);
+    // Sends count particles out from position in every direction. speed is in world units
+    // per second, life in seconds, color 0xRRGGBBAA.
+    void emit(glm::vec2 position, int count, float speed, float life, uint32_t color);
+    // Moves the particles and removes the ones that burnt out
+    void update(float deltaTime);
+    // Draws every live particle into the current viewport with additive blending. Points are
+    // size pixels across; splats are soft dots of about two pixels whatever the size.
+    void draw(const glm::mat4& projection, float size);
+    // Feeds the time the last frame took; bursts shrink while it is over budget
+    void adapt(float frameMilliseconds, float budgetMilliseconds);
+    // Changes whenever the particles would look different, for FrameLayers
+    uint64_t version() const { return changes; }
+    // Updates one particle at a time instead of four, for comparisons
+    void setVectorized(bool enabled) { vectorized = enabled; }
+    void setDrawMode(ParticleDrawMode mode) { drawMode = mode; }
+    ParticleDrawMode mode() const { return drawMode; }
+    void release();
+    const ParticleStats& stats() const { return counters; }
+
+private:
+    float random();
+    void drawPoints(const glm::mat4& projection, float size);
+    void drawSplat(const glm::mat4& projection);
+
+    int capacity = 0;
+    EntityWorld world;            // one entity per live particle
+    std::vector<Entity> dying;    // burnt out during the update, destroyed once it is done
+
+    GlRegistry registry;          // both programs, vertex arrays, the vertex buffer and the splat texture
+    unsigned int program = 0;
+    unsigned int vao = 0;
+    unsigned int vertexBuffer = 0;
+    int projectionLocation = -1;
+    int sizeLocation = -1;
+
+    ParticleDrawMode drawMode = PARTICLE_DRAW_POINTS;
+    unsigned int splatProgram = 0;
+    unsigned int splatVAO = 0;    // empty; the quad's corners come from gl_VertexID
+    unsigned int splatTexture = 0;
+    int splatWidth = 0;
+    int splatHeight = 0;
+    std::vector<uint8_t> splatImage;
+    uint32_t randomState = 0x9E3779B9u;
+    float averageFrame = 0.0f;
+    uint64_t changes = 0;
+    bool vectorized = true;
+    ParticleStats counters;
+};
@@ -0,0 +1,46 @@
+/*
+ * Title: Match server protocol
+ * Description: Encoding and decoding of the messages declared in Protocol.h.
+ *
+ * SNAPSHOT: header matchId(4) then the bit-packed message described in SnapshotCodec.cpp
+*/
+
+#include "Protocol.h"
+
+void writeHeader(ByteWriter& writer, MessageType type) {
+    writer.u32(PROTOCOL_MAGIC);
+    writer.u8(type);
+}
+
+bool readHeader(ByteReader& reader, MessageType& type) {
+    uint32_t magic = reader.u32();
+    type = static_cast<MessageType>(reader.u8());
+    return reader.ok && magic == PROTOCOL_MAGIC;
+}
+
+void encodeWelcome(std::vector<unsigned char>& out, uint32_t matchId, int player, int playerCount) {
+    ByteWriter writer(out);
+    writeHeader(writer, MSG_WELCOME);
+    writer.u32(matchId);
+    writer.u8(static_cast<uint8_t>(player));
+    writer.u8(static_cast<uint8_t>(playerCount));
+}
+
+/*
+ * This function builds the snapshot message for one player
+ * @param out: receives the message
+ * @param matchId: id of the match
+ * @param encoder: the match's encoder, already holding the current tick
+ * @param state: current state of the match
+ * @param ackTick: last tick the player acknowledged, or NO_ACK
+ * @param forceKeyframe: send the whole state even if the baseline is usable
+ * @return true if a keyframe was written
+*/
+
+bool encodeSnapshot(std::vector<unsigned char>& out, uint32_t matchId, SnapshotEncoder& encoder, const GameState& state,
+    uint32_t ackTick, bool forceKeyframe) {
+    ByteWriter writer(out);
+    writeHeader(writer, MSG_SNAPSHOT);
+    writer.u32(matchId);
+    return encoder.encode(state, ackTick, out, forceKeyframe);
+}
@@ -0,0 +1,75 @@
+/*
+ * Title: Match server protocol
+ * Description: Messages exchanged between SnakeServer and its clients. Every tick each player
+ *      gets a snapshot from SnapshotCodec.h, encoded against the last tick that player
+ *      acknowledged (the tick field of its inputs). A lost snapshot costs nothing extra: the
+ *      next one still starts from the acknowledged tick and covers the gap. Keyframes with the
+ *      whole state are sent when a match starts, when a client asks for one and now and then.
+*/
+
+#pragma once
+
+#include "Game.h"
+#include "SnapshotCodec.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+const uint32_t PROTOCOL_MAGIC = 0x53524E53;   // "SNRS"
+const int MAX_DATAGRAM = 65000;                // largest message the server will build
+
+// Message types; the first group goes client -> server, the second server -> client
+enum MessageType : unsigned char {
+    MSG_JOIN = 1,        // ask to be put in a match
+    MSG_INPUT = 2,       // direction + last tick received (acts as an acknowledgement)
+    MSG_RESYNC = 3,      // a snapshot could not be applied, send a keyframe
+    MSG_LEAVE = 4,
+    MSG_WATCH = 5,       // relay -> server: stream a match (match id, 0 for any); repeat as keepalive
+    MSG_VIEW = 6,        // viewer -> relay: start or keep watching
+    MSG_WELCOME = 10,    // match id, player index, player count
+    MSG_SNAPSHOT = 13,   // match id, then a SnapshotCodec message
+};
+
+const size_t SNAPSHOT_HEADER_SIZE = 9;         // magic, type, match id
+
+// The spectator stream is one message per tick shared by every viewer. Each message reaches
+// back this many ticks, so a viewer can miss a few datagrams in a row and still keep up.
+const uint32_t SPECTATOR_REDUNDANCY_TICKS = 3;
+const uint32_t SPECTATOR_KEYFRAME_TICKS = 120;  // keyframe interval of the spectator stream
+
+// Little endian writer into a byte vector
+class ByteWriter {
+public:
+    explicit ByteWriter(std::vector<unsigned char>& buffer) : out(buffer) { out.clear(); }
+    void u8(uint8_t value) { out.push_back(value); }
+    void u16(uint16_t value) { u8(value & 255); u8(value >> 8); }
+    void u32(uint32_t value) { u16(value & 65535); u16(value >> 16); }
+    void i16(int16_t value) { u16(static_cast<uint16_t>(value)); }
+    size_t size() const { return out.size(); }
+private:
+    std::vector<unsigned char>& out;
+};
+
+// Little endian reader; reading past the end sets ok to false and returns zeros
+class ByteReader {
+public:
+    ByteReader(const unsigned char* data, size_t size) : data(data), size(size) {}
+    uint8_t u8() { if (position + 1 > size) { ok = false; return 0; } return data[position++]; }
+    uint16_t u16() { uint16_t low = u8(); return low | (u8() << 8); }
+    uint32_t u32() { uint32_t low = u16(); return low | (uint32_t(u16()) << 16); }
+    int16_t i16() { return static_cast<int16_t>(u16()); }
+    size_t offset() const { return position; }
+    bool ok = true;
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t position = 0;
+};
+
+void writeHeader(ByteWriter& writer, MessageType type);
+bool readHeader(ByteReader& reader, MessageType& type);
+
+void encodeWelcome(std::vector<unsigned char>& out, uint32_t matchId, int player, int playerCount);
+// Writes the header and the snapshot for one player. Returns true if it is a keyframe.
+bool encodeSnapshot(std::vector<unsigned char>& out, uint32_t matchId, SnapshotEncoder& encoder, const GameState& state,
+    uint32_t ackTick, bool forceKeyframe);
@@ -0,0 +1,401 @@
+/*
+ * Title: Snake Game spectator relay
+ * Description: Watches one match on SnakeServer and fans its spectator stream out to many
+ *      viewers. Every datagram from the server is stored once in a reference counted buffer;
+ *      the per-viewer sends only point at it (one iovec per viewer, batched with sendmmsg), so
+ *      the payload is never copied per viewer. The relay keeps the latest keyframe and every
+ *      message after it, which is what a viewer joining late (or asking for a resync) gets.
+ * Platform: Linux (epoll, recvmmsg/sendmmsg)
+ * Usage: ./SnakeRelay [--server 127.0.0.1:9000] [--port 9200] [--match 0]
+*/
+
+#include "Net.h"
+#include "Protocol.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const int RECEIVE_BATCH = 64;
+const int SEND_BATCH = 256;
+const double WATCH_INTERVAL_SECONDS = 1.0;     // keepalive to the server
+const double STREAM_SILENCE_SECONDS = 0.5;     // ask again sooner when the stream stops
+const double VIEWER_TIMEOUT_SECONDS = 10.0;
+const double STATS_INTERVAL_SECONDS = 1.0;
+
+typedef std::chrono::steady_clock RelayClock;
+
+// One datagram from the server, shared by every send that refers to it
+typedef std::shared_ptr<const std::vector<unsigned char>> PacketBuffer;
+
+// Relay settings from the command line
+struct RelayConfig {
+    NetAddress server;
+    uint16_t port = 9200;
+    uint32_t matchId = 0;
+};
+
+struct Viewer {
+    NetAddress address;
+    double lastHeard = 0.0;
+};
+
+// Counters printed every second
+struct RelayStats {
+    unsigned long long upstreamPackets = 0, upstreamBytes = 0, datagramsOut = 0, bytesOut = 0;
+    unsigned long long sendCalls = 0, dropped = 0, lateJoins = 0;
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void stopRelay(int) {
+    running = 0;
+}
+
+static uint64_t addressKey(const NetAddress& address) {
+    return (uint64_t(address.host) << 16) | address.port;
+}
+
+static double secondsSince(RelayClock::time_point start) {
+    return std::chrono::duration<double>(RelayClock::now() - start).count();
+}
+
+class SpectatorRelay {
+public:
+    SpectatorRelay(const RelayConfig& config) : config(config) {}
+    int run();
+
+private:
+    void receiveUpstream();
+    void receiveViewers();
+    void handleViewerPacket(const NetAddress& from, const unsigned char* data, size_t size);
+    void sendCatchUp(const NetAddress& to);
+    void sendWatch();
+    void queueSend(const NetAddress& to, const PacketBuffer& packet);
+    void flushOutgoing();
+    void expireViewers();
+
+    RelayConfig config;
+    UdpSocket upstream;          // talks to the server
+    UdpSocket downstream;        // talks to viewers
+    RelayClock::time_point startTime = RelayClock::now();
+    double lastWatch = -1.0, lastUpstream = 0.0;
+
+    std::unordered_map<uint64_t, Viewer> viewers;
+    uint32_t matchId = 0;                   // match currently being relayed
+    std::vector<PacketBuffer> sinceKeyframe; // latest keyframe followed by every later message
+
+    // pending datagrams; packets keeps the buffers alive until flushOutgoing()
+    std::vector<mmsghdr> outgoing;
+    std::vector<iovec> outgoingVectors;
+    std::vector<sockaddr_in> outgoingAddresses;
+    std::vector<PacketBuffer> packets;
+    RelayStats stats;
+};
+
+/*
+ * This function runs the relay until SIGINT/SIGTERM
+ * @return process exit code
+*/
+
+int SpectatorRelay::run() {
+    if (!downstream.open(config.port) || !upstream.open(0)) {
+        fprintf(stderr, "could not bind UDP port %u\n", config.port);
+        return 1;
+    }
+    int bufferSize = 8 * 1024 * 1024;
+    setsockopt(downstream.handle(), SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    setsockopt(upstream.handle(), SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+    int epoll = epoll_create1(0);
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = upstream.handle();
+    epoll_ctl(epoll, EPOLL_CTL_ADD, upstream.handle(), &event);
+    event.data.fd = downstream.handle();
+    epoll_ctl(epoll, EPOLL_CTL_ADD, downstream.handle(), &event);
+
+    printf("SnakeRelay relaying %s on UDP %u\n", addressToString(config.server).c_str(), config.port);
+
+    double lastStats = 0.0, lastExpire = 0.0;
+    epoll_event events[2];
+    while (running) {
+        int count = epoll_wait(epoll, events, 2, 50);
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == upstream.handle()) {
+                receiveUpstream();
+            }
+            else {
+                receiveViewers();
+            }
+        }
+        flushOutgoing();
+
+        double now = secondsSince(startTime);
+        if (now - lastWatch >= WATCH_INTERVAL_SECONDS || (now - lastUpstream >= STREAM_SILENCE_SECONDS && now - lastWatch >= STREAM_SILENCE_SECONDS)) {
+            sendWatch();
+            lastWatch = now;
+        }
+        if (now - lastExpire >= 1.0) {
+            lastExpire = now;
+            expireViewers();
+        }
+        if (now - lastStats >= STATS_INTERVAL_SECONDS) {
+            double interval = now - lastStats;
+            lastStats = now;
+            printf("match %u  viewers %zu  in %.0f pkt/s %.1f KB/s  out %.0f pkt/s %.1f MB/s  sendmmsg %.0f/s  dropped %llu  late joins %llu  cached %zu\n",
+                matchId, viewers.size(), stats.upstreamPackets / interval,
+                stats.upstreamBytes / interval / 1024.0, stats.datagramsOut / interval,
+                stats.bytesOut / interval / (1024.0 * 1024.0), stats.sendCalls / interval, stats.dropped, stats.lateJoins,
+                sinceKeyframe.size());
+            fflush(stdout);
+            stats = RelayStats();
+        }
+    }
+
+    close(epoll);
+    return 0;
+}
+
+/*
+ * This function asks the server for the stream, and keeps the subscription alive
+*/
+
+void SpectatorRelay::sendWatch() {
+    std::vector<unsigned char> message;
+    ByteWriter writer(message);
+    writeHeader(writer, MSG_WATCH);
+    writer.u32(config.matchId);
+    upstream.send(config.server, message.data(), message.size());
+}
+
+/*
+ * This function takes the server's messages and fans each one out to every viewer
+*/
+
+void SpectatorRelay::receiveUpstream() {
+    unsigned char buffer[MAX_DATAGRAM];
+    NetAddress from;
+    int size;
+    while ((size = upstream.receive(from, buffer, sizeof(buffer))) >= 0) {
+        ByteReader reader(buffer, size);
+        MessageType type;
+        if (!(from == config.server) || !readHeader(reader, type) || type != MSG_SNAPSHOT) {
+            continue;
+        }
+        uint32_t packetMatch = reader.u32();
+        uint32_t tick;
+        bool keyframe;
+        if (!reader.ok || !peekSnapshot(buffer + SNAPSHOT_HEADER_SIZE, size - SNAPSHOT_HEADER_SIZE, tick, keyframe)) {
+            continue;
+        }
+        lastUpstream = secondsSince(startTime);
+        stats.upstreamPackets++;
+        stats.upstreamBytes += size;
+
+        // the one copy this datagram gets
+        PacketBuffer packet = std::make_shared<const std::vector<unsigned char>>(buffer, buffer + size);
+        if (packetMatch != matchId) {
+            // a new match: its first message is a keyframe, anything else is left over
+            if (!keyframe) {
+                continue;
+            }
+            matchId = packetMatch;
+        }
+        if (keyframe) {
+            sinceKeyframe.clear();
+        }
+        if (!sinceKeyframe.empty() || keyframe) {
+            sinceKeyframe.push_back(packet);
+        }
+        for (const auto& entry : viewers) {
+            queueSend(entry.second.address, packet);
+        }
+        // keep the batches bounded when there are many viewers
+        if (outgoing.size() >= 16 * SEND_BATCH) {
+            flushOutgoing();
+        }
+    }
+}
+
+/*
+ * This function reads viewer requests, in batches
+*/
+
+void SpectatorRelay::receiveViewers() {
+    static unsigned char buffers[RECEIVE_BATCH][64];
+    mmsghdr messages[RECEIVE_BATCH];
+    iovec vectors[RECEIVE_BATCH];
+    sockaddr_in addresses[RECEIVE_BATCH];
+    for (;;) {
+        for (int i = 0; i < RECEIVE_BATCH; i++) {
+            vectors[i].iov_base = buffers[i];
+            vectors[i].iov_len = sizeof(buffers[i]);
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_name = &addresses[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+        }
+        int count = recvmmsg(downstream.handle(), messages, RECEIVE_BATCH, MSG_DONTWAIT, nullptr);
+        if (count <= 0) {
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            handleViewerPacket(fromSockaddr(addresses[i]), buffers[i], messages[i].msg_len);
+        }
+        if (count < RECEIVE_BATCH) {
+            return;
+        }
+    }
+}
+
+/*
+ * This function handles one viewer message: joining, keeping alive, resync and leaving
+*/
+
+void SpectatorRelay::handleViewerPacket(const NetAddress& from, const unsigned char* data, size_t size) {
+    ByteReader reader(data, size);
+    MessageType type;
+    if (!readHeader(reader, type)) {
+        return;
+    }
+    double now = secondsSince(startTime);
+    uint64_t key = addressKey(from);
+    auto found = viewers.find(key);
+
+    if (type == MSG_VIEW) {
+        if (found == viewers.end()) {
+            Viewer viewer;
+            viewer.address = from;
+            viewer.lastHeard = now;
+            viewers[key] = viewer;
+            stats.lateJoins++;
+            sendCatchUp(from);
+        }
+        else {
+            found->second.lastHeard = now;
+        }
+    }
+    else if (type == MSG_RESYNC && found != viewers.end()) {
+        found->second.lastHeard = now;
+        sendCatchUp(from);
+    }
+    else if (type == MSG_LEAVE && found != viewers.end()) {
+        viewers.erase(found);
+    }
+}
+
+/*
+ * This function sends a viewer the latest keyframe and everything since, which brings it to
+ * the current tick; from then on the regular stream keeps it there
+*/
+
+void SpectatorRelay::sendCatchUp(const NetAddress& to) {
+    for (const PacketBuffer& packet : sinceKeyframe) {
+        queueSend(to, packet);
+    }
+}
+
+/*
+ * This function adds a datagram to the outgoing batch. Only a pointer to the shared buffer is
+ * stored; the buffer is kept alive until the batch has been sent.
+*/
+
+void SpectatorRelay::queueSend(const NetAddress& to, const PacketBuffer& packet) {
+    if (packets.empty() || packets.back() != packet) {
+        packets.push_back(packet);
+    }
+    mmsghdr header;
+    memset(&header, 0, sizeof(header));
+    outgoing.push_back(header);
+    iovec vector;
+    vector.iov_base = const_cast<unsigned char*>(packet->data());
+    vector.iov_len = packet->size();
+    outgoingVectors.push_back(vector);
+    outgoingAddresses.push_back(toSockaddr(to));
+}
+
+/*
+ * This function sends everything queued since the last call
+*/
+
+void SpectatorRelay::flushOutgoing() {
+    for (size_t i = 0; i < outgoing.size(); i++) {
+        outgoing[i].msg_hdr.msg_iov = &outgoingVectors[i];
+        outgoing[i].msg_hdr.msg_iovlen = 1;
+        outgoing[i].msg_hdr.msg_name = &outgoingAddresses[i];
+        outgoing[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+    size_t sent = 0;
+    while (sent < outgoing.size()) {
+        unsigned int batch = static_cast<unsigned int>(std::min<size_t>(SEND_BATCH, outgoing.size() - sent));
+        int result = sendmmsg(downstream.handle(), &outgoing[sent], batch, MSG_DONTWAIT);
+        stats.sendCalls++;
+        if (result <= 0) {
+            // socket buffer full: the viewers catch up from the redundancy or ask for a resync
+            break;
+        }
+        for (int i = 0; i < result; i++) {
+            stats.bytesOut += outgoingVectors[sent + i].iov_len;
+        }
+        sent += result;
+    }
+    stats.datagramsOut += sent;
+    stats.dropped += outgoing.size() - sent;
+    outgoing.clear();
+    outgoingVectors.clear();
+    outgoingAddresses.clear();
+    packets.clear();
+}
+
+/*
+ * This function forgets viewers that stopped sending keepalives
+*/
+
+void SpectatorRelay::expireViewers() {
+    double now = secondsSince(startTime);
+    for (auto it = viewers.begin(); it != viewers.end();) {
+        if (now - it->second.lastHeard > VIEWER_TIMEOUT_SECONDS) {
+            it = viewers.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+/*
+ * main method parses the command line and runs the relay
+*/
+
+int main(int argc, char** argv) {
+    RelayConfig config;
+    std::string serverText = "127.0.0.1:9000";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--server") == 0) serverText = argv[i + 1];
+        else if (strcmp(argv[i], "--port") == 0) config.port = static_cast<uint16_t>(atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--match") == 0) config.matchId = static_cast<uint32_t>(strtoul(argv[i + 1], nullptr, 10));
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!parseAddress(serverText, config.server)) {
+        fprintf(stderr, "bad server address %s\n", serverText.c_str());
+        return 1;
+    }
+
+    signal(SIGINT, stopRelay);
+    signal(SIGTERM, stopRelay);
+    SpectatorRelay relay(config);
+    return relay.run();
+}
@@ -0,0 +1,1464 @@
+/*
+ * Title: Snake Game render benchmarks
+ * Description: Frame time benchmarks for the renderers, drawn offscreen in a headless OpenGL
+ *      context (see HeadlessGL.h). Without a GPU, Mesa's llvmpipe software rasterizer does the
+ *      drawing, which is the slowest place the game is expected to run.
+ * Usage: ./SnakeRenderBench <benchmark> [options], run without arguments to list the benchmarks
+*/
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <glad/glad.h>
+#include "Allocations.h"
+#include "Arena.h"
+#include "ArenaRenderer.h"
+#include "Camera.h"
+#include "ClassicRenderer.h"
+#include "DynamicResolution.h"
+#include "FrameLayers.h"
+#include "GlStats.h"
+#include "HeadlessGL.h"
+#include "Hud.h"
+#include "Minimap.h"
+#include "Observations.h"
+#include "Particles.h"
+#include "Shader.h"
+#include "SoftwareRenderer.h"
+#include "Timedemo.h"
+#include <algorithm>
+#include <chrono>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+typedef std::chrono::steady_clock BenchClock;
+
+const double FRAME_BUDGET_MS = 1000.0 / 60.0;
+
+static double milliseconds(BenchClock::time_point start, BenchClock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/*
+ * This function returns the given percentile of a list of samples (the list gets sorted)
+*/
+
+static double percentile(std::vector<double>& samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    size_t index = std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()));
+    return samples[index];
+}
+
+/*
+ * This function loads one of the game's textures, or makes a plain one if the file is missing
+ * so the benchmark still runs from another directory
+*/
+
+static unsigned int loadBenchTexture(const char* path) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    int width, height, components;
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char* data = stbi_load(path, &width, &height, &components, 4);
+    if (data) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        stbi_image_free(data);
+    }
+    else {
+        unsigned char white[4 * 4 * 4];
+        memset(white, 255, sizeof(white));
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 4, 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    }
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+// An offscreen color buffer to draw the frames into
+struct RenderTarget {
+    unsigned int framebuffer = 0;
+    unsigned int color = 0;
+    int width = 0;
+    int height = 0;
+};
+
+static RenderTarget createTarget(int width, int height) {
+    RenderTarget target;
+    target.width = width;
+    target.height = height;
+    glGenFramebuffers(1, &target.framebuffer);
+    glGenRenderbuffers(1, &target.color);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color);
+    glViewport(0, 0, width, height);
+    return target;
+}
+
+static void destroyTarget(RenderTarget& target) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(1, &target.color);
+    glDeleteFramebuffers(1, &target.framebuffer);
+}
+
+/*
+ * This function returns cell k of a path that sweeps the board in rows two cells apart,
+ * right along one row, up, left along the next. A snake laid on consecutive cells of it never
+ * touches itself, and the player input to follow it is easy to work out.
+*/
+
+static ArenaCell serpentineCell(long k, int width) {
+    long period = width + 1;      // a row, then one step up
+    long lane = k / period, r = k % period;
+    bool rightward = lane % 2 == 0;
+    if (r < width) {
+        return { static_cast<int16_t>(rightward ? r : width - 1 - r), static_cast<int16_t>(2 * lane) };
+    }
+    return { static_cast<int16_t>(rightward ? width - 1 : 0), static_cast<int16_t>(2 * lane + 1) };
+}
+
+static Direction stepDirection(ArenaCell from, ArenaCell to) {
+    if (to.x > from.x) return RIGHT;
+    if (to.x < from.x) return LEFT;
+    return to.y > from.y ? UP : DOWN;
+}
+
+// One benchmark run of the arena renderer and what it measured
+struct ArenaRun {
+    long segments = 100000;
+    int frames = 300;
+    int width = 800;
+    int height = 600;
+    bool wholeBoard = false;      // zoomed out to the whole board, or following the head
+    float zoom = 1.0f;            // when following
+    bool lod = true;
+    bool scaled = false;          // draw through DynamicResolution
+    bool dynamic = true;          // and let it pick the resolution
+    float budget = 12.0f;         // its GPU budget in ms
+    bool layered = false;         // draw through FrameLayers, with a background layer (needs scaled)
+    bool cached = true;           // and let it skip frames that didn't change
+    int refresh = 60;             // frames per second of the display; the arena ticks 60 times a second
+
+    double mean = 0.0;            // frame time in ms, including the tick
+    double p99 = 0.0;
+    ArenaRenderStats perFrame;    // averages
+    bool crashed = false;
+    float scale = 1.0f;           // resolution scale at the end
+    float gpu = 0.0f;             // GPU time at the end, ms
+    FrameLayerStats frameStats;
+};
+
+static ArenaTextures benchTextures;
+static unsigned int backgroundTexture = 0;
+static unsigned int backgroundProgram = 0;
+static unsigned int backgroundVAO = 0;
+
+// A full screen quad made from gl_VertexID, standing in for the game's background
+static const char* backgroundVertexSource = R"glsl(
+    #version 330 core
+    out vec2 texCoord;
+    void main() {
+        vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+        texCoord = corner;
+        gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+    }
+)glsl";
+
+static const char* backgroundFragmentSource = R"glsl(
+    #version 330 core
+    in vec2 texCoord;
+    out vec4 fragColor;
+    uniform sampler2D image;
+    void main() {
+        fragColor = texture(image, texCoord);
+    }
+)glsl";
+
+static void drawBackground() {
+    glUseProgram(backgroundProgram);
+    glBindVertexArray(backgroundVAO);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, backgroundTexture);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+/*
+ * This function runs the arena at 60 ticks per second with one tick per frame, as the game
+ * does, with one snake laid out along serpentineCell() on a 1024x1024 board
+*/
+
+static void runArena(ArenaRun& run) {
+    ArenaConfig config;
+    config.width = 1024;
+    config.height = 1024;
+    config.snakeCount = 1;
+    config.player = true;
+    config.seed = 7;
+    RenderTarget target = createTarget(run.width, run.height);
+    WorkerPool pool(1);
+
+    ArenaState arena;
+    initArena(arena, config);
+    std::vector<ArenaCell> body(run.segments);
+    long headIndex = run.segments - 1;
+    for (long i = 0; i < run.segments; i++) {
+        body[i] = serpentineCell(headIndex - i, config.width);
+    }
+    placeArenaSnake(arena, 0, body, stepDirection(body[1], body[0]));
+
+    ArenaRenderer renderer;
+    renderer.init(arena, benchTextures);
+    renderer.setLodEnabled(run.lod);
+    Camera camera;
+    camera.setBounds(config.width * MOVE_STRIDE, config.height * MOVE_STRIDE);
+    camera.setViewport(run.width, run.height);
+    camera.setZoom(run.wholeBoard ? camera.minimumZoom() : run.zoom);
+    DynamicResolution resolution;
+    if (run.scaled) {
+        resolution.init(run.budget, 0.5f);
+        resolution.setEnabled(run.dynamic);
+    }
+    camera.lookAt(arenaPosition(arena.snakes[0].segment(0)));
+    FrameArena scratch;
+    FrameLayers layers;
+    int boardLayer = 0;
+    if (run.layered) {
+        layers.init();
+        layers.setCachingEnabled(run.cached);
+        layers.addLayer(LAYER_STATIC, drawBackground);
+        boardLayer = layers.addLayer(LAYER_DYNAMIC, [&]() { renderer.draw(arena, camera, scratch, resolution.scale()); });
+    }
+
+    std::vector<double> samples;
+    ArenaRenderStats total;
+    for (int frame = 0; frame < run.frames; frame++) {
+        auto begin = BenchClock::now();
+        scratch.reset();
+        // tick as many times as 60 ticks per second call for by the end of this frame
+        long ticksDue = long(frame + 1) * 60 / run.refresh - long(frame) * 60 / run.refresh;
+        for (long t = 0; t < ticksDue; t++) {
+            Direction input = stepDirection(serpentineCell(headIndex, config.width), serpentineCell(headIndex + 1, config.width));
+            stepArena(arena, input, pool);
+            headIndex++;
+            renderer.noteTick(arena);
+        }
+        camera.follow(arenaPosition(arena.snakes[0].segment(0)), 1.0f / run.refresh);
+        if (run.layered) {
+            uint64_t version = combineVersion(static_cast<uint64_t>(arena.tick), camera.center().x);
+            version = combineVersion(version, camera.center().y);
+            layers.setVersion(boardLayer, combineVersion(version, camera.zoom()));
+            layers.render(resolution, { 0, 0, run.width, run.height });
+        }
+        else {
+            if (run.scaled) {
+                resolution.begin({ 0, 0, run.width, run.height });
+            }
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            renderer.draw(arena, camera, scratch, run.scaled ? resolution.scale() : 1.0f);
+            if (run.scaled) {
+                resolution.end();
+            }
+        }
+        glFinish();
+        samples.push_back(milliseconds(begin, BenchClock::now()));
+        total.chunksVisible += renderer.stats().chunksVisible;
+        total.chunksRebuilt += renderer.stats().chunksRebuilt;
+        total.drawCalls += renderer.stats().drawCalls;
+        total.instances += renderer.stats().instances;
+        total.level = renderer.stats().level;
+    }
+    run.crashed = !arena.snakes[0].alive;
+    run.mean = 0.0;
+    for (double sample : samples) {
+        run.mean += sample;
+    }
+    run.mean /= samples.size();
+    run.p99 = percentile(samples, 0.99);
+    run.perFrame.chunksVisible = total.chunksVisible / run.frames;
+    run.perFrame.chunksRebuilt = total.chunksRebuilt / run.frames;
+    run.perFrame.drawCalls = total.drawCalls / run.frames;
+    run.perFrame.instances = total.instances / run.frames;
+    run.perFrame.level = total.level;
+    if (run.layered) {
+        run.frameStats = layers.stats();
+        layers.release();
+    }
+    if (run.scaled) {
+        run.scale = resolution.scale();
+        run.gpu = resolution.gpuMilliseconds();
+        resolution.release();
+    }
+    renderer.release();
+    destroyTarget(target);
+}
+
+static void loadArenaTextures() {
+    benchTextures.body = loadBenchTexture("textures/body3.png");
+    benchTextures.playerHead = loadBenchTexture("textures/head1.png");
+    benchTextures.botHead = loadBenchTexture("textures/head2.png");
+    benchTextures.food = loadBenchTexture("textures/food.png");
+}
+
+static bool fitsBoard(long segments, int frames) {
+    if (segments >= 1025L * 512 - frames * 2) {
+        printf("too many segments for a 1024x1024 board\n");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * This function benchmarks the arena renderer with one very long snake on a 1M cell board,
+ * following the head at the normal zoom and with the whole board in view
+*/
+
+static int benchArenaRender(int argc, char** argv) {
+    ArenaRun run;
+    run.segments = argc > 0 ? atol(argv[0]) : 100000;
+    run.frames = argc > 1 ? atoi(argv[1]) : 300;
+    run.width = argc > 2 ? atoi(argv[2]) : 800;
+    run.height = argc > 3 ? atoi(argv[3]) : 600;
+    if (!fitsBoard(run.segments, run.frames)) {
+        return 1;
+    }
+    loadArenaTextures();
+
+    printf("1 snake of %ld segments on 1024x1024 cells, %dx%d pixels, %d frames\n", run.segments, run.width, run.height, run.frames);
+    printf("%-10s %10s %10s %8s %6s %10s %10s %10s %10s\n", "view", "mean ms", "p99 ms", "FPS", "LOD", "chunks", "rebuilt", "draws", "instances");
+    int failures = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        run.wholeBoard = pass == 1;
+        runArena(run);
+        printf("%-10s %10.2f %10.2f %8.0f %6d %10d %10d %10d %10u\n", run.wholeBoard ? "board" : "follow", run.mean, run.p99,
+            1000.0 / run.mean, run.perFrame.level, run.perFrame.chunksVisible, run.perFrame.chunksRebuilt, run.perFrame.drawCalls,
+            run.perFrame.instances);
+        if (run.crashed) {
+            printf("FAIL: the snake crashed\n");
+            failures++;
+        }
+        if (run.p99 > FRAME_BUDGET_MS) {
+            printf("note: p99 frame time is over the 60 FPS budget of %.1f ms\n", FRAME_BUDGET_MS);
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+/*
+ * This function shows how the quad count grows with snake length with and without levels of
+ * detail, with the whole board in view
+*/
+
+static int benchLod(int argc, char** argv) {
+    int frames = argc > 0 ? atoi(argv[0]) : 60;
+    const long lengths[] = { 25000, 100000, 400000 };
+    loadArenaTextures();
+    printf("whole 1024x1024 board in 800x600 pixels, %d frames\n", frames);
+    printf("%-10s %-6s %10s %10s %6s %10s\n", "segments", "LOD", "mean ms", "p99 ms", "level", "instances");
+    for (long segments : lengths) {
+        if (!fitsBoard(segments, frames)) {
+            return 1;
+        }
+        for (int lod = 0; lod < 2; lod++) {
+            ArenaRun run;
+            run.segments = segments;
+            run.frames = frames;
+            run.wholeBoard = true;
+            run.lod = lod == 1;
+            runArena(run);
+            printf("%-10ld %-6s %10.2f %10.2f %6d %10u\n", segments, run.lod ? "on" : "off", run.mean, run.p99, run.perFrame.level,
+                run.perFrame.instances);
+        }
+    }
+    return 0;
+}
+
+/*
+ * This function times keeping the minimap current on boards of several sizes with the same
+ * snakes, against uploading the whole board every tick
+*/
+
+static int benchMinimap(int argc, char** argv) {
+    int ticks = argc > 0 ? atoi(argv[0]) : 300;
+    int snakes = argc > 1 ? atoi(argv[1]) : 200;
+    const int sizes[] = { 256, 1024, 4096 };
+    RenderTarget target = createTarget(800, 600);
+    WorkerPool pool(1);
+    printf("%d snakes, %d ticks, map drawn into 800x600 pixels\n", snakes, ticks);
+    printf("%-10s %12s %14s %12s %16s\n", "board", "texels/tick", "update us", "draw us", "full upload us");
+    for (int size : sizes) {
+        ArenaConfig config;
+        config.width = size;
+        config.height = size;
+        config.snakeCount = snakes;
+        config.player = false;
+        config.seed = 5;
+        ArenaState arena;
+        initArena(arena, config);
+        Minimap minimap;
+        minimap.init(arena);
+        Camera camera;
+        camera.setBounds(size * MOVE_STRIDE, size * MOVE_STRIDE);
+        camera.setViewport(target.width, target.height);
+
+        std::vector<double> update, draw;
+        uint64_t texels = 0;
+        for (int t = 0; t < ticks; t++) {
+            stepArena(arena, RIGHT, pool);
+            glFinish();
+            auto begin = BenchClock::now();
+            minimap.noteTick(arena);
+            glFinish();
+            auto updated = BenchClock::now();
+            minimap.draw(target.width, target.height, camera);
+            glFinish();
+            update.push_back(milliseconds(begin, updated) * 1000.0);
+            draw.push_back(milliseconds(updated, BenchClock::now()) * 1000.0);
+            texels += minimap.lastUpdates();
+        }
+
+        // what updating the map would cost if the whole board went up every tick
+        std::vector<uint8_t> board(size_t(size) * size);
+        std::vector<double> full;
+        for (int t = 0; t < 10; t++) {
+            auto begin = BenchClock::now();
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RED, GL_UNSIGNED_BYTE, board.data());
+            glFinish();
+            full.push_back(milliseconds(begin, BenchClock::now()) * 1000.0);
+        }
+        printf("%4dx%-5d %12.0f %14.1f %12.1f %16.1f\n", size, size, double(texels) / ticks, percentile(update, 0.5),
+            percentile(draw, 0.5), percentile(full, 0.5));
+        minimap.release();
+    }
+    destroyTarget(target);
+    return 0;
+}
+
+/*
+ * This function compares drawing at the window's size with dynamic resolution at several
+ * window sizes. The camera zooms with the window, as on a HiDPI display, so every size shows
+ * the same part of the board and only the pixel count grows.
+*/
+
+static int benchResolution(int argc, char** argv) {
+    int frames = argc > 0 ? atoi(argv[0]) : 120;
+    float budget = argc > 1 ? static_cast<float>(atof(argv[1])) : 12.0f;
+    const int sizes[][2] = { { 800, 600 }, { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+    loadArenaTextures();
+    printf("1 snake of 100000 segments, following the head, %d frames, GPU budget %.1f ms\n", frames, budget);
+    printf("%-10s %-8s %10s %10s %8s %8s %12s %10s\n", "window", "scaling", "mean ms", "p99 ms", "FPS", "scale", "scene", "GPU ms");
+    for (const int* size : sizes) {
+        for (int dynamic = 0; dynamic < 2; dynamic++) {
+            ArenaRun run;
+            run.frames = frames;
+            run.width = size[0];
+            run.height = size[1];
+            run.zoom = size[1] / 600.0f;
+            run.scaled = true;
+            run.dynamic = dynamic == 1;
+            run.budget = budget;
+            runArena(run);
+            char scene[32];
+            snprintf(scene, sizeof(scene), "%dx%d", int(size[0] * run.scale + 0.5f), int(size[1] * run.scale + 0.5f));
+            char window[32];
+            snprintf(window, sizeof(window), "%dx%d", size[0], size[1]);
+            printf("%-10s %-8s %10.2f %10.2f %8.0f %8.2f %12s %10.2f\n", window, run.dynamic ? "dynamic" : "off", run.mean, run.p99,
+                1000.0 / run.mean, run.scale, scene, run.gpu);
+        }
+    }
+    return 0;
+}
+
+/*
+ * This function compares drawing every frame with the layer cache, on a display refreshing
+ * faster than the arena ticks. Frames between ticks show the same board when the camera is
+ * still, so with the whole board in view most of them are only shown again; a camera that
+ * follows the head moves on every frame and leaves little to skip.
+*/
+
+static int benchLayers(int argc, char** argv) {
+    int frames = argc > 0 ? atoi(argv[0]) : 240;
+    int refresh = argc > 1 ? std::max(1, atoi(argv[1])) : 144;
+    long segments = argc > 2 ? atol(argv[2]) : 100000;
+    if (!fitsBoard(segments, frames)) {
+        return 1;
+    }
+    loadArenaTextures();
+    backgroundTexture = loadBenchTexture("textures/snakeBackground.png");
+    backgroundProgram = createShaderProgram(backgroundVertexSource, backgroundFragmentSource);
+    glGenVertexArrays(1, &backgroundVAO);
+
+    printf("1 snake of %ld segments, 800x600, %d frames on a %d Hz display, 60 ticks per second\n", segments, frames, refresh);
+    printf("%-8s %-8s %10s %10s %8s %8s %8s %10s\n", "view", "cache", "mean ms", "p99 ms", "FPS", "drawn", "skipped", "static");
+    for (int pass = 0; pass < 2; pass++) {
+        for (int cached = 0; cached < 2; cached++) {
+            ArenaRun run;
+            run.segments = segments;
+            run.frames = frames;
+            run.wholeBoard = pass == 0;
+            run.scaled = true;
+            run.dynamic = false;
+            run.layered = true;
+            run.cached = cached == 1;
+            run.refresh = refresh;
+            runArena(run);
+            printf("%-8s %-8s %10.2f %10.2f %8.0f %8llu %8llu %10llu\n", run.wholeBoard ? "board" : "follow", run.cached ? "on" : "off",
+                run.mean, run.p99, 1000.0 / run.mean, (unsigned long long)run.frameStats.framesDrawn,
+                (unsigned long long)run.frameStats.framesSkipped, (unsigned long long)run.frameStats.staticRedraws);
+        }
+    }
+    glDeleteVertexArrays(1, &backgroundVAO);
+    glDeleteProgram(backgroundProgram);
+    return 0;
+}
+
+/*
+ * This function times the HUD with six lines of text, as the game shows with the performance
+ * overlay on: once with text that stays the same, as between score changes, and once with
+ * every line changing every frame. CPU time covers setting the lines and issuing the draw;
+ * frame time also waits for the draw to finish, which on llvmpipe is where the pixels get made.
+*/
+
+static int benchHud(int argc, char** argv) {
+    int frames = argc > 0 ? atoi(argv[0]) : 600;
+    RenderTarget target = createTarget(800, 600);
+    Hud hud;
+    auto begin = BenchClock::now();
+    hud.init();
+    double initMs = milliseconds(begin, BenchClock::now());
+    printf("6 lines at 800x600, %d frames, atlas built in %.2f ms\n", frames, initMs);
+    printf("%-10s %10s %10s %10s %10s\n", "text", "CPU us", "frame us", "glyphs", "rebuilds");
+    for (int changing = 0; changing < 2; changing++) {
+        std::vector<double> cpu, total;
+        uint64_t rebuildsBefore = hud.stats().rebuilds;
+        for (int frame = 0; frame < frames; frame++) {
+            int value = changing ? frame : 0;
+            char line[64];
+            glFinish();
+            auto start = BenchClock::now();
+            snprintf(line, sizeof(line), "SCORE %d", 120 + value);
+            hud.setLine(0, line);
+            snprintf(line, sizeof(line), "LENGTH %d", 45 + value);
+            hud.setLine(1, line);
+            hud.setLine(2, "SPEED 83/S");
+            snprintf(line, sizeof(line), "FPS %d", 60 + value % 7);
+            hud.setLine(3, line);
+            snprintf(line, sizeof(line), "GPU %.1f MS AT %d%%", 11.0 + value % 10 / 10.0, 100 - value % 50);
+            hud.setLine(4, line, HUD_YELLOW);
+            snprintf(line, sizeof(line), "REUSED %d OF 72 FRAMES", value % 72);
+            hud.setLine(5, line);
+            hud.draw(target.width, target.height);
+            cpu.push_back(milliseconds(start, BenchClock::now()) * 1000.0);
+            glFinish();
+            total.push_back(milliseconds(start, BenchClock::now()) * 1000.0);
+        }
+        printf("%-10s %10.1f %10.1f %10u %10llu\n", changing ? "changing" : "steady", percentile(cpu, 0.5), percentile(total, 0.5),
+            hud.stats().glyphs, (unsigned long long)(hud.stats().rebuilds - rebuildsBefore));
+    }
+    hud.release();
+    destroyTarget(target);
+    return 0;
+}
+
+/*
+ * This function keeps a number of particles alive over the 800x600 board and times the update
+ * and both ways of drawing them, then the update alone with and without SSE. Last it fires far
+ * more bursts than fit the budget while drawing points, and shows where the emission factor
+ * settles.
+*/
+
+static void topUpParticles(ParticleSystem& particles, uint32_t population, uint32_t& seed) {
+    while (particles.stats().live < population) {
+        seed = seed * 1664525u + 1013904223u;
+        int burst = static_cast<int>(std::min<uint32_t>(1000, population - particles.stats().live));
+        // long lived, so the population stays put during the run
+        particles.emit(glm::vec2(float(seed >> 8 & 511) + 140.0f, float(seed >> 20 & 511) + 40.0f), burst, 80.0f, 100.0f, 0xFFB040FF);
+    }
+}
+
+static int benchParticles(int argc, char** argv) {
+    uint32_t live = argc > 0 ? static_cast<uint32_t>(atol(argv[0])) : 100000;
+    int frames = argc > 1 ? atoi(argv[1]) : 60;
+    float budget = argc > 2 ? static_cast<float>(atof(argv[2])) : 12.0f;
+    RenderTarget target = createTarget(800, 600);
+    glm::mat4 projection = glm::ortho(0.0f, 800.0f, 0.0f, 600.0f);
+    const float dt = 1.0f / 60.0f;
+    printf("800x600, %d frames, points 4 pixels across\n", frames);
+    printf("%-10s %-8s %12s %12s %12s\n", "live", "draw", "update us", "draw ms", "frame ms");
+    const uint32_t counts[] = { 10000, live };
+    for (uint32_t population : counts) {
+        for (int mode = 0; mode < 2; mode++) {
+            ParticleSystem particles;
+            particles.init(std::max<int>(population, PARTICLE_CAPACITY));
+            particles.setDrawMode(mode == 0 ? PARTICLE_DRAW_POINTS : PARTICLE_DRAW_SPLAT);
+            std::vector<double> update, draw, frame;
+            uint32_t seed = 1;
+            topUpParticles(particles, population, seed);
+            for (int f = 0; f < frames; f++) {
+                glClear(GL_COLOR_BUFFER_BIT);
+                glFinish();
+                auto begin = BenchClock::now();
+                particles.update(dt);
+                auto updated = BenchClock::now();
+                particles.draw(projection, 4.0f);
+                glFinish();
+                auto drawn = BenchClock::now();
+                update.push_back(milliseconds(begin, updated) * 1000.0);
+                draw.push_back(milliseconds(updated, drawn));
+                frame.push_back(milliseconds(begin, drawn));
+            }
+            printf("%-10u %-8s %12.1f %12.2f %12.2f\n", population, mode == 0 ? "points" : "splat", percentile(update, 0.5),
+                percentile(draw, 0.5), percentile(frame, 0.5));
+            particles.release();
+        }
+    }
+
+    for (int vectorized = 1; vectorized >= 0; vectorized--) {
+        ParticleSystem particles;
+        particles.init(std::max<int>(live, PARTICLE_CAPACITY));
+        particles.setVectorized(vectorized == 1);
+        uint32_t seed = 3;
+        topUpParticles(particles, live, seed);
+        std::vector<double> update;
+        static std::vector<char> junk(16 << 20);
+        for (int f = 0; f < frames * 4; f++) {
+            for (size_t j = 0; j < junk.size(); j += 64) junk[j]++;
+            auto begin = BenchClock::now();
+            particles.update(dt);
+            update.push_back(milliseconds(begin, BenchClock::now()) * 1000.0);
+        }
+        printf("update of %u particles, %s: %.1f us\n", live, vectorized ? "SSE" : "scalar", percentile(update, 0.5));
+        particles.release();
+    }
+
+    // 4 bursts of 2000 every frame, over 100k live at once, drawn as points
+    ParticleSystem particles;
+    particles.init();
+    particles.setDrawMode(PARTICLE_DRAW_POINTS);
+    std::vector<double> frame;
+    uint32_t seed = 7;
+    uint64_t allocations = 0;
+    for (int f = 0; f < frames * 3; f++) {
+        auto begin = BenchClock::now();
+        // the pool's chunks are reserved by init(), so emitting and burning out allocate nothing
+        uint64_t allocationsBefore = allocationCounts().allocations;
+        for (int burst = 0; burst < 4; burst++) {
+            seed = seed * 1664525u + 1013904223u;
+            particles.emit(glm::vec2(float(seed >> 8 & 511) + 140.0f, float(seed >> 20 & 511) + 40.0f), 2000, 120.0f, 1.0f, 0xFFB040FF);
+        }
+        particles.update(dt);
+        allocations += allocationCounts().allocations - allocationsBefore;
+        glClear(GL_COLOR_BUFFER_BIT);
+        particles.draw(projection, 4.0f);
+        glFinish();
+        double ms = milliseconds(begin, BenchClock::now());
+        particles.adapt(static_cast<float>(ms), budget);
+        if (f >= frames * 2) {
+            frame.push_back(ms);
+        }
+    }
+    printf("overloaded points, budget %.1f ms: emission settled at %.0f%%, %u live, %.2f ms per frame (p99 %.2f)\n", budget,
+        particles.stats().emission * 100.0f, particles.stats().live, percentile(frame, 0.5), percentile(frame, 0.99));
+    particles.release();
+    destroyTarget(target);
+    if (allocations > 0) {
+        printf("FAIL: emitting and updating particles allocated %llu times\n", (unsigned long long)allocations);
+        return 1;
+    }
+    return 0;
+}
+
+// The game's classic mode shaders, so the benchmark makes the same calls as drawSquare()
+static const char* classicVertexSource = R"glsl(
+    #version 330 core
+    layout (location = 0) in vec2 aPos;
+    layout (location = 1) in vec2 aTexCoord;
+    uniform mat4 model;
+    uniform mat4 projection;
+    out vec2 TexCoord;
+    void main() {
+        gl_Position = projection * model * vec4(aPos, 0.0, 1.0);
+        TexCoord = aTexCoord;
+    }
+)glsl";
+
+static const char* classicFragmentSource = R"glsl(
+    #version 330 core
+    out vec4 FragColor;
+    in vec2 TexCoord;
+    uniform sampler2D texture1;
+    uniform vec4 color;
+    uniform bool useTexture;
+    void main() {
+        if (useTexture) {
+            vec4 texColor = texture(texture1, TexCoord);
+            if (texColor.a < 0.1)
+                discard;
+            FragColor = texColor;
+        } else {
+            FragColor = color;
+        }
+    }
+)glsl";
+
+/*
+ * This function draws one square the way the game's drawSquare() does: every uniform looked up
+ * by name, the model matrix sent twice, and the texture and VAO bound again for every square
+*/
+
+static void drawClassicSquare(unsigned int program, unsigned int vao, unsigned int texture, glm::vec2 position) {
+    GL_SITE("drawSquare");
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(position, 0.0f));
+    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, &model[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, &model[0][0]);
+    glUniform1i(glGetUniformLocation(program, "useTexture"), 1);
+    glUniform4f(glGetUniformLocation(program, "color"), 0.0f, 1.0f, 0.0f, 1.0f);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(glGetUniformLocation(program, "texture1"), 0);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+}
+
+/*
+ * This function draws the classic mode frame: the background, a snake of the given length
+ * wound across the 800x600 board, the food and the HUD
+*/
+
+static void drawClassicFrame(unsigned int program, unsigned int vao, int segments, Hud& hud, const RenderTarget& target) {
+    {
+        GL_SITE("background");
+        drawBackground();
+    }
+    {
+        GL_SITE("board");
+        glm::mat4 projection = glm::ortho(0.0f, 800.0f, 0.0f, 600.0f);
+        glUseProgram(program);
+        glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, &projection[0][0]);
+        glBindVertexArray(vao);
+        for (int i = 0; i < segments; i++) {
+            int column = i % 40, row = i / 40;
+            float x = 10.0f + 20.0f * (row % 2 == 0 ? column : 39 - column);
+            drawClassicSquare(program, vao, i == 0 ? benchTextures.playerHead : benchTextures.body, glm::vec2(x, 10.0f + 20.0f * (row % 30)));
+        }
+        drawClassicSquare(program, vao, benchTextures.food, glm::vec2(790.0f, 590.0f));
+    }
+    GL_SITE("hud");
+    hud.draw(target.width, target.height);
+}
+
+/*
+ * This function draws the classic mode frame with and without the GL call counting layer,
+ * prints the counted report of one frame and what the counting costs, and checks that the
+ * report found the redundant calls drawSquare() is known to make
+*/
+
+static int benchGlStats(int argc, char** argv) {
+    int segments = argc > 0 ? atoi(argv[0]) : 200;
+    int frames = argc > 1 ? atoi(argv[1]) : 300;
+    RenderTarget target = createTarget(800, 600);
+    loadArenaTextures();
+    backgroundTexture = loadBenchTexture("textures/snakeBackground.png");
+    backgroundProgram = createShaderProgram(backgroundVertexSource, backgroundFragmentSource);
+    glGenVertexArrays(1, &backgroundVAO);
+    unsigned int program = createShaderProgram(classicVertexSource, classicFragmentSource);
+    float quad[] = {
+         10.0f,  10.0f, 1.0f, 1.0f,
+         10.0f, -10.0f, 1.0f, 0.0f,
+        -10.0f, -10.0f, 0.0f, 0.0f,
+        -10.0f,  10.0f, 0.0f, 1.0f,
+    };
+    unsigned int vao, vbo;
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    Hud hud;
+    hud.init();
+    hud.setLine(0, "SCORE 120");
+    hud.setLine(1, "LENGTH 200");
+
+    printf("classic frame with %d segments at 800x600, %d frames\n", segments, frames);
+    printf("%-12s %10s %10s %10s\n", "counting", "CPU us", "p99 us", "frame us");
+    // warm up the driver's caches so the first pass isn't the slow one
+    for (int frame = 0; frame < frames / 4; frame++) {
+        drawClassicFrame(program, vao, segments, hud, target);
+    }
+    glFinish();
+    GlFrameReport report;
+    int64_t liveBefore[GL_OBJECT_KINDS] = {};
+    int64_t liveAfter[GL_OBJECT_KINDS] = {};
+    for (int counted = 0; counted < 2; counted++) {
+        if (counted) {
+            glStatsInstall();
+            for (int kind = 0; kind < GL_OBJECT_KINDS; kind++) {
+                liveBefore[kind] = glStatsLiveObjects(static_cast<GlObjectKind>(kind));
+            }
+        }
+        std::vector<double> cpu, total;
+        for (int frame = 0; frame < frames; frame++) {
+            glFinish();
+            auto start = BenchClock::now();
+            glClear(GL_COLOR_BUFFER_BIT);
+            drawClassicFrame(program, vao, segments, hud, target);
+            cpu.push_back(milliseconds(start, BenchClock::now()) * 1000.0);
+            glFinish();
+            total.push_back(milliseconds(start, BenchClock::now()) * 1000.0);
+            if (counted) {
+                glStatsEndFrame();
+            }
+        }
+        double mean = 0.0;
+        for (double sample : cpu) {
+            mean += sample / cpu.size();
+        }
+        printf("%-12s %10.1f %10.1f %10.1f\n", counted ? "on" : "off", mean, percentile(cpu, 0.99), percentile(total, 0.5));
+        if (counted) {
+            report = glStatsLastFrame();
+            for (int kind = 0; kind < GL_OBJECT_KINDS; kind++) {
+                liveAfter[kind] = glStatsLiveObjects(static_cast<GlObjectKind>(kind));
+            }
+            glStatsUninstall();
+        }
+    }
+    printf("\nlast counted frame:\n");
+    for (const std::string& line : glStatsFormat(report, 10)) {
+        printf("%s\n", line.c_str());
+    }
+    int failures = 0;
+    // per square: the second model upload, texture1 = 0 and useTexture/color after the first
+    // square are repeats, as are the texture bind of every body segment and every VAO bind
+    if (report.redundantUniforms < static_cast<uint32_t>(segments) || report.redundantBinds < static_cast<uint32_t>(segments)) {
+        printf("FAIL: the redundant uniforms and binds of drawSquare() were not all found\n");
+        failures++;
+    }
+    for (int kind = 0; kind < GL_OBJECT_KINDS; kind++) {
+        if (liveAfter[kind] != liveBefore[kind]) {
+            printf("FAIL: %lld %s made and not deleted over the frames\n", (long long)(liveAfter[kind] - liveBefore[kind]),
+                glObjectKindName(static_cast<GlObjectKind>(kind)));
+            failures++;
+        }
+    }
+    hud.release();
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteProgram(program);
+    destroyTarget(target);
+    return failures == 0 ? 0 : 1;
+}
+
+// Live GL objects of every kind, as GlStats counts them
+struct LiveObjects {
+    int64_t count[GL_OBJECT_KINDS] = {};
+};
+
+static LiveObjects liveObjects() {
+    LiveObjects live;
+    for (int kind = 0; kind < GL_OBJECT_KINDS; kind++) {
+        live.count[kind] = glStatsLiveObjects(static_cast<GlObjectKind>(kind));
+    }
+    return live;
+}
+
+/*
+ * This function prints the live objects of the kinds that changed, before the renderers were
+ * made, once they were, after the restarts and after release(), and counts the failures: any
+ * object made or deleted over the restarts, or left after release()
+*/
+
+static int checkLiveObjects(const LiveObjects& before, const LiveObjects& start, const LiveObjects& end, const LiveObjects& after) {
+    printf("\n%-16s %8s %8s %8s\n", "live GL objects", "start", "end", "released");
+    int failures = 0;
+    for (int kind = 0; kind < GL_OBJECT_KINDS; kind++) {
+        const char* name = glObjectKindName(static_cast<GlObjectKind>(kind));
+        if (start.count[kind] == before.count[kind] && end.count[kind] == before.count[kind]) {
+            continue;
+        }
+        printf("%-16s %8lld %8lld %8lld\n", name, (long long)(start.count[kind] - before.count[kind]),
+            (long long)(end.count[kind] - before.count[kind]), (long long)(after.count[kind] - before.count[kind]));
+        if (end.count[kind] != start.count[kind]) {
+            printf("FAIL: %lld %s made or deleted over the restarts\n", (long long)(end.count[kind] - start.count[kind]), name);
+            failures++;
+        }
+        if (after.count[kind] != before.count[kind]) {
+            printf("FAIL: %lld %s left after release()\n", (long long)(after.count[kind] - before.count[kind]), name);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/*
+ * This function restarts the classic game thousands of times the way the game does after a
+ * game over, plays it until the snake crashes or for a number of ticks, and draws a frame,
+ * with the GL live object counts on. It fails if any GL object is made or deleted over the
+ * restarts, or if release() leaves any behind, and compares a restart with making the
+ * renderer again. Then it does the same for the arena, with its renderer, minimap, layer
+ * cache and scene framebuffer.
+*/
+
+static int benchRestart(int argc, char** argv) {
+    int restarts = argc > 0 ? atoi(argv[0]) : 3000;
+    int ticks = argc > 1 ? atoi(argv[1]) : 20;
+    const int remakes = 20;
+    RenderTarget target = createTarget(800, 600);
+    glm::mat4 projection = glm::ortho(0.0f, windowWIDTH, 0.0f, windowHEIGHT);
+    glStatsInstall();
+    LiveObjects liveBefore = liveObjects();
+
+    ClassicRenderer renderer;
+    renderer.init();
+    GameState game;
+    uint32_t seed = 1;
+    initGame(game, 1, seed);
+    LiveObjects liveStart = liveObjects();
+    std::vector<double> restartTimes, frameTimes;
+    restartTimes.reserve(restarts);
+    frameTimes.reserve(restarts);
+    uint64_t allocations = 0;
+    uint64_t played = 0;
+    for (int r = 0; r < restarts; r++) {
+        uint64_t allocationsBefore = allocationCounts().allocations;
+        auto start = BenchClock::now();
+        seed = seed * 1664525u + 1013904223u;
+        initGame(game, 1, seed);
+        restartTimes.push_back(milliseconds(start, BenchClock::now()) * 1000.0);
+        allocations += allocationCounts().allocations - allocationsBefore;
+        // turn up or down once, so the games differ
+        Direction inputs[2] = { (r & 1) ? UP : DOWN, RIGHT };
+        for (int t = 0; t < ticks && !game.gameOver; t++) {
+            stepGame(game, &inputs[t < ticks / 2 ? 0 : 1]);
+            played++;
+        }
+        start = BenchClock::now();
+        glClear(GL_COLOR_BUFFER_BIT);
+        renderer.drawBackground(projection);
+        renderer.drawBoard(game, projection);
+        glFinish();
+        frameTimes.push_back(milliseconds(start, BenchClock::now()) * 1000.0);
+        glStatsEndFrame();
+    }
+    LiveObjects liveEnd = liveObjects();
+    size_t registered = renderer.resources().size();
+    renderer.release();
+
+    // what restarting cost before: every shader, buffer and texture made again
+    std::vector<double> remakeTimes;
+    for (int r = 0; r < remakes; r++) {
+        auto start = BenchClock::now();
+        ClassicRenderer again;
+        again.init();
+        glFinish();
+        remakeTimes.push_back(milliseconds(start, BenchClock::now()) * 1000.0);
+        again.release();
+    }
+    LiveObjects liveAfter = liveObjects();
+
+    printf("classic game restarted %d times, up to %d ticks and a frame after each (%llu ticks), 800x600\n", restarts, ticks,
+        (unsigned long long)played);
+    printf("%-22s %10s %10s %12s\n", "", "mean us", "p99 us", "allocations");
+    auto report = [](const char* what, std::vector<double>& samples, long long allocated) {
+        double mean = 0.0;
+        for (double sample : samples) {
+            mean += sample / samples.size();
+        }
+        if (allocated >= 0) {
+            printf("%-22s %10.2f %10.2f %12lld\n", what, mean, percentile(samples, 0.99), allocated);
+        }
+        else {
+            printf("%-22s %10.2f %10.2f %12s\n", what, mean, percentile(samples, 0.99), "-");
+        }
+    };
+    report("restart", restartTimes, static_cast<long long>(allocations));
+    report("renderer made again", remakeTimes, -1);
+    report("frame", frameTimes, -1);
+
+    int failures = checkLiveObjects(liveBefore, liveStart, liveEnd, liveAfter);
+    if (allocations > 0) {
+        printf("FAIL: restarting allocated\n");
+        failures++;
+    }
+    if (failures == 0) {
+        printf("PASS: the same %zu GL objects through %d restarts, all deleted by release()\n", registered, restarts);
+    }
+
+    // The arena, the way the game keeps it across restarts. The whole board is in view at a
+    // fixed resolution, so the first game gives every chunk the buffer of the one level drawn.
+    int arenaRestarts = std::max(1, restarts / 10);
+    loadArenaTextures();
+    liveBefore = liveObjects();
+    ArenaConfig config;
+    config.width = 256;
+    config.height = 256;
+    config.snakeCount = 100;
+    config.player = false;
+    config.seed = 3;
+    ArenaState arena;
+    initArena(arena, config);
+    WorkerPool pool(1);
+    FrameArena scratch;
+    ArenaRenderer arenaRenderer;
+    arenaRenderer.init(arena, benchTextures);
+    Minimap minimap;
+    minimap.init(arena);
+    DynamicResolution resolution;
+    resolution.init(12.0f, 0.5f);
+    resolution.setEnabled(false);
+    Camera camera;
+    camera.setBounds(config.width * MOVE_STRIDE, config.height * MOVE_STRIDE);
+    camera.setViewport(target.width, target.height);
+    camera.setZoom(camera.minimumZoom());
+    camera.lookAt(glm::vec2(config.width, config.height) * (MOVE_STRIDE / 2.0f));
+    FrameLayers layers;
+    layers.init();
+    layers.addLayer(LAYER_STATIC, []() {
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    });
+    int boardLayer = layers.addLayer(LAYER_DYNAMIC, [&]() { arenaRenderer.draw(arena, camera, scratch, resolution.scale()); });
+    uint64_t arenaTicks = 0;
+    auto playArena = [&](int game) {
+        for (int t = 0; t < ticks; t++) {
+            stepArena(arena, static_cast<Direction>(t & 3), pool);
+            arenaRenderer.noteTick(arena);
+            minimap.noteTick(arena);
+            scratch.reset();
+            layers.setVersion(boardLayer, combineVersion(static_cast<uint64_t>(arena.tick), static_cast<uint64_t>(game)));
+            layers.render(resolution, { 0, 0, target.width, target.height });
+            minimap.draw(target.width, target.height, camera);
+            glFinish();
+            glStatsEndFrame();
+            arenaTicks++;
+        }
+    };
+    playArena(0);
+    liveStart = liveObjects();
+    for (int r = 1; r <= arenaRestarts; r++) {
+        config.seed = config.seed * 1664525u + 1013904223u;
+        initArena(arena, config);
+        arenaRenderer.noteRestart(arena);
+        minimap.noteRestart(arena);
+        playArena(r);
+    }
+    liveEnd = liveObjects();
+    layers.release();
+    resolution.release();
+    minimap.release();
+    arenaRenderer.release();
+    liveAfter = liveObjects();
+    glStatsUninstall();
+
+    printf("\narena of %d snakes on %dx%d cells restarted %d times, %d ticks and frames each (%llu ticks)\n", config.snakeCount,
+        config.width, config.height, arenaRestarts, ticks, (unsigned long long)arenaTicks);
+    int arenaFailures = checkLiveObjects(liveBefore, liveStart, liveEnd, liveAfter);
+    if (arenaFailures == 0) {
+        printf("PASS: the arena kept the same GL objects through %d restarts, all deleted by release()\n", arenaRestarts);
+    }
+    failures += arenaFailures;
+    destroyTarget(target);
+    return failures == 0 ? 0 : 1;
+}
+
+/*
+ * This function lays a snake of the given length along rows across the board, MOVE_STRIDE
+ * apart like a moving snake's segments, turning up at each end, and adds a second player's
+ * short snake along the top and the food
+*/
+
+static GameState softwareBenchState(int segments, bool bigFood) {
+    GameState state;
+    state.snakes.resize(2);
+    std::vector<Square> path;
+    glm::vec2 position(15.0f, 15.0f);
+    Direction direction = RIGHT;
+    int climbed = 0;
+    while ((int)path.size() < segments && position.y < windowHEIGHT - 40.0f) {
+        path.push_back({ position, direction });
+        if (direction == UP) {
+            if (++climbed == 10) {// a row up; go back the other way
+                direction = position.x > windowWIDTH / 2.0f ? LEFT : RIGHT;
+                climbed = 0;
+            }
+        }
+        else if ((direction == RIGHT && position.x >= windowWIDTH - 15.0f) || (direction == LEFT && position.x <= 15.0f)) {
+            direction = UP;
+        }
+        position += direction == UP ? glm::vec2(0.0f, MOVE_STRIDE) : glm::vec2(direction == RIGHT ? MOVE_STRIDE : -MOVE_STRIDE, 0.0f);
+    }
+    // the head is the newest square
+    state.snakes[0].body.assign(path.rbegin(), path.rend());
+    for (int i = 0; i < 40; i++) {
+        state.snakes[1].body.push_back({ glm::vec2(200.0f + i * MOVE_STRIDE, windowHEIGHT - 17.5f), LEFT });
+    }
+    state.smallFood = { glm::vec2(407.5f, 292.5f), RIGHT };
+    state.bigFood = { glm::vec2(612.5f, 372.5f), RIGHT };
+    state.bigFoodOnScreen = bigFood;
+    return state;
+}
+
+static int benchSoftware(int argc, char** argv) {
+    int frames = argc > 0 ? atoi(argv[0]) : 200;
+    int segments = argc > 1 ? atoi(argv[1]) : 2000;
+    const int width = 800, height = 600;
+    const int tolerance = 8;                  // per channel, for rounding and filtering differences
+    const double required = 99.9;             // percent of pixels within the tolerance
+    RenderTarget target = createTarget(width, height);
+    glm::mat4 projection = glm::ortho(0.0f, windowWIDTH, 0.0f, windowHEIGHT);
+
+    ClassicRenderer gl;
+    gl.init();
+    SoftwareRenderer software;
+    if (!software.init(width, height)) {
+        printf("FAIL: the textures did not load; run from the repository's directory\n");
+        destroyTarget(target);
+        return 1;
+    }
+    GameState states[2] = { softwareBenchState(segments, false), softwareBenchState(segments, true) };
+    printf("classic frame drawn by OpenGL and on the CPU, %dx%d, %zu segments, %d frames\n\n", width, height,
+        states[0].snakes[0].body.size() + states[0].snakes[1].body.size(), frames);
+
+    // Compare the two pictures
+    int failures = 0;
+    std::vector<uint32_t> readback((size_t)width * height);
+    printf("%-10s %12s %10s %10s\n", "food", "matching %", "max diff", "mean diff");
+    for (int i = 0; i < 2; i++) {
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        gl.drawBackground(projection);
+        gl.drawBoard(states[i], projection);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, readback.data());
+        software.drawBackground(projection);
+        software.drawBoard(states[i], projection);
+        const uint32_t* pixels = software.pixels();
+        size_t matching = 0;
+        int maxDiff = 0;
+        double totalDiff = 0.0;
+        for (size_t p = 0; p < readback.size(); p++) {
+            int diff = 0;
+            for (int c = 0; c < 3; c++) {
+                int a = (readback[p] >> (c * 8)) & 0xFF, b = (pixels[p] >> (c * 8)) & 0xFF;
+                diff = std::max(diff, std::abs(a - b));
+            }
+            matching += diff <= tolerance;
+            maxDiff = std::max(maxDiff, diff);
+            totalDiff += diff;
+        }
+        double percent = 100.0 * matching / readback.size();
+        printf("%-10s %12.3f %10d %10.3f\n", i == 0 ? "small" : "big", percent, maxDiff, totalDiff / readback.size());
+        if (percent < required) {
+            printf("FAIL: fewer than %.1f%% of the pixels within %d of the OpenGL frame\n", required, tolerance);
+            failures++;
+        }
+    }
+
+    // Time the frames; the tiles were sampled above, as the first frames of a game would
+    auto timeFrames = [&](auto draw) {
+        std::vector<double> times;
+        times.reserve(frames);
+        for (int f = 0; f < frames; f++) {
+            auto start = BenchClock::now();
+            draw(states[f & 1]);
+            times.push_back(milliseconds(start, BenchClock::now()));
+        }
+        double mean = 0.0;
+        for (double time : times) {
+            mean += time / times.size();
+        }
+        return std::make_pair(mean, percentile(times, 0.99));
+    };
+    auto softwareFrame = [&](const GameState& state) {
+        software.drawBackground(projection);
+        software.drawBoard(state, projection);
+    };
+    auto glFrame = [&](const GameState& state) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        gl.drawBackground(projection);
+        gl.drawBoard(state, projection);
+        glFinish();
+    };
+    auto cold = BenchClock::now();
+    SoftwareRenderer fresh;
+    fresh.init(width, height);
+    auto loaded = BenchClock::now();
+    fresh.drawBackground(projection);
+    fresh.drawBoard(states[0], projection);
+    fresh.drawBoard(states[1], projection);
+    auto sampled = BenchClock::now();
+    fresh.release();
+
+    printf("\n%-22s %10s %10s %10s\n", "", "mean ms", "p99 ms", "fps");
+    auto report = [](const char* what, std::pair<double, double> times) {
+        printf("%-22s %10.3f %10.3f %10.0f\n", what, times.first, times.second, 1000.0 / times.first);
+    };
+    software.setVectorized(true);
+    report("software, SSE2", timeFrames(softwareFrame));
+    software.setVectorized(false);
+    report("software, scalar", timeFrames(softwareFrame));
+    report("OpenGL (glFinish)", timeFrames(glFrame));
+    printf("\nsoftware setup: %.1f ms decoding and mipmapping, %.1f ms sampling %zu tiles and the background\n",
+        milliseconds(cold, loaded), milliseconds(loaded, sampled), software.tiles());
+    if (failures == 0) {
+        printf("PASS: the software frames match the OpenGL ones\n");
+    }
+    gl.release();
+    software.release();
+    destroyTarget(target);
+    return failures == 0 ? 0 : 1;
+}
+
+/*
+ * This function plays every game a tick with random turns, starting a new one where a game
+ * ended, so each batch has something new to draw
+*/
+
+static void stepObservedGames(std::vector<GameState>& games, uint32_t& seed) {
+    for (GameState& game : games) {
+        seed = seed * 1664525u + 1013904223u;
+        if (game.gameOver) {
+            initGame(game, 1, seed);
+        }
+        Direction input = static_cast<Direction>((seed >> 24) % 4);
+        stepGame(game, &input);
+    }
+}
+
+static int benchObservations(int argc, char** argv) {
+    int batches = argc > 0 ? atoi(argv[0]) : 20;
+    int tileWidth = argc > 1 ? atoi(argv[1]) : 160;
+    int tileHeight = argc > 2 ? atoi(argv[2]) : 120;
+    const int sizes[] = { 1, 4, 16, 64, 256 };
+    const int largest = 256;
+    ObservationRenderer observer;
+    if (!observer.init(tileWidth, tileHeight, largest)) {
+        return 1;
+    }
+    std::vector<GameState> games(largest);
+    uint32_t seed = 1;
+    for (int i = 0; i < largest; i++) {
+        initGame(games[i], 1, 1000 + i);
+    }
+    for (int t = 0; t < 30; t++) {
+        stepObservedGames(games, seed);
+    }
+    std::vector<std::vector<unsigned char>> buffers(largest, std::vector<unsigned char>((size_t)tileWidth * tileHeight * 3));
+    std::vector<unsigned char*> outputs(largest);
+    for (int i = 0; i < largest; i++) {
+        outputs[i] = buffers[i].data();
+    }
+
+    // A game's tile in a full batch should be the picture it gets drawn alone
+    int failures = 0;
+    observer.submit(games.data(), largest);
+    observer.receive(outputs.data());
+    std::vector<unsigned char> alone((size_t)tileWidth * tileHeight * 3);
+    unsigned char* aloneOutput = alone.data();
+    // (interpolation on llvmpipe depends a little on where in the framebuffer a tile is)
+    const int tolerance = 2;
+    int maxDiff = 0;
+    for (int i = 0; i < largest; i += 37) {
+        observer.submit(&games[i], 1);
+        observer.receive(&aloneOutput);
+        for (size_t k = 0; k < alone.size(); k++) {
+            maxDiff = std::max(maxDiff, std::abs(alone[k] - buffers[i][k]));
+        }
+    }
+    if (maxDiff > tolerance) {
+        printf("FAIL: games drawn alone differ from their tile in a batch by up to %d\n", maxDiff);
+        failures++;
+    }
+
+    printf("%d batches of classic games as %dx%d RGB observations\n", batches, tileWidth, tileHeight);
+    printf("%-6s %16s %16s %16s %12s\n", "games", "one by one /s", "batch, wait /s", "batch, async /s", "ms a batch");
+    for (int size : sizes) {
+        std::vector<GameState> batch(games.begin(), games.begin() + size);
+        // one game at a time, waiting for each picture
+        auto start = BenchClock::now();
+        for (int b = 0; b < batches; b++) {
+            stepObservedGames(batch, seed);
+            for (int i = 0; i < size; i++) {
+                observer.submit(&batch[i], 1);
+                observer.receive(&outputs[i]);
+            }
+        }
+        double oneByOne = milliseconds(start, BenchClock::now());
+        // the whole batch in one pass, waiting for it
+        start = BenchClock::now();
+        for (int b = 0; b < batches; b++) {
+            stepObservedGames(batch, seed);
+            observer.submit(batch.data(), size);
+            observer.receive(outputs.data());
+        }
+        double waited = milliseconds(start, BenchClock::now());
+        // the next batch stepped and submitted before the last one is received
+        start = BenchClock::now();
+        stepObservedGames(batch, seed);
+        observer.submit(batch.data(), size);
+        for (int b = 1; b < batches; b++) {
+            stepObservedGames(batch, seed);
+            observer.submit(batch.data(), size);
+            observer.receive(outputs.data());
+        }
+        observer.receive(outputs.data());
+        double pipelined = milliseconds(start, BenchClock::now());
+        double frames = (double)size * batches;
+        printf("%-6d %16.0f %16.0f %16.0f %12.2f\n", size, frames * 1000.0 / oneByOne, frames * 1000.0 / waited,
+            frames * 1000.0 / pipelined, pipelined / batches);
+    }
+    if (failures == 0) {
+        printf("PASS: batched tiles match the games drawn alone to within %d\n", maxDiff);
+    }
+    observer.release();
+    return failures == 0 ? 0 : 1;
+}
+
+/*
+ * This function steers the classic snake toward the food, across first and then along, for a
+ * recorded game that grows
+*/
+
+static Direction chaseFood(const GameState& game) {
+    const Square& head = game.snakes[0].body[0];
+    glm::vec2 offset = (game.bigFoodOnScreen ? game.bigFood.position : game.smallFood.position) - head.position;
+    Direction across = offset.x > 0.0f ? RIGHT : LEFT;
+    Direction along = offset.y > 0.0f ? UP : DOWN;
+    Direction wanted = std::abs(offset.x) >= MOVE_STRIDE ? across : along;
+    if (isOppositeDirection(head.direction, wanted)) {// can't turn back; go round
+        wanted = wanted == across ? along : across;
+    }
+    return wanted;
+}
+
+static int benchTimedemo(int argc, char** argv) {
+    Replay replay;
+    const char* replayPath = argc > 0 ? argv[0] : "recorded";
+    if (argc > 0) {
+        if (!loadReplay(replay, argv[0])) {
+            printf("FAIL: could not load %s\n", argv[0]);
+            return 1;
+        }
+    }
+    else {
+        // record a classic game of up to 3000 ticks
+        replay.seed = 2024;
+        GameState game;
+        initGame(game, 1, replay.seed);
+        for (int t = 0; t < 3000 && !game.gameOver; t++) {
+            Direction input = chaseFood(game);
+            replay.record(&input);
+            stepGame(game, &input);
+        }
+    }
+    RenderTarget target = createTarget(800, 600);
+    ClassicRenderer renderer;
+    renderer.init();
+
+    // Twice, to check everything but the times comes out the same; the second time with the GL
+    // counting on, as --gl-stats has it, which the run must leave on
+    TimedemoResult first = runTimedemo(replay, renderer, target.width, target.height, []() {});
+    glStatsInstall();
+    TimedemoResult second = runTimedemo(replay, renderer, target.width, target.height, []() {});
+    bool countingKept = glStatsInstalled();
+    glStatsUninstall();
+    writeTimedemoJson(stdout, replayPath, second);
+    int failures = 0;
+    if (!countingKept) {
+        printf("FAIL: the timedemo left the GL counting layer uninstalled\n");
+        failures++;
+    }
+    if (first.frames != second.frames || first.hash != second.hash || first.drawCallsMean != second.drawCallsMean ||
+        first.drawCallsMin != second.drawCallsMin || first.drawCallsMax != second.drawCallsMax) {
+        printf("FAIL: the second run drew %u frames (hash %08x, %.2f draws) against %u (hash %08x, %.2f draws)\n",
+            second.frames, second.hash, second.drawCallsMean, first.frames, first.hash, first.drawCallsMean);
+        failures++;
+    }
+    if (second.frames != replay.ticks()) {
+        printf("FAIL: %u frames for %u ticks\n", second.frames, replay.ticks());
+        failures++;
+    }
+    // the renderer's own count must match what the GL counting layer sees, in an untimed pass
+    if (replay.mode == REPLAY_CLASSIC) {
+        glm::mat4 projection = glm::ortho(0.0f, windowWIDTH, 0.0f, windowHEIGHT);
+        ReplayPlayer player;
+        player.start(replay);
+        WorkerPool pool(1);
+        glStatsInstall();
+        uint64_t counted = 0;
+        while (player.step(pool)) {
+            renderer.drawBackground(projection);
+            renderer.drawBoard(player.game, projection);
+            glStatsEndFrame();
+            counted += glStatsLastFrame().draws;
+        }
+        glStatsUninstall();
+        double countedMean = second.frames > 0 ? static_cast<double>(counted) / second.frames : 0.0;
+        if (countedMean != second.drawCallsMean) {
+            printf("FAIL: GlStats counted %.2f draw calls per frame, the renderer %.2f\n", countedMean, second.drawCallsMean);
+            failures++;
+        }
+    }
+    if (failures == 0) {
+        printf("PASS: both runs drew the same %u frames, %.2f draw calls each; frame p50 %.3f ms, then %.3f ms\n",
+            second.frames, second.drawCallsMean, first.frameTimes.p50, second.frameTimes.p50);
+    }
+    renderer.release();
+    destroyTarget(target);
+    return failures == 0 ? 0 : 1;
+}
+
+// Table of available benchmarks
+struct Benchmark {
+    const char* name;
+    int (*run)(int argc, char** argv);
+    const char* description;
+};
+
+static const Benchmark benchmarks[] = {
+    { "arena", benchArenaRender, "[segments] [frames] [width] [height] chunked arena drawing with one long snake on 1M cells" },
+    { "minimap", benchMinimap, "[ticks] [snakes] minimap update cost on 256 to 4096 cell boards" },
+    { "resolution", benchResolution, "[frames] [budget ms] frame times at 800x600 to 3840x2160 with and without dynamic resolution" },
+    { "layers", benchLayers, "[frames] [refresh Hz] [segments] frames skipped and frame time with and without the layer cache" },
+    { "hud", benchHud, "[frames] CPU and GPU time of the HUD with steady and changing text" },
+    { "particles", benchParticles, "[live] [frames] [budget ms] particle update and draw cost, and emission under overload" },
+    { "glstats", benchGlStats, "[segments] [frames] GL calls, redundant state changes and counting overhead of the classic frame" },
+    { "restart", benchRestart, "[restarts] [ticks] GL objects and allocations over thousands of classic and arena restarts" },
+    { "software", benchSoftware, "[frames] [segments] CPU renderer against OpenGL: matching pixels and frame time" },
+    { "observations", benchObservations, "[batches] [tile width] [tile height] RGB observations per second for batches of 1 to 256 games" },
+    { "timedemo", benchTimedemo, "[replay] plays a replay twice through the classic render path and checks the reports agree" },
+    { "lod", benchLod, "[frames] quads drawn and frame time for 25k-400k segments with and without levels of detail" },
+};
+
+/*
+ * main method creates the context and runs the benchmark named on the command line
+*/
+
+int main(int argc, char** argv) {
+    if (argc >= 2) {
+        for (const Benchmark& benchmark : benchmarks) {
+            if (strcmp(argv[1], benchmark.name) == 0) {
+                if (!createHeadlessContext()) {
+                    return 1;
+                }
+                printf("%s | %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+                int result = benchmark.run(argc - 2, argv + 2);
+                destroyHeadlessContext();
+                return result;
+            }
+        }
+    }
+    printf("usage: %s <benchmark> [options]\n", argv[0]);
+    for (const Benchmark& benchmark : benchmarks) {
+        printf("  %-12s %s\n", benchmark.name, benchmark.description);
+    }
+    return argc >= 2 ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * Title: Replays
+ * Description: Implementation of the replay file and player declared in Replay.h.
+*/
+
+#include "Replay.h"
+#include "WorkerPool.h"
+#include <cstdio>
+#include <cstring>
+
+const char REPLAY_MAGIC[4] = { 'S', 'N', 'K', 'R' };
+const uint8_t REPLAY_VERSION = 1;
+
+void Replay::record(const Direction* directions) {
+    int count = mode == REPLAY_CLASSIC ? players : 1;
+    for (int i = 0; i < count; i++) {
+        inputs.push_back(static_cast<uint8_t>(directions[i]));
+    }
+}
+
+namespace {
+
+// Little-endian fields, so a replay plays on any machine
+void putU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint32_t getU32(const uint8_t* in) {
+    return uint32_t(in[0]) | uint32_t(in[1]) << 8 | uint32_t(in[2]) << 16 | uint32_t(in[3]) << 24;
+}
+
+}
+
+/*
+ * This function writes a replay: magic, version, mode, the start settings, the input count
+ * and the inputs
+ * @return false if the file could not be written
+*/
+
+bool saveReplay(const Replay& replay, const char* path) {
+    std::vector<uint8_t> header(REPLAY_MAGIC, REPLAY_MAGIC + 4);
+    header.push_back(REPLAY_VERSION);
+    header.push_back(replay.mode);
+    header.push_back(static_cast<uint8_t>(replay.players));
+    header.push_back(replay.arena.player ? 1 : 0);
+    putU32(header, replay.seed);
+    putU32(header, static_cast<uint32_t>(replay.arena.width));
+    putU32(header, static_cast<uint32_t>(replay.arena.height));
+    putU32(header, static_cast<uint32_t>(replay.arena.snakeCount));
+    putU32(header, static_cast<uint32_t>(replay.arena.foodCount));
+    putU32(header, static_cast<uint32_t>(replay.arena.startLength));
+    putU32(header, replay.arena.seed);
+    putU32(header, static_cast<uint32_t>(replay.inputs.size()));
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = fwrite(header.data(), 1, header.size(), file) == header.size() &&
+        fwrite(replay.inputs.data(), 1, replay.inputs.size(), file) == replay.inputs.size();
+    return fclose(file) == 0 && written;
+}
+
+bool loadReplay(Replay& replay, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    uint8_t header[40];
+    bool valid = fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header, REPLAY_MAGIC, 4) == 0 &&
+        header[4] == REPLAY_VERSION && (header[5] == REPLAY_CLASSIC || header[5] == REPLAY_ARENA) &&
+        header[6] >= 1 && header[6] <= MAX_PLAYERS;
+    if (valid) {
+        replay.mode = static_cast<ReplayMode>(header[5]);
+        replay.players = header[6];
+        replay.arena.player = header[7] != 0;
+        replay.seed = getU32(header + 8);
+        replay.arena.width = static_cast<int>(getU32(header + 12));
+        replay.arena.height = static_cast<int>(getU32(header + 16));
+        replay.arena.snakeCount = static_cast<int>(getU32(header + 20));
+        replay.arena.foodCount = static_cast<int>(getU32(header + 24));
+        replay.arena.startLength = static_cast<int>(getU32(header + 28));
+        replay.arena.seed = getU32(header + 32);
+        replay.inputs.resize(getU32(header + 36));
+        valid = fread(replay.inputs.data(), 1, replay.inputs.size(), file) == replay.inputs.size();
+        for (uint8_t input : replay.inputs) {
+            valid = valid && input <= RIGHT;
+        }
+    }
+    fclose(file);
+    return valid;
+}
+
+void ReplayPlayer::start(const Replay& replay) {
+    this->replay = &replay;
+    played = 0;
+    if (replay.mode == REPLAY_CLASSIC) {
+        initGame(game, replay.players, replay.seed);
+    }
+    else {
+        initArena(arena, replay.arena);
+    }
+}
+
+bool ReplayPlayer::step(WorkerPool& pool, TickEvents* events) {
+    if (replay == nullptr || played >= replay->ticks()) {
+        return false;
+    }
+    if (replay->mode == REPLAY_CLASSIC) {
+        Direction inputs[MAX_PLAYERS];
+        for (int i = 0; i < replay->players; i++) {
+            inputs[i] = static_cast<Direction>(replay->inputs[played * replay->players + i]);
+        }
+        TickEvents tickEvents = stepGame(game, inputs);
+        if (events != nullptr) {
+            *events = tickEvents;
+        }
+    }
+    else {
+        stepArena(arena, static_cast<Direction>(replay->inputs[played]), pool);
+    }
+    played++;
+    return true;
+}
+
+uint32_t ReplayPlayer::hash() const {
+    return replay != nullptr && replay->mode == REPLAY_ARENA ? hashArena(arena) : hashGameState(game);
+}
@@ -0,0 +1,59 @@
+/*
+ * Title: Replays
+ * Description: A recorded game: how it started and every input it got, one per tick. The
+ *      simulations are deterministic (Game.h, Arena.h), so that is enough to play the game
+ *      again exactly, tick for tick, without storing any of its state.
+ *
+ *      A classic game keeps one direction per player per tick; an arena keeps the player's
+ *      direction per tick (the bots decide for themselves). On disk a replay is a small header
+ *      followed by the inputs, one byte each.
+*/
+
+#pragma once
+
+#include "Arena.h"
+#include "Game.h"
+#include <cstdint>
+#include <vector>
+
+class WorkerPool;
+
+const size_t REPLAY_RESERVE_TICKS = 360000; // an hour at 100 ticks a second
+
+enum ReplayMode : uint8_t { REPLAY_CLASSIC = 1, REPLAY_ARENA = 2 };
+
+struct Replay {
+    ReplayMode mode = REPLAY_CLASSIC;
+    int players = 1;              // classic only
+    uint32_t seed = 1;            // classic only; an arena has its seed in its config
+    ArenaConfig arena;            // arena only
+    std::vector<uint8_t> inputs;  // a Direction per player per tick
+
+    uint32_t ticks() const { return static_cast<uint32_t>(inputs.size() / (mode == REPLAY_CLASSIC ? players : 1)); }
+    // Appends the inputs of one tick: players directions for a classic game, one for an arena
+    void record(const Direction* directions);
+    // Makes room for recording that many ticks without allocating
+    void reserve(size_t ticks) { inputs.reserve(ticks * (mode == REPLAY_CLASSIC ? players : 1)); }
+};
+
+bool saveReplay(const Replay& replay, const char* path);
+// Returns false if the file is missing or isn't a replay
+bool loadReplay(Replay& replay, const char* path);
+
+// Plays a replay back one tick at a time, into a game or arena state of its own
+class ReplayPlayer {
+public:
+    void start(const Replay& replay);
+    // Steps one tick; returns false once every recorded tick has been played
+    bool step(WorkerPool& pool, TickEvents* events = nullptr);
+    uint32_t tick() const { return played; }
+    // hashGameState or hashArena of the current state
+    uint32_t hash() const;
+
+    GameState game;
+    ArenaState arena;
+
+private:
+    const Replay* replay = nullptr;
+    uint32_t played = 0;
+};
@@ -0,0 +1,623 @@
+/*
+ * Title: Snake Game match server
+ * Description: Headless authoritative server that hosts many matches in one process.
+ *      It uses the simulation rules from Game.h and has no GLFW or OpenGL dependency.
+ *      One thread does all UDP I/O through epoll (with recvmmsg/sendmmsg batching); on every
+ *      tick the active matches are stepped in parallel on a worker pool, each match encodes a
+ *      snapshot per player against what that player acknowledged, and the I/O thread sends all
+ *      of them in batches. Relays (SnakeRelay) can watch a match; they get one shared
+ *      spectator stream that they fan out to their viewers.
+ * Platform: Linux (epoll, timerfd, recvmmsg/sendmmsg)
+ * Usage: ./SnakeServer [--port 9000] [--threads N] [--max-matches 10000] [--players 2] [--tick-ms 12]
+*/
+
+#include "Game.h"
+#include "Net.h"
+#include "Protocol.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+const int RECEIVE_BATCH = 64;            // datagrams read per recvmmsg call
+const int SEND_BATCH = 256;              // datagrams written per sendmmsg call
+const double CLIENT_TIMEOUT_SECONDS = 10.0;
+const double STATS_INTERVAL_SECONDS = 5.0;
+const uint32_t KEYFRAME_INTERVAL_TICKS = 600;  // players get a keyframe this often anyway
+
+typedef std::chrono::steady_clock ServerClock;
+
+// Server settings from the command line
+struct ServerConfig {
+    uint16_t port = 9000;
+    int threads = 0;
+    int maxMatches = 10000;
+    int playersPerMatch = 2;
+    int tickMilliseconds = 12;
+};
+
+// A connected player
+struct Client {
+    NetAddress address;
+    int match = -1;               // slot in the match table, -1 while waiting for a match
+    int player = 0;               // -1 for a relay watching the match
+    double lastHeard = 0.0;
+};
+
+// One game in progress. Everything a match touches during a tick lives in here,
+// so matches can be stepped on different threads without locking.
+struct Match {
+    bool active = false;
+    uint32_t id = 0;
+    GameState state;
+    int clients[MAX_PLAYERS] = {};
+    Direction inputs[MAX_PLAYERS] = {};
+    SnapshotEncoder encoder;
+    uint32_t acked[MAX_PLAYERS] = {};                 // last tick each player confirmed
+    bool needsKeyframe[MAX_PLAYERS] = {};
+    std::vector<unsigned char> snapshot[MAX_PLAYERS]; // this tick's message for each player
+    int keyframesSent = 0;
+    std::vector<int> watchers;                        // relays getting the spectator stream
+    std::vector<unsigned char> spectator;             // this tick's spectator message
+    bool spectatorKeyframe = false;                   // a new watcher needs a keyframe
+    bool finished = false;
+    bool abandoned = false;                       // a player left; end without another tick
+};
+
+// Counters printed every few seconds
+struct ServerStats {
+    unsigned long long packetsIn = 0, packetsOut = 0, bytesOut = 0, ticks = 0, matchesStarted = 0, matchesFinished = 0;
+    unsigned long long keyframes = 0;
+    double tickSeconds = 0.0, maxTickSeconds = 0.0;
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void stopServer(int) {
+    running = 0;
+}
+
+static uint64_t addressKey(const NetAddress& address) {
+    return (uint64_t(address.host) << 16) | address.port;
+}
+
+static double secondsSince(ServerClock::time_point start) {
+    return std::chrono::duration<double>(ServerClock::now() - start).count();
+}
+
+class MatchServer {
+public:
+    MatchServer(const ServerConfig& config) : config(config), pool(config.threads) {}
+    int run();
+
+private:
+    void receivePackets();
+    void handlePacket(const NetAddress& from, const unsigned char* data, size_t size);
+    void startMatches();
+    void tick();
+    void flushOutgoing();
+    void queueSend(const NetAddress& to, const std::vector<unsigned char>& message);
+    void watchMatch(const NetAddress& from, uint32_t matchId, double now);
+    void dropClient(int clientIndex);
+    void expireClients();
+
+    ServerConfig config;
+    WorkerPool pool;
+    UdpSocket socket;
+    ServerClock::time_point startTime = ServerClock::now();
+
+    std::vector<Client> clients;
+    std::vector<int> freeClients;
+    std::unordered_map<uint64_t, int> clientByAddress;
+    std::vector<int> waiting;                    // clients waiting for a match
+
+    std::vector<Match> matches;
+    std::vector<int> freeMatches;
+    std::vector<int> activeMatches;              // slots in use, stepped every tick
+    uint32_t nextMatchId = 1;
+
+    // pending datagrams; the payload pointers stay valid until flushOutgoing()
+    std::vector<mmsghdr> outgoing;
+    std::vector<iovec> outgoingVectors;
+    std::vector<sockaddr_in> outgoingAddresses;
+    std::vector<std::vector<unsigned char>> scratch;   // replies built on the I/O thread
+    size_t scratchUsed = 0;
+    ServerStats stats;
+};
+
+/*
+ * This function runs the server until SIGINT/SIGTERM
+ * @return process exit code
+*/
+
+int MatchServer::run() {
+    if (!socket.open(config.port)) {
+        fprintf(stderr, "could not bind UDP port %u\n", config.port);
+        return 1;
+    }
+    int bufferSize = 8 * 1024 * 1024;
+    setsockopt(socket.handle(), SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    setsockopt(socket.handle(), SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+    matches.resize(config.maxMatches);
+    for (int i = config.maxMatches - 1; i >= 0; i--) {
+        freeMatches.push_back(i);
+    }
+
+    int timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    itimerspec interval;
+    interval.it_interval.tv_sec = config.tickMilliseconds / 1000;
+    interval.it_interval.tv_nsec = (config.tickMilliseconds % 1000) * 1000000L;
+    interval.it_value = interval.it_interval;
+    timerfd_settime(timer, 0, &interval, nullptr);
+
+    int epoll = epoll_create1(0);
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = socket.handle();
+    epoll_ctl(epoll, EPOLL_CTL_ADD, socket.handle(), &event);
+    event.data.fd = timer;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, timer, &event);
+
+    printf("SnakeServer listening on UDP %u: %d threads, %d match slots, %d players per match, %d ms ticks\n",
+        config.port, pool.size(), config.maxMatches, config.playersPerMatch, config.tickMilliseconds);
+
+    double lastStats = 0.0, lastExpire = 0.0;
+    epoll_event events[4];
+    while (running) {
+        int count = epoll_wait(epoll, events, 4, 100);
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == socket.handle()) {
+                receivePackets();
+            }
+            else if (events[i].data.fd == timer) {
+                uint64_t expirations = 0;
+                if (read(timer, &expirations, sizeof(expirations)) > 0) {
+                    // if the server fell behind, catch up a little but never spiral
+                    for (uint64_t t = 0; t < expirations && t < 4; t++) {
+                        tick();
+                    }
+                }
+            }
+        }
+        flushOutgoing();
+
+        double now = secondsSince(startTime);
+        if (now - lastExpire >= 1.0) {
+            lastExpire = now;
+            expireClients();
+        }
+        if (now - lastStats >= STATS_INTERVAL_SECONDS) {
+            double interval = now - lastStats;
+            lastStats = now;
+            printf("matches %zu  clients %zu  waiting %zu  started %llu  finished %llu  tick avg %.3f ms max %.3f ms  in %.0f pkt/s  out %.0f pkt/s %.1f KB/s  keyframes %llu\n",
+                activeMatches.size(), clientByAddress.size(), waiting.size(), stats.matchesStarted, stats.matchesFinished,
+                stats.ticks ? 1000.0 * stats.tickSeconds / stats.ticks : 0.0, 1000.0 * stats.maxTickSeconds,
+                stats.packetsIn / interval, stats.packetsOut / interval, stats.bytesOut / interval / 1024.0, stats.keyframes);
+            ServerStats totals;
+            totals.matchesStarted = stats.matchesStarted;
+            totals.matchesFinished = stats.matchesFinished;
+            stats = totals;
+            fflush(stdout);
+        }
+    }
+
+    close(epoll);
+    close(timer);
+    return 0;
+}
+
+/*
+ * This function reads every datagram waiting on the socket, in batches
+*/
+
+void MatchServer::receivePackets() {
+    static unsigned char buffers[RECEIVE_BATCH][1500];
+    mmsghdr messages[RECEIVE_BATCH];
+    iovec vectors[RECEIVE_BATCH];
+    sockaddr_in addresses[RECEIVE_BATCH];
+    for (;;) {
+        for (int i = 0; i < RECEIVE_BATCH; i++) {
+            vectors[i].iov_base = buffers[i];
+            vectors[i].iov_len = sizeof(buffers[i]);
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_name = &addresses[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+        }
+        int count = recvmmsg(socket.handle(), messages, RECEIVE_BATCH, MSG_DONTWAIT, nullptr);
+        if (count <= 0) {
+            return;
+        }
+        stats.packetsIn += count;
+        for (int i = 0; i < count; i++) {
+            handlePacket(fromSockaddr(addresses[i]), buffers[i], messages[i].msg_len);
+        }
+        startMatches();
+        if (count < RECEIVE_BATCH) {
+            return;
+        }
+    }
+}
+
+/*
+ * This function handles one client message
+*/
+
+void MatchServer::handlePacket(const NetAddress& from, const unsigned char* data, size_t size) {
+    ByteReader reader(data, size);
+    MessageType type;
+    if (!readHeader(reader, type)) {
+        return;
+    }
+    double now = secondsSince(startTime);
+    auto found = clientByAddress.find(addressKey(from));
+
+    if (type == MSG_JOIN) {
+        if (found == clientByAddress.end()) {
+            int index;
+            if (!freeClients.empty()) {
+                index = freeClients.back();
+                freeClients.pop_back();
+            }
+            else {
+                index = static_cast<int>(clients.size());
+                clients.emplace_back();
+            }
+            clients[index] = Client();
+            clients[index].address = from;
+            clients[index].lastHeard = now;
+            clientByAddress[addressKey(from)] = index;
+            waiting.push_back(index);
+        }
+        else if (clients[found->second].match >= 0 && clients[found->second].player >= 0) {
+            // the welcome got lost: say it again and send a keyframe with the next tick
+            Client& client = clients[found->second];
+            Match& match = matches[client.match];
+            if (scratchUsed == scratch.size()) {
+                scratch.emplace_back();
+            }
+            encodeWelcome(scratch[scratchUsed], match.id, client.player, static_cast<int>(match.state.snakes.size()));
+            queueSend(from, scratch[scratchUsed++]);
+            match.needsKeyframe[client.player] = true;
+        }
+        return;
+    }
+
+    if (type == MSG_WATCH) {
+        uint32_t matchId = reader.u32();
+        if (reader.ok) {
+            watchMatch(from, matchId, now);
+        }
+        return;
+    }
+
+    if (found == clientByAddress.end()) {
+        return;
+    }
+    Client& client = clients[found->second];
+    client.lastHeard = now;
+
+    if (type == MSG_INPUT && client.match >= 0 && client.player >= 0) {
+        Match& match = matches[client.match];
+        uint8_t direction = reader.u8();
+        uint32_t ackTick = reader.u32();
+        if (reader.ok && direction <= RIGHT) {
+            match.inputs[client.player] = static_cast<Direction>(direction);
+            // inputs can arrive out of order; only move the baseline forward
+            uint32_t& acked = match.acked[client.player];
+            if (ackTick <= match.state.tick && (acked == NO_ACK || ackTick > acked)) {
+                acked = ackTick;
+            }
+        }
+    }
+    else if (type == MSG_RESYNC && client.match >= 0) {
+        if (client.player >= 0) {
+            matches[client.match].needsKeyframe[client.player] = true;
+        }
+        else {
+            matches[client.match].spectatorKeyframe = true;
+        }
+    }
+    else if (type == MSG_LEAVE) {
+        dropClient(found->second);
+    }
+}
+
+/*
+ * This function attaches a relay to a match, or keeps an existing one alive
+ * @param from: address of the relay
+ * @param matchId: match to watch, 0 for the longest running one
+ * @param now: current server time
+*/
+
+void MatchServer::watchMatch(const NetAddress& from, uint32_t matchId, double now) {
+    auto found = clientByAddress.find(addressKey(from));
+    if (found != clientByAddress.end()) {
+        Client& client = clients[found->second];
+        client.lastHeard = now;
+        return;
+    }
+    int slot = -1;
+    for (int active : activeMatches) {
+        const Match& match = matches[active];
+        if (!match.finished && !match.abandoned && (matchId == 0 || match.id == matchId) &&
+            (slot < 0 || match.id < matches[slot].id)) {
+            slot = active;
+        }
+    }
+    if (slot < 0) {
+        return; // nothing to watch yet; the relay asks again
+    }
+
+    int index;
+    if (!freeClients.empty()) {
+        index = freeClients.back();
+        freeClients.pop_back();
+    }
+    else {
+        index = static_cast<int>(clients.size());
+        clients.emplace_back();
+    }
+    clients[index] = Client();
+    clients[index].address = from;
+    clients[index].lastHeard = now;
+    clients[index].match = slot;
+    clients[index].player = -1;
+    clientByAddress[addressKey(from)] = index;
+    matches[slot].watchers.push_back(index);
+    matches[slot].spectatorKeyframe = true;
+}
+
+/*
+ * This function moves waiting clients into new matches
+*/
+
+void MatchServer::startMatches() {
+    while (static_cast<int>(waiting.size()) >= config.playersPerMatch && !freeMatches.empty()) {
+        int slot = freeMatches.back();
+        freeMatches.pop_back();
+        Match& match = matches[slot];
+        match.active = true;
+        match.finished = false;
+        match.id = nextMatchId++;
+        initGame(match.state, config.playersPerMatch, match.id * 2654435761u);
+        match.encoder.reset(match.state);
+        for (int p = 0; p < config.playersPerMatch; p++) {
+            int clientIndex = waiting[waiting.size() - config.playersPerMatch + p];
+            clients[clientIndex].match = slot;
+            clients[clientIndex].player = p;
+            match.clients[p] = clientIndex;
+            match.inputs[p] = match.state.snakes[p].body[0].direction;
+            match.acked[p] = NO_ACK;
+            match.needsKeyframe[p] = false;
+
+            if (scratchUsed == scratch.size()) {
+                scratch.emplace_back();
+            }
+            encodeWelcome(scratch[scratchUsed], match.id, p, config.playersPerMatch);
+            queueSend(clients[clientIndex].address, scratch[scratchUsed++]);
+        }
+        waiting.resize(waiting.size() - config.playersPerMatch);
+        activeMatches.push_back(slot);
+        stats.matchesStarted++;
+    }
+}
+
+/*
+ * This function steps every active match once. The matches are independent, so they are split
+ * across the worker pool; each one writes only into its own Match.
+*/
+
+void MatchServer::tick() {
+    auto begin = ServerClock::now();
+
+    pool.parallelFor(activeMatches.size(), 64, [this](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            Match& match = matches[activeMatches[i]];
+            int players = static_cast<int>(match.state.snakes.size());
+            if (match.abandoned) {
+                for (int p = 0; p < players; p++) {
+                    match.snapshot[p].clear();
+                }
+                match.finished = true;
+                continue;
+            }
+            stepGame(match.state, match.inputs);
+            match.encoder.recordTick(match.state);
+            // periodic keyframes are spread over the ticks so they don't all go out at once
+            bool periodic = (match.state.tick + match.id) % KEYFRAME_INTERVAL_TICKS == 0;
+            for (int p = 0; p < players; p++) {
+                if (encodeSnapshot(match.snapshot[p], match.id, match.encoder, match.state, match.acked[p],
+                    match.needsKeyframe[p] || periodic)) {
+                    match.keyframesSent++;
+                }
+            }
+            if (!match.watchers.empty()) {
+                uint32_t tick = match.state.tick;
+                uint32_t base = tick >= SPECTATOR_REDUNDANCY_TICKS ? tick - SPECTATOR_REDUNDANCY_TICKS : NO_ACK;
+                encodeSnapshot(match.spectator, match.id, match.encoder, match.state, base,
+                    match.spectatorKeyframe || tick % SPECTATOR_KEYFRAME_TICKS == 0);
+            }
+            match.finished = match.state.gameOver;
+        }
+    });
+
+    double elapsed = secondsSince(begin);
+    stats.ticks++;
+    stats.tickSeconds += elapsed;
+    stats.maxTickSeconds = std::max(stats.maxTickSeconds, elapsed);
+
+    // queue the results; a finished match frees its slot and its players have to join again
+    for (size_t i = 0; i < activeMatches.size();) {
+        int slot = activeMatches[i];
+        Match& match = matches[slot];
+        int players = static_cast<int>(match.state.snakes.size());
+        stats.keyframes += match.keyframesSent;
+        match.keyframesSent = 0;
+        for (int p = 0; p < players; p++) {
+            match.needsKeyframe[p] = false;
+            if (!match.snapshot[p].empty()) {
+                queueSend(clients[match.clients[p]].address, match.snapshot[p]);
+            }
+        }
+        match.spectatorKeyframe = false;
+        if (!match.abandoned) {
+            for (int watcher : match.watchers) {
+                queueSend(clients[watcher].address, match.spectator);
+            }
+        }
+        if (match.finished) {
+            for (int p = 0; p < players; p++) {
+                clients[match.clients[p]].match = -1;
+                clientByAddress.erase(addressKey(clients[match.clients[p]].address));
+                freeClients.push_back(match.clients[p]);
+            }
+            // relays are released too and pick another match on their next watch message
+            for (int watcher : match.watchers) {
+                clients[watcher].match = -1;
+                clientByAddress.erase(addressKey(clients[watcher].address));
+                freeClients.push_back(watcher);
+            }
+            match.watchers.clear();
+            match.active = false;
+            match.abandoned = false;
+            freeMatches.push_back(slot);
+            activeMatches[i] = activeMatches.back();
+            activeMatches.pop_back();
+            stats.matchesFinished++;
+        }
+        else {
+            i++;
+        }
+    }
+    // send now: the next tick re-encodes into the same buffers
+    flushOutgoing();
+}
+
+/*
+ * This function adds a datagram to the outgoing batch. The message is not copied, so it has
+ * to stay unchanged until flushOutgoing() runs.
+*/
+
+void MatchServer::queueSend(const NetAddress& to, const std::vector<unsigned char>& message) {
+    mmsghdr header;
+    memset(&header, 0, sizeof(header));
+    outgoing.push_back(header);
+    iovec vector;
+    vector.iov_base = const_cast<unsigned char*>(message.data());
+    vector.iov_len = message.size();
+    outgoingVectors.push_back(vector);
+    outgoingAddresses.push_back(toSockaddr(to));
+}
+
+/*
+ * This function sends everything queued since the last call with as few system calls as possible
+*/
+
+void MatchServer::flushOutgoing() {
+    // the header pointers are filled in only now, because the vectors may have reallocated
+    for (size_t i = 0; i < outgoing.size(); i++) {
+        outgoing[i].msg_hdr.msg_iov = &outgoingVectors[i];
+        outgoing[i].msg_hdr.msg_iovlen = 1;
+        outgoing[i].msg_hdr.msg_name = &outgoingAddresses[i];
+        outgoing[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        stats.bytesOut += outgoingVectors[i].iov_len;
+    }
+    size_t sent = 0;
+    while (sent < outgoing.size()) {
+        unsigned int batch = static_cast<unsigned int>(std::min<size_t>(SEND_BATCH, outgoing.size() - sent));
+        int result = sendmmsg(socket.handle(), &outgoing[sent], batch, MSG_DONTWAIT);
+        if (result <= 0) {
+            // the socket buffer is full; this is UDP, so the rest is dropped and the next
+            // snapshots cover the gap from each client's acknowledged tick
+            break;
+        }
+        sent += result;
+    }
+    stats.packetsOut += sent;
+    outgoing.clear();
+    outgoingVectors.clear();
+    outgoingAddresses.clear();
+    scratchUsed = 0;
+}
+
+/*
+ * This function removes a client; a match that loses a player ends
+*/
+
+void MatchServer::dropClient(int clientIndex) {
+    Client& client = clients[clientIndex];
+    if (client.match >= 0 && client.player < 0) {
+        std::vector<int>& watchers = matches[client.match].watchers;
+        watchers.erase(std::remove(watchers.begin(), watchers.end(), clientIndex), watchers.end());
+        clientByAddress.erase(addressKey(client.address));
+        freeClients.push_back(clientIndex);
+    }
+    else if (client.match >= 0) {
+        // ending the match frees every player in it on the next tick; the others notice
+        // the missing snapshots and join again
+        matches[client.match].abandoned = true;
+    }
+    else {
+        waiting.erase(std::remove(waiting.begin(), waiting.end(), clientIndex), waiting.end());
+        clientByAddress.erase(addressKey(client.address));
+        freeClients.push_back(clientIndex);
+    }
+}
+
+/*
+ * This function drops clients that have not sent anything for a while
+*/
+
+void MatchServer::expireClients() {
+    double now = secondsSince(startTime);
+    std::vector<int> expired;
+    for (const auto& entry : clientByAddress) {
+        const Client& client = clients[entry.second];
+        if (now - client.lastHeard > CLIENT_TIMEOUT_SECONDS) {
+            expired.push_back(entry.second);
+        }
+    }
+    for (int clientIndex : expired) {
+        dropClient(clientIndex);
+    }
+}
+
+/*
+ * main method parses the command line and runs the server
+*/
+
+int main(int argc, char** argv) {
+    ServerConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--port") == 0) config.port = static_cast<uint16_t>(atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--threads") == 0) config.threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--max-matches") == 0) config.maxMatches = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--players") == 0) config.playersPerMatch = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--tick-ms") == 0) config.tickMilliseconds = atoi(argv[i + 1]);
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (config.playersPerMatch < 1 || config.playersPerMatch > MAX_PLAYERS || config.maxMatches < 1 || config.tickMilliseconds < 1) {
+        fprintf(stderr, "invalid settings\n");
+        return 1;
+    }
+
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    MatchServer server(config);
+    return server.run();
+}
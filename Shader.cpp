@@ -0,0 +1,64 @@
+/*
+ * Title: Shader helpers
+ * Description: Implementation of the shader helpers declared in Shader.h, moved out of
+ *      main.cpp so that code without a window can build shaders too.
+*/
+
+#include "Shader.h"
+#include <glad/glad.h>
+#include <iostream>
+
+/*
+* This function helps with creating shader program
+* @param vertexSource: vertex shader source code
+* @param fragmentSource: fragment shader source code
+* @return program: integer id of shader program
+*/
+
+unsigned int createShaderProgram(const char* vertexSource, const char* fragmentSource) {
+    // Compile the shader source codes
+    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    unsigned int program = glCreateProgram();
+    // Attach each shader to the program
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    // Link the vertex and fragment shaders to the program
+    glLinkProgram(program);
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    // If linking wasn't successful, print an error message
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, nullptr, infoLog);
+        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+    //After the linking, we can delete the now useless compiled shaders
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    // Return the id (int) of program
+    return program;
+}
+
+/*
+* This function is used inside createShaderProgram to compile the shader source codes
+* @param type: type of shader: fragment or vertex
+* @return id: return the id of compiled shader
+*/
+
+unsigned int compileShader(unsigned int type, const char* source) {
+    unsigned int id = glCreateShader(type);
+    glShaderSource(id, 1, &source, nullptr);
+    // Compile the shader course code and assign it an int value
+    glCompileShader(id);
+    int success;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &success);
+    // If the compilation is not successful, print an error message
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(id, 512, nullptr, infoLog);
+        std::cerr << "ERROR::SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+    // Return the id (integer) of compiled shader
+    return id;
+}
@@ -0,0 +1,10 @@
+/*
+ * Title: Shader helpers
+ * Description: Compiling and linking GLSL programs. Shared by the game window and the
+ *      renderers, which also run in the headless render benchmark.
+*/
+
+#pragma once
+
+unsigned int compileShader(unsigned int type, const char* source);
+unsigned int createShaderProgram(const char* vertexSource, const char* fragmentSource);
@@ -0,0 +1,571 @@
+/*
+ * Title: Snapshot codec
+ * Description: Implementation of the bit-packed snapshot encoding declared in SnapshotCodec.h.
+ *
+ * Message layout (bits):
+ *      keyframe(1) tick(32)
+ *      keyframe: flags(3) smallFoodEaten(2) smallFood(16+16) bigFood(16+16) snakes(2)
+ *                per snake: score(v) alive(1) length(v) head x(16) y(16) direction(2)
+ *                           then runs of [step(3) direction(2) count-1(v)] covering the body,
+ *                           step 7 is followed by an absolute x(16) y(16) for one segment
+ *      delta:    span(v) flags(3) foodChanged(1) [smallFood bigFood] snakes(2)
+ *                per snake: scoreChanged(1) [score(v)]
+ *                per tick in the span, per snake: moved(1) [sameDirection(1) [direction(2)]]
+ *                                                 event(1) [grew(1) [growth-1(v)] died(1)]
+ *      both:     hasChecksum(1) [checksum(32)]
+ * (v) is an Exp-Golomb number. Positions are signed half-pixel units, which is exact because
+ * snakes move in strides of 2.5 and food sits on whole pixels.
+*/
+
+#include "SnapshotCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// Bits of the 3-bit flags field
+const uint32_t SNAPSHOT_GAME_OVER = 1;
+const uint32_t SNAPSHOT_SMALL_FOOD = 2;
+const uint32_t SNAPSHOT_BIG_FOOD = 4;
+
+// Longest body a message may describe; anything longer is taken to be corrupt
+const uint32_t SNAPSHOT_MAX_LENGTH = 1u << 24;
+
+// Step codes between consecutive body segments in a keyframe
+const uint32_t STEP_SAME = 0, STEP_RIGHT = 1, STEP_LEFT = 2, STEP_UP = 3, STEP_DOWN = 4, STEP_ABSOLUTE = 7;
+
+void BitWriter::bits(uint32_t value, int count) {
+    if (count < 32) {
+        value &= (1u << count) - 1;
+    }
+    accumulator |= uint64_t(value) << pending;
+    pending += count;
+    while (pending >= 8) {
+        out.push_back(static_cast<unsigned char>(accumulator & 255));
+        accumulator >>= 8;
+        pending -= 8;
+    }
+}
+
+void BitWriter::varint(uint32_t value) {
+    // Exp-Golomb: write (value + 1) in binary, preceded by as many zeros as it has bits minus one
+    uint64_t coded = uint64_t(value) + 1;
+    int length = 0;
+    while ((coded >> (length + 1)) != 0) {
+        length++;
+    }
+    bits(0, length);
+    // most significant bit first so the reader can stop at the leading one
+    for (int i = length; i >= 0; i--) {
+        bits(static_cast<uint32_t>((coded >> i) & 1), 1);
+    }
+}
+
+void BitWriter::flush() {
+    if (pending > 0) {
+        out.push_back(static_cast<unsigned char>(accumulator & 255));
+        accumulator = 0;
+        pending = 0;
+    }
+}
+
+uint32_t BitReader::bits(int count) {
+    if (bitPosition + count > size * 8) {
+        ok = false;
+        bitPosition = size * 8;
+        return 0;
+    }
+    uint32_t value = 0;
+    for (int written = 0; written < count;) {
+        size_t byte = bitPosition >> 3;
+        int offset = bitPosition & 7;
+        int take = std::min(8 - offset, count - written);
+        value |= uint32_t((data[byte] >> offset) & ((1u << take) - 1)) << written;
+        written += take;
+        bitPosition += take;
+    }
+    return value;
+}
+
+uint32_t BitReader::varint() {
+    int length = 0;
+    while (ok && bits(1) == 0) {
+        length++;
+        if (length > 32) {
+            ok = false;
+            return 0;
+        }
+    }
+    uint64_t coded = 1;
+    for (int i = 0; i < length; i++) {
+        coded = (coded << 1) | bits(1);
+    }
+    return static_cast<uint32_t>(coded - 1);
+}
+
+static int16_t quantize(float value) {
+    return static_cast<int16_t>(std::lround(value * 2.0f));
+}
+
+static float dequantize(uint32_t bits16) {
+    return static_cast<int16_t>(static_cast<uint16_t>(bits16)) * 0.5f;
+}
+
+static void writePosition(BitWriter& writer, glm::vec2 position) {
+    writer.bits(static_cast<uint16_t>(quantize(position.x)), 16);
+    writer.bits(static_cast<uint16_t>(quantize(position.y)), 16);
+}
+
+static glm::vec2 readPosition(BitReader& reader) {
+    float x = dequantize(reader.bits(16));
+    float y = dequantize(reader.bits(16));
+    return glm::vec2(x, y);
+}
+
+static uint32_t stateFlags(const GameState& state) {
+    return (state.gameOver ? SNAPSHOT_GAME_OVER : 0) | (state.smallFoodOnScreen ? SNAPSHOT_SMALL_FOOD : 0) |
+        (state.bigFoodOnScreen ? SNAPSHOT_BIG_FOOD : 0);
+}
+
+static void applyFlags(GameState& state, uint32_t flags) {
+    state.gameOver = (flags & SNAPSHOT_GAME_OVER) != 0;
+    state.smallFoodOnScreen = (flags & SNAPSHOT_SMALL_FOOD) != 0;
+    state.bigFoodOnScreen = (flags & SNAPSHOT_BIG_FOOD) != 0;
+}
+
+// Moves a head one stride, with exactly the same arithmetic as stepGame
+static void moveHead(Square& head, Direction direction) {
+    head.direction = direction;
+    switch (direction) {
+    case UP: head.position.y += MOVE_STRIDE; break;
+    case DOWN: head.position.y -= MOVE_STRIDE; break;
+    case LEFT: head.position.x -= MOVE_STRIDE; break;
+    case RIGHT: head.position.x += MOVE_STRIDE; break;
+    }
+}
+
+// Finds the step code that leads from one segment to the next
+static uint32_t stepCode(glm::vec2 from, glm::vec2 to) {
+    glm::vec2 step = to - from;
+    if (step.x == 0.0f && step.y == 0.0f) return STEP_SAME;
+    if (step.y == 0.0f && step.x == MOVE_STRIDE) return STEP_RIGHT;
+    if (step.y == 0.0f && step.x == -MOVE_STRIDE) return STEP_LEFT;
+    if (step.x == 0.0f && step.y == MOVE_STRIDE) return STEP_UP;
+    if (step.x == 0.0f && step.y == -MOVE_STRIDE) return STEP_DOWN;
+    return STEP_ABSOLUTE;
+}
+
+static glm::vec2 applyStep(glm::vec2 from, uint32_t code) {
+    switch (code) {
+    case STEP_RIGHT: from.x += MOVE_STRIDE; break;
+    case STEP_LEFT: from.x -= MOVE_STRIDE; break;
+    case STEP_UP: from.y += MOVE_STRIDE; break;
+    case STEP_DOWN: from.y -= MOVE_STRIDE; break;
+    default: break;
+    }
+    return from;
+}
+
+/*
+ * This function starts a new stream
+ * @param state: the state the stream starts from; receivers get it as a keyframe
+*/
+
+void SnapshotEncoder::reset(const GameState& state) {
+    snakeCount = std::min<int>(static_cast<int>(state.snakes.size()), MAX_PLAYERS);
+    firstTick = state.tick;
+    lastTick = state.tick;
+    for (int s = 0; s < snakeCount; s++) {
+        previousLength[s] = static_cast<uint32_t>(state.snakes[s].body.size());
+        previousAlive[s] = state.snakes[s].alive;
+    }
+}
+
+/*
+ * This function stores what changed in the tick that produced the given state
+ * @param state: the streamed state right after stepGame
+*/
+
+void SnapshotEncoder::recordTick(const GameState& state) {
+    if (state.tick == lastTick) {
+        return; // the game is over and stepGame did nothing
+    }
+    TickRecord& record = history[state.tick % SNAPSHOT_HISTORY];
+    record.tick = state.tick;
+    for (int s = 0; s < snakeCount; s++) {
+        const Snake& snake = state.snakes[s];
+        SnakeTickRecord& change = record.snakes[s];
+        change.direction = snake.body[0].direction;
+        change.moved = previousAlive[s];
+        change.died = previousAlive[s] && !snake.alive;
+        change.growth = static_cast<uint8_t>(snake.body.size() - previousLength[s]);
+        record.score[s] = static_cast<uint32_t>(snake.score);
+        previousLength[s] = static_cast<uint32_t>(snake.body.size());
+        previousAlive[s] = snake.alive;
+    }
+    record.smallFood = state.smallFood.position;
+    record.bigFood = state.bigFood.position;
+    lastTick = state.tick;
+    if (lastTick - firstTick >= SNAPSHOT_HISTORY) {
+        firstTick = lastTick - (SNAPSHOT_HISTORY - 1);
+    }
+}
+
+/*
+ * This function encodes the current state as a delta against the receiver's baseline
+ * @param state: the streamed state, at the last recorded tick
+ * @param ackTick: last tick the receiver confirmed having, or NO_ACK
+ * @param out: the message is appended here
+ * @param forceKeyframe: always send the whole state
+ * @return true if a keyframe was written
+*/
+
+bool SnapshotEncoder::encode(const GameState& state, uint32_t ackTick, std::vector<unsigned char>& out, bool forceKeyframe) {
+    bool baselineKnown = ackTick != NO_ACK && ackTick >= firstTick && ackTick <= lastTick;
+    if (forceKeyframe || !baselineKnown) {
+        encodeKeyframe(state, out);
+        return true;
+    }
+
+    BitWriter writer(out);
+    writer.flag(false);
+    writer.bits(lastTick, 32);
+    uint32_t span = lastTick - ackTick;
+    writer.varint(span);
+    writer.bits(stateFlags(state), 3);
+
+    // food and scores are sent as absolute values, and only if they changed since the baseline.
+    // A baseline equal to firstTick has no record, so treat everything as changed then.
+    const TickRecord* baseline = ackTick > firstTick ? &history[ackTick % SNAPSHOT_HISTORY] : nullptr;
+    bool foodChanged = baseline == nullptr || baseline->smallFood != state.smallFood.position || baseline->bigFood != state.bigFood.position;
+    writer.flag(foodChanged);
+    if (foodChanged) {
+        writePosition(writer, state.smallFood.position);
+        writePosition(writer, state.bigFood.position);
+    }
+    writer.bits(snakeCount, 2);
+    for (int s = 0; s < snakeCount; s++) {
+        uint32_t score = static_cast<uint32_t>(state.snakes[s].score);
+        bool scoreChanged = baseline == nullptr || baseline->score[s] != score;
+        writer.flag(scoreChanged);
+        if (scoreChanged) {
+            writer.varint(score);
+        }
+    }
+
+    Direction lastDirection[MAX_PLAYERS];
+    bool haveDirection[MAX_PLAYERS] = {};
+    for (uint32_t t = ackTick + 1; t <= lastTick; t++) {
+        const TickRecord& record = history[t % SNAPSHOT_HISTORY];
+        for (int s = 0; s < snakeCount; s++) {
+            const SnakeTickRecord& change = record.snakes[s];
+            writer.flag(change.moved);
+            if (change.moved) {
+                bool same = haveDirection[s] && lastDirection[s] == change.direction;
+                writer.flag(same);
+                if (!same) {
+                    writer.bits(change.direction, 2);
+                }
+                lastDirection[s] = change.direction;
+                haveDirection[s] = true;
+            }
+            bool event = change.growth > 0 || change.died;
+            writer.flag(event);
+            if (event) {
+                writer.flag(change.growth > 0);
+                if (change.growth > 0) {
+                    writer.varint(change.growth - 1);
+                }
+                writer.flag(change.died);
+            }
+        }
+    }
+
+    bool checksum = lastTick % SNAPSHOT_CHECKSUM_INTERVAL == 0;
+    writer.flag(checksum);
+    if (checksum) {
+        writer.bits(hashVisibleState(state), 32);
+    }
+    return false;
+}
+
+/*
+ * This function encodes the complete state. Bodies are written as the head followed by
+ * runs of identical steps, so a straight stretch of any length costs a few bits.
+ * @param state: the state to encode
+ * @param out: the message is appended here
+*/
+
+void SnapshotEncoder::encodeKeyframe(const GameState& state, std::vector<unsigned char>& out) {
+    BitWriter writer(out);
+    writer.flag(true);
+    writer.bits(state.tick, 32);
+    writer.bits(stateFlags(state), 3);
+    writer.bits(static_cast<uint32_t>(std::min(state.smallFoodEaten, 3)), 2);
+    writePosition(writer, state.smallFood.position);
+    writePosition(writer, state.bigFood.position);
+    int count = std::min<int>(static_cast<int>(state.snakes.size()), MAX_PLAYERS);
+    writer.bits(count, 2);
+
+    for (int s = 0; s < count; s++) {
+        const Snake& snake = state.snakes[s];
+        writer.varint(static_cast<uint32_t>(snake.score));
+        writer.flag(snake.alive);
+        writer.varint(static_cast<uint32_t>(snake.body.size()));
+        if (snake.body.empty()) {
+            continue;
+        }
+        writePosition(writer, snake.body[0].position);
+        writer.bits(snake.body[0].direction, 2);
+
+        size_t i = 1;
+        while (i < snake.body.size()) {
+            uint32_t code = stepCode(snake.body[i - 1].position, snake.body[i].position);
+            Direction direction = snake.body[i].direction;
+            writer.bits(code, 3);
+            writer.bits(direction, 2);
+            if (code == STEP_ABSOLUTE) {
+                writePosition(writer, snake.body[i].position);
+                i++;
+                continue;
+            }
+            size_t run = 1;
+            while (i + run < snake.body.size() && snake.body[i + run].direction == direction &&
+                stepCode(snake.body[i + run - 1].position, snake.body[i + run].position) == code) {
+                run++;
+            }
+            writer.varint(static_cast<uint32_t>(run - 1));
+            i += run;
+        }
+    }
+    writer.flag(false); // keyframes carry the state itself, no checksum needed
+}
+
+bool peekSnapshot(const unsigned char* data, size_t size, uint32_t& tick, bool& keyframe) {
+    BitReader reader(data, size);
+    keyframe = reader.flag();
+    tick = reader.bits(32);
+    return reader.ok;
+}
+
+// One snake's part of a delta tick that the receiver hasn't seen yet
+struct DeltaStep {
+    uint8_t snake = 0;
+    bool moved = false;
+    bool died = false;
+    Direction direction = UP;
+    uint32_t growth = 0;
+};
+
+/*
+ * This function decodes a keyframe into a state
+*/
+
+static bool decodeKeyframe(BitReader& reader, uint32_t tick, GameState& state) {
+    state.tick = tick;
+    applyFlags(state, reader.bits(3));
+    state.smallFoodEaten = static_cast<int>(reader.bits(2));
+    state.smallFood.position = readPosition(reader);
+    state.bigFood.position = readPosition(reader);
+    int count = static_cast<int>(reader.bits(2));
+    if (count > MAX_PLAYERS) {
+        return false;
+    }
+    state.snakes.resize(count);
+    for (Snake& snake : state.snakes) {
+        snake.score = static_cast<int>(reader.varint());
+        snake.alive = reader.flag();
+        uint32_t length = reader.varint();
+        if (!reader.ok || length > SNAPSHOT_MAX_LENGTH) {
+            return false;
+        }
+        snake.body.resize(length);
+        if (length == 0) {
+            continue;
+        }
+        snake.body[0].position = readPosition(reader);
+        snake.body[0].direction = static_cast<Direction>(reader.bits(2));
+
+        size_t i = 1;
+        while (i < length && reader.ok) {
+            uint32_t code = reader.bits(3);
+            Direction direction = static_cast<Direction>(reader.bits(2));
+            if (code == STEP_ABSOLUTE) {
+                snake.body[i].position = readPosition(reader);
+                snake.body[i].direction = direction;
+                i++;
+                continue;
+            }
+            size_t run = reader.varint() + 1;
+            if (code > STEP_DOWN || i + run > length) {
+                return false;
+            }
+            for (size_t r = 0; r < run; r++, i++) {
+                snake.body[i].position = applyStep(snake.body[i - 1].position, code);
+                snake.body[i].direction = direction;
+            }
+        }
+    }
+    return reader.ok;
+}
+
+/*
+ * This function applies a snapshot message to a receiver's copy of the state
+ * @param data: message bytes (without any transport header)
+ * @param size: message size
+ * @param state: receiver copy; replaced by a keyframe, advanced by a delta
+ * @return SNAPSHOT_APPLIED, SNAPSHOT_STALE (nothing new in it) or SNAPSHOT_NEED_KEYFRAME
+ *      (the receiver is behind the message's baseline, or the message is broken)
+ *
+ * Nothing in state changes until the whole message has been read, so a truncated or corrupt
+ * message leaves it as it was: a keyframe is decoded into a copy kept per thread, and a
+ * delta's ticks are noted as steps and replayed at the end.
+*/
+
+SnapshotResult decodeSnapshot(const unsigned char* data, size_t size, GameState& state) {
+    BitReader reader(data, size);
+    bool keyframe = reader.flag();
+    uint32_t tick = reader.bits(32);
+    if (!reader.ok) {
+        return SNAPSHOT_NEED_KEYFRAME;
+    }
+
+    if (keyframe) {
+        // everything but the random state and the food directions comes from the message
+        static thread_local GameState scratch;
+        scratch.rngState = state.rngState;
+        scratch.smallFood = state.smallFood;
+        scratch.bigFood = state.bigFood;
+        if (!decodeKeyframe(reader, tick, scratch)) {
+            return SNAPSHOT_NEED_KEYFRAME;
+        }
+        std::swap(state, scratch);
+        return SNAPSHOT_APPLIED;
+    }
+
+    uint32_t span = reader.varint();
+    uint32_t baseTick = tick - span;
+    uint32_t current = state.tick;
+    if (tick <= current) {
+        return SNAPSHOT_STALE;
+    }
+    if (baseTick > current) {
+        return SNAPSHOT_NEED_KEYFRAME; // we missed ticks this message doesn't describe
+    }
+
+    uint32_t flags = reader.bits(3);
+    bool foodChanged = reader.flag();
+    glm::vec2 smallFood = state.smallFood.position, bigFood = state.bigFood.position;
+    if (foodChanged) {
+        smallFood = readPosition(reader);
+        bigFood = readPosition(reader);
+    }
+    int count = static_cast<int>(reader.bits(2));
+    if (!reader.ok || count != static_cast<int>(state.snakes.size())) {
+        return SNAPSHOT_NEED_KEYFRAME;
+    }
+    int score[MAX_PLAYERS];
+    for (int s = 0; s < count; s++) {
+        score[s] = reader.flag() ? static_cast<int>(reader.varint()) : state.snakes[s].score;
+    }
+    if (!reader.ok) {
+        return SNAPSHOT_NEED_KEYFRAME;
+    }
+
+    // Ticks up to our current one are parsed and skipped; the rest are noted as steps and
+    // replayed once the message has been read to the end
+    static thread_local std::vector<DeltaStep> steps;
+    steps.clear();
+    size_t length[MAX_PLAYERS];
+    for (int s = 0; s < count; s++) {
+        length[s] = state.snakes[s].body.size();
+    }
+    Direction lastDirection[MAX_PLAYERS] = {};
+    for (uint32_t t = baseTick + 1; t <= tick && reader.ok; t++) {
+        bool apply = t > current;
+        for (int s = 0; s < count; s++) {
+            DeltaStep step;
+            step.snake = static_cast<uint8_t>(s);
+            step.moved = reader.flag();
+            if (step.moved && !reader.flag()) {
+                lastDirection[s] = static_cast<Direction>(reader.bits(2));
+            }
+            step.direction = lastDirection[s];
+            if (reader.flag()) {
+                step.growth = reader.flag() ? reader.varint() + 1 : 0;
+                step.died = reader.flag();
+            }
+            // a corrupt count would otherwise ask for gigabytes of segments
+            if (step.growth > SNAPSHOT_MAX_LENGTH - std::min<size_t>(length[s], SNAPSHOT_MAX_LENGTH)) {
+                return SNAPSHOT_NEED_KEYFRAME;
+            }
+            if (apply && (step.moved || step.growth > 0 || step.died)) {
+                length[s] += length[s] > 0 ? step.growth : 0;
+                steps.push_back(step);
+            }
+        }
+    }
+
+    bool hasChecksum = reader.flag();
+    uint32_t checksum = hasChecksum ? reader.bits(32) : 0;
+    if (!reader.ok) {
+        return SNAPSHOT_NEED_KEYFRAME;
+    }
+
+    // Replayed like stepGame: shift the body, move the head, append the grown segments, then
+    // mark deaths
+    for (const DeltaStep& step : steps) {
+        Snake& snake = state.snakes[step.snake];
+        if (step.moved && !snake.body.empty()) {
+            std::copy_backward(snake.body.begin(), snake.body.end() - 1, snake.body.end());
+            moveHead(snake.body[0], step.direction);
+        }
+        if (step.growth > 0 && !snake.body.empty()) {
+            Square tail = snake.body.back();
+            snake.body.insert(snake.body.end(), step.growth, tail);
+        }
+        if (step.died) {
+            snake.alive = false;
+        }
+    }
+    for (int s = 0; s < count; s++) {
+        state.snakes[s].score = score[s];
+    }
+    state.smallFood.position = smallFood;
+    state.bigFood.position = bigFood;
+    applyFlags(state, flags);
+    state.tick = tick;
+    // the keyframe this asks for replaces the state that didn't match
+    if (hasChecksum && checksum != hashVisibleState(state)) {
+        return SNAPSHOT_NEED_KEYFRAME;
+    }
+    return SNAPSHOT_APPLIED;
+}
+
+/*
+ * This function hashes only what receivers can see (bodies, food, scores). hashGameState
+ * can't be used because receivers don't have the random generator's state.
+*/
+
+uint32_t hashVisibleState(const GameState& state) {
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            hash ^= (value >> (i * 8)) & 255;
+            hash *= 16777619u;
+        }
+    };
+    auto mixPosition = [&mix](glm::vec2 position) {
+        mix(static_cast<uint16_t>(quantize(position.x)) | (uint32_t(static_cast<uint16_t>(quantize(position.y))) << 16));
+    };
+    for (const Snake& snake : state.snakes) {
+        mix(static_cast<uint32_t>(snake.body.size()));
+        for (const Square& segment : snake.body) {
+            mixPosition(segment.position);
+            mix(segment.direction);
+        }
+        mix(static_cast<uint32_t>(snake.score));
+    }
+    mixPosition(state.smallFood.position);
+    mixPosition(state.bigFood.position);
+    return hash;
+}
@@ -0,0 +1,102 @@
+/*
+ * Title: Snapshot codec
+ * Description: Bit-packed encoding of game state for network and spectator streams.
+ *
+ *      A snake only changes in a few ways per tick: the head advances one stride, the tail
+ *      follows, and now and then it grows or dies. The encoder keeps a short history of those
+ *      per-tick changes and describes everything that happened since the tick the receiver last
+ *      acknowledged (its baseline), usually 1-3 bits per snake per tick whatever the length.
+ *      Because the message lists each tick separately, a receiver that is already past the
+ *      baseline simply skips the ticks it has, so nothing has to be stored per baseline.
+ *      Keyframes carry the whole state (bodies run-length encoded) and are sent when a stream
+ *      starts, when the baseline is too old, and periodically for viewers joining late.
+*/
+
+#pragma once
+
+#include "Game.h"
+#include <cstdint>
+#include <vector>
+
+const uint32_t NO_ACK = UINT32_MAX;           // receiver has acknowledged nothing yet
+const int SNAPSHOT_HISTORY = 128;             // ticks a delta can reach back
+const uint32_t SNAPSHOT_CHECKSUM_INTERVAL = 64;
+
+// Writes values of any bit width into a byte vector, least significant bit first
+class BitWriter {
+public:
+    // appends to out, keeping what is already there
+    explicit BitWriter(std::vector<unsigned char>& out) : out(out) {}
+    ~BitWriter() { flush(); }
+    void bits(uint32_t value, int count);
+    void flag(bool value) { bits(value ? 1 : 0, 1); }
+    // Exp-Golomb code: small numbers take few bits (0 -> 1 bit, 1-2 -> 3 bits, ...)
+    void varint(uint32_t value);
+    void flush();
+private:
+    std::vector<unsigned char>& out;
+    uint64_t accumulator = 0;
+    int pending = 0;
+};
+
+// Reads what BitWriter wrote; running out of data sets ok to false and returns zeros
+class BitReader {
+public:
+    BitReader(const unsigned char* data, size_t size) : data(data), size(size) {}
+    uint32_t bits(int count);
+    bool flag() { return bits(1) != 0; }
+    uint32_t varint();
+    bool ok = true;
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t bitPosition = 0;
+};
+
+// What one snake did during one tick
+struct SnakeTickRecord {
+    Direction direction = RIGHT;  // head direction after the tick
+    bool moved = false;           // false once the snake is dead
+    bool died = false;
+    uint8_t growth = 0;           // segments appended this tick
+};
+
+// Everything needed to describe one tick to a receiver
+struct TickRecord {
+    uint32_t tick = 0;
+    SnakeTickRecord snakes[MAX_PLAYERS];
+    uint32_t score[MAX_PLAYERS] = {};
+    glm::vec2 smallFood = glm::vec2(0.0f);
+    glm::vec2 bigFood = glm::vec2(0.0f);
+};
+
+class SnapshotEncoder {
+public:
+    // Starts a new stream at the given state (match start)
+    void reset(const GameState& state);
+    // Call after every stepGame on the state being streamed
+    void recordTick(const GameState& state);
+    // Encodes the current state for a receiver whose last acknowledged tick is ackTick.
+    // Falls back to a keyframe when the baseline is unknown or older than the history.
+    // The message is appended to out. Returns true if a keyframe was written.
+    bool encode(const GameState& state, uint32_t ackTick, std::vector<unsigned char>& out, bool forceKeyframe = false);
+    void encodeKeyframe(const GameState& state, std::vector<unsigned char>& out);
+    uint32_t tick() const { return lastTick; }
+
+private:
+    TickRecord history[SNAPSHOT_HISTORY];
+    uint32_t firstTick = 0;       // oldest tick still in history
+    uint32_t lastTick = 0;        // tick of the current state
+    uint32_t previousLength[MAX_PLAYERS] = {};
+    bool previousAlive[MAX_PLAYERS] = {};
+    int snakeCount = 0;
+};
+
+enum SnapshotResult { SNAPSHOT_APPLIED, SNAPSHOT_STALE, SNAPSHOT_NEED_KEYFRAME };
+
+// Applies a snapshot message to a receiver's copy of the state; a broken message leaves it untouched
+SnapshotResult decodeSnapshot(const unsigned char* data, size_t size, GameState& state);
+// Peeks at a message: its tick and whether it is a keyframe
+bool peekSnapshot(const unsigned char* data, size_t size, uint32_t& tick, bool& keyframe);
+// Hash of what receivers can see (bodies, scores, food); the generator state is not streamed
+uint32_t hashVisibleState(const GameState& state);
@@ -0,0 +1,328 @@
+/*
+ * Title: Software renderer
+ * Description: Implementation of the CPU drawing declared in SoftwareRenderer.h.
+*/
+
+#include "SoftwareRenderer.h"
+#include "Log.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_SSE2 1
+#endif
+
+const float ALPHA_CUTOFF = 0.1f * 255.0f;  // the shader discards texels under this alpha
+
+/*
+ * This function wraps a texel coordinate around the texture, like GL_REPEAT
+ * @param i: the texel coordinate, possibly outside the texture
+ * @param size: the texture's width or height
+ * @return the coordinate inside the texture
+*/
+
+static int repeat(int i, int size) {
+    i %= size;
+    return i < 0 ? i + size : i;
+}
+
+/*
+ * This function samples one mip level between its four nearest texels, like GL_LINEAR
+ * @param texels, width, height: the mip level
+ * @param u, v: texture coordinates, 0 to 1 across the level
+ * @param color: gets red, green, blue and alpha, 0 to 255
+*/
+
+static void bilinear(const std::vector<uint32_t>& texels, int width, int height, float u, float v, float color[4]) {
+    float x = u * width - 0.5f;
+    float y = v * height - 0.5f;
+    float fx = std::floor(x);
+    float fy = std::floor(y);
+    float a = x - fx;
+    float b = y - fy;
+    int x0 = repeat((int)fx, width);
+    int x1 = repeat((int)fx + 1, width);
+    int y0 = repeat((int)fy, height);
+    int y1 = repeat((int)fy + 1, height);
+    uint32_t t00 = texels[(size_t)y0 * width + x0];
+    uint32_t t10 = texels[(size_t)y0 * width + x1];
+    uint32_t t01 = texels[(size_t)y1 * width + x0];
+    uint32_t t11 = texels[(size_t)y1 * width + x1];
+    for (int c = 0; c < 4; c++) {
+        int shift = c * 8;
+        float bottom = ((t00 >> shift) & 0xFF) * (1.0f - a) + ((t10 >> shift) & 0xFF) * a;
+        float top = ((t01 >> shift) & 0xFF) * (1.0f - a) + ((t11 >> shift) & 0xFF) * a;
+        color[c] = bottom * (1.0f - b) + top * b;
+    }
+}
+
+/*
+ * This function packs a filtered color into a pixel
+ * @param color: red, green, blue and alpha, 0 to 255
+ * @return the pixel, red in the lowest byte
+*/
+
+static uint32_t pack(const float color[4]) {
+    uint32_t pixel = 0;
+    for (int c = 0; c < 4; c++) {
+        pixel |= (uint32_t)std::min(255.0f, std::max(0.0f, color[c] + 0.5f)) << (c * 8);
+    }
+    return pixel;
+}
+
+/*
+ * This function samples a mipmapped texture the way GL_LINEAR_MIPMAP_LINEAR does, with
+ * GL_LINEAR for magnification
+ * @param levels: the texture's mip chain, largest first
+ * @param u, v: texture coordinates, 0 to 1 across the texture
+ * @param lod: log2 of the texels per pixel
+ * @return the sampled pixel, red in the lowest byte
+*/
+
+uint32_t SoftwareRenderer::sample(const std::vector<Image>& levels, float u, float v, float lod) {
+    float color[4];
+    int last = (int)levels.size() - 1;
+    if (lod <= 0.0f || last == 0) {// magnified: the largest level only
+        bilinear(levels[0].texels, levels[0].width, levels[0].height, u, v, color);
+        return pack(color);
+    }
+    int level = (int)std::floor(lod);
+    if (level >= last) {
+        const Image& image = levels[last];
+        bilinear(image.texels, image.width, image.height, u, v, color);
+        return pack(color);
+    }
+    float blend = lod - level;
+    float next[4];
+    bilinear(levels[level].texels, levels[level].width, levels[level].height, u, v, color);
+    bilinear(levels[level + 1].texels, levels[level + 1].width, levels[level + 1].height, u, v, next);
+    for (int c = 0; c < 4; c++) {
+        color[c] = color[c] * (1.0f - blend) + next[c] * blend;
+    }
+    return pack(color);
+}
+
+/*
+ * This function loads a texture and makes its mip chain the way Mesa's glGenerateMipmap does,
+ * sampling each texel of a level between the four texels of the level above under its center.
+ * For even sizes that is the average of a 2x2 block; for odd sizes the blocks drift across the
+ * level, as they do in the textures the GL renderer draws with.
+ * @param levels: gets the mip chain, largest first
+ * @param path: path to the texture
+ * @return true if the texture loaded
+*/
+
+bool SoftwareRenderer::loadSprite(std::vector<Image>& levels, const char* path) {
+    stbi_set_flip_vertically_on_load(true);
+    int width, height, nrComponents;
+    // Always four components; stb_image gives images without alpha an opaque one
+    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 4);
+    if (!data) {
+        LOG_ERROR("Texture failed to load at path: %s", path);
+        return false;
+    }
+    levels.clear();
+    levels.push_back(Image{ width, height, std::vector<uint32_t>((size_t)width * height) });
+    std::memcpy(levels[0].texels.data(), data, (size_t)width * height * 4);
+    stbi_image_free(data);
+
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const Image& source = levels.back();
+        Image image{ std::max(1, source.width / 2), std::max(1, source.height / 2), {} };
+        image.texels.resize((size_t)image.width * image.height);
+        float color[4];
+        for (int y = 0; y < image.height; y++) {
+            float v = (y + 0.5f) / image.height;
+            for (int x = 0; x < image.width; x++) {
+                bilinear(source.texels, source.width, source.height, (x + 0.5f) / image.width, v, color);
+                image.texels[(size_t)y * image.width + x] = pack(color);
+            }
+        }
+        levels.push_back(std::move(image));
+    }
+    return true;
+}
+
+bool SoftwareRenderer::init(int width, int height) {
+    frameWidth = width;
+    frameHeight = height;
+    frame.assign((size_t)width * height, 0);
+    background.assign((size_t)width * height, 0);
+    backgroundProjection = glm::mat4(0.0f);
+    tileCache.clear();
+    // CLASSIC_BIG_FOOD draws with the food's levels
+    return loadSprite(sprites[CLASSIC_BODY], "textures/body3.png")
+        && loadSprite(sprites[CLASSIC_HEAD_1], "textures/head1.png")
+        && loadSprite(sprites[CLASSIC_HEAD_2], "textures/head2.png")
+        && loadSprite(sprites[CLASSIC_FOOD], "textures/food.png")
+        && loadSprite(backgroundImage, "textures/snakeBackground.png");
+}
+
+void SoftwareRenderer::drawBackground(const glm::mat4& projection) {
+    if (projection != backgroundProjection) {// sample it again for the new projection
+        backgroundProjection = projection;
+        std::fill(background.begin(), background.end(), 0);
+        float sx = projection[0][0] * frameWidth / 2.0f;
+        float sy = projection[1][1] * frameHeight / 2.0f;
+        float x0 = (projection[3][0] + 1.0f) * frameWidth / 2.0f;
+        float y0 = (projection[3][1] + 1.0f) * frameHeight / 2.0f;
+        float x1 = x0 + windowWIDTH * sx;
+        float y1 = y0 + windowHEIGHT * sy;
+        const Image& image = backgroundImage[0];
+        float lod = std::log2(std::max(image.width / (x1 - x0), image.height / (y1 - y0)));
+        // The pixels whose centers are inside the quad
+        int left = std::max(0, (int)std::ceil(x0 - 0.5f));
+        int right = std::min(frameWidth, (int)std::ceil(x1 - 0.5f));
+        int bottom = std::max(0, (int)std::ceil(y0 - 0.5f));
+        int top = std::min(frameHeight, (int)std::ceil(y1 - 0.5f));
+        for (int y = bottom; y < top; y++) {
+            float v = (y + 0.5f - y0) / (y1 - y0);
+            for (int x = left; x < right; x++) {
+                float u = (x + 0.5f - x0) / (x1 - x0);
+                background[(size_t)y * frameWidth + x] = sample(backgroundImage, u, v, lod);
+            }
+        }
+    }
+    std::memcpy(frame.data(), background.data(), frame.size() * sizeof(uint32_t));
+}
+
+void SoftwareRenderer::beginBoard(const glm::mat4& projection) {
+    float sx = projection[0][0] * frameWidth / 2.0f;
+    float sy = projection[1][1] * frameHeight / 2.0f;
+    if (sx != scaleX || sy != scaleY) {// the tiles were sampled at another size
+        tileCache.clear();
+        scaleX = sx;
+        scaleY = sy;
+    }
+    offsetX = (projection[3][0] + 1.0f) * frameWidth / 2.0f;
+    offsetY = (projection[3][1] + 1.0f) * frameHeight / 2.0f;
+}
+
+/*
+ * This function finds the tile for a sprite, sampling it the first time it is asked for
+ * @param sprite: which sprite
+ * @param direction: which way the sprite faces
+ * @param subX, subY: where the square's corner is inside its pixel, in 1/SOFTWARE_SUBPIXELS
+ * @return the tile
+*/
+
+const SoftwareRenderer::Tile& SoftwareRenderer::tile(ClassicSprite sprite, Direction direction, int subX, int subY) {
+    uint32_t key = (uint32_t)sprite | ((uint32_t)direction << 3) | ((uint32_t)subX << 5) | ((uint32_t)subY << 9);
+    std::unordered_map<uint32_t, Tile>::iterator found = tileCache.find(key);
+    if (found != tileCache.end()) {
+        return found->second;
+    }
+
+    const std::vector<Image>& levels = sprites[sprite == CLASSIC_BIG_FOOD ? CLASSIC_FOOD : sprite];
+    float half = classicHalfSize(sprite);
+    float x0 = (float)subX / SOFTWARE_SUBPIXELS;
+    float y0 = (float)subY / SOFTWARE_SUBPIXELS;
+    float x1 = x0 + 2.0f * half * scaleX;
+    float y1 = y0 + 2.0f * half * scaleY;
+    // The texture's width runs along the screen's y when the sprite is turned up or down
+    bool turned = direction == UP || direction == DOWN;
+    float texelsX = (float)(turned ? levels[0].height : levels[0].width);
+    float texelsY = (float)(turned ? levels[0].width : levels[0].height);
+    float lod = std::log2(std::max(texelsX / (x1 - x0), texelsY / (y1 - y0)));
+
+    Tile& result = tileCache[key];
+    result.x = (int)std::ceil(x0 - 0.5f);
+    result.y = (int)std::ceil(y0 - 0.5f);
+    result.width = (int)std::ceil(x1 - 0.5f) - result.x;
+    result.height = (int)std::ceil(y1 - 0.5f) - result.y;
+    result.pixels.resize((size_t)result.width * result.height);
+    for (int y = 0; y < result.height; y++) {
+        // From the square's center, in world units
+        float ly = (result.y + y + 0.5f - (y0 + y1) / 2.0f) / scaleY;
+        for (int x = 0; x < result.width; x++) {
+            float lx = (result.x + x + 0.5f - (x0 + x1) / 2.0f) / scaleX;
+            // Turn back by the square's rotation to get the sprite's own coordinates
+            float sx, sy;
+            switch (direction) {
+            case UP: sx = ly; sy = -lx; break;           // 90 degrees
+            case DOWN: sx = -ly; sy = lx; break;         // 270 degrees
+            case LEFT: sx = -lx; sy = -ly; break;        // 180 degrees
+            default: sx = lx; sy = ly; break;
+            }
+            uint32_t pixel = sample(levels, (sx + half) / (2.0f * half), (sy + half) / (2.0f * half), lod);
+            // Discarded texels are left as 0 so the blit keeps the framebuffer's pixel
+            result.pixels[(size_t)y * result.width + x] = (pixel >> 24) < ALPHA_CUTOFF ? 0 : pixel;
+        }
+    }
+    return result;
+}
+
+/*
+ * This function copies a tile into the framebuffer, keeping the framebuffer's pixels under
+ * the tile's discarded texels
+ * @param tile: the tile to copy
+ * @param x, y: the framebuffer pixel the tile's first pixel goes to
+*/
+
+void SoftwareRenderer::blit(const Tile& tile, int x, int y) {
+    int left = std::max(0, -x);
+    int right = std::min(tile.width, frameWidth - x);
+    int bottom = std::max(0, -y);
+    int top = std::min(tile.height, frameHeight - y);
+    int count = right - left;
+    if (count <= 0) {
+        return;
+    }
+    for (int row = bottom; row < top; row++) {
+        const uint32_t* source = tile.pixels.data() + (size_t)row * tile.width + left;
+        uint32_t* destination = frame.data() + (size_t)(y + row) * frameWidth + x + left;
+        int i = 0;
+#ifdef SOFTWARE_SSE2
+        if (vectorized) {
+            const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+            const __m128i zero = _mm_setzero_si128();
+            for (; i + 4 <= count; i += 4) {
+                __m128i texels = _mm_loadu_si128((const __m128i*)(source + i));
+                __m128i pixels = _mm_loadu_si128((const __m128i*)(destination + i));
+                // All ones where the texel was discarded
+                __m128i keep = _mm_cmpeq_epi32(_mm_and_si128(texels, alpha), zero);
+                pixels = _mm_or_si128(_mm_and_si128(keep, pixels), _mm_andnot_si128(keep, texels));
+                _mm_storeu_si128((__m128i*)(destination + i), pixels);
+            }
+        }
+#endif
+        for (; i < count; i++) {
+            if (source[i] >> 24) {
+                destination[i] = source[i];
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::drawSprite(const Square& square, ClassicSprite sprite) {
+    float half = classicHalfSize(sprite);
+    float left = (square.position.x - half) * scaleX + offsetX;
+    float bottom = (square.position.y - half) * scaleY + offsetY;
+    int x = (int)std::floor(left);
+    int y = (int)std::floor(bottom);
+    int subX = (int)std::lround((left - x) * SOFTWARE_SUBPIXELS);
+    int subY = (int)std::lround((bottom - y) * SOFTWARE_SUBPIXELS);
+    if (subX == SOFTWARE_SUBPIXELS) {
+        x++;
+        subX = 0;
+    }
+    if (subY == SOFTWARE_SUBPIXELS) {
+        y++;
+        subY = 0;
+    }
+    const Tile& found = tile(sprite, square.direction, subX, subY);
+    blit(found, x + found.x, y + found.y);
+}
+
+void SoftwareRenderer::release() {
+    for (int i = 0; i < CLASSIC_SPRITES; i++) {
+        sprites[i].clear();
+    }
+    backgroundImage.clear();
+    frame.clear();
+    background.clear();
+    tileCache.clear();
+}
@@ -0,0 +1,89 @@
+/*
+ * Title: Software renderer
+ * Description: Draws the classic game on the CPU into an RGBA8 framebuffer, for machines
+ *      without a GPU, where the GL path would go through a software rasterizer anyway. It is
+ *      a ClassicBackend, so drawClassicBoard() draws the same squares with it as with the GL
+ *      renderer, and it needs no GL context at all.
+ *
+ *      The sprites are decoded by stb_image and given mipmaps the way glGenerateMipmap makes
+ *      them, and a square is sampled the way the game's shader samples it: trilinear,
+ *      repeating at the edges, covering the pixels whose centers fall inside it, and leaving
+ *      out texels with alpha under 0.1. That costs a few hundred operations a pixel, but the
+ *      snake moves in steps of MOVE_STRIDE, so a sprite only lands on a few sub-pixel offsets;
+ *      each sprite, direction and offset (to 1/16 pixel) is sampled once into a tile, and
+ *      every square after that is a copy of its tile. The copy goes a row at a time, four
+ *      pixels per SSE2 instruction, keeping the framebuffer's pixel wherever the tile's texel
+ *      failed the alpha test. The background never moves, so it is sampled once at the
+ *      framebuffer's size and a frame starts with one memcpy of it.
+ *
+ *      Rows go from the bottom up, like glReadPixels, so a frame can be compared with the GL
+ *      one pixel for pixel.
+*/
+
+#pragma once
+
+#include "ClassicBackend.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+const int SOFTWARE_SUBPIXELS = 16;        // sub-pixel offsets a tile is made for, per axis
+
+class SoftwareRenderer : public ClassicBackend {
+public:
+    // Loads the sprites from textures/; returns false if one is missing
+    bool init(int width, int height);
+    void drawBackground(const glm::mat4& projection) override;
+    void beginBoard(const glm::mat4& projection) override;
+    void drawSprite(const Square& square, ClassicSprite sprite) override;
+    // Draws every snake, then the food that is on screen
+    void drawBoard(const GameState& state, const glm::mat4& projection) { drawClassicBoard(*this, state, projection); }
+    void release();
+
+    // RGBA8, a uint32_t per pixel with red in the lowest byte, bottom row first
+    const uint32_t* pixels() const { return frame.data(); }
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    // Copies tiles a pixel at a time instead of with SSE2, for comparisons
+    void setVectorized(bool enabled) { vectorized = enabled; }
+    // Tiles sampled so far
+    size_t tiles() const { return tileCache.size(); }
+
+private:
+    // One mip level
+    struct Image {
+        int width = 0;
+        int height = 0;
+        std::vector<uint32_t> texels;
+    };
+
+    // A sprite sampled at one direction and sub-pixel offset; texels that failed the alpha
+    // test are 0
+    struct Tile {
+        int x = 0;                // first pixel, from the pixel the square's corner is in
+        int y = 0;
+        int width = 0;
+        int height = 0;
+        std::vector<uint32_t> pixels;
+    };
+
+    bool loadSprite(std::vector<Image>& levels, const char* path);
+    static uint32_t sample(const std::vector<Image>& levels, float u, float v, float lod);
+    const Tile& tile(ClassicSprite sprite, Direction direction, int offsetX, int offsetY);
+    void blit(const Tile& tile, int x, int y);
+
+    std::vector<Image> sprites[CLASSIC_SPRITES];
+    std::vector<Image> backgroundImage;
+    std::vector<uint32_t> frame;
+    std::vector<uint32_t> background; // the background sampled at the framebuffer's size
+    glm::mat4 backgroundProjection = glm::mat4(0.0f);
+    std::unordered_map<uint32_t, Tile> tileCache;
+    int frameWidth = 0;
+    int frameHeight = 0;
+    // world to pixel: pixel = world * scale + offset, from the board's projection
+    float scaleX = 0.0f;
+    float scaleY = 0.0f;
+    float offsetX = 0.0f;
+    float offsetY = 0.0f;
+    bool vectorized = true;
+};
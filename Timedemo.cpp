@@ -0,0 +1,162 @@
+/*
+ * Title: Timedemo
+ * Description: Implementation of the replay playback and its report declared in Timedemo.h.
+*/
+
+#include "Timedemo.h"
+#include "ArenaRenderer.h"
+#include "Camera.h"
+#include "FrameArena.h"
+#include "GlStats.h"
+#include "WorkerPool.h"
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+typedef std::chrono::steady_clock TimedemoClock;
+
+static double milliseconds(TimedemoClock::time_point start, TimedemoClock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/*
+ * This function summarizes a list of times (the list gets sorted)
+ * @param samples: the times in milliseconds
+ * @return their mean, percentiles and maximum
+*/
+
+static TimedemoTimes summarize(std::vector<double>& samples) {
+    TimedemoTimes times;
+    if (samples.empty()) {
+        return times;
+    }
+    std::sort(samples.begin(), samples.end());
+    for (double sample : samples) {
+        times.mean += sample / samples.size();
+    }
+    auto percentile = [&](double p) { return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))]; };
+    times.p50 = percentile(0.50);
+    times.p95 = percentile(0.95);
+    times.p99 = percentile(0.99);
+    times.max = samples.back();
+    return times;
+}
+
+TimedemoResult runTimedemo(const Replay& replay, ClassicRenderer& renderer, int width, int height, const std::function<void()>& present) {
+    TimedemoResult result;
+    result.mode = replay.mode;
+    // frames are timed with the driver's own entry points, not the counting wrappers; the
+    // counting goes back on afterwards for whoever had it on
+    bool glStatsWereInstalled = glStatsInstalled();
+    glStatsUninstall();
+    glm::mat4 projection = glm::ortho(0.0f, windowWIDTH, 0.0f, windowHEIGHT);
+
+    ReplayPlayer player;
+    player.start(replay);
+    // The arena is stepped on every core, as in the game; its camera jumps to the player's head
+    // every frame instead of following it, so the view doesn't depend on the frame times
+    bool arenaMode = replay.mode == REPLAY_ARENA;
+    WorkerPool pool(arenaMode ? 0 : 1);
+    ArenaRenderer arenaRenderer;
+    Camera camera;
+    FrameArena scratch;
+    if (arenaMode) {
+        ArenaTextures textures;
+        textures.body = renderer.bodyTexture();
+        textures.playerHead = renderer.headTexture(0);
+        textures.botHead = renderer.headTexture(1);
+        textures.food = renderer.foodTexture();
+        arenaRenderer.init(player.arena, textures);
+        camera.setBounds(replay.arena.width * MOVE_STRIDE, replay.arena.height * MOVE_STRIDE);
+        camera.setViewport(width, height);
+    }
+
+    std::vector<double> frameTimes, tickTimes;
+    frameTimes.reserve(replay.ticks());
+    tickTimes.reserve(replay.ticks());
+    uint64_t drawCalls = 0;
+    result.drawCallsMin = UINT32_MAX;
+    TimedemoClock::time_point start = TimedemoClock::now();
+    while (true) {
+        TimedemoClock::time_point frameStart = TimedemoClock::now();
+        if (!player.step(pool)) {
+            break;
+        }
+        tickTimes.push_back(milliseconds(frameStart, TimedemoClock::now()));
+
+        uint64_t drawsBefore = renderer.drawCalls();
+        glViewport(0, 0, width, height);
+        glClear(GL_COLOR_BUFFER_BIT);
+        renderer.drawBackground(projection);
+        if (arenaMode) {
+            scratch.reset();
+            arenaRenderer.noteTick(player.arena);
+            camera.lookAt(arenaPosition(player.arena.snakes[0].segment(0)));
+            arenaRenderer.draw(player.arena, camera, scratch);
+        }
+        else {
+            renderer.drawBoard(player.game, projection);
+        }
+        glFinish();
+        present();
+        frameTimes.push_back(milliseconds(frameStart, TimedemoClock::now()));
+
+        uint32_t draws = static_cast<uint32_t>(renderer.drawCalls() - drawsBefore);
+        if (arenaMode) {
+            draws += static_cast<uint32_t>(arenaRenderer.stats().drawCalls);
+        }
+        drawCalls += draws;
+        result.drawCallsMin = std::min(result.drawCallsMin, draws);
+        result.drawCallsMax = std::max(result.drawCallsMax, draws);
+    }
+    result.wallSeconds = milliseconds(start, TimedemoClock::now()) / 1000.0;
+
+    result.frames = static_cast<uint32_t>(frameTimes.size());
+    result.hash = player.hash();
+    result.frameTimes = summarize(frameTimes);
+    result.tickTimes = summarize(tickTimes);
+    if (result.frames > 0) {
+        result.drawCallsMean = static_cast<double>(drawCalls) / result.frames;
+    }
+    else {
+        result.drawCallsMin = 0;
+    }
+    if (arenaMode) {
+        arenaRenderer.release();
+    }
+    if (glStatsWereInstalled) {
+        glStatsInstall();
+    }
+    return result;
+}
+
+/*
+ * This function writes a distribution of times as a JSON object
+*/
+
+static void writeTimes(FILE* out, const char* name, const TimedemoTimes& times, bool last) {
+    fprintf(out, "  \"%s\": { \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f }%s\n", name,
+        times.mean, times.p50, times.p95, times.p99, times.max, last ? "" : ",");
+}
+
+void writeTimedemoJson(FILE* out, const char* replayPath, const TimedemoResult& result) {
+    fprintf(out, "{\n  \"replay\": \"");
+    for (const char* c = replayPath; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', out);
+        }
+        fputc(*c, out);
+    }
+    fprintf(out, "\",\n");
+    fprintf(out, "  \"mode\": \"%s\",\n", result.mode == REPLAY_ARENA ? "arena" : "classic");
+    fprintf(out, "  \"frames\": %u,\n", result.frames);
+    fprintf(out, "  \"final_hash\": \"%08x\",\n", result.hash);
+    fprintf(out, "  \"wall_seconds\": %.3f,\n", result.wallSeconds);
+    writeTimes(out, "frame_ms", result.frameTimes, false);
+    writeTimes(out, "tick_ms", result.tickTimes, false);
+    fprintf(out, "  \"draw_calls_per_frame\": { \"mean\": %.2f, \"min\": %u, \"max\": %u }\n", result.drawCallsMean,
+        result.drawCallsMin, result.drawCallsMax);
+    fprintf(out, "}\n");
+}
@@ -0,0 +1,51 @@
+/*
+ * Title: Timedemo
+ * Description: Plays a recorded game back as fast as it will go through the whole render path,
+ *      to compare drivers and machines on the same work.
+ *
+ *      Each tick of the replay is one frame: the tick, then the background and the board drawn
+ *      from scratch, then glFinish, so a frame's time includes the GPU's work. There is no layer
+ *      cache and no dynamic resolution, so every run draws exactly the same frames; the frames,
+ *      ticks, draw calls and final state hash come out the same every time, and only the times
+ *      differ. The result is written as JSON with its keys always in the same order.
+ *
+ *      The draw calls are counted by the renderers themselves. Counting them through the GL
+ *      wrappers of GlStats.h would add its own cost to every frame timed, so those are taken
+ *      out for the run and put back once it is over.
+*/
+
+#pragma once
+
+#include "ClassicRenderer.h"
+#include "Replay.h"
+#include <cstdio>
+#include <functional>
+
+// A distribution of times, in milliseconds
+struct TimedemoTimes {
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+struct TimedemoResult {
+    ReplayMode mode = REPLAY_CLASSIC;
+    uint32_t frames = 0;          // one per tick
+    uint32_t hash = 0;            // hashGameState or hashArena after the last tick
+    double wallSeconds = 0.0;
+    TimedemoTimes frameTimes;
+    TimedemoTimes tickTimes;
+    double drawCallsMean = 0.0;   // counted by the renderers
+    uint32_t drawCallsMin = 0;
+    uint32_t drawCallsMax = 0;
+};
+
+// Plays the replay at width x height pixels into the bound framebuffer. Needs a current
+// OpenGL 3.3 context and an initialized renderer; present() is called after every frame, to
+// swap buffers for instance. The GlStats.h counting layer is off while the frames are timed
+// and reinstalled afterwards if it was on, which starts its counts over.
+TimedemoResult runTimedemo(const Replay& replay, ClassicRenderer& renderer, int width, int height, const std::function<void()>& present);
+// Writes the result as one JSON object
+void writeTimedemoJson(FILE* out, const char* replayPath, const TimedemoResult& result);
@@ -0,0 +1,177 @@
+/*
+ * Title: Timer wheel
+ * Description: Implementation of the hierarchical timer wheel declared in TimerWheel.h.
+*/
+
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel() {
+}
+
+TimerWheel::~TimerWheel() {
+    reset(0);
+}
+
+/*
+ * This function puts a timer at the end of the slot its due tick belongs to: level 0 when it
+ * is due within the current 256 ticks, otherwise the level of the highest byte where the due
+ * tick and the current tick differ
+*/
+
+void TimerWheel::insert(int32_t index) {
+    Node& node = nodes[index];
+    uint32_t difference = node.due ^ current;
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 && (difference >> ((level + 1) * TIMER_SLOT_BITS)) != 0) {
+        level++;
+    }
+    node.slot = level * TIMER_SLOTS + int32_t((node.due >> (level * TIMER_SLOT_BITS)) & (TIMER_SLOTS - 1));
+    Slot& slot = slots[node.slot];
+    node.previous = slot.tail;
+    node.next = -1;
+    if (slot.tail >= 0) {
+        nodes[slot.tail].next = index;
+    }
+    else {
+        slot.head = index;
+    }
+    slot.tail = index;
+}
+
+// Takes a timer out of its slot's list
+void TimerWheel::unlink(int32_t index) {
+    Node& node = nodes[index];
+    Slot& slot = slots[node.slot];
+    if (node.previous >= 0) {
+        nodes[node.previous].next = node.next;
+    }
+    else {
+        slot.head = node.next;
+    }
+    if (node.next >= 0) {
+        nodes[node.next].previous = node.previous;
+    }
+    else {
+        slot.tail = node.previous;
+    }
+    node.slot = node.previous = node.next = -1;
+}
+
+/*
+ * This function returns a node, already unlinked, to the free list; its generation goes up so
+ * that old handles to it stop matching
+*/
+
+void TimerWheel::release(int32_t index) {
+    Node& node = nodes[index];
+    node.pending = false;
+    node.generation++;
+    node.fire = node.discard = nullptr;
+    node.context = nullptr;
+    freeNodes.push_back(index);
+    pendingCount--;
+}
+
+TimerId TimerWheel::schedule(uint32_t delay, TimerFunction fire, void* context, uint64_t data, TimerFunction discard) {
+    int32_t index;
+    if (!freeNodes.empty()) {
+        index = freeNodes.back();
+        freeNodes.pop_back();
+    }
+    else {
+        index = static_cast<int32_t>(nodes.size());
+        nodes.push_back(Node());
+        // room to free every node, so releasing one never allocates
+        freeNodes.reserve(nodes.capacity());
+    }
+    Node& node = nodes[index];
+    node.due = current + (delay > 0 ? delay : 1);
+    node.pending = true;
+    node.fire = fire;
+    node.discard = discard;
+    node.context = context;
+    node.data = data;
+    insert(index);
+    pendingCount++;
+    return (uint64_t(node.generation) << 32) | uint32_t(index);
+}
+
+bool TimerWheel::cancel(TimerId id) {
+    uint32_t index = uint32_t(id);
+    uint32_t generation = uint32_t(id >> 32);
+    if (index >= nodes.size() || nodes[index].generation != generation || !nodes[index].pending) {
+        return false;
+    }
+    Node node = nodes[index];
+    unlink(index);
+    release(index);
+    if (node.discard) {
+        node.discard(node.context, node.data);
+    }
+    return true;
+}
+
+/*
+ * This function empties the current slot of a level into the levels below it, keeping the
+ * order the timers were scheduled in
+*/
+
+void TimerWheel::cascade(int level) {
+    Slot& slot = slots[level * TIMER_SLOTS + int32_t((current >> (level * TIMER_SLOT_BITS)) & (TIMER_SLOTS - 1))];
+    int32_t index = slot.head;
+    slot.head = slot.tail = -1;
+    while (index >= 0) {
+        int32_t next = nodes[index].next;
+        insert(index);
+        cascaded++;
+        index = next;
+    }
+}
+
+/*
+ * This function moves the wheel on one tick and fires what is due in it. When the low bytes
+ * of the tick roll over, the matching slots of the higher levels are spread out first, from
+ * the top down, so that the timers due in this tick have reached level 0.
+*/
+
+void TimerWheel::step() {
+    current++;
+    int top = 0;
+    while (top < TIMER_LEVELS - 1 && (current & ((1u << ((top + 1) * TIMER_SLOT_BITS)) - 1)) == 0) {
+        top++;
+    }
+    for (int level = top; level >= 1; level--) {
+        cascade(level);
+    }
+    // A firing timer can schedule new ones, which are due later and go to other slots, and
+    // cancel ones still in this slot, which unlinks them; so take the head until it is empty
+    Slot& slot = slots[int32_t(current & (TIMER_SLOTS - 1))];
+    while (slot.head >= 0) {
+        int32_t index = slot.head;
+        Node node = nodes[index];
+        unlink(index);
+        release(index);
+        fired++;
+        node.fire(node.context, node.data);
+    }
+}
+
+void TimerWheel::advanceTo(uint32_t tick) {
+    while (current != tick) {
+        step();
+    }
+}
+
+void TimerWheel::reset(uint32_t tick) {
+    for (int32_t index = 0; index < static_cast<int32_t>(nodes.size()); index++) {
+        if (nodes[index].pending) {
+            Node node = nodes[index];
+            unlink(index);
+            release(index);
+            if (node.discard) {
+                node.discard(node.context, node.data);
+            }
+        }
+    }
+    current = tick;
+}
@@ -0,0 +1,101 @@
+/*
+ * Title: Timer wheel
+ * Description: Events scheduled a number of sim ticks ahead, for things like a bot coming back
+ *      after a crash or big food moving on when nobody eats it.
+ *
+ *      The wheel has TIMER_LEVELS levels of TIMER_SLOTS slots. Level 0 has one slot per tick
+ *      for the next 256 ticks, level 1 one slot per 256 ticks, and so on, which covers every
+ *      32-bit tick. A timer goes into the level of the highest 8 bits its due tick differs in
+ *      from the current tick, appended to that slot's list. Every 256 ticks the next slot of
+ *      level 1 is emptied into level 0 (and every 65536 ticks level 2 into level 1...), so each
+ *      timer is moved at most three times before it fires. Scheduling and cancelling are O(1),
+ *      and a tick costs only the timers that fire in it, however many are waiting.
+ *
+ *      Slots are doubly linked lists threaded through the timers' nodes, by index, so a slot
+ *      takes no memory of its own and cancelling unlinks the node there and then. Nodes are
+ *      reused through a free list, so nothing is allocated once the wheel has held as many
+ *      timers at once as it ever will; with arrays per slot, each of the 1024 slots would
+ *      allocate the first time it filled up, and a level 1 slot only comes round every 65536
+ *      ticks. Timers due in the same tick fire in the order they were scheduled, so a
+ *      deterministic simulation stays deterministic.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const int TIMER_SLOT_BITS = 8;
+const int TIMER_SLOTS = 1 << TIMER_SLOT_BITS;
+const int TIMER_LEVELS = 4;               // 4 x 8 bits: any delay a uint32_t tick can hold
+
+// Handle to a pending timer; 0 is never a timer
+typedef uint64_t TimerId;
+
+// Called when a timer fires; context and data are whatever was given to schedule
+typedef void (*TimerFunction)(void* context, uint64_t data);
+
+class TimerWheel {
+public:
+    TimerWheel();
+    ~TimerWheel();
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Calls fire(context, data) once the wheel has advanced delay ticks; a delay of 0 counts
+    // as 1, as the current tick has already fired. discard, if given, is called instead when
+    // the timer is cancelled or the wheel cleared, so the owner of context can let go of it.
+    TimerId schedule(uint32_t delay, TimerFunction fire, void* context, uint64_t data = 0,
+        TimerFunction discard = nullptr);
+    // Returns false if the timer already fired or was cancelled
+    bool cancel(TimerId id);
+    // Steps the wheel up to the given tick, firing every timer due on the way. A timer can
+    // schedule and cancel others while it fires.
+    void advanceTo(uint32_t tick);
+    // Drops every pending timer (calling their discard functions) and restarts at the given tick
+    void reset(uint32_t tick = 0);
+    uint32_t now() const { return current; }
+    size_t pending() const { return pendingCount; }
+    // Timers that fired and timers moved down a level, since the wheel was made
+    uint64_t firedCount() const { return fired; }
+    uint64_t cascadedCount() const { return cascaded; }
+
+private:
+    struct Node {
+        uint32_t due = 0;
+        uint32_t generation = 1;      // goes up when the node is freed, so old handles stop matching
+        bool pending = false;
+        int32_t slot = -1;            // level * TIMER_SLOTS + slot while pending
+        int32_t previous = -1;        // neighbours in the slot's list
+        int32_t next = -1;
+        TimerFunction fire = nullptr;
+        TimerFunction discard = nullptr;
+        void* context = nullptr;
+        uint64_t data = 0;
+    };
+
+    struct Slot {
+        int32_t head = -1;
+        int32_t tail = -1;
+    };
+
+    void insert(int32_t index);
+    void unlink(int32_t index);
+    void release(int32_t index);
+    void cascade(int level);
+    void step();
+
+    std::vector<Node> nodes;
+    std::vector<int32_t> freeNodes;
+    Slot slots[TIMER_LEVELS * TIMER_SLOTS];
+    uint32_t current = 0;
+    size_t pendingCount = 0;
+    uint64_t fired = 0;
+    uint64_t cascaded = 0;
+};
+
+// Lets a timed coroutine (GameTask.h) find the wheel of the object it was started on
+inline TimerWheel& timerWheelOf(TimerWheel& wheel) {
+    return wheel;
+}
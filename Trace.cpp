@@ -0,0 +1,240 @@
+/*
+ * Title: Tracing
+ * Description: Implementation of the per-thread span rings and the trace writer declared in
+ *      Trace.h.
+*/
+
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// On x86 spans are stamped with the time stamp counter, as in Log.cpp: it is several times
+// cheaper to read than the system clock, and the writer converts it to time
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TRACE_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define TRACE_TSC 0
+#endif
+
+const int TRACE_PROCESS = 1;
+const int TRACE_GPU_LANE = 1000;          // thread id of the GPU lane, sorted after the threads
+
+std::atomic<bool> traceActive{ false };
+
+namespace {
+
+// One thread's spans. The owning thread is the only writer; head counts every span it ever
+// recorded, so the writer can tell which slots were overwritten while it read them.
+struct TraceBuffer {
+    TraceEvent events[TRACE_RING_EVENTS];
+    std::atomic<uint64_t> head{ 0 };
+    uint64_t startHead = 0;               // head when the recording started
+    std::atomic<const char*> name{ nullptr };
+    int lane = 0;
+};
+
+struct TraceRegistry {
+    std::mutex mutex;                     // taken when a thread records for the first time, and by the writer
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    TraceBuffer gpu;
+    uint64_t recordStart = 0;
+    std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+    uint64_t clockStartStamp = 0;
+
+    TraceRegistry() {
+#if TRACE_TSC
+        clockStartStamp = __rdtsc();
+#endif
+        gpu.name.store("GPU", std::memory_order_relaxed);
+        gpu.lane = TRACE_GPU_LANE;
+    }
+};
+
+TraceRegistry registry;
+thread_local TraceBuffer* localBuffer = nullptr;
+thread_local const char* localName = nullptr; // kept until the thread records, so naming a thread costs no ring
+
+/*
+ * This function gives the calling thread its ring the first time it records
+*/
+
+TraceBuffer* threadBuffer() {
+    if (localBuffer == nullptr) {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.buffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer()));
+        localBuffer = registry.buffers.back().get();
+        localBuffer->lane = static_cast<int>(registry.buffers.size());
+        localBuffer->name.store(localName, std::memory_order_relaxed);
+    }
+    return localBuffer;
+}
+
+void push(TraceBuffer& buffer, const char* name, uint64_t start, uint64_t end) {
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    TraceEvent& event = buffer.events[head & (TRACE_RING_EVENTS - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+/*
+ * This function copies the spans of a ring recorded since the recording started, leaving out
+ * any the owning thread overwrote while they were being copied
+*/
+
+void collect(const TraceBuffer& buffer, std::vector<TraceEvent>& events) {
+    events.clear();
+    uint64_t head = buffer.head.load(std::memory_order_acquire);
+    uint64_t first = std::max(buffer.startHead, head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0);
+    for (uint64_t i = first; i < head; i++) {
+        events.push_back(buffer.events[i & (TRACE_RING_EVENTS - 1)]);
+    }
+    uint64_t after = buffer.head.load(std::memory_order_acquire);
+    if (after > TRACE_RING_EVENTS && after - TRACE_RING_EVENTS > first) {
+        size_t lost = static_cast<size_t>(std::min<uint64_t>(after - TRACE_RING_EVENTS - first, events.size()));
+        events.erase(events.begin(), events.begin() + lost);
+    }
+}
+
+/*
+ * This function writes a name as a JSON string; the names are literals from the code, so only
+ * quotes and backslashes need escaping
+*/
+
+void writeName(FILE* file, const char* name) {
+    fputc('"', file);
+    for (const char* c = name; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+}
+
+uint64_t traceStamp() {
+#if TRACE_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - registry.clockStart).count());
+#endif
+}
+
+double traceStampsPerSecond() {
+#if TRACE_TSC
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - registry.clockStart).count();
+    uint64_t stamps = __rdtsc() - registry.clockStartStamp;
+    if (seconds > 0.0 && stamps > 0) {
+        return stamps / seconds;
+    }
+#endif
+    return 1e9;
+}
+
+void traceRecord(const char* name, uint64_t start, uint64_t end) {
+    push(*threadBuffer(), name, start, end);
+}
+
+void traceRecordGpu(const char* name, uint64_t start, uint64_t end) {
+    push(registry.gpu, name, start, end);
+}
+
+void traceThreadName(const char* name) {
+    localName = name;
+    if (localBuffer != nullptr) {
+        localBuffer->name.store(name, std::memory_order_relaxed);
+    }
+}
+
+void traceStart() {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.recordStart = traceStamp();
+    for (const std::unique_ptr<TraceBuffer>& buffer : registry.buffers) {
+        buffer->startHead = buffer->head.load(std::memory_order_acquire);
+    }
+    registry.gpu.startHead = registry.gpu.head.load(std::memory_order_acquire);
+    traceActive.store(true, std::memory_order_relaxed);
+}
+
+void traceStop() {
+    traceActive.store(false, std::memory_order_relaxed);
+}
+
+TraceStats traceStats() {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    TraceStats stats;
+    for (const std::unique_ptr<TraceBuffer>& buffer : registry.buffers) {
+        uint64_t recorded = buffer->head.load(std::memory_order_acquire) - buffer->startHead;
+        stats.recorded += recorded;
+        stats.overwritten += recorded > TRACE_RING_EVENTS ? recorded - TRACE_RING_EVENTS : 0;
+        stats.threads++;
+    }
+    return stats;
+}
+
+/*
+ * This function writes the recording as a JSON object of trace events: a complete ("X") event
+ * per span, with times in microseconds from the start of the recording, and a metadata event
+ * naming each lane
+ * @param path: the file to write
+ * @return false if the file could not be opened
+*/
+
+bool traceWrite(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    double microsecondsPerStamp = 1e6 / traceStampsPerSecond();
+    std::vector<const TraceBuffer*> lanes;
+    for (const std::unique_ptr<TraceBuffer>& buffer : registry.buffers) {
+        lanes.push_back(buffer.get());
+    }
+    lanes.push_back(&registry.gpu);
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    std::vector<TraceEvent> events;
+    for (const TraceBuffer* lane : lanes) {
+        const char* name = lane->name.load(std::memory_order_relaxed);
+        fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n",
+            TRACE_PROCESS, lane->lane);
+        first = false;
+        if (name != nullptr) {
+            writeName(file, name);
+        }
+        else {
+            fprintf(file, "\"thread %d\"", lane->lane);
+        }
+        fprintf(file, "}},\n{\"ph\":\"M\",\"name\":\"thread_sort_index\",\"pid\":%d,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+            TRACE_PROCESS, lane->lane, lane->lane);
+        collect(*lane, events);
+        for (const TraceEvent& event : events) {
+            if (event.end < registry.recordStart) {
+                continue;
+            }
+            double start = static_cast<int64_t>(event.start - registry.recordStart) * microsecondsPerStamp;
+            double duration = static_cast<double>(event.end - event.start) * microsecondsPerStamp;
+            fprintf(file, ",\n{\"ph\":\"X\",\"name\":");
+            writeName(file, event.name);
+            fprintf(file, ",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", TRACE_PROCESS, lane->lane, start, duration);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    bool written = ferror(file) == 0;
+    return fclose(file) == 0 && written;
+}
@@ -0,0 +1,97 @@
+/*
+ * Title: Tracing
+ * Description: A timeline of what every thread did, written as Chrome trace event JSON that
+ *      chrome://tracing and Perfetto (ui.perfetto.dev) open directly.
+ *
+ *      TRACE_SCOPE("render") records one span from where it is to the end of the enclosing
+ *      scope. Each thread records into its own ring of TRACE_RING_EVENTS spans, made the first
+ *      time the thread records, so recording takes no lock and shares no cache line with
+ *      another thread: two clock readings and a store. The ring keeps the newest spans and
+ *      overwrites the oldest. While nothing is being recorded a scope costs one load of a flag.
+ *
+ *      traceStart() begins a recording and traceWrite() writes every span recorded since then,
+ *      from all threads, to a file. GPU spans (GpuTrace.h) come in on a lane of their own.
+ *
+ *      Build with -DTRACE_ENABLED=0 to remove the scopes altogether.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+const size_t TRACE_RING_EVENTS = 1 << 15;  // per thread, power of two
+
+// One finished span; the name must be a string literal, as only its address is kept
+struct TraceEvent {
+    const char* name;
+    uint64_t start;                       // clock readings: TSC ticks on x86, nanoseconds elsewhere
+    uint64_t end;
+};
+
+struct TraceStats {
+    uint64_t recorded = 0;                // spans recorded since traceStart, on every thread
+    uint64_t overwritten = 0;             // of those, lost to a full ring
+    int threads = 0;                      // threads that have recorded anything
+};
+
+extern std::atomic<bool> traceActive;
+
+inline bool traceRecording() {
+#if TRACE_ENABLED
+    return traceActive.load(std::memory_order_relaxed);
+#else
+    return false;
+#endif
+}
+
+// Begins a recording; spans from before it are left out of the next traceWrite
+void traceStart();
+// Stops recording; the spans stay until the next traceStart
+void traceStop();
+// Writes the spans recorded since traceStart as trace event JSON. Returns false if the file
+// can't be written.
+bool traceWrite(const char* path);
+TraceStats traceStats();
+// Names the calling thread's lane in the timeline (a string literal); takes effect once it records
+void traceThreadName(const char* name);
+// A clock reading in the units of TraceEvent
+uint64_t traceStamp();
+// Clock readings per second, measured against the system clock
+double traceStampsPerSecond();
+// Records a finished span on the calling thread's lane
+void traceRecord(const char* name, uint64_t start, uint64_t end);
+// Records a span on the GPU lane; only the thread that owns the GL context may call this
+void traceRecordGpu(const char* name, uint64_t start, uint64_t end);
+
+// Records the span from its construction to its destruction, if recording when constructed
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name(traceRecording() ? name : nullptr), start(this->name ? traceStamp() : 0) {}
+    ~TraceScope() {
+        if (name != nullptr) {
+            traceRecord(name, start, traceStamp());
+        }
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#if TRACE_ENABLED
+#define TRACE_JOIN2(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_JOIN(traceScope, __LINE__)(name)
+#define TRACE_THREAD(name) traceThreadName(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Title: Worker pool
+ * Description: Implementation of the worker pool declared in WorkerPool.h.
+*/
+
+#include "WorkerPool.h"
+#include "Trace.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(int threadCount) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 1; i < threadCount; i++) {
+        threads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+/*
+ * This function runs a job over [0, count) on every thread of the pool
+ * @param count: number of work items
+ * @param grain: most items handed to one thread at a time
+ * @param work: called with each sub-range; must be safe to call from several threads at once
+*/
+
+void WorkerPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& work) {
+    if (count == 0) {
+        return;
+    }
+    if (threads.empty() || count <= grain) {
+        work(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &work;
+        jobCount = count;
+        jobGrain = std::max<size_t>(1, grain);
+        nextItem.store(0);
+        busyWorkers = static_cast<int>(threads.size());
+        generation++;
+    }
+    wake.notify_all();
+
+    // the calling thread works too instead of just waiting
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busyWorkers == 0; });
+    job = nullptr;
+}
+
+/*
+ * This function takes chunks of the current job until none are left
+*/
+
+void WorkerPool::runChunks() {
+    for (;;) {
+        size_t begin = nextItem.fetch_add(jobGrain);
+        if (begin >= jobCount) {
+            return;
+        }
+        TRACE_SCOPE("worker chunk");
+        (*job)(begin, std::min(jobCount, begin + jobGrain));
+    }
+}
+
+void WorkerPool::workerLoop() {
+    TRACE_THREAD("worker");
+    unsigned long long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        runChunks();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busyWorkers--;
+        }
+        finished.notify_one();
+    }
+}
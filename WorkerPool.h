@@ -0,0 +1,45 @@
+/*
+ * Title: Worker pool
+ * Description: Fixed set of threads that split a range of work items between them.
+ *      The calling thread also takes part, so a pool of size 1 runs everything inline.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool {
+public:
+    // threadCount includes the calling thread; 0 means one per hardware thread
+    explicit WorkerPool(int threadCount = 0);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Calls work(begin, end) on sub-ranges of [0, count) of at most grain items,
+    // spread over all threads, and returns once every item is done
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& work);
+    int size() const { return static_cast<int>(threads.size()) + 1; }
+
+private:
+    void workerLoop();
+    void runChunks();
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(size_t, size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    size_t jobGrain = 1;
+    std::atomic<size_t> nextItem{ 0 };
+    int busyWorkers = 0;
+    unsigned long long generation = 0;
+    bool stopping = false;
+};
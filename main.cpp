@@ -9,7 +9,18 @@
  * Controls: Use UP, DOWN, RIGHT, LEFT arrow keys to change the snake's direction
       SPACE to slow down the game
       LEFT CONTROL to speed up the game
- * Additional features: Textured graphics, variable game speed, big food spawning
+      R to play again after a game over, ESCAPE to quit
+ * Additional features: Textured graphics, variable game speed, big food spawning,
+      two-player rollback netplay (--netplay <localPort> <remoteHost:port> <player>),
+      arena mode against hundreds of bots (--arena [snakes]),
+      GL call counting with a report every few seconds (--gl-stats),
+      a timeline of every frame for chrome://tracing or Perfetto (--trace <file>, or F9 to start
+      and stop), hitch dumps with a replay when a frame or tick runs long (--hitch-ms <ms>,
+      0 to turn them off, and --hitch-dir <directory>), Prometheus metrics on
+      http://127.0.0.1:<port>/metrics (--metrics <port>), a check that fails the run when a
+      frame allocates after the first seconds (--zero-alloc), the game's replay written out when
+      it closes (--record <file>), and playback of a replay as fast as it goes with a JSON report
+      of the frame times (--timedemo <replay> [json file])
 */
 
 // Import necessary libraries
@@ -22,9 +33,36 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <iostream>
+#include "Arena.h"
+#include "ArenaRenderer.h"
+#include "Camera.h"
+#include "Allocations.h"
+#include "ClassicRenderer.h"
+#include "DynamicResolution.h"
+#include "FrameLayers.h"
+#include "FlightRecorder.h"
+#include "FrameArena.h"
+#include "Game.h"
+#include "GlStats.h"
+#include "GpuTrace.h"
+#include "Hud.h"
+#include "Log.h"
+#include "Metrics.h"
+#include "Minimap.h"
+#include "Netplay.h"
+#include "Particles.h"
+#include "Replay.h"
+#include "Shader.h"
+#include "Timedemo.h"
+#include "Trace.h"
+#include "WorkerPool.h"
 
 
 // Variable to control game speed dynamically
@@ -33,106 +71,138 @@ float GAME_SPEED = 0.012f; // Time interval for snake movement which controls ga
 // Stores the initial game speed to allow resetting
 float game_speed_controller = GAME_SPEED;
 
-// Tracks the player's current score
-int score = 0;
-
-// Flags to manage food spawning and tracking
-bool bigFoodOnScreen = false;
-bool smallFoodOnScreen = true;
-int smallFoodEaten = 0;
-int bigFoodEaten = 0;
-
-// Constants for game window and object dimensions
-const float windowWIDTH = 800.0f;      // Width of the game window
-const float windowHEIGHT = 600.0f;     // Height of the game window
-const float SQUARE_SIZE = 20.0f;       // Size of game objects (snake segments, food)
-const float WALL_THICKNESS = 60.0f;    // Thickness of game boundaries
-
-// Timing and movement constants
+// Timing constants
 const int SEGMENT_DELAY_MS = 50;       // Delay between snake segment movements
-const float MOVE_STRIDE = 2.5; // Distance moved in a single step
+const float ARENA_TICK_SECONDS = 1.0f / 60.0f; // The arena always runs at 60 ticks per second
+const float SCENE_BUDGET_MS = 12.0f;   // GPU time the scene may take before its resolution drops
+const float MIN_RESOLUTION_SCALE = 0.5f;
+const float HUD_SAMPLE_SECONDS = 0.5f; // how often the FPS and performance lines are updated
+const float EFFECTS_BUDGET_MS = 12.0f; // frame time before the swap above which particle bursts shrink
+const float PARTICLE_PIXELS = 5.0f;    // size of a new particle at full resolution
+const float GAME_OVER_SECONDS = 1.0f;  // the crash plays out for this long before the score is shown
+const float GL_STATS_LOG_SECONDS = 5.0f; // how often --gl-stats logs the last frame's GL calls
+const float ZERO_ALLOC_WARMUP_SECONDS = 2.0f; // --zero-alloc lets the first frames fill caches and pools
+const int ZERO_ALLOC_REPORTS = 10;     // frames --zero-alloc describes before it only counts them
 
 // Timing variable to control rendering and movement speed
 float lastMoveTime = 0.0f; // Used to allow for some time to pass before rendering to make the game playable
 
-// Game state tracking
-bool gameOver = false; // Tracks whether the game has ended, initially set to false
+// Initial snake movement direction
+Direction currentDirection = RIGHT; // Snake starts moving to the right
+// Stores the next direction based on user input
+Direction nextDirection = currentDirection;
 
-// Enum to represent possible movement directions of the snake
-enum Direction { UP, DOWN, LEFT, RIGHT };
+// The arena is larger than the window; this camera follows the player and zooms with the mouse wheel
+Camera arenaCamera;
 
-// Struct to represent snake segments and food items
-struct Square {
-    glm::vec2 position;           // Current position
-    Direction direction;          // Movement direction
+// F3 shows the performance overlay under the score
+bool showPerformance = false;
 
-};
+// R was pressed; after a game over it starts the next game
+bool restartRequested = false;
 
-// Snake is represented as a vector of Square segments
-std::vector<Square> snake;
+// Keeps the last seconds of frames, ticks and inputs, and writes them out after a hitch
+FlightRecorder flightRecorder;
 
-// Food items
-Square smallFood;
-Square bigFood;
+// Frame, tick and input latency histograms and game counters, served by --metrics
+GameMetrics gameMetrics;
+// When the oldest direction key not yet shown was pressed, or -1; and whether a tick has taken it
+double pendingInputAt = -1.0;
+bool pendingInputTicked = false;
 
-// Initial snake movement direction
-Direction currentDirection = RIGHT; // Snake starts moving to the right
-// Stores the next direction based on user input
-Direction nextDirection = currentDirection;
+// Where a trace goes: the file given to --trace, or this one when F9 started it
+const char* tracePath = "snake-trace.json";
 
 // Function prototypes
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
-void drawSquare(const Square& square, unsigned int shaderProgram, unsigned int VAO, bool useTexture, unsigned int textureID, glm::vec3 color);
-void spawnFood(bool isBigFood);
-unsigned int compileShader(unsigned int type, const char* source);
-unsigned int createShaderProgram(const char* vertexSource, const char* fragmentSource);
-unsigned int loadTexture(char const* path);
-void useBackgroundTexture(unsigned int shaderProgram, GLuint backgroundVAO, unsigned int backgroundTextureID, glm::mat4 projection);
-void setupBackgroundBuffers(GLuint& backgroundVAO, GLuint& backgroundVBO);
-void setupSnakeBuffers(GLuint& squareVAO, GLuint& squareVBO, bool isBigFood);
-
-
-// Vertex shader source code
-const char* vertexShaderSource = R"glsl(
-    #version 330 core
-    layout (location = 0) in vec2 aPos;
-    layout (location = 1) in vec2 aTexCoord;
-    uniform mat4 model;
-    uniform mat4 projection;
-    out vec2 TexCoord;
-    void main() {
-        // apply projection to map the coordinates to the window
-        gl_Position = projection * model * vec4(aPos, 0.0, 1.0);
-        TexCoord = aTexCoord;
-    }
-)glsl";
-
-// Fragment shader souce code
-const char* fragmentShaderSource = R"glsl(
-    #version 330 core
-    out vec4 FragColor;
-    in vec2 TexCoord;
-    uniform sampler2D texture1;
-    uniform vec4 color;
-    uniform bool useTexture;
-    void main() {
-        if (useTexture) {
-        vec4 texColor = texture(texture1, TexCoord);
-            if (texColor.a < 0.1) // Discard nearly transparent pixels
-                discard;
-                FragColor = texColor;
-        } else {
-            FragColor = color;
-        }
-    }
-)glsl";
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void emitTickEffects(ParticleSystem& particles, const TickEvents& events);
+void updateHud(Hud& hud, int score, size_t length, float ticksPerSecond, bool sample, float seconds, const DynamicResolution& resolution, const FrameLayers& layers);
+void endGlStatsFrame(float now, bool log);
+void recordInputLatency();
+void logFrameAllocations(const AllocationFrame& allocations);
+
 
 /*
 * main method is the starting point of this program
 */
 
-int main() {
+int main(int argc, char** argv) {
+    // --gl-stats counts every frame's GL calls, --trace <file> records a timeline from the
+    // start, --metrics <port> serves the metrics on localhost, --zero-alloc fails the run if
+    // a frame allocates and --record <file> saves the last game's replay; they are taken out of
+    // the arguments, so they can go with any of the modes below
+    bool glStats = false;
+    bool traceFromStart = false;
+    int metricsPort = -1;
+    bool zeroAlloc = false;
+    const char* recordPath = nullptr;
+    FlightConfig flightConfig;
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--gl-stats") == 0) {
+            glStats = true;
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFromStart = true;
+            tracePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--hitch-ms") == 0 && i + 1 < argc) {
+            // frames get the whole threshold; a tick should take a fraction of a frame
+            flightConfig.frameMilliseconds = static_cast<float>(atof(argv[++i]));
+            flightConfig.tickMilliseconds = flightConfig.frameMilliseconds / 5.0f;
+        }
+        else if (strcmp(argv[i], "--hitch-dir") == 0 && i + 1 < argc) {
+            flightConfig.directory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metricsPort = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--zero-alloc") == 0) {
+            zeroAlloc = true;
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        }
+        else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    // Netplay is started with: --netplay <localPort> <remoteHost:port> <player 0|1>
+    // Player 0 picks the random seed, so both instances see the same food.
+    bool netplay = false;
+    NetplaySession session;
+    if (argc >= 5 && strcmp(argv[1], "--netplay") == 0) {
+        NetAddress remote;
+        int player = atoi(argv[4]);
+        if (!parseAddress(argv[3], remote) || (player != 0 && player != 1)) {
+            std::cerr << "Usage: " << argv[0] << " --netplay <localPort> <remoteHost:port> <player 0|1>" << std::endl;
+            return -1;
+        }
+        if (!session.start(static_cast<uint16_t>(atoi(argv[2])), remote, player, static_cast<uint32_t>(time(nullptr)))) {
+            std::cerr << "Failed to open UDP port " << argv[2] << std::endl;
+            return -1;
+        }
+        netplay = true;
+    }
+    // Arena mode is started with: --arena [number of snakes]
+    bool arenaMode = argc >= 2 && strcmp(argv[1], "--arena") == 0;
+    ArenaConfig arenaConfig;
+    if (arenaMode && argc >= 3) {
+        arenaConfig.snakeCount = std::max(1, atoi(argv[2]));
+    }
+    arenaConfig.seed = static_cast<uint32_t>(time(nullptr));
+    // Timedemo is started with: --timedemo <replay> [json file]; the report goes to stdout
+    // without a file
+    Replay timedemoReplay;
+    bool timedemo = argc >= 3 && strcmp(argv[1], "--timedemo") == 0;
+    if (timedemo && !loadReplay(timedemoReplay, argv[2])) {
+        std::cerr << "Failed to load the replay " << argv[2] << std::endl;
+        return -1;
+    }
+
     // GLFW initialization
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -147,226 +217,533 @@ int main() {
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetScrollCallback(window, scroll_callback);
 
     // GLAD initialization
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         std::cerr << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    // the metrics count draw calls, which takes the GL call counting
+    if (glStats || metricsPort >= 0) {
+        glStatsInstall();
+    }
+    MetricsServer metricsServer;
+    if (metricsPort >= 0) {
+        if (metricsServer.start(static_cast<uint16_t>(metricsPort), []() { return metricsPage(gameMetrics); })) {
+            LOG_INFO("Metrics on http://127.0.0.1:%d/metrics", metricsServer.port());
+        }
+        else {
+            LOG_ERROR("Failed to open port %d for the metrics", metricsPort);
+        }
+    }
+    TRACE_THREAD("main");
+    GpuTrace gpuTrace;
+    gpuTrace.init();
+    if (traceFromStart) {
+        traceStart();
+    }
 
-    // Set up shaders
-    unsigned int shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
-
-    // Create and bind VBO and VAO for body segments
-    unsigned int squareVBO, squareVAO;
-    setupSnakeBuffers(squareVAO, squareVBO, false);
-    unsigned int bodyTexture = loadTexture("textures/body3.png");
-
-    // Create separte VAO and VBO for head so that we can apply different texture to it
+    // Shaders, buffers and textures of the classic game, made once and kept across restarts
+    ClassicRenderer classicRenderer;
+    classicRenderer.init();
 
-    unsigned int headVAO, headVBO;
-    setupSnakeBuffers(headVAO, headVBO, false);
-    // load the snake head texture
-    unsigned int headTexture = loadTexture("textures/head1.png");
-   
+    // Use orthgraphic projection matrix to convert the window coordinates 
+    // to normalized device coordinate (NDC) which goes from -1 to 1
+    glm::mat4 projection = glm::ortho(0.0f, windowWIDTH, 0.0f, windowHEIGHT);
 
-    // Now, we need VAO and VBO for the small food
-    unsigned int smallFoodVAO, smallFoodVBO;
-    setupSnakeBuffers(smallFoodVAO, smallFoodVBO, false);
-    
-    // We also need VAO and VBO for big food
-    unsigned int bigFoodVAO, bigFoodVBO;
-    setupSnakeBuffers(bigFoodVAO, bigFoodVBO, true);
-    
-    // load the snake head texture
-    unsigned int foodTexture = loadTexture("textures/food.png");
-  
+    if (timedemo) {
+        // every frame as soon as the last one is done, without waiting for the display
+        glfwSwapInterval(0);
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        LOG_INFO("Playing %s: %u ticks", argv[2], timedemoReplay.ticks());
+        TimedemoResult result = runTimedemo(timedemoReplay, classicRenderer, framebufferWidth, framebufferHeight, [&]() {
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        });
+        FILE* report = argc >= 4 ? fopen(argv[3], "w") : stdout;
+        if (report == nullptr) {
+            LOG_ERROR("Failed to open %s for the timedemo report", argv[3]);
+        }
+        classicRenderer.release();
+        gpuTrace.release();
+        metricsServer.stop();
+        glStatsUninstall();
+        glfwTerminate();
+        // the log has written everything out before the report goes to stdout
+        logShutdown();
+        if (report == nullptr) {
+            return 1;
+        }
+        writeTimedemoJson(report, argv[2], result);
+        if (report != stdout) {
+            fclose(report);
+        }
+        return 0;
+    }
 
-    // Load the background texture
-    unsigned int backgroundTextureID = loadTexture("textures/snakeBackground.png");
+    // The scene is drawn at a resolution that keeps the GPU within its budget, then scaled up
+    DynamicResolution resolution;
+    resolution.init(SCENE_BUDGET_MS, MIN_RESOLUTION_SCALE);
 
-    //Setup VAO and VBO buffers for the background texture
-    GLuint backgroundVAO, backgroundVBO;
-    setupBackgroundBuffers(backgroundVAO, backgroundVBO);
-  
+    // Initialize game state
+    // The local game has one snake in the middle of the screen going to the right;
+    // in netplay the session owns the state and creates it once both players are connected
+    GameState game;
+    uint32_t gameSeed = static_cast<uint32_t>(time(nullptr));
+    initGame(game, 1, gameSeed);
+    const GameState& state = netplay ? session.state() : game;
+    int localPlayer = netplay ? session.localPlayer() : 0;
+
+    // The arena is stepped on every core; a pool of one thread starts no threads
+    ArenaState arena;
+    WorkerPool arenaPool(arenaMode ? 0 : 1);
+    ArenaRenderer arenaRenderer;
+    Minimap minimap;
+    // What a frame gathers only to upload comes from here; it is emptied at the start of every frame
+    FrameArena frameArena;
+    float lastFrameTime = 0.0f;
+    if (arenaMode) {
+        initArena(arena, arenaConfig);
+        currentDirection = arena.snakes[0].direction;
+        nextDirection = currentDirection;
+        ArenaTextures arenaTextures;
+        arenaTextures.body = classicRenderer.bodyTexture();
+        arenaTextures.playerHead = classicRenderer.headTexture(0);
+        arenaTextures.botHead = classicRenderer.headTexture(1);
+        arenaTextures.food = classicRenderer.foodTexture();
+        arenaRenderer.init(arena, arenaTextures);
+        minimap.init(arena);
+        arenaCamera.setBounds(arenaConfig.width * MOVE_STRIDE, arenaConfig.height * MOVE_STRIDE);
+        arenaCamera.lookAt(arenaPosition(arena.snakes[0].segment(0)));
+    }
 
+    // The background is drawn once and kept; the board is drawn again only when a tick or the
+    // camera changed it, otherwise the last frame is shown again
+    FrameLayers layers;
+    layers.init();
+    layers.addLayer(LAYER_STATIC, [&]() {
+        GL_SITE("background");
+        // the background stays put on the screen; only the board scrolls
+        classicRenderer.drawBackground(projection);
+    });
+    int sceneLayer = layers.addLayer(LAYER_DYNAMIC, [&]() {
+        GL_SITE("board");
+        if (arenaMode) {
+            arenaRenderer.draw(arena, arenaCamera, frameArena, resolution.scale());
+            return;
+        }
+        classicRenderer.drawBoard(state, projection);
+    });
+
+    if (netplay) {
+        LOG_INFO("Waiting for the other player...");
+        while (!session.isConnected() && !glfwWindowShouldClose(window)) {
+            session.poll();
+            glClear(GL_COLOR_BUFFER_BIT);
+            classicRenderer.drawBackground(projection);
+            glfwSwapBuffers(window);
+            glfwWaitEventsTimeout(0.01);
+        }
+        currentDirection = state.snakes[localPlayer].body[0].direction;
+        nextDirection = currentDirection;
+        lastMoveTime = static_cast<float>(glfwGetTime());
+    }
 
-    // Initialize game state
-    // start the snake with one square in the middle of the screen going to the right
-    snake.push_back({ glm::vec2(windowWIDTH / 2.0, windowHEIGHT / 2.0), RIGHT });
-    // spawn the food in random place
-    spawnFood(false);
 
-    // Use orthgraphic projection matrix to convert the window coordinates 
-    // to normalized device coordinate (NDC) which goes from -1 to 1
-    glm::mat4 projection = glm::ortho(0.0f, windowWIDTH, 0.0f, windowHEIGHT);
+    // Sparks for food and crashes, drawn over the board in the same frame
+    ParticleSystem particles;
+    particles.init();
+    int particleLayer = layers.addLayer(LAYER_DYNAMIC, [&]() {
+        GL_SITE("particles");
+        particles.draw(arenaMode ? arenaCamera.projection() : projection, PARTICLE_PIXELS * resolution.scale());
+    });
+
+    // Score, length, speed and FPS over the game, drawn at the window's resolution
+    Hud hud;
+    hud.init();
+    float hudSampleStart = static_cast<float>(glfwGetTime());
+    float previousFrameStart = hudSampleStart;
+    float gameOverAt = -1.0f;     // when the game ended, or -1 while it goes on
+    float frameWorkMs = 0.0f;     // CPU time of the last frame before its buffer swap
+
+    // Every local game is recorded as it is played, so a hitch dump can replay it; a netplay
+    // game depends on the other player's inputs and isn't recorded
+    Replay replay;
+    replay.mode = arenaMode ? REPLAY_ARENA : REPLAY_CLASSIC;
+    replay.seed = gameSeed;
+    replay.arena = arenaConfig;
+    replay.reserve(REPLAY_RESERVE_TICKS);
+    const Replay* hitchReplay = netplay ? nullptr : &replay;
+    if (!flightRecorder.init(flightConfig, glfwGetTime())) {
+        LOG_ERROR("Can't create the hitch directory %s; hitches will not be recorded", flightConfig.directory);
+    }
+    // the writer thread finishes a dump some frames later; its outcome is logged here
+    auto reportHitchDump = [&]() {
+        DumpState dumpState = flightRecorder.poll();
+        if (dumpState == DUMP_WRITTEN) {
+            LOG_WARN("Hitch recorded in %s", flightRecorder.lastDump());
+        }
+        else if (dumpState == DUMP_FAILED) {
+            LOG_ERROR("Hitch dump %s could not be written", flightRecorder.lastDump());
+        }
+    };
+    auto dumpHitch = [&]() {
+        reportHitchDump();
+        bool started;
+        if (arenaMode) {
+            started = flightRecorder.dump(hitchReplay, arena.tick, hashArena(arena));
+        }
+        else {
+            started = flightRecorder.dump(hitchReplay, state.tick, hashGameState(state));
+        }
+        if (!started) {
+            LOG_WARN("Hitch not recorded: the last dump is still being written");
+        }
+    };
 
+    // --zero-alloc: after the warm-up, every frame that allocates is a failure
+    float allocationCheckFrom = static_cast<float>(glfwGetTime()) + ZERO_ALLOC_WARMUP_SECONDS;
+    uint64_t allocatingFrames = 0;
+    uint64_t checkedFrames = 0;
+
+    // R after a game over starts the next game in place. Everything the last game made is kept:
+    // the GL objects, the reserved snake bodies and replay, the arena's renderer and minimap.
+    bool gameOverShown = false;   // the score was logged and R restarts
+    uint64_t restarts = 0;
+    auto restartGame = [&]() {
+        double restartStart = glfwGetTime();
+        gameSeed = gameSeed * 1664525u + 1013904223u;
+        if (arenaMode) {
+            arenaConfig.seed = gameSeed;
+            initArena(arena, arenaConfig);
+            arenaRenderer.noteRestart(arena);
+            minimap.noteRestart(arena);
+            arenaCamera.lookAt(arenaPosition(arena.snakes[0].segment(0)));
+            currentDirection = arena.snakes[0].direction;
+            replay.arena = arenaConfig;
+            // a new arena makes its snakes again, so it gets a warm-up of its own
+            allocationCheckFrom = static_cast<float>(restartStart) + ZERO_ALLOC_WARMUP_SECONDS;
+        }
+        else {
+            initGame(game, 1, gameSeed);
+            currentDirection = state.snakes[0].body[0].direction;
+        }
+        nextDirection = currentDirection;
+        replay.seed = gameSeed;
+        replay.inputs.clear();
+        restarts++;
+        gameOverAt = -1.0f;
+        gameOverShown = false;
+        lastMoveTime = static_cast<float>(glfwGetTime());
+        LOG_INFO("Restarted in %.0f us", (glfwGetTime() - restartStart) * 1e6);
+    };
 
     // rendering loop
     while (!glfwWindowShouldClose(window)) {
-        processInput(window);
+        TRACE_SCOPE("frame");
+        frameArena.reset();
+        gpuTrace.collect();
+        {
+            ALLOCATION_SCOPE(ALLOCATIONS_INPUT);
+            processInput(window);
+        }
+        if (restartRequested) {
+            if (gameOverShown) {
+                restartGame();
+            }
+            restartRequested = false;
+        }
+        float frameStart = static_cast<float>(glfwGetTime());
+        // the last frame's allocations, from one frame start to the next
+        AllocationFrame allocations = allocationEndFrame();
+        if (zeroAlloc && frameStart >= allocationCheckFrom) {
+            checkedFrames++;
+            if (allocations.total > 0 && allocatingFrames++ < ZERO_ALLOC_REPORTS) {
+                logFrameAllocations(allocations);
+            }
+        }
+        bool hudSample = frameStart - hudSampleStart >= HUD_SAMPLE_SECONDS;
+        float hudSeconds = frameStart - hudSampleStart;
+        if (hudSample) {
+            hudSampleStart = frameStart;
+        }
+        particles.update(frameStart - previousFrameStart);
+        if (flightRecorder.frame(frameStart, (frameStart - previousFrameStart) * 1000.0f, frameWorkMs)) {
+            dumpHitch();
+        }
+        reportHitchDump();
+        if (frameStart > previousFrameStart) {
+            gameMetrics.frameTime.record(static_cast<uint64_t>((frameStart - previousFrameStart) * 1e6f));
+        }
+        previousFrameStart = frameStart;
+        layers.setVersion(particleLayer, particles.version());
+
+        if (arenaMode) {
+            float now = static_cast<float>(glfwGetTime());
+            if (now - lastMoveTime >= ARENA_TICK_SECONDS) {
+                lastMoveTime = now;
+                const ArenaSnake& player = arena.snakes[0];
+                int scoreBefore = player.score;
+                bool aliveBefore = player.alive;
+                {
+                    TRACE_SCOPE("tick");
+                    ALLOCATION_SCOPE(ALLOCATIONS_TICK);
+                    double tickStart = glfwGetTime();
+                    replay.record(&nextDirection);
+                    stepArena(arena, nextDirection, arenaPool);
+                    double tickSeconds = glfwGetTime() - tickStart;
+                    if (flightRecorder.tick(tickStart, arena.tick, static_cast<float>(tickSeconds * 1000.0))) {
+                        dumpHitch();
+                    }
+                    gameMetrics.tickTime.record(static_cast<uint64_t>(tickSeconds * 1e6));
+                    pendingInputTicked = pendingInputAt >= 0.0;
+                    arenaRenderer.noteTick(arena);
+                    minimap.noteTick(arena);
+                }
+                currentDirection = arena.snakes[0].direction;
+                // the arena reports no events, so the player's score and life tell what happened
+                TickEvents events;
+                glm::vec2 head = arenaPosition(player.segment(0));
+                events.ateSmallFood = player.score == scoreBefore + 1;
+                events.ateBigFood = player.score > scoreBefore + 1;
+                events.eatenPosition = head;
+                events.snakeDied = aliveBefore && !player.alive;
+                events.deathPosition = head;
+                emitTickEffects(particles, events);
+                // foodTaken still holds who took each food item during the tick
+                gameMetrics.foodEaten.add(static_cast<uint64_t>(std::count_if(arena.foodTaken.begin(), arena.foodTaken.end(),
+                    [](int taker) { return taker >= 0; })));
+            }
+            int framebufferWidth, framebufferHeight;
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+            arenaCamera.setViewport(framebufferWidth, framebufferHeight);
+            arenaCamera.follow(arenaPosition(arena.snakes[0].segment(0)), now - lastFrameTime);
+            lastFrameTime = now;
+
+            // the board looks different after a tick or once the camera moved or zoomed
+            uint64_t version = combineVersion(combineVersion(static_cast<uint64_t>(arena.tick), restarts), arenaCamera.center().x);
+            version = combineVersion(version, arenaCamera.center().y);
+            layers.setVersion(sceneLayer, combineVersion(version, arenaCamera.zoom()));
+            // the camera's view has the window's shape, so the arena fills the whole window
+            {
+                TRACE_SCOPE("render");
+                ALLOCATION_SCOPE(ALLOCATIONS_RENDER);
+                GPU_TRACE_SCOPE(gpuTrace, "render");
+                {
+                    GL_SITE("layers");
+                    GPU_TRACE_SCOPE(gpuTrace, "layers");
+                    layers.render(resolution, { 0, 0, framebufferWidth, framebufferHeight });
+                }
+                // the minimap is drawn at the window's resolution, so it stays sharp
+                {
+                    GL_SITE("minimap");
+                    GPU_TRACE_SCOPE(gpuTrace, "minimap");
+                    minimap.draw(framebufferWidth, framebufferHeight, arenaCamera);
+                }
+                ALLOCATION_SCOPE(ALLOCATIONS_HUD);
+                updateHud(hud, arena.snakes[0].score, arena.snakes[0].length, 1.0f / ARENA_TICK_SECONDS, hudSample, hudSeconds, resolution, layers);
+                {
+                    GL_SITE("hud");
+                    GPU_TRACE_SCOPE(gpuTrace, "hud");
+                    hud.draw(framebufferWidth, framebufferHeight);
+                }
+            }
+
+            if (!arena.snakes[0].alive && gameOverAt < 0.0f) {
+                gameOverAt = now;
+            }
+            if (gameOverAt >= 0.0f && now - gameOverAt >= GAME_OVER_SECONDS && !gameOverShown) {
+                int rank = 1;
+                for (const ArenaSnake& snake : arena.snakes) {
+                    rank += snake.score > arena.snakes[0].score ? 1 : 0;
+                }
+                LOG_INFO("Game Over");
+                LOG_INFO("Your Score: %d (rank %d of %zu)", arena.snakes[0].score, rank, arena.snakes.size());
+                LOG_INFO("Press R to play again or Escape to quit");
+                gameMetrics.gamesPlayed.add();
+                gameOverShown = true;
+            }
+            frameWorkMs = (static_cast<float>(glfwGetTime()) - frameStart) * 1000.0f;
+            particles.adapt(frameWorkMs, EFFECTS_BUDGET_MS);
+            endGlStatsFrame(now, glStats);
+            {
+                TRACE_SCOPE("swap");
+                glfwSwapBuffers(window);
+            }
+            recordInputLatency();
+            glfwPollEvents();
+            continue;
+        }
         float currentTime = static_cast<float>(glfwGetTime()); // get the current time
         float deltaTime = currentTime - lastMoveTime; // get the time interval (change in time) since last time snake moved
 
+        // Both netplay peers have to tick at the same rate, so the speed keys only work locally
+        float tickInterval = netplay ? game_speed_controller : GAME_SPEED;
+
         // In each frame check whether enough time has passed (and game is not over)
         // to update the position of snake so that the game is playable and not too fast.
-
-        if (deltaTime >= GAME_SPEED && !gameOver) {
-
-            currentDirection = nextDirection; // update current direction
+        // Netplay keeps ticking after a game over until the remote inputs confirm it.
+        if (deltaTime >= tickInterval && (!state.gameOver || netplay)) {
             lastMoveTime = currentTime;       // update last move time to current time
 
-            // Move each segment of the snake by updating its position and direction
-            // Start from the last segment and update its position and direction by
-            // assigning the position and direction of the segment next to the last and so on.
-            for (int i = snake.size() - 1; i > 0; i--) {
-   
-                snake[i].position = snake[i - 1].position;
-                snake[i].direction = snake[i - 1].direction;
-            }
-    
-
-
-
-            // Move the head depending on direction player chooses
-            // Reference to the first element (head) of the snake vector
-            Square& head = snake[0];
-            // Set the head's direction to the current game direction
-            head.direction = currentDirection;
-            // Move the snake head based on the current direction
-            switch (head.direction) {
-            case UP:
-                // Move snake head upward by increasing y-coordinate
-                head.position.y += MOVE_STRIDE;
-                break;
-            case DOWN:
-                // Move snake head downward by decreasing y-coordinate
-                head.position.y -= MOVE_STRIDE;
-                break;
-            case LEFT:
-                // Move snake head to the left by decreasing x-coordinate
-                head.position.x -= MOVE_STRIDE;
-                break;
-            case RIGHT:
-                // Move snake head to the right by increasing x-coordinate
-                head.position.x += MOVE_STRIDE;
-                break;
-            }
-
-            // Check collision with walls; if head collides with wall, game over.
-            if (head.position.x < 0 + WALL_THICKNESS ||             //left wall
-                head.position.x >= windowWIDTH - WALL_THICKNESS ||   //right wall
-                head.position.y < 0 + WALL_THICKNESS - 17.0 ||       //bottom wall
-                head.position.y >= windowHEIGHT - WALL_THICKNESS)   //top wall
+            TickEvents events;
             {
-                gameOver = true;
-            }
-
-            // Check collision with snake's own body:
-            // Iterate over each segment of the body (except head)
-            // and check the distance between the head and selected body segment
-            // If the distance between them is less than the square size (20.0f),
-            // then it means that head and body segment collided each other
-            // In that case, set the game over variable to true to end the game
-            for (size_t i = 1; i < snake.size(); ++i) {
-                // Use GLM distance function to check the distance between head and body segment
-                if (glm::distance(head.position, snake[i].position) < MOVE_STRIDE) {
-                    gameOver = true;
-                    break;
+                TRACE_SCOPE("tick");
+                ALLOCATION_SCOPE(netplay ? ALLOCATIONS_NET : ALLOCATIONS_TICK);
+                double tickStart = glfwGetTime();
+                bool ticked = true;
+                if (netplay) {
+                    // advance() returns false when waiting for the other player; just try again next frame
+                    ticked = session.advance(nextDirection, &events);
                 }
-            }
-            
-           // Check for small food collision
-            if (smallFoodOnScreen && glm::distance(head.position, smallFood.position) < SQUARE_SIZE) {
-                // Add new segment to snake
-                Square newSegment = snake.back();
-                for (int i = 0; i < 25; i++) {
-                    snake.push_back(newSegment);
+                else {
+                    currentDirection = nextDirection; // update current direction
+                    replay.record(&currentDirection);
+                    events = stepGame(game, &currentDirection);
                 }
-                // Increase score and small food counter
-                score++;
-                smallFoodEaten++;
-
-                // Check if it's time for big food
-                if (smallFoodEaten == 3) {
-                    // Time for big food
-                    spawnFood(true);
-                    bigFoodOnScreen = true;
-                    smallFoodOnScreen = false;
-                    smallFoodEaten = 0;  // Reset the counter
+                double tickSeconds = glfwGetTime() - tickStart;
+                if (flightRecorder.tick(tickStart, state.tick, static_cast<float>(tickSeconds * 1000.0))) {
+                    dumpHitch();
                 }
-                else {
-                    // Spawn new small food
-                    spawnFood(false);
-                    smallFoodOnScreen = true;
+                if (ticked) {
+                    gameMetrics.tickTime.record(static_cast<uint64_t>(tickSeconds * 1e6));
+                    gameMetrics.foodEaten.add(events.ateSmallFood || events.ateBigFood ? 1 : 0);
+                    pendingInputTicked = pendingInputAt >= 0.0;
                 }
             }
+            currentDirection = state.snakes[localPlayer].body[0].direction;
 
-            // Check for big food collision
-            if (bigFoodOnScreen && glm::distance(head.position, bigFood.position) < SQUARE_SIZE * 2) {
-                // Add two new segments to snake
-                Square newSegment = snake.back();
-                for (int i = 0; i < 75; i++) {
-                    snake.push_back(newSegment);
-                }
-                // Increase score
-                score += 2;
-
-                // Spawn small food and remove big food
-                spawnFood(false);
-                smallFoodOnScreen = true;
-                bigFoodOnScreen = false;
+            emitTickEffects(particles, events);
+            if (events.foodSpawned) {
+                LOG_INFO("%s Food spawned at: (%g, %g)", events.spawnedBigFood ? "Big" : "Small", events.spawnPosition.x, events.spawnPosition.y);
             }
         }
+        else if (netplay) {
+            // keep acknowledging the other player's inputs between ticks
+            ALLOCATION_SCOPE(ALLOCATIONS_NET);
+            session.poll();
+            session.synchronize();
+        }
 
-        // set the background color
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        
-        // Draw background texture first
-        useBackgroundTexture(shaderProgram, backgroundVAO, backgroundTextureID, projection);
-
-        // Use shader program to render
-        glUseProgram(shaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-        
-        // Bind the VAO
-        glBindVertexArray(squareVAO);
-        
-        // Draw each segment of snake
-        for (int i = 0; i < snake.size(); i++) {
-            if (i == 0) {//this is for the head segment
-                drawSquare(snake[i], shaderProgram, headVAO, true, headTexture, glm::vec3(0.0, 1.0, 0.0));
+        // The board is 800x600; it keeps that shape in any window, with black bars around it
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        // the snakes and food only move on a tick; a rollback can change them without one
+        // a restart starts the ticks from 0 again
+        uint64_t version = combineVersion(static_cast<uint64_t>(state.tick), restarts);
+        if (netplay) {
+            version = combineVersion(version, static_cast<uint64_t>(session.stats().rollbacks));
+        }
+        layers.setVersion(sceneLayer, version);
+        {
+            TRACE_SCOPE("render");
+            ALLOCATION_SCOPE(ALLOCATIONS_RENDER);
+            GPU_TRACE_SCOPE(gpuTrace, "render");
+            {
+                GL_SITE("layers");
+                GPU_TRACE_SCOPE(gpuTrace, "layers");
+                layers.render(resolution, letterbox(framebufferWidth, framebufferHeight, windowWIDTH / windowHEIGHT));
             }
-            else {// body segments
-                drawSquare(snake[i], shaderProgram, squareVAO, true, bodyTexture, glm::vec3(0.0, 1.0, 0.0));
+            const Snake& localSnake = state.snakes[localPlayer];
+            ALLOCATION_SCOPE(ALLOCATIONS_HUD);
+            updateHud(hud, localSnake.score, localSnake.body.size(), 1.0f / tickInterval, hudSample, hudSeconds, resolution, layers);
+            {
+                GL_SITE("hud");
+                GPU_TRACE_SCOPE(gpuTrace, "hud");
+                hud.draw(framebufferWidth, framebufferHeight);
             }
         }
-        // Draw the food depending on which one needs to be rendered
-        if (bigFoodOnScreen == true) {// render big food
-            drawSquare(bigFood, shaderProgram, bigFoodVAO, true, foodTexture, glm::vec3(0.0, 1.0, 0.0));
-            
+
+        // If game over, display "Game Over" message and the score to the console.
+        // A netplay game over only counts once every input that led to it is confirmed,
+        // otherwise a late correction could still undo it.
+        if (state.gameOver && (!netplay || session.confirmedFrames() >= state.tick) && gameOverAt < 0.0f) {
+            gameOverAt = currentTime;
         }
-        else {// otherwise, render small food
-            drawSquare(smallFood, shaderProgram, smallFoodVAO, true, foodTexture, glm::vec3(0.0, 1.0, 0.0));
+        if (gameOverAt >= 0.0f && currentTime - gameOverAt >= GAME_OVER_SECONDS && !gameOverShown) {
+            LOG_INFO("Game Over");
+            if (netplay) {
+                for (size_t s = 0; s < state.snakes.size(); s++) {
+                    LOG_INFO("Player %zu%s Score: %d%s", s + 1, int(s) == localPlayer ? " (you)" : "", state.snakes[s].score,
+                        state.snakes[s].alive ? " - survived" : "");
+                }
+            }
+            else {
+                LOG_INFO("Your Score: %d", state.snakes[0].score);
+            }
+            gameMetrics.gamesPlayed.add();
+            // both netplay peers would have to agree on a new game, so netplay ends here
+            if (netplay) {
+                break;
+            }
+            LOG_INFO("Press R to play again or Escape to quit");
+            gameOverShown = true;
         }
-      
-        // If game over, display "Game Over" message and the score to the console
-        if (gameOver) {
-            std::cerr << "Game Over" << std::endl;
-            std::cerr << "Your Score: " <<score<<std::endl;
-
-            break;
+        frameWorkMs = (static_cast<float>(glfwGetTime()) - frameStart) * 1000.0f;
+        particles.adapt(frameWorkMs, EFFECTS_BUDGET_MS);
+        endGlStatsFrame(currentTime, glStats);
+        {
+            TRACE_SCOPE("swap");
+            glfwSwapBuffers(window);
         }
-        glfwSwapBuffers(window);
+        recordInputLatency();
         glfwPollEvents();
     }
+    // Give the other player a moment to receive our last inputs so it can finish too
+    if (netplay) {
+        double lingerEnd = glfwGetTime() + 0.5;
+        while (glfwGetTime() < lingerEnd) {
+            session.flush();
+            glfwWaitEventsTimeout(0.01);
+        }
+    }
+    if (zeroAlloc) {
+        if (allocatingFrames > 0) {
+            LOG_ERROR("Zero allocation check failed: %llu of %llu frames allocated", (unsigned long long)allocatingFrames,
+                (unsigned long long)checkedFrames);
+        }
+        else {
+            LOG_INFO("Zero allocation check passed: no heap allocations in %llu frames", (unsigned long long)checkedFrames);
+        }
+    }
+    if (recordPath != nullptr && hitchReplay != nullptr) {
+        if (saveReplay(replay, recordPath)) {
+            LOG_INFO("Replay of the last game written to %s", recordPath);
+        }
+        else {
+            LOG_ERROR("Failed to write the replay to %s", recordPath);
+        }
+    }
+    const FrameLayerStats& frames = layers.stats();
+    LOG_INFO("Frames drawn: %llu, shown again unchanged: %llu", (unsigned long long)frames.framesDrawn,
+        (unsigned long long)frames.framesSkipped);
     // Cleanup
-    glDeleteVertexArrays(1, &squareVAO);
-    glDeleteBuffers(1, &squareVBO);
-    glDeleteProgram(shaderProgram);
+    hud.release();
+    particles.release();
+    layers.release();
+    resolution.release();
+    if (arenaMode) {
+        arenaRenderer.release();
+        minimap.release();
+    }
+    classicRenderer.release();
+    if (traceRecording()) {
+        gpuTrace.collect();
+        traceStop();
+        if (traceWrite(tracePath)) {
+            LOG_INFO("Trace written to %s", tracePath);
+        }
+    }
+    gpuTrace.release();
+    metricsServer.stop();
+    glStatsUninstall();
     glfwTerminate();
-    return 0;
+    flightRecorder.finish();
+    reportHitchDump();
+    logShutdown();
+    return zeroAlloc && allocatingFrames > 0 ? 1 : 0;
 }
 
 
@@ -379,6 +756,24 @@ void processInput(GLFWwindow* window) {
     // Static flags to track key press states and prevent multiple triggers
     static bool spacePressed = false;
     static bool ctrlPressed = false;
+    static bool f3Pressed = false;
+    static bool f9Pressed = false;
+    static bool rPressed = false;
+    TRACE_SCOPE("processInput");
+
+    // Escape closes the window, which ends the game
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+        glfwSetWindowShouldClose(window, true);
+    }
+
+    // R starts a new game once the last one is over
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && !rPressed) {
+        rPressed = true;
+        restartRequested = true;
+    }
+    else if (glfwGetKey(window, GLFW_KEY_R) == GLFW_RELEASE) {
+        rPressed = false;
+    }
 
     // Space bar functionality - slow down game speed
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && !spacePressed) {
@@ -414,7 +809,38 @@ void processInput(GLFWwindow* window) {
         }
     }
 
+    // F3 toggles the performance overlay
+    if (glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS && !f3Pressed) {
+        f3Pressed = true;
+        showPerformance = !showPerformance;
+    }
+    else if (glfwGetKey(window, GLFW_KEY_F3) == GLFW_RELEASE) {
+        f3Pressed = false;
+    }
+
+    // F9 starts a trace, and pressed again writes it out
+    if (glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS && !f9Pressed) {
+        f9Pressed = true;
+        if (!traceRecording()) {
+            traceStart();
+            LOG_INFO("Tracing; press F9 again to write %s", tracePath);
+        }
+        else {
+            traceStop();
+            if (traceWrite(tracePath)) {
+                LOG_INFO("Trace written to %s", tracePath);
+            }
+            else {
+                LOG_ERROR("Failed to write the trace to %s", tracePath);
+            }
+        }
+    }
+    else if (glfwGetKey(window, GLFW_KEY_F9) == GLFW_RELEASE) {
+        f9Pressed = false;
+    }
+
     // Directional controls for game movement
+    Direction directionBefore = nextDirection;
     // Up arrow - change direction to UP if not currently moving DOWN
     if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS && currentDirection != DOWN) {
         nextDirection = UP;
@@ -431,333 +857,149 @@ void processInput(GLFWwindow* window) {
     else if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS && currentDirection != LEFT) {
         nextDirection = RIGHT;
     }
+    if (nextDirection != directionBefore) {
+        flightRecorder.input(glfwGetTime(), static_cast<uint8_t>(nextDirection));
+        if (pendingInputAt < 0.0) {
+            pendingInputAt = glfwGetTime();
+        }
+    }
 }
 
 /*
- * This function sets up the vertex buffer objects and vertex array object for the snake segments and food
- * @param squareVAO: reference to the Vertex Array Object for the square
- * @param squareVBO: reference to the Vertex Buffer Object for the square
- * @param isBigFood: boolean flag indicating whether to set up buffers for big food (true) or regular square (false)
-*/
-
-void setupSnakeBuffers(GLuint& squareVAO, GLuint& squareVBO, bool isBigFood) {
-    // Determine the size of the square based on whether it's big food or not
-    float halfSquareSize;
-    if (isBigFood == true) {
-        halfSquareSize = SQUARE_SIZE;
-    
-    } 
-    else{
-        halfSquareSize = SQUARE_SIZE / 2.0;
-    }
-    // Define vertex data for the square, including positions and texture coordinates
-    float vertices[] = {
-        // positions                         // texture coords
-         halfSquareSize,  halfSquareSize, 0.0f,  1.0f, 1.0f,  // top right
-         halfSquareSize, -halfSquareSize, 0.0f,  1.0f, 0.0f,  // bottom right
-        -halfSquareSize, -halfSquareSize, 0.0f,  0.0f, 0.0f,  // bottom left
-        -halfSquareSize,  halfSquareSize, 0.0f,  0.0f, 1.0f   // top left
-    };
-    // Define indices for drawing the square using two triangles
-    unsigned int indices[] = {
-        0, 1, 3,
-        1, 2, 3
-    };
-
-    // Generate and bind Vertex Array Object (VAO) and a buffer
-    glGenVertexArrays(1, &squareVAO);
-    glGenBuffers(1, &squareVBO);
-    GLuint EBO;
-    glGenBuffers(1, &EBO);
-    glBindVertexArray(squareVAO);
-    // bind the VBO
-    glBindBuffer(GL_ARRAY_BUFFER, squareVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    // bind the VBE
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Texture coordinate attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    // Unbind the VBO and VAO to prevent accidental modifications
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-}
-
-/*
-* This function renders a square to the screen after applying transformation
-* @param square: snake segment or food of type Square
-* @param shaderProgram: the integer id of shader program to render the square
-* @param VAO: Vertex Array Object that contains information about the square
+ * This function sends out sparks for what happened during a tick: a small puff for small
+ * food, a bigger one for big food and a red burst where a snake crashed
+ * @param particles: the particle system to emit into
+ * @param events: what the tick reported
 */
 
-void drawSquare(const Square& square, unsigned int shaderProgram, unsigned int VAO, bool useTexture, unsigned int textureID, glm::vec3 color) {
-    // Initialize identity matrix
-    glm::mat4 identity = glm::mat4(1.0f);
-    // Pass the identity matrix to the model matrix to do the translation operation
-    glm::mat4 model = glm::translate(identity, glm::vec3(square.position, 0.0f));
-
-    if (square.direction == UP) {
-        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    }
-    else if (square.direction == DOWN) {
-        model = glm::rotate(model, glm::radians(270.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    }
-    else if (square.direction == RIGHT) {
-        model = glm::rotate(model, glm::radians(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+void emitTickEffects(ParticleSystem& particles, const TickEvents& events) {
+    if (events.ateSmallFood) {
+        particles.emit(events.eatenPosition, 150, 140.0f, 0.5f, 0xFFC040FF);
     }
-    else { // direction LEFT
-        model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    if (events.ateBigFood) {
+        particles.emit(events.eatenPosition, 600, 220.0f, 0.7f, 0xFFE060FF);
     }
-
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-
-
-    // Send the model matrix to the vertex shader 
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    // Get the location of "useTexture" variable in the fragment shader and set the useTexture field to either true or false
-    glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), useTexture);
-    // Get the location of "color" variable in the fragment shader and give it a color
-    glUniform4f(glGetUniformLocation(shaderProgram, "color"), color.x, color.y, color.z, 1.0f);
-
-    // If a food or snake has a texture, then use that texture in the fragment shader and bypass color attribute
-    if (useTexture) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
+    if (events.snakeDied) {
+        particles.emit(events.deathPosition, 2000, 300.0f, 0.9f, 0xFF4030FF);
     }
-
-    glBindVertexArray(VAO);
-    // Draw the square as two triangles
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 6);
 }
 
 /*
- * This function spawns food (either big or small) at a random position on the screen
- * @param isBigFood: boolean flag indicating whether to spawn big food (true) or small food (false)
- */
-
-void spawnFood(bool isBigFood) {
-    // Get the max multiplicative factor of window to allow the food spawn within the window
-
-    glm::vec2 newPosition;
-    bool validPosition;
-    do {
-        //Get the new random position of food.
-        //"% xMax" and "% yMax" allows the new coordinate to stay within window size
-        int newX = int(WALL_THICKNESS + 40.0) + (rand() % (int(windowWIDTH) - 2 * int(WALL_THICKNESS + 2 * SQUARE_SIZE) + 1));
-        int newY = int(WALL_THICKNESS + 40.0) + (rand() % (int(windowHEIGHT) - 2 * int(WALL_THICKNESS + 2 * SQUARE_SIZE) + 1));
-        // Update the new postion of foood
-        newPosition = glm::vec2(newX, newY);
-
-        validPosition = true; // initialize the valid position to true
-
-        // Don't allow the food to spawn on top of the snake
-        for (const auto& segment : snake) {
-            // Check the distance of food with each segment of snake. 
-            // If the distance is less than the segment size (20.0f)
-            // Then, the new position is on top of the snake. In that case, set the validPosition to false,
-            // so that new food position can be re-calculated
-            if (glm::distance(segment.position, newPosition) < SQUARE_SIZE) {
-                validPosition = false;
-                break;
-            }
-        }
-    } while (!validPosition); // if the food wants spawn on top of snake, re-calculate a new position for it
-
-    // Update the food's new position
+ * This function sets the HUD's lines. The score, length and speed are set every frame; the HUD
+ * only rebuilds its glyphs when they change. FPS and the performance overlay change every frame,
+ * so they are only updated when a new sample is taken.
+ * @param score, length: of the local player's snake
+ * @param ticksPerSecond: how fast the game is running
+ * @param sample: whether to update the FPS and performance lines
+ * @param seconds: time since the last sample
+ * @param resolution, layers: where the performance overlay gets its numbers
+*/
 
-    if (isBigFood == true) {
-        bigFood.position = newPosition;
-        std::cout << "Big Food spawned at: (" << newPosition.x << ", " << newPosition.y << ")" << std::endl;
+void updateHud(Hud& hud, int score, size_t length, float ticksPerSecond, bool sample, float seconds, const DynamicResolution& resolution, const FrameLayers& layers) {
+    static uint64_t framesAtSample = 0;
+    static uint64_t skippedAtSample = 0;
+    static uint64_t allocationsAtSample = 0;
+    char line[64];
+    snprintf(line, sizeof(line), "SCORE %d", score);
+    hud.setLine(0, line);
+    snprintf(line, sizeof(line), "LENGTH %zu", length);
+    hud.setLine(1, line);
+    snprintf(line, sizeof(line), "SPEED %.0f/S", ticksPerSecond);
+    hud.setLine(2, line);
+    if (!sample) {
+        return;
     }
-    else {
-        smallFood.position = newPosition;
-        std::cout << "Small Food spawned at: (" << newPosition.x << ", " << newPosition.y << ")" << std::endl;
+    const FrameLayerStats& frames = layers.stats();
+    uint64_t drawn = frames.framesDrawn - framesAtSample, skipped = frames.framesSkipped - skippedAtSample;
+    framesAtSample = frames.framesDrawn;
+    skippedAtSample = frames.framesSkipped;
+    float fps = (drawn + skipped) / seconds;
+    snprintf(line, sizeof(line), "FPS %.0f", fps);
+    hud.setLine(3, line, fps < 55.0f ? HUD_YELLOW : HUD_WHITE);
+    if (!showPerformance) {
+        hud.clearLine(4);
+        hud.clearLine(5);
+        hud.clearLine(6);
+        hud.clearLine(7);
+        return;
     }
+    snprintf(line, sizeof(line), "GPU %.1f MS AT %.0f%%", resolution.gpuMilliseconds(), resolution.scale() * 100.0f);
+    hud.setLine(4, line, resolution.scale() < 1.0f ? HUD_YELLOW : HUD_WHITE);
+    snprintf(line, sizeof(line), "REUSED %llu OF %llu FRAMES", (unsigned long long)skipped, (unsigned long long)(drawn + skipped));
+    hud.setLine(5, line);
+    if (glStatsInstalled()) {
+        const GlFrameReport& gl = glStatsLastFrame();
+        snprintf(line, sizeof(line), "DRAWS %u UNIFORMS %u REDUNDANT %u", gl.draws, gl.uniformUploads + gl.uniformLookups,
+            gl.redundantBinds + gl.redundantUniforms);
+        hud.setLine(6, line, gl.redundantBinds + gl.redundantUniforms > 0 ? HUD_YELLOW : HUD_WHITE);
+    }
+    uint64_t allocations = allocationCounts().allocations;
+    uint64_t allocated = allocations - allocationsAtSample;
+    allocationsAtSample = allocations;
+    snprintf(line, sizeof(line), "ALLOCATIONS %.1f PER FRAME", static_cast<double>(allocated) / std::max<uint64_t>(1, drawn + skipped));
+    hud.setLine(7, line, allocated > 0 ? HUD_YELLOW : HUD_WHITE);
 }
 
 /*
- * This function sets up the vertex buffer objects and vertex array object for the background texture
- * @param backgroundVAO: reference to the Vertex Array Object for the background
- * @param backgroundVBO: reference to the Vertex Buffer Object for the background
-*/
-
-void setupBackgroundBuffers(GLuint& backgroundVAO, GLuint& backgroundVBO) {
-    // Wall vertices (outline of the game window)
-    /*
-        Texture coordinate for background that covers the entire screen
-        It forms two triangles with 3 vertices, each with its texture coordinates
-    */
-
-    float backgroundVertices[] = {
-    0.0f, 0.0f, 0.0f, 0.0f,        // Bottom-left
-    windowWIDTH, 0.0f, 1.0f, 0.0f, // Bottom-right
-    windowWIDTH, windowHEIGHT, 1.0f, 1.0f, // Top-right
-    0.0f, windowHEIGHT, 0.0f, 1.0f // Top-left
-    };
-
-    // Generate the VAO and VBO
-    glGenVertexArrays(1, &backgroundVAO);
-    glGenBuffers(1, &backgroundVBO);
-
-    // Bind the VAO
-    glBindVertexArray(backgroundVAO);
-
-    // Bind the VBO and set the buffer data
-    glBindBuffer(GL_ARRAY_BUFFER, backgroundVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(backgroundVertices), backgroundVertices, GL_STATIC_DRAW);
-
-    // Set up vertex attribute pointers
-    // first 2 elements in the background vertex is for position
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // second 2 elements in the background vertex is for texture
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    // Unbind the VBO and VAO to avoid accidental modifications
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-}
-
-/*
- * This function renders the background texture to the screen
- * @param shaderProgram: the integer id of shader program to render the background
- * @param backgroundVAO: Vertex Array Object that contains information about the background quad
- * @param backgroundTextureID: the ID of the background texture to be rendered
- * @param projection: the projection matrix for transforming coordinates
+ * This function closes the frame for the GL call counts when --gl-stats or --metrics is on,
+ * adds its draws to the metrics, and logs the last frame's report every few seconds
+ * @param now: the current time in seconds
+ * @param log: whether to log the report (--gl-stats)
 */
 
-void useBackgroundTexture(unsigned int shaderProgram, GLuint backgroundVAO, unsigned int backgroundTextureID, glm::mat4 projection) {
-
-    glm::mat4 backgroundModel = glm::mat4(1.0f);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(backgroundModel));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-    glBindVertexArray(backgroundVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, backgroundTextureID);
-    glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-    glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), GL_TRUE);
-
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-    glBindVertexArray(0);
+void endGlStatsFrame(float now, bool log) {
+    static float loggedAt = 0.0f;
+    if (!glStatsInstalled()) {
+        return;
+    }
+    glStatsEndFrame();
+    gameMetrics.drawCalls.add(glStatsLastFrame().draws);
+    if (!log || now - loggedAt < GL_STATS_LOG_SECONDS) {
+        return;
+    }
+    loggedAt = now;
+    for (const std::string& line : glStatsFormat(glStatsLastFrame())) {
+        LOG_INFO("GL: %s", line);
+    }
 }
 
 /*
-* This function helps with creating shader program
-* @param vertexSource: vertex shader source code
-* @param fragmentSource: fragment shader source code
-* @return program: integer id of shader program
+ * This function records the input latency of the oldest direction key waiting to be shown,
+ * once a tick has taken it and this frame, which shows the result, has been swapped
 */
 
-unsigned int createShaderProgram(const char* vertexSource, const char* fragmentSource) {
-    // Compile the shader source codes
-    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
-    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
-    unsigned int program = glCreateProgram();
-    // Attach each shader to the program
-    glAttachShader(program, vertexShader);
-    glAttachShader(program, fragmentShader);
-    // Link the vertex and fragment shaders to the program
-    glLinkProgram(program);
-    int success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    // If linking wasn't successful, print an error message
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(program, 512, nullptr, infoLog);
-        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-    //After the linking, we can delete the now useless compiled shaders
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    // Return the id (int) of program
-    return program;
+void recordInputLatency() {
+    if (!pendingInputTicked) {
+        return;
+    }
+    gameMetrics.inputLatency.record(static_cast<uint64_t>((glfwGetTime() - pendingInputAt) * 1e6));
+    pendingInputAt = -1.0;
+    pendingInputTicked = false;
 }
 
 /*
-* This function is used inside createShaderProgram to compile the shader source codes
-* @param type: type of shader: fragment or vertex
-* @return id: return the id of compiled shader
+ * This function logs a frame that allocated during --zero-alloc, with what each subsystem
+ * allocated
 */
 
-unsigned int compileShader(unsigned int type, const char* source) {
-    unsigned int id = glCreateShader(type);
-    glShaderSource(id, 1, &source, nullptr);
-    // Compile the shader course code and assign it an int value
-    glCompileShader(id);
-    int success;
-    glGetShaderiv(id, GL_COMPILE_STATUS, &success);
-    // If the compilation is not successful, print an error message
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(id, 512, nullptr, infoLog);
-        std::cerr << "ERROR::SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-    // Return the id (integer) of compiled shader
-    return id;
+void logFrameAllocations(const AllocationFrame& allocations) {
+    char line[256];
+    int length = snprintf(line, sizeof(line), "Frame allocated %llu times:", (unsigned long long)allocations.total);
+    for (int i = 0; i < ALLOCATION_SUBSYSTEMS && length < static_cast<int>(sizeof(line)); i++) {
+        if (allocations.allocations[i] > 0) {
+            length += snprintf(line + length, sizeof(line) - length, " %s %llu (%llu bytes)", allocationSubsystemName(static_cast<AllocationSubsystem>(i)),
+                (unsigned long long)allocations.allocations[i], (unsigned long long)allocations.bytes[i]);
+        }
+    }
+    LOG_ERROR("%s", line);
 }
 
 /*
-* This function loads a texture from a user provided file path and generates an int texture ID
-* @param path: path to the texture to be loaded as string
-* @return textureID: texture ID of loaded texture
+* This function is called when the mouse wheel turns; it zooms the arena camera
+* @param yoffset: wheel steps, positive when turned away from the user
 */
-
-unsigned int loadTexture(char const* path)
-{
-    // variable to hold the textureID
-    unsigned int textureID;
-    stbi_set_flip_vertically_on_load(true);
-    // Generate a texture object with its ID as well
-    glGenTextures(1, &textureID);
-
-    // Variables to hold texture dimensions and component count
-    int width, height, nrComponents;
-    // Load the texture data
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-
-    if (data) // Check if the texture data was loaded witout any issues
-    {
-        // Determine the format based on the number of components
-        GLenum format = GL_RGB; //rgb is the default
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        // Set the texture image data
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        // create a mipmaps for the texture
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        // Set the texture wrapping and filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        // Free the loaded image data
-        stbi_image_free(data);
-    }
-    else // Handle loading failure
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-        return 0;
-    }
-    //return the texture ID
-    return textureID;
+void scroll_callback([[maybe_unused]] GLFWwindow* window, [[maybe_unused]] double xoffset, double yoffset) {
+    arenaCamera.zoomBy(static_cast<float>(std::pow(1.1, yoffset)));
 }
 
 /*